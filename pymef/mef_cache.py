@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# -----------------------------------------------------------------------------
+# Copyright (c) Jan Cimbalnik, Matt Stead, Ben Brinkmann, and Dan Crepeau.
+# All Rights Reserved.
+# Distributed under the (new) BSD License. See LICENSE.txt for more info.
+# -----------------------------------------------------------------------------
+
+# Standard library imports
+import os
+import json
+import shutil
+
+# Third party imports
+import numpy as np
+from numpy.lib import recfunctions
+
+CACHE_VERSION = 4
+CACHE_DIR_NAME = '.pymef_cache'
+
+# section 2 fields used by MefSession.read_ts_channel_basic_info, the rest of
+# the protected metadata (and section 3 as a whole) is never cached
+CACHE_SECTION_2_FIELDS = ['sampling_frequency', 'number_of_samples',
+                          'units_conversion_factor', 'units_description',
+                          'channel_description']
+
+# files whose contents end up in the cache
+CACHE_KEY_EXTENSIONS = ['tmet', 'tidx', 'vmet', 'vidx', 'ridx', 'rdat']
+
+
+class MefMetadataCache():
+    """
+    Sidecar cache of the time series channel metadata of a session. The
+    channel TOCs, start/end times and the few section 2 fields of the
+    channel basic info are stored as flat numpy files that are memory
+    mapped when the cache is loaded. The section 2 fields are level 1
+    protected in the session but stored unencrypted, the cache directory
+    is therefore created accessible to its owner only. The cache is valid
+    as long as the version and the password access level match and no
+    metadata, indices or records file of the session changed size or
+    modification time.
+
+    Parameters
+    ----------
+    session_path: str
+        path to mef session
+    cache_path: str
+        directory of the cache (default=None - hidden directory inside
+        the session)
+    access_level: int
+        access level of the session password (1 or 2), a cache written
+        with one level is not served to the other (default=None)
+    """
+
+    def __init__(self, session_path, cache_path=None, access_level=None):
+
+        if not session_path.endswith('/'):
+            session_path += '/'
+
+        if cache_path is None:
+            cache_path = session_path + CACHE_DIR_NAME
+        if not cache_path.endswith('/'):
+            cache_path += '/'
+
+        self.session_path = session_path
+        self.path = cache_path
+        self.access_level = access_level
+
+        self._channels = None
+        self._toc = None
+        self._section_2 = None
+        self._times = None
+
+    # ----- Helper functions -----
+    def _file_key(self):
+        """
+        Returns relative path, size and modification time of the metadata,
+        indices and records files of the session.
+        """
+        key = []
+        for path, subdirs, files in os.walk(self.session_path):
+            subdirs[:] = sorted(x for x in subdirs if not x.startswith('.'))
+            for name in sorted(files):
+                if name.rsplit('.', 1)[-1] not in CACHE_KEY_EXTENSIONS:
+                    continue
+                file_path = os.path.join(path, name)
+                stat = os.stat(file_path)
+                key.append([os.path.relpath(file_path, self.session_path),
+                            stat.st_size, stat.st_mtime_ns])
+        return key
+
+    # ----- Cache operations -----
+    def load(self):
+        """
+        Loads the cache if it is valid for the current session files.
+
+        Returns
+        -------
+        valid: bool
+            True if the cache was loaded
+        """
+        self._channels = None
+
+        try:
+            with open(self.path + 'manifest.json', 'r') as f:
+                manifest = json.load(f)
+        except (OSError, ValueError):
+            return False
+
+        if manifest.get('version') != CACHE_VERSION:
+            return False
+        if manifest.get('access_level') != self.access_level:
+            return False
+        if manifest.get('key') != self._file_key():
+            return False
+
+        try:
+            self._toc = np.load(self.path + 'toc.npy', mmap_mode='r')
+            self._section_2 = np.load(self.path + 'section_2.npy',
+                                      mmap_mode='r')
+            self._times = np.load(self.path + 'times.npy', mmap_mode='r')
+        except (OSError, ValueError):
+            return False
+
+        self._channels = manifest['channels']
+        return True
+
+    def write(self, session_md, toc_func):
+        """
+        Writes the cache for the metadata of a read session.
+
+        Parameters
+        ----------
+        session_md: dict
+            Session metadata with all time series channels
+        toc_func: callable
+            Returns the TOC of a channel
+        """
+        key = self._file_key()
+
+        ts_channels = session_md.get('time_series_channels', {})
+        names = sorted(ts_channels.keys())
+
+        channels = {}
+        tocs = []
+        section_2 = []
+        times = np.zeros([len(names), 2], dtype='int64')
+        n_blocks = 0
+        for i, channel in enumerate(names):
+            channel_md = ts_channels[channel]
+            toc = toc_func(channel)
+            channels[channel] = [i, n_blocks, toc.shape[1]]
+            n_blocks += toc.shape[1]
+            tocs.append(toc)
+            section_2.append(recfunctions.repack_fields(
+                np.array(channel_md['section_2'])[CACHE_SECTION_2_FIELDS]))
+            spec_md = channel_md['channel_specific_metadata']
+            times[i] = [spec_md['earliest_start_time'][0],
+                        spec_md['latest_end_time'][0]]
+
+        if not len(names):
+            return
+
+        # the manifest is written last, a cache without it is not valid
+        os.makedirs(self.path, mode=0o700, exist_ok=True)
+        if os.path.exists(self.path + 'manifest.json'):
+            os.remove(self.path + 'manifest.json')
+
+        np.save(self.path + 'toc.npy', np.concatenate(tocs, axis=1))
+        np.save(self.path + 'section_2.npy', np.concatenate(section_2))
+        np.save(self.path + 'times.npy', times)
+
+        tmp_path = self.path + 'manifest.json.tmp'
+        with open(tmp_path, 'w') as f:
+            json.dump({'version': CACHE_VERSION,
+                       'access_level': self.access_level, 'key': key,
+                       'channels': channels}, f)
+        os.replace(tmp_path, self.path + 'manifest.json')
+
+        self.load()
+
+    def clear(self):
+        """
+        Removes the cache directory.
+        """
+        self._channels = None
+        self._toc = None
+        self._section_2 = None
+        self._times = None
+        if os.path.exists(self.path):
+            shutil.rmtree(self.path)
+
+    # ----- Cached metadata -----
+    @property
+    def valid(self):
+        return self._channels is not None
+
+    def has_channel(self, channel):
+        return self.valid and channel in self._channels
+
+    def get_channel_toc(self, channel, ranges_only=False):
+        """
+        Returns the cached TOC of the channel, see
+        MefSession.get_channel_toc.
+        """
+        _, first, n_blocks = self._channels[channel]
+        toc = self._toc[:, first:first+n_blocks]
+        if not ranges_only:
+            return toc
+
+        fs = self.get_section_2(channel)['sampling_frequency'][0]
+        # the first block of every segment is flagged, it starts a range
+        # only if it does not follow the previous block
+        flagged = np.where(toc[0, 1:] == 1)[0] + 1
+        time_diff = ((toc[3, flagged] - toc[3, flagged - 1])
+                     - (1e6 * (toc[2, flagged] - toc[2, flagged - 1])) / fs)
+        gaps = time_diff.astype('int64') >= int(1e6 / fs)
+        starts = np.concatenate([[0], flagged[gaps]]).astype('int64')
+        if not toc.shape[1]:
+            return np.empty([3, 0], dtype='int64')
+        lasts = np.concatenate([starts[1:], [toc.shape[1]]]) - 1
+        ranges = np.empty([3, len(starts)], dtype='int64')
+        ranges[0] = toc[3, starts]
+        ranges[1] = toc[3, lasts] + ((toc[1, lasts] / fs) * 1e6).astype('int64')
+        ranges[2] = np.add.reduceat(toc[1], starts)
+        return ranges
+
+    def get_section_2(self, channel):
+        i = self._channels[channel][0]
+        return self._section_2[i:i+1]
+
+    def get_times(self, channel):
+        """
+        Returns earliest start and latest end time of the channel.
+        """
+        i = self._channels[channel][0]
+        return self._times[i]
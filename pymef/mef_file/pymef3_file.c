@@ -118,12 +118,6 @@ static PyObject *write_mef_data_records(PyObject *self, PyObject *args) {
         Py_RETURN_NONE;
     }
 
-    // initialize MEF library
-    (void) initialize_meflib();
-
-    // Apply recording offset
-    MEF_globals->recording_time_offset = recording_time_offset;
-
     // password entries
     if (PyUnicode_Check(py_pass_1_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_pass_1_obj, "utf-8", "strict"); // Encode to UTF-8 python objects
@@ -167,9 +161,9 @@ static PyObject *write_mef_data_records(PyObject *self, PyObject *args) {
     uh->start_time = recording_start_uutc_time;
     uh->end_time = recording_stop_uutc_time;
 
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     gen_fps->password_data = process_password_data(NULL, level_1_password, level_2_password, uh);
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
 
     // Check for directory type
     // Segment level
@@ -382,8 +376,13 @@ static PyObject *write_mef_data_records(PyObject *self, PyObject *args) {
     rec_data_fps->universal_header->maximum_entry_size = max_rec_bytes + RECORD_HEADER_BYTES;
     rec_data_fps->directives.io_bytes = file_offset;
 
+    // Apply recording offset
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(recording_time_offset, MEF_FALSE);
+    Py_END_ALLOW_THREADS
     write_MEF_file(rec_data_fps);
     write_MEF_file(rec_idx_fps);
+    unlock_mef_globals_c();
     free_file_processing_struct(rec_data_fps);
     free_file_processing_struct(rec_idx_fps);
     free_file_processing_struct(gen_fps);
@@ -425,9 +424,6 @@ static PyObject *write_mef_ts_metadata(PyObject *self, PyObject *args) {
         return NULL;
     }
 
-    // initialize MEF library
-    (void) initialize_meflib();
-
     // password entries
     if (PyUnicode_Check(py_pass_1_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_pass_1_obj, "utf-8", "strict"); // Encode to UTF-8 python objects
@@ -471,9 +467,9 @@ static PyObject *write_mef_ts_metadata(PyObject *self, PyObject *args) {
     uh->start_time = recording_start_uutc_time;
     uh->end_time = recording_stop_uutc_time;
     
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     gen_fps->password_data = process_password_data(NULL, level_1_password, level_2_password, uh);
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
 
     // Check for directory type
     extract_path_parts(py_file_path, path_out, name, type);
@@ -530,9 +526,11 @@ static PyObject *write_mef_ts_metadata(PyObject *self, PyObject *args) {
     map_python_md3(py_md3_dict, metadata_fps->metadata.section_3);
 
     // Assign recording_time_offset
-    MEF_globals->recording_time_offset = metadata_fps->metadata.section_3->recording_time_offset;
-
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(metadata_fps->metadata.section_3->recording_time_offset, MEF_FALSE);
+    Py_END_ALLOW_THREADS
     write_MEF_file(metadata_fps);
+    unlock_mef_globals_c();
     free_file_processing_struct(metadata_fps);
     free_file_processing_struct(gen_fps);
 
@@ -573,9 +571,6 @@ static PyObject *write_mef_v_metadata(PyObject *self, PyObject *args) {
         return NULL;
     }
 
-    // initialize MEF library
-    (void) initialize_meflib();
-
     // password entries
     if (PyUnicode_Check(py_pass_1_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_pass_1_obj, "utf-8", "strict"); // Encode to UTF-8 python objects
@@ -619,9 +614,9 @@ static PyObject *write_mef_v_metadata(PyObject *self, PyObject *args) {
     uh->start_time = recording_start_uutc_time;
     uh->end_time = recording_stop_uutc_time;
     
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     gen_fps->password_data = process_password_data(NULL, level_1_password, level_2_password, uh);
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
 
     // Check for directory type
     extract_path_parts(py_file_path, path_out, name, type);
@@ -677,9 +672,11 @@ static PyObject *write_mef_v_metadata(PyObject *self, PyObject *args) {
     map_python_md3(py_md3_dict, metadata_fps->metadata.section_3);
 
     // Apply recording offset
-    MEF_globals->recording_time_offset = metadata_fps->metadata.section_3->recording_time_offset;
-
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(metadata_fps->metadata.section_3->recording_time_offset, MEF_FALSE);
+    Py_END_ALLOW_THREADS
     write_MEF_file(metadata_fps);
+    unlock_mef_globals_c();
 
     free_file_processing_struct(metadata_fps);
     free_file_processing_struct(gen_fps);
@@ -693,6 +690,7 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     si1    *py_file_path;
     PyObject    *py_pass_1_obj, *py_pass_2_obj;
     si4    lossy_flag;
+    si4    n_threads;
     si4    array_type;
     
     PyObject *temp_UTF_str;
@@ -704,8 +702,9 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     FILE_PROCESSING_STRUCT  *gen_fps, *metadata_fps, *ts_idx_fps, *ts_data_fps;
     TIME_SERIES_METADATA_SECTION_2  *tmd2;
     TIME_SERIES_INDEX   *tsi;
-    RED_PROCESSING_STRUCT   *rps;
     RED_BLOCK_HEADER    *block_header;
+    RED_ENCODE_WORKER   *workers;
+    ui1     *batch_blocks;
 
     si1     level_1_password_arr[PASSWORD_BYTES] = {0};
     si1     level_2_password_arr[PASSWORD_BYTES] = {0};
@@ -716,34 +715,56 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     si1     path_in[MEF_FULL_FILE_NAME_BYTES], path_out[MEF_FULL_FILE_NAME_BYTES], name[MEF_BASE_FILE_NAME_BYTES], type[TYPE_BYTES];
     si1     full_file_name[MEF_FULL_FILE_NAME_BYTES], file_path[MEF_FULL_FILE_NAME_BYTES], segment_name[MEF_BASE_FILE_NAME_BYTES];
     si4     max_samp, min_samp;
-    ui4     block_samps;
-    si8     start_sample, ts_indices_file_bytes, samps_remaining, file_offset;
-    si8     curr_time, time_inc;
+    si4     i;
+    si8     start_sample, ts_indices_file_bytes, file_offset;
+    si8     time_inc, block_idx, batch_n_blocks, max_batch_blocks, slot_bytes;
+    si8     n_clipped, data_stride;
+    sf8     scale;
+    si4     convert_data;
+    PyObject    *py_lossy_params;
+    RED_LOSSY_PARAMS    lossy_params;
+    PyObject    *py_report, *py_value_obj;
+    PyArrayObject   *py_block_ratios, *py_block_residuals;
+    npy_intp    dims[1];
+    sf8     *block_ratios, *block_residuals, *batch_residuals;
+    sf8     bytes_per_sample;
+    si8     target_block_bytes, min_block_samps, max_block_samps;
+    si8     *block_starts;
 
     // Optional arguments
     lossy_flag = 0; // default - no lossy compression
+    n_threads = 0;  // default - number of CPUs
+    scale = 1.0;
+    py_lossy_params = NULL;
+    target_block_bytes = -1;    // default - fixed blocks of samps_per_mef_block
 
     // --- Parse the input --- 
-    if (!PyArg_ParseTuple(args,"sOOLO|i",
+    if (!PyArg_ParseTuple(args,"sOOLO|iidOL",
                           &py_file_path, // full path including segment
                           &py_pass_1_obj,
                           &py_pass_2_obj,
                           &samps_per_mef_block,
                           &raw_data,
-                          &lossy_flag)){
+                          &lossy_flag,
+                          &n_threads,
+                          &scale,
+                          &py_lossy_params,
+                          &target_block_bytes)){
         return NULL;
     }
 
-    // check raw_data data type, convert if necessary
-    array_type = PyArray_TYPE(raw_data);
-    if (array_type != NPY_INT32) {
-        PyErr_SetString(PyExc_RuntimeError, "Incorrect data type. Please convert your NumPy array to Int32 data type!");
+    if (parse_lossy_params_c(py_lossy_params, &lossy_params) < 0)
+        return NULL;
+
+    // check raw_data data type - other types than contiguous int32 are converted block by block
+    array_type = writer_sample_type_c((PyObject *) raw_data);
+    if (array_type < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Incorrect data type. Please provide 1D integer or float NumPy array in native byte order!");
         PyErr_Occurred();
         return NULL;
     }
-
-    // initialize MEF library
-    (void) initialize_meflib();
+    data_stride = (si8) PyArray_STRIDES(raw_data)[0];
+    convert_data = (array_type != NPY_INT32 || data_stride != sizeof(si4) || scale != 1.0);
 
     // password entries
     if (PyUnicode_Check(py_pass_1_obj)) {
@@ -784,9 +805,9 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     // set up a generic mef3 fps and process the password data with it
     gen_fps = allocate_file_processing_struct(UNIVERSAL_HEADER_BYTES, NO_FILE_TYPE_CODE, NULL, NULL, 0);
     initialize_universal_header(gen_fps, MEF_TRUE, MEF_FALSE, MEF_TRUE);
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     pwd = process_password_data(NULL, level_1_password, level_2_password, gen_fps->universal_header);
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
 
     // extract the segment name and check the firectory-type (if indeed segment)
     MEF_strncpy(file_path, py_file_path, MEF_FULL_FILE_NAME_BYTES);
@@ -830,9 +851,6 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     MEF_snprintf(full_file_name, MEF_FULL_FILE_NAME_BYTES, "%s/%s.%s", file_path, segment_name, TIME_SERIES_METADATA_FILE_TYPE_STRING);
     metadata_fps = read_MEF_file(NULL, full_file_name, level_1_password, pwd, NULL, USE_GLOBAL_BEHAVIOR);
 
-    // 
-    MEF_globals->recording_time_offset = metadata_fps->metadata.section_3->recording_time_offset;
-
 
     //
     // Point to and update the time-series section 2 of the metadata struct (from the .tmet file)
@@ -851,6 +869,31 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     tmd2->number_of_blocks = (si8) ceil((sf8) tmd2->number_of_samples / (sf8) samps_per_mef_block);
     tmd2->maximum_block_samples = (ui4) samps_per_mef_block;       
 
+    // adaptive blocks of up to samps_per_mef_block samples, the longest block chosen is recorded in the metadata
+    block_starts = NULL;
+    if (target_block_bytes >= 0) {
+        min_block_samps = samps_per_mef_block / ADAPTIVE_MIN_BLOCK_FRACTION;
+        if (min_block_samps < 1)
+            min_block_samps = 1;
+        block_starts = (si8 *) malloc((size_t) ((tmd2->number_of_samples / min_block_samps + 2) * sizeof(si8)));
+        if (block_starts == NULL) {
+            free_file_processing_struct(metadata_fps);
+            free_file_processing_struct(gen_fps);
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        tmd2->number_of_blocks = plan_adaptive_blocks_c((ui1 *) PyArray_BYTES(raw_data), data_stride, array_type, scale, tmd2->number_of_samples,
+                                                        target_block_bytes, min_block_samps, samps_per_mef_block, block_starts);
+        Py_END_ALLOW_THREADS
+        max_block_samps = 0;
+        for (block_idx = 0; block_idx < tmd2->number_of_blocks; block_idx++)
+            if (block_starts[block_idx + 1] - block_starts[block_idx] > max_block_samps)
+                max_block_samps = block_starts[block_idx + 1] - block_starts[block_idx];
+        tmd2->maximum_block_samples = (ui4) max_block_samps;
+    }
+
 
     // 
     // Set up a file-processing-struct and universal-header for the time-series indices (file)
@@ -881,7 +924,12 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     // generate/update the ts-data file uuid and set some of the entries fields
     generate_UUID(ts_data_uh->file_UUID);
     ts_data_uh->number_of_entries = tmd2->number_of_blocks;
-    ts_data_uh->maximum_entry_size = samps_per_mef_block;
+    ts_data_uh->maximum_entry_size = tmd2->maximum_block_samples;
+
+    // RED_encode() and write_MEF_file() apply the recording time offset from MEF_globals, held until the files are written
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(metadata_fps->metadata.section_3->recording_time_offset, MEF_FALSE);
+    Py_END_ALLOW_THREADS
 
     // write the universal header of the ts-data file
     ts_data_fps->directives.io_bytes = UNIVERSAL_HEADER_BYTES;
@@ -893,78 +941,137 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
     //
     //
 
-    // TODO optional filtration
-    // use allocation below if lossy
-    if (lossy_flag == 1) {
-        rps = RED_allocate_processing_struct(samps_per_mef_block, 0, samps_per_mef_block, RED_MAX_DIFFERENCE_BYTES(samps_per_mef_block), samps_per_mef_block, samps_per_mef_block, pwd);
-        // ASK RED lossy compression user specified???
-        rps->compression.mode = RED_MEAN_RESIDUAL_RATIO;
-        rps->directives.detrend_data = MEF_TRUE;
-        rps->directives.require_normality = MEF_TRUE;
-        rps->compression.goal_mean_residual_ratio = 0.10;
-        rps->compression.goal_tolerance = 0.01;
-    } else {
-        rps = RED_allocate_processing_struct(samps_per_mef_block, 0, 0, RED_MAX_DIFFERENCE_BYTES(samps_per_mef_block), 0, 0, pwd);
+    // Blocks are independent - they are encoded in parallel in batches, each worker with its own
+    // RED processing struct, and written, indexed and CRC'd in order by this thread
+    if (n_threads <= 0)
+        n_threads = get_cpu_count_c();
+    if ((si8) n_threads > tmd2->number_of_blocks)
+        n_threads = (si4) tmd2->number_of_blocks;
+    if (n_threads < 1)
+        n_threads = 1;
+
+    slot_bytes = RED_MAX_COMPRESSED_BYTES(samps_per_mef_block, 1);
+    max_batch_blocks = (si8) n_threads * RED_ENCODE_BATCH_BLOCKS;
+    if (max_batch_blocks > tmd2->number_of_blocks)
+        max_batch_blocks = tmd2->number_of_blocks;
+
+    // compression report
+    dims[0] = (npy_intp) tmd2->number_of_blocks;
+    py_block_ratios = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+    py_block_residuals = NULL;
+    if (lossy_flag == 1)
+        py_block_residuals = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+
+    workers = (RED_ENCODE_WORKER *) calloc((size_t) n_threads, sizeof(RED_ENCODE_WORKER));
+    batch_blocks = (ui1 *) calloc((size_t) (max_batch_blocks + 1), (size_t) slot_bytes);
+    batch_residuals = (sf8 *) calloc((size_t) (max_batch_blocks + 1), sizeof(sf8));
+    if ((workers == NULL) || (batch_blocks == NULL) || (batch_residuals == NULL) ||
+        (py_block_ratios == NULL) || ((lossy_flag == 1) && (py_block_residuals == NULL))) {
+        unlock_mef_globals_c();
+        Py_XDECREF(py_block_ratios);
+        Py_XDECREF(py_block_residuals);
+        free (workers);
+        free (batch_blocks);
+        free (batch_residuals);
+        free (block_starts);
+        fclose(ts_data_fps->fp);
+        free_file_processing_struct(metadata_fps);
+        free_file_processing_struct(ts_data_fps);
+        free_file_processing_struct(ts_idx_fps);
+        free_file_processing_struct(gen_fps);
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+    for (i = 0; i < n_threads; i++) {
+        workers[i].rps = allocate_encoder_rps_c(samps_per_mef_block, (lossy_flag == 1) ? &lossy_params : NULL, pwd);
+        workers[i].residual_ratios = (lossy_flag == 1) ? batch_residuals : NULL;
+        workers[i].blocks = batch_blocks;
+        workers[i].slot_bytes = slot_bytes;
+        workers[i].block_samps = (ui4) samps_per_mef_block;
+        workers[i].first_block = i;
+        workers[i].block_step = n_threads;
+        if (convert_data) {
+            workers[i].src_stride = data_stride;
+            workers[i].src_type = array_type;
+            workers[i].scale = scale;
+            workers[i].conv_buffer = (si4 *) malloc((size_t) (samps_per_mef_block * sizeof(si4)));
+        }
     }
-
-    rps->block_header = (RED_BLOCK_HEADER *) (rps->compressed_data = ts_data_fps->RED_blocks);
 
     // create new RED blocks
-    curr_time = metadata_fps->universal_header->start_time;
     time_inc = (si8) (((sf8) samps_per_mef_block / tmd2->sampling_frequency) * (sf8) 1e6);
-    samps_remaining = tmd2->number_of_samples;
-    block_header = rps->block_header;
     tsi = ts_idx_fps->time_series_indices;
     min_samp = RED_POSITIVE_INFINITY;
     max_samp = RED_NEGATIVE_INFINITY;
-    block_samps = (ui4) samps_per_mef_block;
     file_offset = UNIVERSAL_HEADER_BYTES;
 
     start_sample = 0;
 
-    // Write the data and update the metadata
-    while (samps_remaining) {
+    block_ratios = (sf8 *) PyArray_DATA(py_block_ratios);
+    block_residuals = (py_block_residuals != NULL) ? (sf8 *) PyArray_DATA(py_block_residuals) : NULL;
 
-        // check
-        if (samps_remaining < block_samps)
-            block_samps = (ui4) samps_remaining;
-		
-        block_header->number_of_samples = block_samps;
-        block_header->start_time = (si8) (curr_time + 0.5); // ASK Why 0.5 here?
-        curr_time += time_inc;
-        
-        rps->original_data = rps->original_ptr = (si4 *) PyArray_DATA(raw_data) + (tmd2->number_of_samples - samps_remaining);
+    // Write the data and update the metadata
+    for (block_idx = 0; block_idx < tmd2->number_of_blocks; block_idx += batch_n_blocks) {
 
-        // filter - comment out if don't want
-        // filtps->data_length = block_samps;
-        // RED_filter(filtps);
+        batch_n_blocks = tmd2->number_of_blocks - block_idx;
+        if (batch_n_blocks > max_batch_blocks)
+            batch_n_blocks = max_batch_blocks;
 
-        samps_remaining -= (si8) block_samps;
+        // first sample of the batch
+        start_sample = (block_starts != NULL) ? block_starts[block_idx] : block_idx * samps_per_mef_block;
+        for (i = 0; i < n_threads; i++) {
+            if (convert_data)
+                workers[i].src = (ui1 *) PyArray_BYTES(raw_data) + (start_sample * data_stride);
+            else
+                workers[i].data = (si4 *) PyArray_DATA(raw_data) + start_sample;
+            workers[i].tsi = tsi;
+            workers[i].n_blocks = batch_n_blocks;
+            workers[i].n_samples = tmd2->number_of_samples - start_sample;
+            if (block_starts != NULL) {
+                workers[i].block_starts = block_starts + block_idx;
+                workers[i].sampling_frequency = tmd2->sampling_frequency;
+                workers[i].start_time = metadata_fps->universal_header->start_time;
+            } else {
+                workers[i].start_time = metadata_fps->universal_header->start_time + (block_idx * time_inc);
+            }
+            workers[i].time_inc = time_inc;
+            // only the first block of the segment is a discontinuity
+            workers[i].discontinuity = (block_idx == 0);
+        }
 
         // compress
-        (void) RED_encode(rps);
-        ts_data_fps->universal_header->body_CRC = CRC_update((ui1 *) block_header, block_header->block_bytes, ts_data_fps->universal_header->body_CRC);
-        e_fwrite((void *) block_header, sizeof(ui1), block_header->block_bytes, ts_data_fps->fp, ts_data_fps->full_file_name, __FUNCTION__, __LINE__, EXIT_ON_FAIL);
-
-        // time series indices
-        tsi->file_offset = file_offset;
-        file_offset += (tsi->block_bytes = block_header->block_bytes);
-        tsi->start_time = block_header->start_time;
-        tsi->start_sample = start_sample;
-        start_sample += (tsi->number_of_samples = (si8) block_samps);
-        RED_find_extrema(rps->original_ptr, block_samps, tsi);
-        if (max_samp < tsi->maximum_sample_value)
-            max_samp = tsi->maximum_sample_value;
-        if (min_samp > tsi->minimum_sample_value)
-            min_samp = tsi->minimum_sample_value;
-        tsi->RED_block_flags = block_header->flags;
-        ++tsi;
-
-        // update metadata
-        if (tmd2->maximum_block_bytes < block_header->block_bytes)
-            tmd2->maximum_block_bytes = block_header->block_bytes;
-        if (tmd2->maximum_difference_bytes < block_header->difference_bytes)
-            tmd2->maximum_difference_bytes = block_header->difference_bytes;
+        Py_BEGIN_ALLOW_THREADS
+        run_parallel_c(encode_blocks_worker_c, (void *) workers, sizeof(RED_ENCODE_WORKER), n_threads);
+        Py_END_ALLOW_THREADS
+
+        for (i = 0; i < batch_n_blocks; i++, tsi++) {
+            block_header = (RED_BLOCK_HEADER *) (batch_blocks + (i * slot_bytes));
+
+            ts_data_fps->universal_header->body_CRC = CRC_update((ui1 *) block_header, block_header->block_bytes, ts_data_fps->universal_header->body_CRC);
+            e_fwrite((void *) block_header, sizeof(ui1), block_header->block_bytes, ts_data_fps->fp, ts_data_fps->full_file_name, __FUNCTION__, __LINE__, EXIT_ON_FAIL);
+
+            // time series indices - the rest was filled in by the workers
+            tsi->file_offset = file_offset;
+            file_offset += tsi->block_bytes;
+            tsi->start_sample = start_sample;
+            start_sample += tsi->number_of_samples;
+            if (max_samp < tsi->maximum_sample_value)
+                max_samp = tsi->maximum_sample_value;
+            if (min_samp > tsi->minimum_sample_value)
+                min_samp = tsi->minimum_sample_value;
+
+            // compressed / original bytes
+            block_ratios[block_idx + i] = (sf8) tsi->block_bytes / ((sf8) tsi->number_of_samples * sizeof(si4));
+            if (block_residuals != NULL)
+                block_residuals[block_idx + i] = batch_residuals[i];
+
+            // update metadata
+            if (tmd2->maximum_block_bytes < block_header->block_bytes)
+                tmd2->maximum_block_bytes = block_header->block_bytes;
+            if (tmd2->maximum_difference_bytes < block_header->difference_bytes)
+                tmd2->maximum_difference_bytes = block_header->difference_bytes;
+        }
     }
 
     // update metadata
@@ -977,6 +1084,7 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
         tmd2->minimum_native_sample_value = (sf8) max_samp * tmd2->units_conversion_factor;
     }
     tmd2->maximum_contiguous_blocks = tmd2->number_of_blocks;
+    bytes_per_sample = (tmd2->number_of_samples > 0) ? (sf8) (file_offset - UNIVERSAL_HEADER_BYTES) / (sf8) tmd2->number_of_samples : 0.0;
 
     // calculate the CRC for the time-series data-file and set in the universal header
     ts_data_fps->universal_header->header_CRC = CRC_calculate(ts_data_fps->raw_data + CRC_BYTES, UNIVERSAL_HEADER_BYTES - CRC_BYTES);
@@ -991,19 +1099,38 @@ static PyObject *write_mef_ts_data_and_indices(PyObject *self, PyObject *args) {
 
     // write time-series indices (file)
     write_MEF_file(ts_idx_fps);
+    unlock_mef_globals_c();
 
     // clean up
     free_file_processing_struct(metadata_fps);
     free_file_processing_struct(ts_data_fps);
     free_file_processing_struct(ts_idx_fps);
     free_file_processing_struct(gen_fps);
-    rps->block_header = NULL;
-    rps->compressed_data = NULL;
-    rps->original_data = NULL;
-    rps->original_ptr = NULL;
-    RED_free_processing_struct(rps);
+    n_clipped = 0;
+    for (i = 0; i < n_threads; i++) {
+        free_encoder_rps_c(workers[i].rps);
+        free (workers[i].conv_buffer);
+        n_clipped += workers[i].n_clipped;
+    }
+    free (workers);
+    free (batch_blocks);
+    free (batch_residuals);
+    free (block_starts);
+
+    if (n_clipped > 0)
+        PyErr_WarnEx(PyExc_RuntimeWarning, "Samples out of the int32 range were clipped", 1);
+
+    // achieved compression
+    py_report = PyDict_New();
+    PY_DICTSET_FUNC(py_report, "bytes_per_sample", PyFloat_FromDouble(bytes_per_sample));
+    PyDict_SetItemString(py_report, "block_compression_ratios", (PyObject *) py_block_ratios);
+    Py_DECREF(py_block_ratios);
+    if (py_block_residuals != NULL) {
+        PyDict_SetItemString(py_report, "block_mean_residual_ratios", (PyObject *) py_block_residuals);
+        Py_DECREF(py_block_residuals);
+    }
 
-    Py_RETURN_NONE;
+    return py_report;
 }
 
 static PyObject *write_mef_v_indices(PyObject *self, PyObject *args) {
@@ -1040,12 +1167,6 @@ static PyObject *write_mef_v_indices(PyObject *self, PyObject *args) {
         return NULL;
     }
 
-    // initialize MEF library
-    (void) initialize_meflib();
-
-    // Apply recording offset
-    MEF_globals->recording_time_offset = METADATA_RECORDING_TIME_OFFSET_NO_ENTRY;
-
     // NOTE: gen_fps is unecessart here if the metadata file with the universal header already exists, or is it?
     // password entries
     if (PyUnicode_Check(py_pass_1_obj)) {
@@ -1088,9 +1209,9 @@ static PyObject *write_mef_v_indices(PyObject *self, PyObject *args) {
     initialize_universal_header(gen_fps, MEF_TRUE, MEF_FALSE, MEF_TRUE);
     uh = gen_fps->universal_header;
 
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     gen_fps->password_data = process_password_data(NULL, level_1_password, level_2_password, uh);
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
 
     // Check for directory type
     MEF_strncpy(file_path, py_file_path, MEF_FULL_FILE_NAME_BYTES);
@@ -1141,8 +1262,12 @@ static PyObject *write_mef_v_indices(PyObject *self, PyObject *args) {
     // Run through the python list and create indices
     map_python_vi(vi_array, v_idx_fps->video_indices);
 
-    // write the file
+    // write the file, no recording offset is applied
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(METADATA_RECORDING_TIME_OFFSET_NO_ENTRY, MEF_FALSE);
+    Py_END_ALLOW_THREADS
     write_MEF_file(v_idx_fps);
+    unlock_mef_globals_c();
 
     // clean up
     free_file_processing_struct(v_idx_fps);
@@ -1186,13 +1311,25 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     si4     max_samp, min_samp;
     si8     start_sample, samps_remaining, block_samps, file_offset, ts_indices_file_bytes;
     sf8     curr_time, time_inc;
+    si4     array_type;
+    si4     *conv_buffer;
+    si8     n_clipped, n_blocks, block_i, appended_bytes;
+    sf8     scale;
+    PyObject    *py_lossy_params;
+    RED_LOSSY_PARAMS    lossy_params;
+    PyObject    *py_report, *py_value_obj;
+    PyArrayObject   *py_block_ratios, *py_block_residuals;
+    npy_intp    dims[1];
+    sf8     *block_ratios, *block_residuals;
 
     // Optional arguments
     discontinuity_flag = 1; // default - appended samples are discontinuity
     lossy_flag = 0; // default - no lossy compression
+    scale = 1.0;
+    py_lossy_params = NULL;
 
     // --- Parse the input --- 
-    if (!PyArg_ParseTuple(args,"sOOLLLO|ii",
+    if (!PyArg_ParseTuple(args,"sOOLLLO|iidO",
                           &py_file_path, // full path including segment
                           &py_pass_1_obj,
                           &py_pass_2_obj,
@@ -1201,12 +1338,22 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
                           &samps_per_mef_block,
                           &raw_data,
                           &discontinuity_flag,
-                          &lossy_flag)){
+                          &lossy_flag,
+                          &scale,
+                          &py_lossy_params)){
         return NULL;
     }
 
-    // initialize MEF library
-    (void) initialize_meflib();
+    if (parse_lossy_params_c(py_lossy_params, &lossy_params) < 0)
+        return NULL;
+
+    // check raw_data data type - samples are converted to int32 block by block
+    array_type = writer_sample_type_c((PyObject *) raw_data);
+    if (array_type < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Incorrect data type. Please provide 1D integer or float NumPy array in native byte order!");
+        PyErr_Occurred();
+        return NULL;
+    }
 
     // password entries
     if (PyUnicode_Check(py_pass_1_obj)) {
@@ -1249,9 +1396,9 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     initialize_universal_header(gen_fps, MEF_TRUE, MEF_FALSE, MEF_TRUE);
     uh = gen_fps->universal_header;
 
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     pwd = gen_fps->password_data = process_password_data(NULL, level_1_password, level_2_password, uh);
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
 
     // Check for directory type
     MEF_strncpy(file_path, py_file_path, MEF_FULL_FILE_NAME_BYTES);
@@ -1304,7 +1451,10 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     // We are appending so get only the end time
     metadata_fps->universal_header->end_time = recording_stop_uutc_time;
 
-    MEF_globals->recording_time_offset = metadata_fps->metadata.section_3->recording_time_offset;
+    // meflib applies the recording time offset from MEF_globals, held until the files are written
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(metadata_fps->metadata.section_3->recording_time_offset, MEF_FALSE);
+    Py_END_ALLOW_THREADS
 
     tmd2->number_of_blocks +=  (si8) ceil((sf8) PyArray_SHAPE(raw_data)[0] / (sf8) samps_per_mef_block);
     if (samps_per_mef_block > tmd2->maximum_block_samples)
@@ -1320,6 +1470,7 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     ts_idx_fps = read_MEF_file(ts_idx_fps, full_file_name, level_1_password, pwd, gen_directives, USE_GLOBAL_BEHAVIOR);
 
     if (ts_idx_fps == NULL) {
+        unlock_mef_globals_c();
         PyErr_SetString(PyExc_FileNotFoundError, "Index file does not exist, exiting...");
         PyErr_Occurred();
         free_file_processing_struct(gen_fps);
@@ -1333,6 +1484,7 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     ts_data_fps = read_MEF_file(ts_data_fps, full_file_name, level_1_password, pwd, gen_directives, USE_GLOBAL_BEHAVIOR);
     
     if (ts_data_fps == NULL) {
+        unlock_mef_globals_c();
         PyErr_SetString(PyExc_FileNotFoundError, "Data file does not exist, exiting...");
         PyErr_Occurred();
         free_file_processing_struct(gen_fps);
@@ -1344,19 +1496,7 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     // Switch the directives back for wirting
     gen_directives->io_bytes = FPS_FULL_FILE;
 
-    // TODO optional filtration
-    // use allocation below if lossy
-    if (lossy_flag == 1) {
-        rps = RED_allocate_processing_struct(samps_per_mef_block, 0, samps_per_mef_block, RED_MAX_DIFFERENCE_BYTES(samps_per_mef_block), samps_per_mef_block, samps_per_mef_block, pwd);
-        // ASK RED lossy compression user specified???
-        rps->compression.mode = RED_MEAN_RESIDUAL_RATIO;
-        rps->directives.detrend_data = MEF_TRUE;
-        rps->directives.require_normality = MEF_TRUE;
-        rps->compression.goal_mean_residual_ratio = 0.10;
-        rps->compression.goal_tolerance = 0.01;
-    } else {
-        rps = RED_allocate_processing_struct(samps_per_mef_block, 0, 0, RED_MAX_DIFFERENCE_BYTES(samps_per_mef_block), 0, 0, pwd);
-    }
+    rps = allocate_encoder_rps_c(samps_per_mef_block, (lossy_flag == 1) ? &lossy_params : NULL, pwd);
 
     //rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
 
@@ -1383,6 +1523,37 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     e_fseek(ts_idx_fps->fp, 0, SEEK_END, ts_idx_fps->full_file_name, __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
     // allocate time_series_index
     tsi = e_calloc(1, TIME_SERIES_INDEX_BYTES, __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
+    conv_buffer = e_calloc((size_t) samps_per_mef_block, sizeof(si4), __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
+    n_clipped = 0;
+
+    // compression report
+    n_blocks = (si8) ceil((sf8) PyArray_SHAPE(raw_data)[0] / (sf8) samps_per_mef_block);
+    dims[0] = (npy_intp) n_blocks;
+    py_block_ratios = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+    py_block_residuals = NULL;
+    if (lossy_flag == 1)
+        py_block_residuals = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+    if ((py_block_ratios == NULL) || ((lossy_flag == 1) && (py_block_residuals == NULL))) {
+        unlock_mef_globals_c();
+        Py_XDECREF(py_block_ratios);
+        Py_XDECREF(py_block_residuals);
+        fclose(ts_data_fps->fp);
+        fclose(ts_idx_fps->fp);
+        free_file_processing_struct(metadata_fps);
+        free_file_processing_struct(ts_data_fps);
+        free_file_processing_struct(ts_idx_fps);
+        free_file_processing_struct(gen_fps);
+        free_encoder_rps_c(rps);
+        free (tsi);
+        free (conv_buffer);
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+    block_ratios = (sf8 *) PyArray_DATA(py_block_ratios);
+    block_residuals = (py_block_residuals != NULL) ? (sf8 *) PyArray_DATA(py_block_residuals) : NULL;
+    block_i = 0;
+    appended_bytes = file_offset;
 
     // Write the data and update the metadata
     while (samps_remaining) {
@@ -1393,7 +1564,9 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
         block_header->number_of_samples = (ui4) block_samps;
         block_header->start_time = (si8) (curr_time + 0.5);
         curr_time += time_inc;
-        rps->original_data = rps->original_ptr = (si4 *) PyArray_DATA(raw_data) + ((si8) PyArray_SHAPE(raw_data)[0] - samps_remaining);
+        n_clipped += convert_to_si4_c((ui1 *) PyArray_BYTES(raw_data) + (((si8) PyArray_SHAPE(raw_data)[0] - samps_remaining) * (si8) PyArray_STRIDES(raw_data)[0]),
+                                      (si8) PyArray_STRIDES(raw_data)[0], array_type, scale, conv_buffer, block_samps);
+        rps->original_data = rps->original_ptr = conv_buffer;
 
         // filter - comment out if don't want
         // filtps->data_length = block_samps;
@@ -1422,12 +1595,19 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
         ts_idx_fps->universal_header->body_CRC = CRC_update((ui1 *) tsi, TIME_SERIES_INDEX_BYTES, ts_idx_fps->universal_header->body_CRC);
         e_fwrite((void *) tsi, TIME_SERIES_INDEX_BYTES, 1, ts_idx_fps->fp, ts_idx_fps->full_file_name, __FUNCTION__, __LINE__, EXIT_ON_FAIL);
 
+        // compressed / original bytes
+        block_ratios[block_i] = (sf8) tsi->block_bytes / ((sf8) tsi->number_of_samples * sizeof(si4));
+        if (block_residuals != NULL)
+            block_residuals[block_i] = rps->compression.actual_mean_residual_ratio;
+        block_i++;
+
         // update metadata
         if (tmd2->maximum_block_bytes < block_header->block_bytes)
             tmd2->maximum_block_bytes = block_header->block_bytes;
         if (tmd2->maximum_difference_bytes < block_header->difference_bytes)
             tmd2->maximum_difference_bytes = block_header->difference_bytes;
     }
+    appended_bytes = file_offset - appended_bytes;
     // update metadata
     tmd2->maximum_contiguous_block_bytes = file_offset - UNIVERSAL_HEADER_BYTES;
     if (tmd2->units_conversion_factor >= 0.0) {
@@ -1457,6 +1637,7 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     e_fwrite(uh, sizeof(ui1), UNIVERSAL_HEADER_BYTES, ts_idx_fps->fp, ts_idx_fps->full_file_name, __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
     // Update the metadta file
     write_MEF_file(metadata_fps);
+    unlock_mef_globals_c();
     // Close the file pointers
     fclose(ts_data_fps->fp);
     fclose(ts_idx_fps->fp);
@@ -1465,12 +1646,23 @@ static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args) {
     free_file_processing_struct(ts_data_fps);
     free_file_processing_struct(ts_idx_fps);
     free_file_processing_struct(gen_fps);
-    rps->block_header = NULL;
-    rps->compressed_data = NULL;
-    rps->original_data = NULL;
-    RED_free_processing_struct(rps);
-    
-    Py_RETURN_NONE;
+    free_encoder_rps_c(rps);
+    free (conv_buffer);
+
+    if (n_clipped > 0)
+        PyErr_WarnEx(PyExc_RuntimeWarning, "Samples out of the int32 range were clipped", 1);
+
+    // achieved compression
+    py_report = PyDict_New();
+    PY_DICTSET_FUNC(py_report, "bytes_per_sample", PyFloat_FromDouble((PyArray_SHAPE(raw_data)[0] > 0) ? (sf8) appended_bytes / (sf8) PyArray_SHAPE(raw_data)[0] : 0.0));
+    PyDict_SetItemString(py_report, "block_compression_ratios", (PyObject *) py_block_ratios);
+    Py_DECREF(py_block_ratios);
+    if (py_block_residuals != NULL) {
+        PyDict_SetItemString(py_report, "block_mean_residual_ratios", (PyObject *) py_block_residuals);
+        Py_DECREF(py_block_residuals);
+    }
+
+    return py_report;
 }
 
 // ASK No need for modify functions - can be taken care of at python level - just load and rewrite,
@@ -1503,6 +1695,8 @@ static PyObject *read_mef_session_metadata(PyObject *self, PyObject *args, PyObj
     PyObject    *py_password_obj;
 	si4 map_indices_flag = 1;
 	si4 copy_metadata_to_dict = 0; // default - use ndarray with pointers to underlying C data
+	si4 n_threads = 0; // default - no prefetch
+	si4 check_password = 0; // default - password not checked
 	
     // output dictionary
     PyObject *ses_metadata_dict;
@@ -1515,18 +1709,17 @@ static PyObject *read_mef_session_metadata(PyObject *self, PyObject *args, PyObj
     PyObject    *temp_UTF_str;
  
     // --- Parse the input --- 
-	static char* keywords[] = {"target_path", "password", "map_indices_flag", "copy_metadata_to_dict", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|pp", keywords,
+	static char* keywords[] = {"target_path", "password", "map_indices_flag", "copy_metadata_to_dict", "n_threads", "check_password", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|ppip", keywords,
 									 &py_session_path,
                                      &py_password_obj,
                                      &map_indices_flag,
-						             &copy_metadata_to_dict)) {
+						             &copy_metadata_to_dict,
+                                     &n_threads,
+                                     &check_password)) {
         return NULL;
     }
     
-    // initialize MEF library
-    (void) initialize_meflib();
-
     // password entries
     if (PyUnicode_Check(py_password_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_password_obj, "utf-8", "strict");
@@ -1542,10 +1735,25 @@ static PyObject *read_mef_session_metadata(PyObject *self, PyObject *args, PyObj
         password = NULL;
     }
 
+    // warm up the page cache with the metadata files concurrently, meflib then reads them one by one
+    if (n_threads > 1) {
+        Py_BEGIN_ALLOW_THREADS
+        (void) prefetch_session_files_c(py_session_path, n_threads);
+        Py_END_ALLOW_THREADS
+    }
+
 	// read the session metadata (and record-data)
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     session = read_MEF_session(NULL, py_session_path, password, NULL, MEF_FALSE, MEF_TRUE);    
-    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    restore_mef_errors_c();
+
+    // verify the password on the headers meflib has just read
+    if (check_password && check_session_password_c(session, password) < 0) {
+        free_session(session, MEF_TRUE);
+        PyErr_SetString(PyExc_RuntimeError, "MEF password is invalid");
+        PyErr_Occurred();
+        return NULL;
+    }
 
     // map session metadata
     ses_metadata_dict = map_mef3_session(session, map_indices_flag, copy_metadata_to_dict);
@@ -1554,8 +1762,6 @@ static PyObject *read_mef_session_metadata(PyObject *self, PyObject *args, PyObj
     if (copy_metadata_to_dict)
 		free_session(session, MEF_TRUE);
 	
-	// free the meflib globals
-	free_meflib();
 	
 	// return the metadata dictionary
 	return ses_metadata_dict;
@@ -1568,6 +1774,7 @@ static PyObject *read_mef_channel_metadata(PyObject *self, PyObject *args, PyObj
     PyObject    *py_password_obj;
     si4 map_indices_flag = 1;
 	si4 copy_metadata_to_dict = 0; // default - use ndarray with pointers to underlying C data
+	si4 check_password = 0; // default - password not checked
 		
     // output dictionary
     PyObject *ch_metadata_dict;
@@ -1580,18 +1787,16 @@ static PyObject *read_mef_channel_metadata(PyObject *self, PyObject *args, PyObj
     PyObject    *temp_UTF_str;
 	
     // --- Parse the input --- 
-	static char* keywords[] = {"target_path", "password", "map_indices_flag", "copy_metadata_to_dict", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|pp", keywords,
+	static char* keywords[] = {"target_path", "password", "map_indices_flag", "copy_metadata_to_dict", "check_password", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|ppp", keywords,
 									 &py_channel_path,
                                      &py_password_obj,
                                      &map_indices_flag,
-						             &copy_metadata_to_dict)) {
+						             &copy_metadata_to_dict,
+                                     &check_password)) {
         return NULL;
     }
 	
-    // initialize MEF library
-    (void) initialize_meflib();
-
     // password entries
     if (PyUnicode_Check(py_password_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_password_obj, "utf-8", "strict");
@@ -1608,9 +1813,17 @@ static PyObject *read_mef_channel_metadata(PyObject *self, PyObject *args, PyObj
     }
     
     // read the channel metadata (and record-data)
-    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+    suppress_mef_errors_c();
     channel = read_MEF_channel(NULL, py_channel_path, UNKNOWN_CHANNEL_TYPE, password, NULL, MEF_FALSE, MEF_TRUE);    
-	MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+	restore_mef_errors_c();
+
+    // verify the password on the headers meflib has just read
+    if (check_password && check_channel_password_c(channel, password) < 0) {
+        free_channel(channel, MEF_TRUE);
+        PyErr_SetString(PyExc_RuntimeError, "MEF password is invalid");
+        PyErr_Occurred();
+        return NULL;
+    }
 
     // map channel metadata
     ch_metadata_dict = map_mef3_channel(channel, map_indices_flag, copy_metadata_to_dict);
@@ -1619,8 +1832,6 @@ static PyObject *read_mef_channel_metadata(PyObject *self, PyObject *args, PyObj
     if (copy_metadata_to_dict)
 		free_channel(channel, MEF_TRUE);
 
-	// free the meflib globals
-	free_meflib();
 	
 	// return the metadata dictionary    
     return ch_metadata_dict;
@@ -1654,9 +1865,6 @@ static PyObject *read_mef_segment_metadata(PyObject *self, PyObject *args, PyObj
         return NULL;
     }
     
-    // initialize MEF library
-    (void) initialize_meflib();
-
     // password entries
     if (PyUnicode_Check(py_password_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_password_obj, "utf-8", "strict");
@@ -1673,9 +1881,9 @@ static PyObject *read_mef_segment_metadata(PyObject *self, PyObject *args, PyObj
     }
     
 	// read the segment metadata (and record-data)
-	MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+	suppress_mef_errors_c();
     segment = read_MEF_segment(NULL, py_segment_path, UNKNOWN_CHANNEL_TYPE, password, NULL, MEF_FALSE, MEF_TRUE);    
-	MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+	restore_mef_errors_c();
 	
     // map the segment metadata
     seg_metadata_dict = map_mef3_segment(segment, map_indices_flag, copy_metadata_to_dict);
@@ -1684,125 +1892,453 @@ static PyObject *read_mef_segment_metadata(PyObject *self, PyObject *args, PyObj
     if (copy_metadata_to_dict)
 		free_segment(segment, MEF_TRUE);
 
-	// free the meflib globals
-	free_meflib();
 	
 	// return the metadata dictionary    
     return seg_metadata_dict; 
 }
 
-static PyObject *read_mef_ts_data(PyObject *self, PyObject *args) {
+static PyObject *read_mef_channel_toc(PyObject *self, PyObject *args, PyObject *kwargs) {
     // Specified by user
     PyObject    *py_channel_obj;
-    PyObject    *ostart, *oend;
-    si8     start_time, end_time;
-    si8     start_samp, end_samp;
-    si4     times_specified;
- 
+    si4     ranges_only;
+
     // Python variables
-    PyArrayObject    *py_array_out;
+    PyArrayObject   *py_array_out;
+    PyArrayObject   *py_ranges_out;
 
     // Method specific variables
-    ui4     i, j;
-    // si4     offset_to_start_samp;
-    //ui8     data_len;
-    ui4 n_segments;
-    CHANNEL    *channel;
-    ui4 start_segment, end_segment;
-    
-    si8  total_samps;//, samp_counter_base;
-    ui8  total_data_bytes;
-    ui8 start_idx, end_idx, num_blocks, num_block_in_segment;
-    ui1 *compressed_data_buffer, *cdp;
-    si8  segment_start_sample, segment_end_sample;
-    si8  segment_start_time, segment_end_time;
-    si8  block_start_time;
-    FILE *fp;
-    ui8 n_read, bytes_to_read;
-    RED_PROCESSING_STRUCT   *rps;
-    si4 sample_counter;
-    ui4 max_samps;
-    si4 *temp_data_buf;
-    ui4 num_samps;
+    CHANNEL     *channel;
+    SEGMENT     *segment;
+    si8     *toc;
+    si8     n_blocks, seg_n_blocks, n_ranges, i;
+    si4     seg_idx;
+    sf8     fs;
+    npy_intp    dims[2];
 
-    si4 *decomp_data;
-    sf8 *numpy_arr_data;
-    
-    si4 offset_into_output_buffer;
-    si8 block_start_time_offset;
-    
-    si1 py_warning_message[256];
-    si4 crc_block_failure, blocks_decoded;
-    si1 last_block_decoded_flag;
+    static char *kwlist[] = {"channel_specific_metadata", "ranges_only", NULL};
 
-    npy_intp dims[1];
-    
     // Optional arguments
-    times_specified = 0; // default behavior - read samples
+    ranges_only = 0;
 
     // --- Parse the input --- 
-    if (!PyArg_ParseTuple(args,"OOO|i",
-                          &py_channel_obj,
-                          &ostart,
-                          &oend,
-                          &times_specified)){
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p",
+                                     kwlist,
+                                     &py_channel_obj,
+                                     &ranges_only)){
         return NULL;
     }
-        
-    // set up mef 3 library
-    (void) initialize_meflib();
-    MEF_globals->behavior_on_fail = RETURN_ON_FAIL;
-    
-    // initialize Numpy
-    import_array();
 
+    if (!PyArray_Check(py_channel_obj)) {
+        PyErr_SetString(PyExc_RuntimeError, "Channel metadata have to be read into numpy structures (copy_metadata_to_dict=False), exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
 
     channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
-    MEF_globals->recording_time_offset = channel->metadata.section_3->recording_time_offset;
-
     if (channel->channel_type != TIME_SERIES_CHANNEL_TYPE) {
         PyErr_SetString(PyExc_RuntimeError, "Not a time series channel, exiting...");
         PyErr_Occurred();
-		free_meflib();
         return NULL;
     }
 
-    //TODO - take care of situation when user passes times but does not raise the flag times_specified
+    n_blocks = 0;
+    for (seg_idx = 0; seg_idx < channel->number_of_segments; seg_idx++)
+        n_blocks += channel->segments[seg_idx].time_series_indices_fps->universal_header->number_of_entries;
 
-    // If None was passed as one of the arguments move to the start or end of the recording
-    start_samp = 0;
-    start_time = channel->earliest_start_time;
-    end_samp = channel->metadata.time_series_section_2->number_of_samples;
-    end_time = channel->latest_end_time;
-    if (ostart != Py_None)
-        start_samp = start_time = PyLong_AsLongLong(ostart);
-    
-    if (oend != Py_None)
-        end_samp = end_time = PyLong_AsLongLong(oend);
+    // the segment tables are filled into one preallocated array
+    dims[0] = 4;
+    dims[1] = n_blocks;
+    py_array_out = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_INT64);
+    if (py_array_out == NULL)
+        return NULL;
+    toc = (si8 *) PyArray_DATA(py_array_out);
 
-    // check if valid data range
-    if (times_specified && start_time >= end_time) {
-        PyErr_SetString(PyExc_RuntimeError, "Start time later than end time, exiting...");
-        PyErr_Occurred();
-		free_meflib();
+    for (seg_idx = 0, i = 0; seg_idx < channel->number_of_segments; seg_idx++) {
+        segment = channel->segments + seg_idx;
+        seg_n_blocks = segment->time_series_indices_fps->universal_header->number_of_entries;
+        fill_segment_toc_c(segment, toc + i, n_blocks);
+        i += seg_n_blocks;
+    }
+
+    if (!ranges_only)
+        return (PyObject *) py_array_out;
+
+    // contiguous ranges, the first block of a segment continues the previous segment unless there is a gap
+    fs = channel->metadata.time_series_section_2->sampling_frequency;
+    n_ranges = 0;
+    for (i = 0; i < n_blocks; i++)
+        n_ranges += toc_range_start_c(toc, n_blocks, fs, i);
+
+    dims[0] = 3;
+    dims[1] = n_ranges;
+    py_ranges_out = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_INT64);
+    if (py_ranges_out != NULL)
+        (void) toc_ranges_c(toc, n_blocks, fs, (si8 *) PyArray_DATA(py_ranges_out), n_ranges);
+    Py_DECREF(py_array_out);
+
+    return (PyObject *) py_ranges_out;
+}
+
+static PyObject *read_mef_record_table(PyObject *self, PyObject *args, PyObject *kwargs) {
+    // Specified by user
+    si1     *py_file_path;
+    PyObject    *py_password_obj;
+
+    // Python variables
+    PyObject    *py_table_dict;
+    PyObject    *py_type_dict;
+    PyObject    *temp_UTF_str;
+    PyArray_Descr   *descr;
+
+    // Method specific variables
+    FILE_PROCESSING_STRUCT  *rd_fps;
+    RECORD_HEADER   *rh;
+    RECORD_TABLE_TYPE   types[RECORD_TABLE_N_TYPES];
+    RECORD_TABLE_TYPE   *t;
+    si1     password_arr[PASSWORD_BYTES] = {0};
+    si1     *temp_str_bytes;
+    si1     *password;
+    ui1     *rd, *rd_end, *items, *row, *body;
+    si8     n_records, n_items, n_unknown, body_bytes, fixed_bytes, i, j;
+    si4     type_idx, number_of_channels, failed;
+    npy_intp    dims[1];
+
+    static const char *type_strings[RECORD_TABLE_N_TYPES] = {"Note", "EDFA", "LNTP", "Seiz", "CSti", "ESti", "SyLg", "Curs", "Epoc"};
+    static const char *buffer_names[RECORD_TABLE_N_TYPES] = {"text", "text", "template", "channels", NULL, NULL, "text", NULL, NULL};
+    static char *kwlist[] = {"target_path", "password", NULL};
+
+    // --- Parse the input --- 
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO",
+                                     kwlist,
+                                     &py_file_path,
+                                     &py_password_obj)){
         return NULL;
     }
-    if (!times_specified && start_samp >= end_samp) {
-        PyErr_SetString(PyExc_RuntimeError, "Start sample larger than end sample, exiting...");
+
+    // password entries
+    if (PyUnicode_Check(py_password_obj)) {
+        temp_UTF_str = PyUnicode_AsEncodedString(py_password_obj, "utf-8", "strict");
+        temp_str_bytes = PyBytes_AS_STRING(temp_UTF_str);
+
+        if (!*temp_str_bytes)
+            password = NULL;
+        else
+            password = strcpy(password_arr, temp_str_bytes);
+
+		Py_DECREF(temp_UTF_str);	temp_UTF_str = NULL;
+    } else {
+        password = NULL;
+    }
+
+    // read (and decrypt) the records
+    suppress_mef_errors_c();
+    rd_fps = read_MEF_file(NULL, py_file_path, password, NULL, NULL, USE_GLOBAL_BEHAVIOR);
+    restore_mef_errors_c();
+    if (rd_fps == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Error reading file, exiting...");
         PyErr_Occurred();
-		free_meflib();
         return NULL;
-    }    
+    }
 
-    // Fire a warnings if start or stop or both are out of file
-    if (times_specified){
-        if (((start_time < channel->earliest_start_time) & (end_time < channel->earliest_start_time)) |
-            ((start_time > channel->latest_end_time) & (end_time > channel->latest_end_time))){
-            PyErr_WarnEx(PyExc_RuntimeWarning, "Start and stop times are out of file. Returning None", 1);
-			free_meflib();
-            Py_RETURN_NONE;
+    memset(types, 0, sizeof(types));
+    rd_end = rd_fps->raw_data + rd_fps->file_length;
+
+    // first pass - count the records and the variable length items of each type
+    n_records = rd_fps->universal_header->number_of_entries;
+    n_unknown = 0;
+    rd = rd_fps->raw_data + UNIVERSAL_HEADER_BYTES;
+    for (i = 0; i < n_records; ++i) {
+        rh = (RECORD_HEADER *) rd;
+        if (rd + RECORD_HEADER_BYTES > rd_end || rd + RECORD_HEADER_BYTES + rh->bytes > rd_end)
+            break;
+        type_idx = record_table_type_index_c(*((ui4 *) rh->type_string));
+        if (type_idx < 0) {
+            n_unknown++;
+        } else {
+            types[type_idx].n_records++;
+            types[type_idx].n_items += record_table_items_c(rh, type_idx, &items);
         }
-        if (end_time > channel->latest_end_time)
+        rd += (RECORD_HEADER_BYTES + rh->bytes);
+    }
+    n_records = i;
+
+    // preallocate the tables and buffers
+    failed = 0;
+    for (type_idx = 0; type_idx < RECORD_TABLE_N_TYPES; ++type_idx) {
+        t = types + type_idx;
+        if (t->n_records == 0)
+            continue;
+
+        dims[0] = t->n_records;
+        descr = (PyArray_Descr *) create_record_table_dtype_c(type_idx);
+        if (descr != NULL)
+            t->records = PyArray_Zeros(1, dims, descr, 0);  // steals descr
+        if (t->records != NULL)
+            t->row = (ui1 *) PyArray_DATA((PyArrayObject *) t->records);
+
+        dims[0] = t->n_items;
+        switch (type_idx) {
+            case RECORD_TABLE_NOTE:
+            case RECORD_TABLE_EDFA:
+            case RECORD_TABLE_SYLG:
+                t->buffer = PyArray_ZEROS(1, dims, NPY_UINT8, 0);
+                break;
+            case RECORD_TABLE_LNTP:
+                t->buffer = PyArray_ZEROS(1, dims, NPY_INT32, 0);
+                break;
+            case RECORD_TABLE_SEIZ:
+                t->buffer = PyArray_Zeros(1, dims, (PyArray_Descr *) create_seiz_ch_dtype(), 0);
+                break;
+        }
+
+        if (t->records == NULL || (buffer_names[type_idx] != NULL && t->buffer == NULL))
+            failed = 1;
+    }
+
+    // second pass - fill the rows and the buffers
+    rd = rd_fps->raw_data + UNIVERSAL_HEADER_BYTES;
+    for (i = 0; i < n_records && !failed; ++i) {
+        rh = (RECORD_HEADER *) rd;
+        rd += (RECORD_HEADER_BYTES + rh->bytes);
+        type_idx = record_table_type_index_c(*((ui4 *) rh->type_string));
+        if (type_idx < 0)
+            continue;
+        t = types + type_idx;
+        row = t->row;
+        t->row += PyArray_ITEMSIZE((PyArrayObject *) t->records);
+
+        memcpy(row, &rh->time, sizeof(si8));
+        memcpy(row + 8, rh->type_string, TYPE_BYTES);
+        row[13] = rh->version_major;
+        row[14] = rh->version_minor;
+        row[15] = (ui1) rh->encryption;
+        row += RECORD_TABLE_ROW_HEADER_BYTES;
+
+        n_items = record_table_items_c(rh, type_idx, &items);
+        body = (ui1 *) rh + RECORD_HEADER_BYTES;
+        body_bytes = (si8) rh->bytes;
+        switch (type_idx) {
+            case RECORD_TABLE_NOTE:
+            case RECORD_TABLE_SYLG:
+                memcpy(row, &t->item_pos, sizeof(si8));
+                memcpy(row + 8, &n_items, sizeof(si8));
+                memcpy((ui1 *) PyArray_DATA((PyArrayObject *) t->buffer) + t->item_pos, items, (size_t) n_items);
+                break;
+            case RECORD_TABLE_EDFA:
+                if (body_bytes >= (si8) sizeof(si8))
+                    memcpy(row, (ui1 *) rh + MEFREC_EDFA_1_0_OFFSET, sizeof(si8));  // duration
+                memcpy(row + 8, &t->item_pos, sizeof(si8));
+                memcpy(row + 16, &n_items, sizeof(si8));
+                memcpy((ui1 *) PyArray_DATA((PyArrayObject *) t->buffer) + t->item_pos, items, (size_t) n_items);
+                break;
+            case RECORD_TABLE_LNTP:
+                memcpy(row, &n_items, sizeof(si8));
+                memcpy(row + 8, &t->item_pos, sizeof(si8));
+                memcpy((si4 *) PyArray_DATA((PyArrayObject *) t->buffer) + t->item_pos, items, (size_t) n_items * sizeof(si4));
+                break;
+            case RECORD_TABLE_SEIZ:
+                // seizure fields with the number of channels actually stored, then the channel offset
+                fixed_bytes = PyArray_ITEMSIZE((PyArrayObject *) t->records) - RECORD_TABLE_ROW_HEADER_BYTES - (si8) sizeof(si8);
+                memcpy(row, (ui1 *) rh + MEFREC_Seiz_1_0_OFFSET, (size_t) ((body_bytes < fixed_bytes) ? body_bytes : fixed_bytes));
+                number_of_channels = (si4) n_items;
+                memcpy(row + 3 * sizeof(si8), &number_of_channels, sizeof(si4));
+                memcpy(row + fixed_bytes, &t->item_pos, sizeof(si8));
+                for (j = 0; j < n_items; ++j)
+                    memcpy((ui1 *) PyArray_DATA((PyArrayObject *) t->buffer) + (t->item_pos + j) * PyArray_ITEMSIZE((PyArrayObject *) t->buffer),
+                           items + j * MEFREC_Seiz_1_0_CHANNEL_BYTES, (size_t) PyArray_ITEMSIZE((PyArrayObject *) t->buffer));
+                break;
+            default:
+                // fixed size bodies map one to one onto their dtypes
+                fixed_bytes = PyArray_ITEMSIZE((PyArrayObject *) t->records) - RECORD_TABLE_ROW_HEADER_BYTES;
+                memcpy(row, body, (size_t) ((body_bytes < fixed_bytes) ? body_bytes : fixed_bytes));
+                break;
+        }
+        t->item_pos += n_items;
+    }
+
+    // clean up
+    free_file_processing_struct(rd_fps);
+
+    if (failed) {
+        for (type_idx = 0; type_idx < RECORD_TABLE_N_TYPES; ++type_idx) {
+            Py_XDECREF(types[type_idx].records);
+            Py_XDECREF(types[type_idx].buffer);
+        }
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_RuntimeError, "Could not allocate record table, exiting...");
+        return NULL;
+    }
+
+    // one dictionary per record type
+    py_table_dict = PyDict_New();
+    for (type_idx = 0; type_idx < RECORD_TABLE_N_TYPES; ++type_idx) {
+        t = types + type_idx;
+        if (t->records == NULL)
+            continue;
+
+        py_type_dict = PyDict_New();
+        PyDict_SetItemString(py_type_dict, "records", t->records);
+        Py_DECREF(t->records);	t->records = NULL;
+        if (t->buffer != NULL) {
+            PyDict_SetItemString(py_type_dict, buffer_names[type_idx], t->buffer);
+            Py_DECREF(t->buffer);	t->buffer = NULL;
+        }
+        PyDict_SetItemString(py_table_dict, type_strings[type_idx], py_type_dict);
+        Py_DECREF(py_type_dict);	py_type_dict = NULL;
+    }
+
+    if (n_unknown > 0) {
+        if (PyErr_WarnEx(PyExc_RuntimeWarning, "Unrecognized record types were skipped", 1) < 0) {
+            Py_DECREF(py_table_dict);
+            return NULL;
+        }
+    }
+
+    return py_table_dict;
+}
+
+static PyObject *read_mef_ts_data(PyObject *self, PyObject *args, PyObject *kwargs) {
+    // Specified by user
+    PyObject    *py_channel_obj;
+    PyObject    *ostart, *oend;
+    si8     start_time, end_time;
+    si8     start_samp, end_samp;
+    si4     times_specified;
+    si4     keep_files_open;
+    si4     int32_output;
+    si4     gap_mask;
+    PyObject    *py_out_obj;
+    si4     scaled;
+    si4     float32_output;
+    si4     use_mmap;
+ 
+    // Python variables
+    PyArrayObject    *py_array_out;
+    PyArrayObject    *py_gaps_out;
+
+    // Method specific variables
+    CHANNEL    *channel;
+    ui4 num_samps;
+
+    si4 *decomp_data;
+    si4 out_type;
+    si8 out_stride;
+    sf8 scale;
+    si8 n_gaps;
+    si8 *gap_intervals;
+    
+    si1 py_warning_message[256];
+    TS_READ_STATUS  read_status;
+
+    npy_intp dims[1];
+    npy_intp gap_dims[2];
+
+    static char *kwlist[] = {"channel_specific_metadata", "start", "end", "times_specified", "keep_files_open",
+                             "int32_output", "gap_mask", "out", "scaled", "float32_output", "use_mmap", NULL};
+    
+    // Optional arguments
+    times_specified = 0; // default behavior - read samples
+    keep_files_open = 0;
+    int32_output = 0;
+    gap_mask = 0;
+    py_out_obj = Py_None;
+    scaled = 0;
+    float32_output = 0;
+    use_mmap = 0;
+
+    // --- Parse the input --- 
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|ppppOppp",
+                                     kwlist,
+                                     &py_channel_obj,
+                                     &ostart,
+                                     &oend,
+                                     &times_specified,
+                                     &keep_files_open,
+                                     &int32_output,
+                                     &gap_mask,
+                                     &py_out_obj,
+                                     &scaled,
+                                     &float32_output,
+                                     &use_mmap)){
+        return NULL;
+    }
+        
+    // meflib globals were set up once at import, reader threads share them
+
+    // initialize Numpy
+    import_array();
+
+    // caller supplied output - 1D writable int32, float32 or float64 array, any stride
+    if (py_out_obj != Py_None) {
+        if (!PyArray_Check(py_out_obj) || PyArray_NDIM((PyArrayObject *) py_out_obj) != 1 ||
+            !PyArray_ISWRITEABLE((PyArrayObject *) py_out_obj) || !PyArray_ISNOTSWAPPED((PyArrayObject *) py_out_obj) ||
+            !PyArray_ISALIGNED((PyArrayObject *) py_out_obj)) {
+            PyErr_SetString(PyExc_RuntimeError, "Output has to be a writable aligned 1D numpy array, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        }
+        out_type = PyArray_TYPE((PyArrayObject *) py_out_obj);
+        if (out_type != NPY_INT32 && out_type != NPY_FLOAT32 && out_type != NPY_FLOAT64) {
+            PyErr_SetString(PyExc_RuntimeError, "Output array has to be int32, float32 or float64, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        }
+        if (out_type != NPY_INT32)
+            int32_output = 0;
+    } else if (int32_output) {
+        out_type = NPY_INT32;
+    } else {
+        out_type = float32_output ? NPY_FLOAT32 : NPY_FLOAT64;
+    }
+
+    if (scaled && out_type == NPY_INT32) {
+        PyErr_SetString(PyExc_RuntimeError, "Scaled data can only be written to float output, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+
+
+    channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
+
+    if (channel->channel_type != TIME_SERIES_CHANNEL_TYPE) {
+        PyErr_SetString(PyExc_RuntimeError, "Not a time series channel, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+
+    //TODO - take care of situation when user passes times but does not raise the flag times_specified
+
+    // If None was passed as one of the arguments move to the start or end of the recording
+    start_samp = 0;
+    start_time = channel->earliest_start_time;
+    end_samp = channel->metadata.time_series_section_2->number_of_samples;
+    end_time = channel->latest_end_time;
+    if (ostart != Py_None)
+        start_samp = start_time = PyLong_AsLongLong(ostart);
+    
+    if (oend != Py_None)
+        end_samp = end_time = PyLong_AsLongLong(oend);
+
+    // check if valid data range
+    if (times_specified && start_time >= end_time) {
+        PyErr_SetString(PyExc_RuntimeError, "Start time later than end time, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+    if (!times_specified && start_samp >= end_samp) {
+        PyErr_SetString(PyExc_RuntimeError, "Start sample larger than end sample, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }    
+
+    // Fire a warnings if start or stop or both are out of file
+    if (times_specified){
+        if (((start_time < channel->earliest_start_time) & (end_time < channel->earliest_start_time)) |
+            ((start_time > channel->latest_end_time) & (end_time > channel->latest_end_time))){
+            PyErr_WarnEx(PyExc_RuntimeWarning, "Start and stop times are out of file. Returning None", 1);
+            Py_RETURN_NONE;
+        }
+        if (end_time > channel->latest_end_time)
             PyErr_WarnEx(PyExc_RuntimeWarning, "Stop uutc later than latest end time. Will insert NaNs", 1);
         
         if (start_time < channel->earliest_start_time)
@@ -1811,7 +2347,6 @@ static PyObject *read_mef_ts_data(PyObject *self, PyObject *args) {
         if (((start_samp < 0) & (end_samp < 0)) |
             ((start_samp > channel->metadata.time_series_section_2->number_of_samples) & (end_samp > channel->metadata.time_series_section_2->number_of_samples))){
             PyErr_WarnEx(PyExc_RuntimeWarning, "Start and stop samples are out of file. Returning None", 1);
-			free_meflib();
             Py_RETURN_NONE;
         }
         if (end_samp > channel->metadata.time_series_section_2->number_of_samples){
@@ -1833,2185 +2368,3543 @@ static PyObject *read_mef_ts_data(PyObject *self, PyObject *args) {
     // Allocate numpy array
     dims[0] = num_samps;
 
-    // Integers represent the "real" data but cannot use NaNs. this way can put data directly into numpy array
-    // when decompressing - cannot do this with floats - have to be copied
-    //py_array_out = PyArray_SimpleNew(1, dims, NPY_INT); // Integers for now but might have to convert to floats
+    if (py_out_obj != Py_None) {
+        if (PyArray_DIM((PyArrayObject *) py_out_obj, 0) != (npy_intp) num_samps) {
+            sprintf(py_warning_message, "Output array length %ld does not match the number of samples %u, exiting...",
+                    (long) PyArray_DIM((PyArrayObject *) py_out_obj, 0), num_samps);
+            PyErr_SetString(PyExc_RuntimeError, py_warning_message);
+            PyErr_Occurred();
+            return NULL;
+        }
+        py_array_out = (PyArrayObject *) py_out_obj;
+        Py_INCREF(py_array_out);
+    } else {
+        // Usnig doubles so we can use NaN values for discontinuities,
+        // in int32 mode the data are decoded directly into the output and gaps are returned separately
+        py_array_out = (PyArrayObject *) PyArray_SimpleNew(1, dims, out_type);
+        if (py_array_out == NULL) {
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, please try shortening the requested segment.");
+            PyErr_Occurred();
+            return NULL;
+        }
+    }
+    out_stride = (si8) PyArray_STRIDE(py_array_out, 0);
+
+    // units conversion is fused into the final copy
+    scale = 1.0;
+    if (scaled && channel->metadata.time_series_section_2->units_conversion_factor != TIME_SERIES_METADATA_UNITS_CONVERSION_FACTOR_NO_ENTRY)
+        scale = channel->metadata.time_series_section_2->units_conversion_factor;
+
+    py_gaps_out = NULL;
+    if (int32_output && gap_mask) {
+        py_gaps_out = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_BOOL);
+        if (py_gaps_out == NULL) {
+            Py_DECREF(py_array_out);
+            return NULL;
+        }
+    }
+
+    if (!times_specified) {
+        start_time = start_samp;
+        end_time = end_samp;
+    }
+
+    // Reading and decoding does not touch any Python objects - let other threads run meanwhile
+    Py_BEGIN_ALLOW_THREADS
 
-    // Usnig doubles so we can use NaN values for discontinuities
-    py_array_out = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
-    if (py_array_out == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, please try shortening the requested segment.");
+    n_gaps = 0;
+    gap_intervals = NULL;
+
+    // contiguous int32 output is decoded into directly, otherwise through an si4 buffer
+    if (out_type == NPY_INT32 && out_stride == sizeof(si4))
+        decomp_data = (si4 *) PyArray_DATA(py_array_out);
+    else
+        decomp_data = (si4 *) malloc((size_t) ((num_samps + 1) * sizeof(si4)));
+
+    if (decomp_data == NULL) {
+        memset(&read_status, 0, sizeof(TS_READ_STATUS));
+        read_status.error = TS_READ_MEMORY_ERROR;
+    } else {
+        (void) read_ts_data_c(channel, start_time, end_time, times_specified, keep_files_open, use_mmap, decomp_data, num_samps, &read_status);
+
+        // Gaps as a boolean mask or as [start, stop) intervals of output samples
+        if (int32_output && gap_mask) {
+            fill_gap_mask_c(decomp_data, num_samps, (ui1 *) PyArray_DATA(py_gaps_out));
+        } else if (int32_output) {
+            n_gaps = count_gaps_c(decomp_data, num_samps);
+            gap_intervals = (si8 *) malloc((size_t) ((2 * n_gaps + 1) * sizeof(si8)));
+            if (gap_intervals != NULL)
+                fill_gap_intervals_c(decomp_data, num_samps, gap_intervals);
+        }
+
+        // RED NaNs become numpy NaNs in float outputs, scaled in the same pass
+        if (decomp_data != (si4 *) PyArray_DATA(py_array_out)) {
+            convert_ts_data_c(decomp_data, num_samps, (ui1 *) PyArray_DATA(py_array_out), out_stride, out_type, scale);
+            free (decomp_data);
+        }
+    }
+
+    Py_END_ALLOW_THREADS
+
+    // Errors and warnings are deferred until the GIL is held again
+    if (read_status.error != TS_READ_OK || (int32_output && !gap_mask && gap_intervals == NULL)) {
+        Py_DECREF(py_array_out);
+        Py_XDECREF(py_gaps_out);
+        free (gap_intervals);
+        if (read_status.error == TS_READ_INVALID_OFFSET)
+            PyErr_SetString(PyExc_RuntimeError, "Invalid index file offset, exiting...");
+        else
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, please try shortening the requested segment.");
         PyErr_Occurred();
-		free_meflib();
         return NULL;
     }
-    numpy_arr_data = (sf8 *) PyArray_GETPTR1(py_array_out, 0);
-    
-    // Iterate through segments, looking for data that matches our criteria
-    n_segments = (ui4) channel->number_of_segments;
-    start_segment = end_segment = -1;
-    
-    if (times_specified) {
-        start_samp = sample_for_uutc_c(start_time, channel);
-        end_samp = sample_for_uutc_c(end_time, channel);
-    }else{
-        start_time = uutc_for_sample_c(start_samp, channel);
-        end_time = uutc_for_sample_c(end_samp, channel);
+
+    if (read_status.short_read_segment >= 0) {
+        sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d.", read_status.short_read_segment);
+        PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
     }
- 
-    // Find start and stop segments by uutc time
-    // find start segment by finding first segment whose ending is past the start time.
-    // then find stop segment by using the previous segment of the (first segment whose start is past the end time)
-    for (i = 0; i < n_segments; ++i) {
+
+    if (read_status.crc_block_failure > 0) {
+        if (read_status.start_segment != read_status.end_segment)
+            sprintf(py_warning_message, "CRC data block failure detected, %ld blocks skipped, in segments %d through %d.", read_status.blocks_skipped, read_status.start_segment, read_status.end_segment);
+        else
+            sprintf(py_warning_message, "CRC data block failure detected, %ld blocks skipped, in segment %d.", read_status.blocks_skipped, read_status.start_segment);
         
-        if (times_specified) {
-            segment_start_time = channel->segments[i].time_series_data_fps->universal_header->start_time;
-            segment_end_time   = channel->segments[i].time_series_data_fps->universal_header->end_time;
-            remove_recording_time_offset( &segment_start_time);
-            remove_recording_time_offset( &segment_end_time);
-            
-            if ((segment_end_time >= start_time) && (start_segment == -1)) {
-                start_segment = i;
-                end_segment = i;
-            }
-            if ((end_segment != -1) && (segment_start_time <= end_time))
-                end_segment = i;
-            
-        } else {
-            segment_start_sample = channel->segments[i].metadata_fps->metadata.time_series_section_2->start_sample;
-            segment_end_sample   = channel->segments[i].metadata_fps->metadata.time_series_section_2->start_sample +
-            channel->segments[i].metadata_fps->metadata.time_series_section_2->number_of_samples;
-            
-            if ((start_samp >= segment_start_sample) && (start_samp <= segment_end_sample))
-                start_segment = i;
-            if ((end_samp >= segment_start_sample) && (end_samp <= segment_end_sample))
-                end_segment = i;
-            
-        }
+        PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
     }
-    
-    // DAN_CONSULT - no need to do this? - the array will be filled with NaNs, warning will be fired
-    // TBD should this be re-done to include a partial page if partial data is available?
-    // if ((start_segment == -1) || (end_segment == -1)) //hit the end of the file, fill out data with zeros
-    // {
-    //     // TBD do something here?
-        
-    //     return DECOMP_MEF3_ERROR_NOT_ENOUGH_SAMPLES_IN_CHANNEL;
-    // }
-    
-    // find start block in start segment
-    start_idx = end_idx = 0;
-    //samp_counter_base = channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->start_sample;
-    for (j = 1; j < channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks; j++) {
-        
-        block_start_time = channel->segments[start_segment].time_series_indices_fps->time_series_indices[j].start_time;
-        remove_recording_time_offset( &block_start_time);
-        
-        if (block_start_time > start_time) {
-            start_idx = j - 1;
-            break;
+
+    if (!int32_output)
+        return (PyObject *) py_array_out;
+
+    if (!gap_mask) {
+        gap_dims[0] = n_gaps;
+        gap_dims[1] = 2;
+        py_gaps_out = (PyArrayObject *) PyArray_SimpleNew(2, gap_dims, NPY_INT64);
+        if (py_gaps_out == NULL) {
+            free (gap_intervals);
+            Py_DECREF(py_array_out);
+            return NULL;
         }
-        // starting point is in last block in segment
-        start_idx = j;
+        memcpy(PyArray_DATA(py_gaps_out), gap_intervals, (size_t) (2 * n_gaps * sizeof(si8)));
+        free (gap_intervals);
     }
-    
-    // find stop block in stop segment
-    //samp_counter_base = channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->start_sample;
-    for (j = 1; j < channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks; j++) {
-        
-        block_start_time = channel->segments[end_segment].time_series_indices_fps->time_series_indices[j].start_time;
-        remove_recording_time_offset( &block_start_time);
-        
-        if (block_start_time > end_time) {
-            end_idx = j - 1;
-            break;
-        }
-        // ending point is in last block in segment
-        end_idx = j;
+
+    return Py_BuildValue("(NN)", py_array_out, py_gaps_out);
+}
+
+static PyObject *read_mef_ts_data_channels(PyObject *self, PyObject *args, PyObject *kwargs) {
+    // Specified by user
+    PyObject    *py_channel_list;
+    PyObject    *ostart, *oend;
+    si4     times_specified;
+    si4     n_threads;
+    si4     keep_files_open;
+    si4     use_mmap;
+    si4     scaled;
+
+    // Python variables
+    PyObject        *py_channel_obj;
+    PyArrayObject   *py_array_out;
+
+    // Method specific variables
+    si4     i, n_channels;
+    si8     start, end, ch_start, ch_end, n_samples;
+    sf8     fs;
+    CHANNEL *channel;
+    TS_READ_JOB     *jobs;
+    TS_READ_WORKER  *workers;
+    si8     max_samps;
+    sf8     *numpy_arr_data;
+    si1     py_warning_message[256];
+
+    npy_intp dims[2];
+
+    static char *kwlist[] = {"channel_specific_metadata_list", "start", "end", "times_specified", "n_threads",
+                             "keep_files_open", "use_mmap", "scaled", NULL};
+
+    // Optional arguments
+    times_specified = 0; // default behavior - read samples
+    n_threads = 0;
+    keep_files_open = 0;
+    use_mmap = 0;
+    scaled = 0;
+
+    // --- Parse the input --- 
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|pippp",
+                                     kwlist,
+                                     &py_channel_list,
+                                     &ostart,
+                                     &oend,
+                                     &times_specified,
+                                     &n_threads,
+                                     &keep_files_open,
+                                     &use_mmap,
+                                     &scaled)){
+        return NULL;
     }
-    
-    // find total_samps and total_data_bytes, so we can allocate buffers
-    total_samps = 0;
-    total_data_bytes = 0;
-    
-    // TBD do we care about this?
-    //chan->max_sample_value = RED_MINIMUM_SAMPLE_VALUE;
-    //chan->min_sample_value = RED_MAXIMUM_SAMPLE_VALUE;
-    
-    // normal case - everything is in one segment
-    if (start_segment == end_segment) {
-        if (end_idx < (ui8) (channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks - 1)) {
-            total_samps += channel->segments[start_segment].time_series_indices_fps->time_series_indices[end_idx+1].start_sample -
-            channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].start_sample;
-            total_data_bytes += channel->segments[start_segment].time_series_indices_fps->time_series_indices[end_idx+1].file_offset -
-            channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset;
-        } else {
-            // case where end_idx is last block in segment
-            total_samps += channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->number_of_samples -
-            channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].start_sample;
-            total_data_bytes += channel->segments[start_segment].time_series_data_fps->file_length -
-            channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset;
+
+    if (!PySequence_Check(py_channel_list)) {
+        PyErr_SetString(PyExc_RuntimeError, "Channel metadata have to be passed as a list, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+
+    // initialize Numpy
+    import_array();
+
+    n_channels = (si4) PySequence_Size(py_channel_list);
+    jobs = (TS_READ_JOB *) calloc((size_t) (n_channels + 1), sizeof(TS_READ_JOB));
+    if (jobs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+
+    // Set up one job per channel
+    max_samps = 0;
+    for (i = 0; i < n_channels; i++) {
+        py_channel_obj = PySequence_GetItem(py_channel_list, i);
+        if (py_channel_obj == NULL || !PyArray_Check(py_channel_obj)) {
+            Py_XDECREF(py_channel_obj);
+            free (jobs);
+            PyErr_SetString(PyExc_RuntimeError, "Channel metadata list contains an invalid item, exiting...");
+            PyErr_Occurred();
+            return NULL;
         }
-        num_blocks = end_idx - start_idx + 1;
-        // TBD do we car about this?
-        // TBD this max/min calculation doesn't take into account filter/re-sampling.  Also, need to make worth with multiple segments.
-        //for (i = start_idx;i <= end_idx;i++)
-        //{
-        //    // fill in max and min values
-        //    if (channel->segments[start_segment].time_series_indices_fps->time_series_indices[i].maximum_sample_value > chan->max_sample_value)
-        //        chan->max_sample_value = channel->segments[start_segment].time_series_indices_fps->time_series_indices[i].maximum_sample_value;
-        //    if (channel->segments[start_segment].time_series_indices_fps->time_series_indices[i].minimum_sample_value < chan->min_sample_value)
-        //        chan->min_sample_value = channel->segments[start_segment].time_series_indices_fps->time_series_indices[i].minimum_sample_value;
-        //}
-		
-    } else {
-		// spans across segments
-    
-        // start with first segment
-        num_block_in_segment = (ui8) channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks;
-        total_samps += channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->number_of_samples -
-        channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].start_sample;
-        total_data_bytes +=  channel->segments[start_segment].time_series_data_fps->file_length -
-        channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset;
-        num_blocks = num_block_in_segment - start_idx;
-
-        if (channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset < 1024){
-            PyErr_SetString(PyExc_RuntimeError, "Invalid index file offset, exiting...");
+        channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
+        // the metadata stay referenced by the list for the duration of the call
+        Py_DECREF(py_channel_obj);
+
+        if (channel->channel_type != TIME_SERIES_CHANNEL_TYPE) {
+            free (jobs);
+            PyErr_SetString(PyExc_RuntimeError, "Not a time series channel, exiting...");
             PyErr_Occurred();
-			free_meflib();
             return NULL;
         }
-        
-        // this loop will only run if there are segments in between the start and stop segments
-        for (i = (start_segment + 1); i <= (end_segment - 1); i++) {
-            num_block_in_segment = (ui8) channel->segments[i].metadata_fps->metadata.time_series_section_2->number_of_blocks;
-            total_samps += channel->segments[i].metadata_fps->metadata.time_series_section_2->number_of_samples;
-            total_data_bytes += channel->segments[i].time_series_data_fps->file_length -
-            channel->segments[i].time_series_indices_fps->time_series_indices[0].file_offset;
-            num_blocks += num_block_in_segment;
-
-            if (channel->segments[i].time_series_indices_fps->time_series_indices[0].file_offset < 1024){
-                PyErr_SetString(PyExc_RuntimeError, "Invalid index file offset, exiting...");
+
+        fs = channel->metadata.time_series_section_2->sampling_frequency;
+        n_samples = channel->metadata.time_series_section_2->number_of_samples;
+        jobs[i].channel = channel;
+        jobs[i].scale = 1.0;
+        if (scaled && channel->metadata.time_series_section_2->units_conversion_factor != TIME_SERIES_METADATA_UNITS_CONVERSION_FACTOR_NO_ENTRY)
+            jobs[i].scale = channel->metadata.time_series_section_2->units_conversion_factor;
+
+        if (times_specified) {
+            start = (ostart != Py_None) ? PyLong_AsLongLong(ostart) : channel->earliest_start_time;
+            end = (oend != Py_None) ? PyLong_AsLongLong(oend) : channel->latest_end_time;
+            if (start >= end) {
+                free (jobs);
+                PyErr_SetString(PyExc_RuntimeError, "Start time later than end time, exiting...");
                 PyErr_Occurred();
-				free_meflib();
                 return NULL;
             }
-        }
-        
-        // then last segment
-        num_block_in_segment = (ui8) channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks;
-        if (end_idx < (ui8) (channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks - 1)) {
-            total_samps += channel->segments[end_segment].time_series_indices_fps->time_series_indices[end_idx+1].start_sample -
-            channel->segments[end_segment].time_series_indices_fps->time_series_indices[0].start_sample;
-            total_data_bytes += channel->segments[end_segment].time_series_indices_fps->time_series_indices[end_idx+1].file_offset -
-            channel->segments[end_segment].time_series_indices_fps->time_series_indices[0].file_offset;
-            num_blocks += end_idx + 1;
+            jobs[i].row_len = (si8) ((((end - start) / 1000000.0) * fs) + 0.5);
+
+            // window completely out of the channel - the row stays NaN
+            if ((end < channel->earliest_start_time) || (start > channel->latest_end_time))
+                continue;
+
+            jobs[i].start = start;
+            jobs[i].end = end;
+            jobs[i].num_samps = (ui4) jobs[i].row_len;
+            jobs[i].row_offset = 0;
         } else {
-            // case where end_idx is last block in segment
-            total_samps += channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->number_of_samples -
-            channel->segments[end_segment].time_series_indices_fps->time_series_indices[0].start_sample;
-            total_data_bytes += channel->segments[end_segment].time_series_data_fps->file_length -
-            channel->segments[end_segment].time_series_indices_fps->time_series_indices[0].file_offset;
-            num_blocks += end_idx + 1;
-        }
+            start = (ostart != Py_None) ? PyLong_AsLongLong(ostart) : 0;
+            end = (oend != Py_None) ? PyLong_AsLongLong(oend) : n_samples;
+            if (start >= end) {
+                free (jobs);
+                PyErr_SetString(PyExc_RuntimeError, "Start sample larger than end sample, exiting...");
+                PyErr_Occurred();
+                return NULL;
+            }
+            jobs[i].row_len = end - start;
 
-        if (channel->segments[end_segment].time_series_indices_fps->time_series_indices[end_idx].file_offset < 1024){
-            PyErr_SetString(PyExc_RuntimeError, "Invalid index file offset, exiting...");
-            PyErr_Occurred();
-			free_meflib();
-            return NULL;
+            // only the part of the window inside of the channel is decoded
+            ch_start = (start < 0) ? 0 : start;
+            ch_end = (end > n_samples) ? n_samples : end;
+            if (ch_start >= ch_end)
+                continue;
+
+            jobs[i].start = ch_start;
+            jobs[i].end = ch_end;
+            jobs[i].num_samps = (ui4) (ch_end - ch_start);
+            jobs[i].row_offset = ch_start - start;
         }
+
+        if (jobs[i].row_len > max_samps)
+            max_samps = jobs[i].row_len;
     }
-    
-    // allocate buffers
-    //data_len = total_samps;
-    compressed_data_buffer = (ui1 *) malloc((size_t) total_data_bytes);
-    cdp = compressed_data_buffer;
-    decomp_data = (si4 *) malloc((size_t) (num_samps * sizeof(si4)));
-    memset_int(decomp_data, RED_NAN, num_samps);
-    // decomp_data = PyArray_GETPTR1(py_array_out, 0);
-    // memset(decomp_data,NPY_NAN,sizeof(NPY_FLOAT)*num_samps);
-    
-    // read in RED data
-    // normal case - everything is in one segment
-    if (start_segment == end_segment) {
-        if (channel->segments[start_segment].time_series_data_fps->fp == NULL) {
-            channel->segments[start_segment].time_series_data_fps->fp = fopen(channel->segments[start_segment].time_series_data_fps->full_file_name, "rb");
-            channel->segments[start_segment].time_series_data_fps->fd = fileno(channel->segments[start_segment].time_series_data_fps->fp);
-        }
-        fp = channel->segments[start_segment].time_series_data_fps->fp;
-        
-        #ifdef _WIN32
-            _fseeki64(fp, channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset, SEEK_SET);
-        #else
-            fseek(fp, channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset, SEEK_SET);
-        #endif
-        n_read = fread(cdp, sizeof(si1), (size_t) total_data_bytes, fp);
-        if (n_read != total_data_bytes) {
-            sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d.", start_segment);
-            PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
-        }
-        if (channel->segments[start_segment].time_series_data_fps->directives.close_file == MEF_TRUE)
-            fps_close(channel->segments[start_segment].time_series_data_fps);
-    } else {
-		// spans across segments
-	
-        // start with first segment
-        if (channel->segments[start_segment].time_series_data_fps->fp == NULL) {
-            channel->segments[start_segment].time_series_data_fps->fp = fopen(channel->segments[start_segment].time_series_data_fps->full_file_name, "rb");
-            channel->segments[start_segment].time_series_data_fps->fd = fileno(channel->segments[start_segment].time_series_data_fps->fp);
-        }
-        fp = channel->segments[start_segment].time_series_data_fps->fp;
-        #ifdef _WIN32
-             _fseeki64(fp, channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset, SEEK_SET);
-        #else
-            fseek(fp, channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset, SEEK_SET);
-        #endif
-        bytes_to_read = channel->segments[start_segment].time_series_data_fps->file_length -
-        channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset;
-        n_read = fread(cdp, sizeof(si1), (size_t) bytes_to_read, fp);
-        if (n_read != bytes_to_read) {
-            sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d.", start_segment);
-            PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
-        }
-        cdp += n_read;
-        if (channel->segments[start_segment].time_series_data_fps->directives.close_file == MEF_TRUE)
-            fps_close(channel->segments[start_segment].time_series_data_fps);
-        
-        // this loop will only run if there are segments in between the start and stop segments
-        for (i = (start_segment + 1); i <= (end_segment - 1); i++) {
-            if (channel->segments[i].time_series_data_fps->fp == NULL){
-                channel->segments[i].time_series_data_fps->fp = fopen(channel->segments[i].time_series_data_fps->full_file_name, "rb");
-                channel->segments[i].time_series_data_fps->fd = fileno(channel->segments[i].time_series_data_fps->fp);
-            }
-            fp = channel->segments[i].time_series_data_fps->fp;
-            fseek(fp, UNIVERSAL_HEADER_BYTES, SEEK_SET);
-            bytes_to_read = channel->segments[i].time_series_data_fps->file_length - 
-            channel->segments[i].time_series_indices_fps->time_series_indices[0].file_offset;
-            n_read = fread(cdp, sizeof(si1), (size_t) bytes_to_read, fp);
-            if (n_read != bytes_to_read) {
-                sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d.", i);
-                PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
-            }
-            cdp += n_read;
-            if (channel->segments[i].time_series_data_fps->directives.close_file == MEF_TRUE)
-                fps_close(channel->segments[i].time_series_data_fps);
-        }
-        
-        // then last segment
-        if (channel->segments[end_segment].time_series_data_fps->fp == NULL) {
-            channel->segments[end_segment].time_series_data_fps->fp = fopen(channel->segments[end_segment].time_series_data_fps->full_file_name, "rb");
-            channel->segments[end_segment].time_series_data_fps->fd = fileno(channel->segments[end_segment].time_series_data_fps->fp);
-        }
-        num_block_in_segment = channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks;
-        if (end_idx < (ui8) (channel->segments[end_segment].metadata_fps->metadata.time_series_section_2->number_of_blocks - 1)) {
-            fp = channel->segments[end_segment].time_series_data_fps->fp;
-            fseek(fp, UNIVERSAL_HEADER_BYTES, SEEK_SET);
-            bytes_to_read = channel->segments[end_segment].time_series_indices_fps->time_series_indices[end_idx+1].file_offset -
-            channel->segments[end_segment].time_series_indices_fps->time_series_indices[0].file_offset;
-            n_read = fread(cdp, sizeof(si1), (size_t) bytes_to_read, fp);
-            if (n_read != bytes_to_read){
-                sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d.", end_segment);
-                PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
-            }
-            cdp += n_read;
-        } else {
-            // case where end_idx is last block in segment
-            fp = channel->segments[end_segment].time_series_data_fps->fp;
-            fseek(fp, UNIVERSAL_HEADER_BYTES, SEEK_SET);
-            bytes_to_read = channel->segments[end_segment].time_series_data_fps->file_length -
-            channel->segments[end_segment].time_series_indices_fps->time_series_indices[0].file_offset;
-            n_read = fread(cdp, sizeof(si1), (size_t) bytes_to_read, fp);
-            if (n_read != bytes_to_read) {
-                sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d.", end_segment);
-                PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
-            }
-            cdp += n_read;
-        }
-
-        if (channel->segments[end_segment].time_series_data_fps->directives.close_file == MEF_TRUE)
-            fps_close(channel->segments[end_segment].time_series_data_fps);
 
-        // // then last segment
-        // fp = channel->segments[end_segment].time_series_data_fps->fp;
-        // fseek(fp, UNIVERSAL_HEADER_BYTES, SEEK_SET);
-        // bytes_to_read = channel->segments[end_segment].time_series_data_fps->file_length -
-        // channel->segments[end_segment].time_series_indices_fps->time_series_indices[start_idx].file_offset;
-        // n_read = fread(cdp, sizeof(si1), (size_t) bytes_to_read, fp);
-        // if (n_read != bytes_to_read)
-        //     printf("Error reading file");
-        // cdp += bytes_to_read;
+    if (PyErr_Occurred()) {
+        free (jobs);
+        return NULL;
     }
-        
-    // set up RED processing struct
-    cdp = compressed_data_buffer;
-    max_samps = channel->metadata.time_series_section_2->maximum_block_samples;
-    
-    // create RED processing struct
-    rps = (RED_PROCESSING_STRUCT *) calloc((size_t) 1, sizeof(RED_PROCESSING_STRUCT));
-    rps->compression.mode = RED_DECOMPRESSION;
-    //rps->directives.return_block_extrema = MEF_TRUE;
-    rps->decompressed_ptr = rps->decompressed_data = decomp_data;
-    rps->difference_buffer = (si1 *) e_calloc((size_t) RED_MAX_DIFFERENCE_BYTES(max_samps) + 1, sizeof(ui1), __FUNCTION__, __LINE__, USE_GLOBAL_BEHAVIOR);
-    
-    // offset_to_start_samp = start_samp - channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].start_sample;
-    
-    sample_counter = 0;
-    
-    cdp = compressed_data_buffer;
-    
-    crc_block_failure = 0;
-    blocks_decoded = 0;
-    
-	// decode the first block
-    temp_data_buf = (int *) malloc((max_samps * 1.1) * sizeof(si4));
-    rps->decompressed_ptr = rps->decompressed_data = temp_data_buf;
-    rps->compressed_data = cdp;
-    rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
-    if (!check_block_crc((ui1*)(rps->block_header), max_samps, compressed_data_buffer, total_data_bytes)) {
-        crc_block_failure++;
-        last_block_decoded_flag = 0;
-        cdp += rps->block_header->block_bytes;
-    } else {
-        RED_decode(rps);
-        cdp += rps->block_header->block_bytes;
-        blocks_decoded++;
-        last_block_decoded_flag = 1;
-        
-        if (times_specified) {
-            // rps->block_header->start_time is already offset during RED_decode()
-            
-            if ((rps->block_header->start_time - start_time) >= 0)
-                offset_into_output_buffer = (si4) ((((rps->block_header->start_time - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) + 0.5);
-            else
-                offset_into_output_buffer = (si4) ((((rps->block_header->start_time - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) - 0.5);
 
-        } else
-            offset_into_output_buffer = (si4) (channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->start_sample +
-                                               channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].start_sample) - start_samp;
-        
-        // copy requested samples from first block to output buffer
-        // TBD this loop could be optimized
-        for (i = 0; i < rps->block_header->number_of_samples; i++) {
-            if (offset_into_output_buffer < 0) {
-                offset_into_output_buffer++;
-                continue;
-            }
-            
-            if ((ui4) offset_into_output_buffer >= num_samps)
-                break;
-            
-            *(decomp_data + offset_into_output_buffer) = temp_data_buf[i];
-            
-            offset_into_output_buffer++;
-        }
-		sample_counter = offset_into_output_buffer;
+    // One allocation for all channels
+    dims[0] = n_channels;
+    dims[1] = max_samps;
+    py_array_out = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+    if (py_array_out == NULL) {
+        free (jobs);
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, please try shortening the requested segment.");
+        PyErr_Occurred();
+        return NULL;
+    }
+    numpy_arr_data = (sf8 *) PyArray_DATA(py_array_out);
+    for (i = 0; i < n_channels; i++) {
+        jobs[i].row = numpy_arr_data + (i * max_samps);
+        jobs[i].row_len = max_samps;
     }
 
-    
-    // decode blocks in between the first and the last
-    for (i = 1; i < num_blocks - 1; i++) {
-        rps->compressed_data = cdp;
-        rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
-        // check that block fits fully within output array
-        // this should be true, but it's possible a stray block exists out-of-order, or with a bad timestamp
-        
-        // we need to manually remove offset, since we are using the time value of the block bevore decoding the block
-        // (normally the offset is removed during the decoding process)
-
-        if ((rps->block_header->block_bytes == 0) || !check_block_crc((ui1*)(rps->block_header), max_samps, compressed_data_buffer, total_data_bytes)) {
-            crc_block_failure++;
-            
-            // two-in-a-row bad block CRCs - this is probably an unrecoverable situation, so just stop decoding.
-            if (last_block_decoded_flag == 0)
-                goto done_decoding;
-            
-            // set a flag, and keep trying successive blocks.
-            last_block_decoded_flag = 0;
-
-        } else {
+    if (n_threads <= 0)
+        n_threads = get_cpu_count_c();
+    if (n_threads > n_channels)
+        n_threads = n_channels;
+    if (n_threads < 1)
+        n_threads = 1;
+
+    workers = (TS_READ_WORKER *) calloc((size_t) n_threads, sizeof(TS_READ_WORKER));
+    if (workers == NULL) {
+        free (jobs);
+        Py_DECREF(py_array_out);
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+    for (i = 0; i < n_threads; i++) {
+        workers[i].jobs = jobs;
+        workers[i].n_jobs = n_channels;
+        workers[i].times_specified = times_specified;
+        workers[i].keep_files_open = keep_files_open;
+        workers[i].use_mmap = use_mmap;
+        workers[i].first_job = i;
+        workers[i].job_step = n_threads;
+    }
 
-            if (times_specified) {
-                block_start_time_offset = rps->block_header->start_time;
-                remove_recording_time_offset( &block_start_time_offset );
-                
-                // The next two checks see if the block contains out-of-bounds samples.
-                // In that case, skip the block and move on
-                if (block_start_time_offset < start_time) {
-                    cdp += rps->block_header->block_bytes;
-                    continue;
-                }
-                if (block_start_time_offset + ((rps->block_header->number_of_samples / channel->metadata.time_series_section_2->sampling_frequency) * 1e6) >= end_time) {
-                    // Comment this out for now, it creates a strange boundary condition
-                    // cdp += rps->block_header->block_bytes;
-                    continue;
-                }
-                
-                rps->decompressed_ptr = rps->decompressed_data = decomp_data + (int)((((block_start_time_offset - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) + 0.5);
+    // Decode all channels without the GIL
+    Py_BEGIN_ALLOW_THREADS
+    run_parallel_c(read_ts_worker_c, (void *) workers, sizeof(TS_READ_WORKER), n_threads);
+    Py_END_ALLOW_THREADS
 
-            } else {
+    free (workers);
 
-                // prevent buffer overflow
-                if ((sample_counter + rps->block_header->number_of_samples) > num_samps)
-                    goto done_decoding;
-                
-                rps->decompressed_ptr = rps->decompressed_data = decomp_data + sample_counter;
-            }
-            
-            RED_decode(rps);
-            sample_counter += rps->block_header->number_of_samples;
-            blocks_decoded++;
-            last_block_decoded_flag = 1;
+    // Errors and warnings are deferred until the GIL is held again
+    for (i = 0; i < n_channels; i++) {
+        if (jobs[i].status.error == TS_READ_INVALID_OFFSET) {
+            free (jobs);
+            Py_DECREF(py_array_out);
+            PyErr_SetString(PyExc_RuntimeError, "Invalid index file offset, exiting...");
+            PyErr_Occurred();
+            return NULL;
         }
-		
-        cdp += rps->block_header->block_bytes;
-    }
-    
-	// decode last block to temp array
-    if (num_blocks > 1) {
-        rps->compressed_data = cdp;
-        rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
-        rps->decompressed_ptr = rps->decompressed_data = temp_data_buf;
-        if (!check_block_crc((ui1*)(rps->block_header), max_samps, compressed_data_buffer, total_data_bytes)) {
-			crc_block_failure++;
-            goto done_decoding;
+        if (jobs[i].status.error != TS_READ_OK) {
+            free (jobs);
+            Py_DECREF(py_array_out);
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, please try shortening the requested segment.");
+            PyErr_Occurred();
+            return NULL;
         }
-        
-        RED_decode(rps);
-        blocks_decoded++;
-        last_block_decoded_flag = 1;
-        
-        if (times_specified) {
-            if ((rps->block_header->start_time  - start_time) >= 0)
-                offset_into_output_buffer = (si4) ((((rps->block_header->start_time - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) + 0.5);
-            else
-                offset_into_output_buffer = (si4) ((((rps->block_header->start_time - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) - 0.5);
-        } else
-            offset_into_output_buffer = sample_counter;
-        
-        // copy requested samples from last block to output buffer
-        for (i = 0; i < rps->block_header->number_of_samples; i++) {
-            if (offset_into_output_buffer < 0) {
-                offset_into_output_buffer++;
-                continue;
-            }
-            
-            if ((ui4) offset_into_output_buffer >= num_samps)
-                break;
-            
-            *(decomp_data + offset_into_output_buffer) = temp_data_buf[i];
-            
-            offset_into_output_buffer++;
+        if (jobs[i].status.short_read_segment >= 0) {
+            sprintf(py_warning_message, "Read in fewer than expected bytes from data file in segment %d of channel %s.", jobs[i].status.short_read_segment, jobs[i].channel->name);
+            PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
+        }
+        if (jobs[i].status.crc_block_failure > 0) {
+            sprintf(py_warning_message, "CRC data block failure detected, %ld blocks skipped, in channel %s.", jobs[i].status.blocks_skipped, jobs[i].channel->name);
+            PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
         }
     }
-    
-done_decoding:
-    
-    if (crc_block_failure > 0) {
-        if (start_segment != end_segment)
-            sprintf(py_warning_message, "CRC data block failure detected, %ld blocks skipped, in segments %d through %d.", num_blocks - blocks_decoded, start_segment, end_segment);
-        else
-            sprintf(py_warning_message, "CRC data block failure detected, %ld blocks skipped, in segment %d.", num_blocks - blocks_decoded, start_segment);
-        
-        PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
-    }
-    
-    // Numpy double type specific - no need to do this if we use numpy integer array and
-    // put the data directly into it
-
-    // copy requested samples from last block to output buffer
-    for (i = 0; i < num_samps; i++) {
-        if (*(decomp_data + i) == RED_NAN)
-            *(numpy_arr_data + i) = NPY_NAN;
-        else
-            *(numpy_arr_data + i) = (sf8) *(decomp_data + i);
-    }
-    
-    // we're done with the compressed data, get rid of it
-    free (decomp_data);
-    free (temp_data_buf);
-    free (compressed_data_buffer);
-    free (rps->difference_buffer);
-    free (rps);
 
-	// free the meflib globals
-	free_meflib();
+    free (jobs);
 
     return (PyObject *) py_array_out;
 }
 
 /************************************************************************************/
-/****************************  MEF clean up functions  ******************************/
+/*************************  MEF streaming time series iterator  *********************/
 /************************************************************************************/
 
-static PyObject *clean_mef_session_metadata(PyObject *self, PyObject *args) {
-    SESSION     *session;
-    PyObject    *py_session_obj;
+static int ts_data_iterator_init(TS_DATA_ITERATOR *self, PyObject *args, PyObject *kwargs) {
+    // Specified by user
+    PyObject    *py_channel_obj;
+    PyObject    *ostart, *oend;
+    si8         chunk_samples;
 
-    // --- Parse the input --- 
-    if (!PyArg_ParseTuple(args,"O",
-                          &py_session_obj)){
-        return NULL;
-    }
-    session = (SESSION *) PyArray_DATA((PyArrayObject *) py_session_obj);
-    free_session(session, MEF_TRUE);
+    // Method specific variables
+    CHANNEL     *channel;
+    si8         start_samp, end_samp, n_samples, block_idx;
+    si4         seg_idx;
 
-    Py_RETURN_NONE;
-}
+    static char *kwlist[] = {"channel_specific_metadata", "chunk_samples", "start_sample", "end_sample", NULL};
 
-static PyObject *clean_mef_channel_metadata(PyObject *self, PyObject *args) {
-    CHANNEL     *channel;
-    PyObject    *py_channel_obj;
+    // Optional arguments
+    chunk_samples = 0;
+    ostart = oend = Py_None;
 
     // --- Parse the input --- 
-    if (!PyArg_ParseTuple(args,"O",
-                          &py_channel_obj)){
-        return NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|LOO",
+                                     kwlist,
+                                     &py_channel_obj,
+                                     &chunk_samples,
+                                     &ostart,
+                                     &oend)) {
+        return -1;
     }
-    channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
-    free_channel(channel, MEF_TRUE);
 
-    Py_RETURN_NONE;
-}
+    if (!PyArray_Check(py_channel_obj)) {
+        PyErr_SetString(PyExc_RuntimeError, "Channel metadata have to be a numpy array, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-static PyObject *clean_mef_segment_metadata(PyObject *self, PyObject *args) {
-    SEGMENT     *segment;
-    PyObject    *py_segment_obj;
+    channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
+    if (channel->channel_type != TIME_SERIES_CHANNEL_TYPE) {
+        PyErr_SetString(PyExc_RuntimeError, "Not a time series channel, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-    // --- Parse the input --- 
-    if (!PyArg_ParseTuple(args,"O",
-                          &py_segment_obj)){
-        return NULL;
+    if (chunk_samples < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Chunk samples can not be negative, exiting...");
+        PyErr_Occurred();
+        return -1;
     }
-    segment = (SEGMENT *) PyArray_DATA((PyArrayObject *) py_segment_obj);
-    free_segment(segment, MEF_TRUE);
 
+    n_samples = channel->metadata.time_series_section_2->number_of_samples;
+    start_samp = 0;
+    end_samp = n_samples;
+    if (ostart != Py_None)
+        start_samp = PyLong_AsLongLong(ostart);
+    if (oend != Py_None)
+        end_samp = PyLong_AsLongLong(oend);
+    if (PyErr_Occurred())
+        return -1;
+
+    if (start_samp < 0)
+        start_samp = 0;
+    if (end_samp > n_samples)
+        end_samp = n_samples;
+
+    // re-initialization releases the previous state
+    ts_iterator_free_c(self);
+    Py_XDECREF(self->py_channel_obj);
+
+    Py_INCREF(py_channel_obj);
+    self->py_channel_obj = py_channel_obj;
+    self->channel = channel;
+    self->chunk_samples = chunk_samples;
+    self->samples_remaining = (end_samp > start_samp) ? end_samp - start_samp : 0;
+    self->buffer_segment = -1;
+    self->crc_failures = 0;
+    self->decomp_len = self->decomp_pos = 0;
+
+    // buffers are bounded by the largest block of the channel
+    self->max_samps = channel->metadata.time_series_section_2->maximum_block_samples;
+    self->buffer_capacity = RED_MAX_COMPRESSED_BYTES(self->max_samps, 1);
+    if (self->buffer_capacity < TS_ITERATOR_BUFFER_BYTES)
+        self->buffer_capacity = TS_ITERATOR_BUFFER_BYTES;
+
+    self->compressed_buffer = (ui1 *) malloc((size_t) self->buffer_capacity);
+    self->decomp_buffer = (si4 *) malloc((size_t) ((self->max_samps + 1) * sizeof(si4)));
+    self->rps = (RED_PROCESSING_STRUCT *) calloc((size_t) 1, sizeof(RED_PROCESSING_STRUCT));
+    if (self->rps != NULL)
+        self->rps->difference_buffer = (si1 *) calloc((size_t) RED_MAX_DIFFERENCE_BYTES(self->max_samps) + 1, sizeof(ui1));
+    if ((self->compressed_buffer == NULL) || (self->decomp_buffer == NULL) || (self->rps == NULL) || (self->rps->difference_buffer == NULL)) {
+        ts_iterator_free_c(self);
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
+    self->rps->compression.mode = RED_DECOMPRESSION;
+
+    // position on the block containing the start sample
+    self->segment_idx = 0;
+    self->block_idx = 0;
+    if (self->samples_remaining > 0 && find_channel_block_c(channel, start_samp, MEF_TRUE, 0, &seg_idx, &block_idx) == MEF_TRUE) {
+        self->segment_idx = seg_idx;
+        self->block_idx = block_idx;
+
+        // skip the samples preceding start_samp in the first block
+        Py_BEGIN_ALLOW_THREADS
+        if (ts_iterator_load_block_c(self))
+            self->decomp_pos = (ui4) (start_samp - block_key_c(channel->segments + seg_idx, block_idx, MEF_TRUE, 0));
+        Py_END_ALLOW_THREADS
+    }
+
+    return 0;
+}
+
+static void ts_data_iterator_dealloc(TS_DATA_ITERATOR *self) {
+    ts_iterator_free_c(self);
+    Py_XDECREF(self->py_channel_obj);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *ts_data_iterator_close(TS_DATA_ITERATOR *self, PyObject *unused) {
+    ts_iterator_free_c(self);
+    self->samples_remaining = 0;
     Py_RETURN_NONE;
 }
 
-/************************************************************************************/
-/*******************************  Mapper functions  *********************************/
-/************************************************************************************/
+static PyObject *ts_data_iterator_next(TS_DATA_ITERATOR *self) {
+    // Python variables
+    PyArrayObject   *py_array_out, *py_array_part;
 
+    // Method specific variables
+    si8     n_out, n_filled, crc_failures;
+    si4     have_block;
+    si1     py_warning_message[256];
 
-/* Set of functions that map mef3 structures into python dictionaries and are
-hidden from the python api. Structures are in the same order as in meflib.h.*/
+    npy_intp dims[1];
 
-/* Notes for self - size_type X Python conversions
-mef3    Py_BuildValue   Python2C
-si1     "b"             (char) PyLong_AsLong
-ui1     "B"             (unsigned char) PyLong_AsLong
-si2     "h"             (short) PyLong_AsLong
-ui2     "H"             (unsigned short)PyLong_AsLong
-si4     "i"             (int) PyLong_AsLong
-ui4     "I"             (unsigned int) PyLong_AsLong
-si8     "l"             PyLong_AsLong
-ui8     "k"             PyLong_AsUnsignedLong
-sf4     "f"             (float) PyFloat_AsDouble
-sf8     "d"             PyFloat_AsDouble
-sf16     ?
+    if (self->samples_remaining <= 0 || self->rps == NULL)
+        return NULL;
 
----- for strings a bit more complicated
+    crc_failures = self->crc_failures;
 
-temp_UTF_str = PyUnicode_AsEncodedString(temp_o, "utf-8","strict"); // Encode to UTF-8 python objects
-temp_str_bytes = PyBytes_AS_STRING(temp_UTF_str); // Get the *char 
-MEF_strcpy(rh->type_string, temp_str_bytes); // assign to char that we want
+    // chunk size - either fixed or the rest of the current block
+    if (self->chunk_samples > 0) {
+        n_out = self->chunk_samples;
+    } else {
+        have_block = 1;
+        if (self->decomp_pos >= self->decomp_len) {
+            Py_BEGIN_ALLOW_THREADS
+            have_block = ts_iterator_load_block_c(self);
+            Py_END_ALLOW_THREADS
+        }
+        if (!have_block) {
+            self->samples_remaining = 0;
+            return NULL;
+        }
+        n_out = self->decomp_len - self->decomp_pos;
+    }
+    if (n_out > self->samples_remaining)
+        n_out = self->samples_remaining;
 
-*/
+    dims[0] = n_out;
+    py_array_out = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (py_array_out == NULL)
+        return NULL;
 
-/*****************************  Python to Mef struct  *******************************/
+    Py_BEGIN_ALLOW_THREADS
+    n_filled = ts_iterator_fill_c(self, (sf8 *) PyArray_DATA(py_array_out), n_out);
+    Py_END_ALLOW_THREADS
 
-// UNIVERSAL_HEADER *map_python_uh(PyObject *)
-// {
-// }
+    self->samples_remaining -= n_filled;
 
-// METADATA_SECTION_1 *map_python_md1(PyObject *md1_dict)
-// {
-// }
+    if (self->crc_failures > crc_failures) {
+        sprintf(py_warning_message, "CRC data block failure detected, %ld blocks skipped, in channel %s.", self->crc_failures - crc_failures, self->channel->name);
+        PyErr_WarnEx(PyExc_RuntimeWarning, py_warning_message, 1);
+    }
 
-void    map_python_tmd2(PyObject *tmd2_arr, TIME_SERIES_METADATA_SECTION_2 *tmd2) {
-    memcpy(tmd2, PyArray_DATA((PyArrayObject *) tmd2_arr), sizeof(TIME_SERIES_METADATA_SECTION_2));
-    return;
-}
+    if (n_filled == 0) {
+        Py_DECREF(py_array_out);
+        self->samples_remaining = 0;
+        return NULL;
+    }
 
-void    map_python_vmd2(PyObject *vmd2_arr, VIDEO_METADATA_SECTION_2 *vmd2) {
-    memcpy(vmd2, PyArray_DATA((PyArrayObject *) vmd2_arr), sizeof(VIDEO_METADATA_SECTION_2));
-    return;
-}
+    // data ended before the chunk was full
+    if (n_filled < n_out) {
+        self->samples_remaining = 0;
+        dims[0] = n_filled;
+        py_array_part = (PyArrayObject *) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+        if (py_array_part != NULL)
+            memcpy(PyArray_DATA(py_array_part), PyArray_DATA(py_array_out), (size_t) (n_filled * sizeof(sf8)));
+        Py_DECREF(py_array_out);
+        return (PyObject *) py_array_part;
+    }
 
-void    map_python_vi(PyObject *vi_arr, VIDEO_INDEX *vi) {
-    memcpy(vi, PyArray_DATA((PyArrayObject *) vi_arr), sizeof(VIDEO_INDEX)*PyArray_SHAPE((PyArrayObject *) vi_arr)[0]);
-    return;
+    return (PyObject *) py_array_out;
 }
 
-void    map_python_md3(PyObject *md3_arr, METADATA_SECTION_3 *md3) {
-    memcpy(md3, PyArray_DATA((PyArrayObject *) md3_arr), sizeof(METADATA_SECTION_3));
-    return;
-}
+/************************************************************************************/
+/*******************  MEF incremental time series segment writer  *******************/
+/************************************************************************************/
 
-// SEGMENT, CHANNEL, SESSION are constructed from the above when reading
+static int ts_segment_writer_init(TS_SEGMENT_WRITER *self, PyObject *args, PyObject *kwargs) {
+    // Specified by user
+    si1    *py_file_path;
+    PyObject    *py_pass_1_obj, *py_pass_2_obj;
+    si8    samps_per_mef_block;
+    si8    flush_blocks;
+    si4    n_threads;
+    sf8    scale;
 
-/**************************  Python record struct to Mef  ****************************/
+    PyObject *temp_UTF_str;
 
+    // Method specific
+    PASSWORD_DATA           *pwd;
+    FILE_PROCESSING_STRUCT  *metadata_fps;
+    TIME_SERIES_METADATA_SECTION_2  *tmd2;
 
-void    map_python_rh(PyObject *rh_arr, RECORD_HEADER  *rh) {
-    memcpy(rh, PyArray_DATA((PyArrayObject *) rh_arr), sizeof(RECORD_HEADER));
-    return;
-}
+    si1     level_1_password_arr[PASSWORD_BYTES] = {0};
+    si1     level_2_password_arr[PASSWORD_BYTES] = {0};
+    si1    *level_1_password;
+    si1    *level_2_password;
+    si1    *temp_str_bytes;
 
-void    map_python_EDFA_type(PyObject *EDFA_type_arr, MEFREC_EDFA_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) EDFA_type_arr), PyArray_ITEMSIZE((PyArrayObject *) EDFA_type_arr));
-    return;
-}
+    si1     path_in[MEF_FULL_FILE_NAME_BYTES], path_out[MEF_FULL_FILE_NAME_BYTES], name[MEF_BASE_FILE_NAME_BYTES], type[TYPE_BYTES];
+    si1     full_file_name[MEF_FULL_FILE_NAME_BYTES], file_path[MEF_FULL_FILE_NAME_BYTES], segment_name[MEF_BASE_FILE_NAME_BYTES];
+    si4     i;
 
-void    map_python_LNTP_type(PyObject *LNTP_type_arr, MEFREC_LNTP_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) LNTP_type_arr), PyArray_ITEMSIZE((PyArrayObject *) LNTP_type_arr));
-    return;
-}
+    static char *kwlist[] = {"target_path", "password_1", "password_2", "samples_per_mef_block", "flush_blocks", "n_threads", "scale", NULL};
 
-void    map_python_Siez_type(PyObject *Siez_type_arr, MEFREC_Seiz_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) Siez_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Siez_type_arr));
-    return;
-}
+    // Optional arguments
+    flush_blocks = 100;
+    n_threads = 1;
+    scale = 1.0;
 
-// NOTE: void r_type because we are mapping all entries
-void    map_python_Siez_ch_type(PyObject *Siez_ch_type_arr, si1 *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) Siez_ch_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Siez_ch_type_arr) * PyArray_SIZE((PyArrayObject *) Siez_ch_type_arr));
-    return;
-}   
+    // --- Parse the input --- 
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sOOL|Lid",
+                                     kwlist,
+                                     &py_file_path, // full path including segment
+                                     &py_pass_1_obj,
+                                     &py_pass_2_obj,
+                                     &samps_per_mef_block,
+                                     &flush_blocks,
+                                     &n_threads,
+                                     &scale)){
+        return -1;
+    }
 
-void    map_python_CSti_type(PyObject *CSti_type_arr, MEFREC_CSti_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) CSti_type_arr), PyArray_ITEMSIZE((PyArrayObject *) CSti_type_arr));
-    return;
-}
+    if (samps_per_mef_block < 1) {
+        PyErr_SetString(PyExc_RuntimeError, "Samples per MEF block have to be positive, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-void    map_python_ESti_type(PyObject *ESti_type_arr, MEFREC_ESti_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) ESti_type_arr), PyArray_ITEMSIZE((PyArrayObject *) ESti_type_arr));
-    return;
-}
+    // password entries
+    if (PyUnicode_Check(py_pass_1_obj)) {
+        temp_UTF_str = PyUnicode_AsEncodedString(py_pass_1_obj, "utf-8", "strict"); // Encode to UTF-8 python objects
+        temp_str_bytes = PyBytes_AS_STRING(temp_UTF_str); // Get the *char 
 
-void    map_python_Curs_type(PyObject *Curs_type_arr, MEFREC_Curs_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) Curs_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Curs_type_arr));
-    return;
-}
+        if (!*temp_str_bytes)
+            level_1_password = NULL;
+        else
+            level_1_password = strcpy(level_1_password_arr, temp_str_bytes);
 
-void    map_python_Epoc_type(PyObject *Epoc_type_arr, MEFREC_Epoc_1_0  *r_type) {
-    memcpy(r_type, PyArray_DATA((PyArrayObject *) Epoc_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Epoc_type_arr));
-    return;
-}
+		Py_DECREF(temp_UTF_str);	temp_UTF_str = NULL;
+    } else {
+        level_1_password = NULL;
+    }
 
+    if (PyUnicode_Check(py_pass_2_obj)) {
+        temp_UTF_str = PyUnicode_AsEncodedString(py_pass_2_obj, "utf-8", "strict"); // Encode to UTF-8 python objects
+        temp_str_bytes = PyBytes_AS_STRING(temp_UTF_str); // Get the *char 
 
-/*****************************  Mef struct to Python  *******************************/
+        if (!*temp_str_bytes)
+            level_2_password = NULL;
+        else
+            level_2_password = strcpy(level_2_password_arr, temp_str_bytes);
+	
+        Py_DECREF(temp_UTF_str);	temp_UTF_str = NULL;
+    } else {
+        level_2_password = NULL;
+    }
 
-// map a char array with a maximum number of byets) to a Python string
-PyObject *map_mef3_decode_maxbytes_to_string(const char *s, size_t max_size) {
-	size_t str_len = strnlen(s, max_size);
-	return map_mef3_decode_sizebytes_to_string(s, str_len);
-}
+    if ((level_1_password == NULL) && (level_2_password != NULL)) {
+        PyErr_SetString(PyExc_RuntimeError, "Level 2 password cannot be set without level 1 password.");
+        PyErr_Occurred();
+        return -1;
+    }
 
-// map a char array (while indicating the number of bytes) to a Python string
-PyObject *map_mef3_decode_sizebytes_to_string(const char *s, size_t size) {
-	PyObject *py_text;
-	
-	// try to decode as strict UTF-8 (perhaps missing UTF-8 follow up bytes and escaped hexidecimals)
-	py_text = PyUnicode_Decode(s, size, "utf-8", "strict");
-	if (py_text == NULL)
-		PyErr_Clear();
-	else
-		return py_text;
-	
-	/*
-	// try to decode as strict latin-1
-	py_text = PyUnicode_Decode(s, size, "latin-1", "strict");
-	if (py_text == NULL)
-		PyErr_Clear();
-	else
-		return py_text;
-	*/
-	
-	// try to decode as UTF-8 with backslashreplace
-	py_text = PyUnicode_Decode(s, size, "utf-8", "backslashreplace");
-	if (py_text == NULL)
-		PyErr_Clear();
-	else
-		return py_text;
+    // extract the segment name and check the directory-type (if indeed segment)
+    MEF_strncpy(file_path, py_file_path, MEF_FULL_FILE_NAME_BYTES);
+    extract_path_parts(file_path, path_out, name, type);
+    if (strcmp(type,SEGMENT_DIRECTORY_TYPE_STRING)) {
+        PyErr_SetString(PyExc_RuntimeError, "Not a segment, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
+    MEF_strncpy(segment_name, name, MEF_BASE_FILE_NAME_BYTES);
+    MEF_strncpy(path_in, path_out, MEF_FULL_FILE_NAME_BYTES);
+    extract_path_parts(path_in, path_out, name, type);
+    if (strcmp(type,TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING)) {
+        PyErr_SetString(PyExc_RuntimeError, "Not a time series channel, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-	// try to decode as UTF-8 with ignore
-	py_text = PyUnicode_Decode(s, size, "utf-8", "ignore");
-	if (py_text == NULL)
-		PyErr_Clear();
-	else
-		return py_text;
-	
-	// return empty string
-	return Py_BuildValue("s", "");
-	
-}
+    MEF_snprintf(full_file_name, MEF_FULL_FILE_NAME_BYTES, "%s/%s.%s", file_path, segment_name, TIME_SERIES_METADATA_FILE_TYPE_STRING);
+    if (access(full_file_name, F_OK) != 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Please write the metadata file first, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-PyObject *map_mef3_uh(UNIVERSAL_HEADER *uh, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-		
-		import_array();
-		
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {UNIVERSAL_HEADER_BYTES};
-		PyArray_Descr    *descr;
+    // re-initialization closes the previous segment
+    if (self->metadata_fps != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        (void) ts_writer_encode_c(self, MEF_TRUE);
+        ts_writer_flush_c(self);
+        Py_END_ALLOW_THREADS
+    }
+    ts_writer_free_c(self);
 
-		descr = (PyArray_Descr *) create_uh_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) uh, NPY_ARRAY_DEFAULT, Py_None);
-		
-	} else {
-		// python dictionary
+    // set up a generic mef3 fps and process the password data with it
+    self->gen_fps = allocate_file_processing_struct(UNIVERSAL_HEADER_BYTES, NO_FILE_TYPE_CODE, NULL, NULL, 0);
+    initialize_universal_header(self->gen_fps, MEF_TRUE, MEF_FALSE, MEF_TRUE);
+    suppress_mef_errors_c();
+    pwd = process_password_data(NULL, level_1_password, level_2_password, self->gen_fps->universal_header);
+    restore_mef_errors_c();
+    self->password_data = *pwd;
+    pwd = &self->password_data;
+
+    // existing time-series metadata file, read while no other writer uses the recording time offset of MEF_globals
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(0, MEF_TRUE);
+    Py_END_ALLOW_THREADS
+    metadata_fps = read_MEF_file(NULL, full_file_name, level_1_password, pwd, NULL, USE_GLOBAL_BEHAVIOR);
+    unlock_mef_globals_c();
+    metadata_fps->password_data = pwd;
+    self->metadata_fps = metadata_fps;
+    self->recording_time_offset = metadata_fps->metadata.section_3->recording_time_offset;
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_BUILD(py_array_out, "header_CRC",             "I", uh->header_CRC)
-		PY_DICTSET_BUILD(py_array_out, "body_CRC",               "I", uh->body_CRC);
-		PY_DICTSET_BUILD(py_array_out, "file_type_string",       "s", uh->file_type_string);
-		PY_DICTSET_BUILD(py_array_out, "mef_version_major",      "B", uh->mef_version_major);
-		PY_DICTSET_BUILD(py_array_out, "mef_version_minor",      "B", uh->mef_version_minor);
-		PY_DICTSET_BUILD(py_array_out, "byte_order_code",        "B", uh->byte_order_code);
-		PY_DICTSET_LONG (py_array_out, "start_time",                  uh->start_time);
-		PY_DICTSET_LONG (py_array_out, "end_time",                    uh->end_time);
-		PY_DICTSET_LONG (py_array_out, "number_of_entries",           uh->number_of_entries);
-		PY_DICTSET_LONG (py_array_out, "maximum_entry_size",          uh->maximum_entry_size);
-		PY_DICTSET_BUILD(py_array_out, "segment_number",         "i", uh->segment_number);
-		PY_DICTSET_FUNC (py_array_out, "channel_name",                map_mef3_decode_maxbytes_to_string(uh->channel_name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "session_name",                map_mef3_decode_maxbytes_to_string(uh->session_name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "anonymized_name",             map_mef3_decode_maxbytes_to_string(uh->anonymized_name, UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES));
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",            uh->level_UUID, UUID_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "file_UUID",             uh->file_UUID, UUID_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "provenance_UUID",       uh->provenance_UUID, UUID_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_1_password_validation_field",   uh->level_1_password_validation_field, PASSWORD_VALIDATION_FIELD_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_2_password_validation_field",   uh->level_2_password_validation_field, PASSWORD_VALIDATION_FIELD_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",      uh->protected_region, UNIVERSAL_HEADER_PROTECTED_REGION_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",  uh->discretionary_region, UNIVERSAL_HEADER_DISCRETIONARY_REGION_BYTES);
-		
-	}
+    tmd2 = metadata_fps->metadata.time_series_section_2;
+    tmd2->number_of_samples = 0;
+    tmd2->number_of_blocks = 0;
+    tmd2->maximum_block_samples = (ui4) samps_per_mef_block;
+    tmd2->maximum_block_bytes = 0;
+    tmd2->maximum_difference_bytes = 0;
+    tmd2->number_of_discontinuities = 0;
+    tmd2->maximum_contiguous_blocks = 0;
+    tmd2->maximum_contiguous_block_bytes = 0;
+    tmd2->maximum_contiguous_samples = 0;
+
+    // time-series indices file - only the universal header is kept, the entries are appended
+    self->ts_idx_fps = allocate_file_processing_struct(UNIVERSAL_HEADER_BYTES, TIME_SERIES_INDICES_FILE_TYPE_CODE, NULL, metadata_fps, UNIVERSAL_HEADER_BYTES);
+    MEF_snprintf(self->ts_idx_fps->full_file_name, MEF_FULL_FILE_NAME_BYTES, "%s/%s.%s", file_path, segment_name, TIME_SERIES_INDICES_FILE_TYPE_STRING);
+    self->ts_idx_fps->password_data = pwd;
+    generate_UUID(self->ts_idx_fps->universal_header->file_UUID);
+    self->ts_idx_fps->universal_header->number_of_entries = 0;
+    self->ts_idx_fps->universal_header->maximum_entry_size = TIME_SERIES_INDEX_BYTES;
+    self->ts_idx_fps->directives.io_bytes = UNIVERSAL_HEADER_BYTES;
+    self->ts_idx_fps->directives.close_file = MEF_FALSE;
+    write_MEF_file(self->ts_idx_fps);
+
+    // time-series data file
+    self->ts_data_fps = allocate_file_processing_struct(UNIVERSAL_HEADER_BYTES, TIME_SERIES_DATA_FILE_TYPE_CODE, NULL, metadata_fps, UNIVERSAL_HEADER_BYTES);
+    MEF_snprintf(self->ts_data_fps->full_file_name, MEF_FULL_FILE_NAME_BYTES, "%s/%s.%s", file_path, segment_name, TIME_SERIES_DATA_FILE_TYPE_STRING);
+    self->ts_data_fps->password_data = pwd;
+    generate_UUID(self->ts_data_fps->universal_header->file_UUID);
+    self->ts_data_fps->universal_header->number_of_entries = 0;
+    self->ts_data_fps->universal_header->maximum_entry_size = samps_per_mef_block;
+    self->ts_data_fps->directives.io_bytes = UNIVERSAL_HEADER_BYTES;
+    self->ts_data_fps->directives.close_file = MEF_FALSE;
+    write_MEF_file(self->ts_data_fps);
+
+    // body CRCs are accumulated as the blocks and the indices are appended
+    self->ts_data_fps->universal_header->body_CRC = CRC_START_VALUE;
+    self->ts_idx_fps->universal_header->body_CRC = CRC_START_VALUE;
+
+    // encoding state
+    if (n_threads <= 0)
+        n_threads = get_cpu_count_c();
+    if (n_threads < 1)
+        n_threads = 1;
+    self->n_threads = n_threads;
+    self->block_samps = (ui4) samps_per_mef_block;
+    self->max_block_samps = (ui4) samps_per_mef_block;
+    self->max_batch_blocks = (si8) n_threads * RED_ENCODE_BATCH_BLOCKS;
+    self->time_inc = (si8) (((sf8) samps_per_mef_block / tmd2->sampling_frequency) * (sf8) 1e6);
+    self->next_block_time = self->end_time = metadata_fps->universal_header->start_time;
+    self->discontinuity = MEF_TRUE;
+    self->n_discontinuities = 0;
+    self->contiguous_blocks = 0;
+    self->contiguous_block_bytes = 0;
+    self->contiguous_samples = 0;
+    self->n_blocks = 0;
+    self->n_written_samples = 0;
+    self->n_samples = 0;
+    self->file_offset = UNIVERSAL_HEADER_BYTES;
+    self->min_samp = RED_POSITIVE_INFINITY;
+    self->max_samp = RED_NEGATIVE_INFINITY;
+    self->flush_blocks = (flush_blocks > 0) ? flush_blocks : 0;
+    self->scale = scale;
+    self->blocks_since_flush = 0;
+
+    self->samples_capacity = samps_per_mef_block;
+    self->samples = (si4 *) malloc((size_t) (self->samples_capacity * sizeof(si4)));
+    self->metadata_snapshot = (ui1 *) malloc((size_t) metadata_fps->raw_data_bytes);
+    self->batch_blocks = (ui1 *) calloc((size_t) (self->max_batch_blocks + 1), (size_t) RED_MAX_COMPRESSED_BYTES(samps_per_mef_block, 1));
+    self->batch_tsi = (TIME_SERIES_INDEX *) calloc((size_t) self->max_batch_blocks, sizeof(TIME_SERIES_INDEX));
+    self->workers = (RED_ENCODE_WORKER *) calloc((size_t) n_threads, sizeof(RED_ENCODE_WORKER));
+    if ((self->samples == NULL) || (self->metadata_snapshot == NULL) || (self->batch_blocks == NULL) || (self->batch_tsi == NULL) || (self->workers == NULL)) {
+        ts_writer_free_c(self);
+        PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
+    for (i = 0; i < n_threads; i++) {
+        self->workers[i].rps = allocate_encoder_rps_c(samps_per_mef_block, NULL, pwd);
+        self->workers[i].blocks = self->batch_blocks;
+        self->workers[i].slot_bytes = RED_MAX_COMPRESSED_BYTES(samps_per_mef_block, 1);
+        self->workers[i].tsi = self->batch_tsi;
+        self->workers[i].block_samps = (ui4) samps_per_mef_block;
+        self->workers[i].time_inc = self->time_inc;
+        self->workers[i].first_block = i;
+        self->workers[i].block_step = n_threads;
+    }
 
-    return py_array_out;
+    // valid (empty) segment from the start
+    Py_BEGIN_ALLOW_THREADS
+    ts_writer_flush_c(self);
+    Py_END_ALLOW_THREADS
+
+    return 0;
 }
 
-PyObject *map_mef3_md1(METADATA_SECTION_1 *md1, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-
-		import_array();
-		
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {METADATA_SECTION_1_BYTES};
-		PyArray_Descr    *descr;
+static void ts_segment_writer_dealloc(TS_SEGMENT_WRITER *self) {
+    if (self->metadata_fps != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        (void) ts_writer_encode_c(self, MEF_TRUE);
+        ts_writer_flush_c(self);
+        Py_END_ALLOW_THREADS
+    }
+    ts_writer_free_c(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
 
-		descr = (PyArray_Descr *) create_md1_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) md1, NPY_ARRAY_DEFAULT, Py_None);
+static PyObject *ts_segment_writer_write(TS_SEGMENT_WRITER *self, PyObject *args) {
+    // Specified by user
+    PyArrayObject   *raw_data;
+    PyObject    *py_start_time;
 
-	} else {
-		// python dictionary
+    // Method specific
+    si8     n_new, capacity, start_time, expected_time, n_clipped;
+    si4     *samples, array_type;
+    sf8     fs;
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_BUILD(py_array_out, "section_2_encryption",   "b", md1->section_2_encryption);
-		PY_DICTSET_BUILD(py_array_out, "section_3_encryption",   "b", md1->section_3_encryption);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",      md1->protected_region, METADATA_SECTION_1_PROTECTED_REGION_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",  md1->discretionary_region, METADATA_SECTION_1_DISCRETIONARY_REGION_BYTES);
-		
-	}
-	
-    return py_array_out;
-}
+    // Optional arguments
+    py_start_time = NULL;
 
-PyObject *map_mef3_tmd2(TIME_SERIES_METADATA_SECTION_2 *tmd2, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-	
-		import_array();
-		
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {METADATA_SECTION_2_BYTES};
-		PyArray_Descr    *descr;
+    if (!PyArg_ParseTuple(args,"O!|O",
+                          &PyArray_Type,
+                          &raw_data,
+                          &py_start_time)){
+        return NULL;
+    }
 
-		descr = (PyArray_Descr *) create_tmd2_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) tmd2, NPY_ARRAY_DEFAULT, Py_None);
+    if (self->metadata_fps == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Writer is closed, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
 
-	} else {
-		// python dictionary
+    array_type = writer_sample_type_c((PyObject *) raw_data);
+    if (array_type < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Incorrect data type. Please provide 1D integer or float NumPy array in native byte order!");
+        PyErr_Occurred();
+        return NULL;
+    }
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_FUNC (py_array_out, "channel_description",                 map_mef3_decode_maxbytes_to_string(tmd2->channel_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "session_description",                 map_mef3_decode_maxbytes_to_string(tmd2->session_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
-		PY_DICTSET_LONG (py_array_out, "recording_duration",                  tmd2->recording_duration);
+    // a chunk starting at least one sample period after the buffered samples starts a new contiguous range
+    if (py_start_time != NULL && py_start_time != Py_None) {
+        start_time = PyLong_AsLongLong(py_start_time);
+        if (PyErr_Occurred())
+            return NULL;
 
-		PY_DICTSET_FUNC (py_array_out, "reference_description",               map_mef3_decode_maxbytes_to_string(tmd2->reference_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
-		PY_DICTSET_LONG (py_array_out, "acquisition_channel_number",          tmd2->acquisition_channel_number);
-		PY_DICTSET_BUILD(py_array_out, "sampling_frequency",             "d", tmd2->sampling_frequency);
-		PY_DICTSET_BUILD(py_array_out, "low_frequency_filter_setting",   "d", tmd2->low_frequency_filter_setting);
-		PY_DICTSET_BUILD(py_array_out, "high_frequency_filter_setting",  "d", tmd2->high_frequency_filter_setting);
-		PY_DICTSET_BUILD(py_array_out, "notch_filter_frequency_setting", "d", tmd2->notch_filter_frequency_setting);
-		PY_DICTSET_BUILD(py_array_out, "AC_line_frequency",              "d", tmd2->AC_line_frequency);
-		PY_DICTSET_BUILD(py_array_out, "units_conversion_factor",        "d", tmd2->units_conversion_factor);
-		PY_DICTSET_FUNC (py_array_out, "units_description",                   map_mef3_decode_maxbytes_to_string(tmd2->units_description, TIME_SERIES_METADATA_UNITS_DESCRIPTION_BYTES));
-		PY_DICTSET_BUILD(py_array_out, "maximum_native_sample_value",    "d", tmd2->maximum_native_sample_value);
-		PY_DICTSET_BUILD(py_array_out, "minimum_native_sample_value",    "d", tmd2->minimum_native_sample_value);
-		PY_DICTSET_LONG (py_array_out, "start_sample",                        tmd2->start_sample);
-		PY_DICTSET_LONG (py_array_out, "number_of_samples",                   tmd2->number_of_samples);
-		PY_DICTSET_LONG (py_array_out, "number_of_blocks",                    tmd2->number_of_blocks);
-		PY_DICTSET_LONG (py_array_out, "maximum_block_bytes",                 tmd2->maximum_block_bytes);		
-		PY_DICTSET_BUILD(py_array_out, "maximum_block_samples",          "I", tmd2->maximum_block_samples);
-		PY_DICTSET_BUILD(py_array_out, "maximum_difference_bytes",       "I", tmd2->maximum_difference_bytes);
-		PY_DICTSET_LONG (py_array_out, "block_interval",                      tmd2->block_interval);
-		PY_DICTSET_LONG (py_array_out, "number_of_discontinuities",           tmd2->number_of_discontinuities);
-		PY_DICTSET_LONG (py_array_out, "maximum_contiguous_blocks",           tmd2->maximum_contiguous_blocks);
-		PY_DICTSET_LONG (py_array_out, "maximum_contiguous_block_bytes",      tmd2->maximum_contiguous_block_bytes);
-		PY_DICTSET_LONG (py_array_out, "maximum_contiguous_samples",          tmd2->maximum_contiguous_samples);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",              tmd2->protected_region, TIME_SERIES_METADATA_SECTION_2_PROTECTED_REGION_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",          tmd2->discretionary_region, TIME_SERIES_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
-		
-	}
-	
-    return py_array_out;
-}
+        fs = self->metadata_fps->metadata.time_series_section_2->sampling_frequency;
+        expected_time = self->next_block_time + (si8) (((sf8) self->n_samples / fs) * 1e6);
+        if (self->n_blocks == 0 && self->n_samples == 0) {
+            self->next_block_time = start_time;
+        } else if (start_time - expected_time <= -(si8) (1e6 / fs)) {
+            PyErr_SetString(PyExc_RuntimeError, "Chunk start time overlaps the data already written, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        } else if (start_time - expected_time >= (si8) (1e6 / fs)) {
+            // the buffered samples become the last (shorter) block of the previous range
+            Py_BEGIN_ALLOW_THREADS
+            (void) ts_writer_encode_c(self, MEF_TRUE);
+            Py_END_ALLOW_THREADS
+            self->next_block_time = start_time;
+            self->discontinuity = MEF_TRUE;
+        }
+    }
 
-PyObject *map_mef3_vmd2(VIDEO_METADATA_SECTION_2 *vmd2, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
+    n_new = (si8) PyArray_SHAPE(raw_data)[0];
 
-		import_array();
+    // room for the chunk behind the samples left over from the previous write
+    if (self->n_samples + n_new > self->samples_capacity) {
+        capacity = self->samples_capacity;
+        while (capacity < self->n_samples + n_new)
+            capacity *= 2;
+        samples = (si4 *) realloc(self->samples, (size_t) (capacity * sizeof(si4)));
+        if (samples == NULL) {
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        }
+        self->samples = samples;
+        self->samples_capacity = capacity;
+    }
 
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {METADATA_SECTION_2_BYTES};
-		PyArray_Descr    *descr;
+    // converted behind the samples left over from the previous write, full blocks are encoded and appended right away
+    Py_BEGIN_ALLOW_THREADS
+    n_clipped = convert_to_si4_c((ui1 *) PyArray_BYTES(raw_data), (si8) PyArray_STRIDES(raw_data)[0], array_type, self->scale, self->samples + self->n_samples, n_new);
+    self->n_samples += n_new;
+    (void) ts_writer_encode_c(self, MEF_FALSE);
+    Py_END_ALLOW_THREADS
 
-		descr = (PyArray_Descr *) create_vmd2_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) vmd2, NPY_ARRAY_DEFAULT, Py_None);
+    if (n_clipped > 0)
+        PyErr_WarnEx(PyExc_RuntimeWarning, "Samples out of the int32 range were clipped", 1);
 
-	} else {
-		// python dictionary
+    if (self->flush_blocks > 0 && self->blocks_since_flush >= self->flush_blocks) {
+        Py_BEGIN_ALLOW_THREADS
+        ts_writer_flush_c(self);
+        Py_END_ALLOW_THREADS
+    }
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_FUNC (py_array_out, "channel_description",                 map_mef3_decode_maxbytes_to_string(vmd2->channel_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "session_description",                 map_mef3_decode_maxbytes_to_string(vmd2->session_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
-		PY_DICTSET_LONG (py_array_out, "recording_duration",                  vmd2->recording_duration);
-		
-		PY_DICTSET_LONG (py_array_out, "horizontal_resolution",               vmd2->horizontal_resolution);
-		PY_DICTSET_LONG (py_array_out, "vertical_resolution",                 vmd2->vertical_resolution);
-		PY_DICTSET_BUILD(py_array_out, "frame_rate",                     "d", vmd2->frame_rate);
-		PY_DICTSET_LONG (py_array_out, "number_of_clips",                     vmd2->number_of_clips);
-		PY_DICTSET_LONG (py_array_out, "maximum_clip_bytes",                  vmd2->maximum_clip_bytes);
-		PY_DICTSET_FUNC (py_array_out, "video_format",                        map_mef3_decode_maxbytes_to_string(vmd2->video_format, VIDEO_METADATA_VIDEO_FORMAT_BYTES));
-		PY_DICTSET_BUILD(py_array_out, "video_file_CRC",                 "I", vmd2->video_file_CRC);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",              vmd2->protected_region, VIDEO_METADATA_SECTION_2_PROTECTED_REGION_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",          vmd2->discretionary_region, VIDEO_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
-		
-	}
-	
-    return py_array_out;
+    Py_RETURN_NONE;
 }
 
-PyObject *map_mef3_md3(METADATA_SECTION_3 *md3, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-		
-		import_array();
+static PyObject *ts_segment_writer_copy_blocks(TS_SEGMENT_WRITER *self, PyObject *args) {
+    // Specified by user
+    PyObject    *py_channel_obj;
+    si8     first_block, n_blocks;
 
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {METADATA_SECTION_3_BYTES};
-		PyArray_Descr    *descr;
+    // Method specific
+    CHANNEL     *channel;
+    si4     result;
 
-		descr = (PyArray_Descr *) create_md3_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) md3, NPY_ARRAY_DEFAULT, Py_None);
+    if (!PyArg_ParseTuple(args,"OLL",
+                          &py_channel_obj,
+                          &first_block,
+                          &n_blocks)){
+        return NULL;
+    }
 
-	} else {
-		// python dictionary
+    if (self->metadata_fps == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Writer is closed, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_LONG (py_array_out, "recording_time_offset",       md3->recording_time_offset);
-		PY_DICTSET_LONG (py_array_out, "DST_start_time",              md3->DST_start_time);
-		PY_DICTSET_LONG (py_array_out, "DST_end_time",                md3->DST_end_time);
-		PY_DICTSET_BUILD(py_array_out, "GMT_offset",             "i", md3->GMT_offset);
-		PY_DICTSET_FUNC (py_array_out, "subject_name_1",              map_mef3_decode_maxbytes_to_string(md3->subject_name_1, METADATA_SUBJECT_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "subject_name_2",              map_mef3_decode_maxbytes_to_string(md3->subject_name_2, METADATA_SUBJECT_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "subject_ID",                  map_mef3_decode_maxbytes_to_string(md3->subject_ID, METADATA_SUBJECT_ID_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "recording_location",          map_mef3_decode_maxbytes_to_string(md3->recording_location, METADATA_RECORDING_LOCATION_BYTES));
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",      md3->protected_region, METADATA_SECTION_3_PROTECTED_REGION_BYTES);
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",  md3->discretionary_region, METADATA_SECTION_3_DISCRETIONARY_REGION_BYTES);
-		
-	}
-	
-    return py_array_out;
-}
+    channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
+    if (channel->channel_type != TIME_SERIES_CHANNEL_TYPE) {
+        PyErr_SetString(PyExc_RuntimeError, "Not a time series channel, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
 
-// TODO - call number of entries from the parent dtype
-PyObject *map_mef3_ti(TIME_SERIES_INDEX *ti, si8 number_of_entries, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-			
-		import_array();
+    Py_BEGIN_ALLOW_THREADS
+    result = ts_writer_copy_blocks_c(self, channel, first_block, n_blocks);
+    Py_END_ALLOW_THREADS
 
-		npy_intp dims[] = {number_of_entries};
-		npy_intp strides[] = {TIME_SERIES_INDEX_BYTES};
-		PyArray_Descr    *descr;
+    switch (result) {
+        case TS_COPY_OK:
+            break;
+        case TS_COPY_KEY_MISMATCH:
+        case TS_COPY_OFFSET_MISMATCH:
+            Py_RETURN_FALSE;
+        case TS_COPY_INVALID_RANGE:
+            PyErr_SetString(PyExc_RuntimeError, "Blocks out of the channel range, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        case TS_COPY_MEMORY_ERROR:
+            PyErr_SetString(PyExc_RuntimeError, "Memory allocation error, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        case TS_COPY_OVERLAP:
+            PyErr_SetString(PyExc_RuntimeError, "Copied blocks overlap the data already written, exiting...");
+            PyErr_Occurred();
+            return NULL;
+        default:
+            PyErr_SetString(PyExc_RuntimeError, "Could not read the blocks from the data file, exiting...");
+            PyErr_Occurred();
+            return NULL;
+    }
 
-		descr = (PyArray_Descr *) create_ti_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) ti, NPY_ARRAY_DEFAULT, Py_None);
+    if (self->flush_blocks > 0 && self->blocks_since_flush >= self->flush_blocks) {
+        Py_BEGIN_ALLOW_THREADS
+        ts_writer_flush_c(self);
+        Py_END_ALLOW_THREADS
+    }
 
-	} else {
-		// python dictionary
+    Py_RETURN_TRUE;
+}
 
-		py_array_out = PyList_New(number_of_entries);
-		PyObject *py_value_obj;
-		PyObject *py_ti_entry_dict;
+static PyObject *ts_segment_writer_flush(TS_SEGMENT_WRITER *self, PyObject *unused) {
+    if (self->metadata_fps == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Writer is closed, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
 
-		TIME_SERIES_INDEX *ti_entry = ti;
-		for (int i = 0; i < number_of_entries; ++i) {
+    Py_BEGIN_ALLOW_THREADS
+    ts_writer_flush_c(self);
+    Py_END_ALLOW_THREADS
 
-			py_ti_entry_dict = PyDict_New();
+    Py_RETURN_NONE;
+}
 
-			PY_DICTSET_LONG (py_ti_entry_dict, "file_offset",                           ti_entry->file_offset);
-			PY_DICTSET_LONG (py_ti_entry_dict, "start_time",                            ti_entry->start_time);
-			PY_DICTSET_LONG (py_ti_entry_dict, "start_sample",                          ti_entry->start_sample);
-			PY_DICTSET_BUILD(py_ti_entry_dict, "number_of_samples",                "I", ti_entry->number_of_samples);
-			PY_DICTSET_BUILD(py_ti_entry_dict, "block_bytes",                      "I", ti_entry->block_bytes);
-			PY_DICTSET_BUILD(py_ti_entry_dict, "maximum_sample_value",             "i", ti_entry->maximum_sample_value);
-			PY_DICTSET_BUILD(py_ti_entry_dict, "minimum_sample_value",             "i", ti_entry->minimum_sample_value);
-			PY_DICTSET_BYTEARRSIZE(py_ti_entry_dict, "protected_region",                ti_entry->protected_region, TIME_SERIES_INDEX_PROTECTED_REGION_BYTES);
-			PY_DICTSET_BUILD(py_ti_entry_dict, "RED_block_flags",                  "B", ti_entry->RED_block_flags);
-			PY_DICTSET_BYTEARRSIZE(py_ti_entry_dict, "RED_block_protected_region",      ti_entry->RED_block_protected_region, RED_BLOCK_PROTECTED_REGION_BYTES);
-			PY_DICTSET_BYTEARRSIZE(py_ti_entry_dict, "RED_block_discretionary_region",  ti_entry->RED_block_discretionary_region, RED_BLOCK_DISCRETIONARY_REGION_BYTES);
-			
-			PyList_SET_ITEM(py_array_out, i, py_ti_entry_dict); 	// steals reference 'py_ti_entry_dict'
+static PyObject *ts_segment_writer_close(TS_SEGMENT_WRITER *self, PyObject *unused) {
+    if (self->metadata_fps != NULL) {
+        // the rest of the buffer becomes the last (shorter) block
+        Py_BEGIN_ALLOW_THREADS
+        (void) ts_writer_encode_c(self, MEF_TRUE);
+        ts_writer_flush_c(self);
+        Py_END_ALLOW_THREADS
+    }
+    ts_writer_free_c(self);
 
-			// next entry
-			ti_entry += 1;
-			
-		}
-		
-	}
-	
-    return py_array_out;
+    Py_RETURN_NONE;
 }
 
-// TODO - call number of entries from the parent dtype
-PyObject *map_mef3_vi(VIDEO_INDEX *vi, si8 number_of_entries, si1 copy_metadata_to_dict) {
-	PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-			
-		import_array();
+static PyObject *ts_segment_writer_enter(TS_SEGMENT_WRITER *self, PyObject *unused) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
 
-		npy_intp dims[] = {number_of_entries};
-		npy_intp strides[] = {VIDEO_INDEX_BYTES};
-		PyArray_Descr    *descr;
+static PyObject *ts_segment_writer_exit(TS_SEGMENT_WRITER *self, PyObject *args) {
+    return ts_segment_writer_close(self, NULL);
+}
 
-		descr = (PyArray_Descr *) create_vi_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) vi, NPY_ARRAY_DEFAULT, Py_None);
-
-	} else {
-		// python dictionary
+/************************************************************************************/
+/****************************  MEF clean up functions  ******************************/
+/************************************************************************************/
 
-		py_array_out = PyList_New(number_of_entries);
-		PyObject *py_value_obj;
-		PyObject *py_vi_entry_dict;
+static PyObject *clean_mef_session_metadata(PyObject *self, PyObject *args) {
+    SESSION     *session;
+    PyObject    *py_session_obj;
 
-		VIDEO_INDEX *vi_entry = vi;
-		for (int i = 0; i < number_of_entries; ++i) {
+    // --- Parse the input --- 
+    if (!PyArg_ParseTuple(args,"O",
+                          &py_session_obj)){
+        return NULL;
+    }
+    session = (SESSION *) PyArray_DATA((PyArrayObject *) py_session_obj);
+    free_session(session, MEF_TRUE);
 
-			py_vi_entry_dict = PyDict_New();
+    Py_RETURN_NONE;
+}
 
-			PY_DICTSET_LONG (py_vi_entry_dict, "start_time",                      vi_entry->start_time);
-			PY_DICTSET_LONG (py_vi_entry_dict, "end_time",                        vi_entry->end_time);
-			PY_DICTSET_BUILD(py_vi_entry_dict, "start_frame",                "I", vi_entry->start_frame);
-			PY_DICTSET_BUILD(py_vi_entry_dict, "end_frame",                  "I", vi_entry->end_frame);
-			PY_DICTSET_LONG (py_vi_entry_dict, "file_offset",                     vi_entry->file_offset);
-			PY_DICTSET_LONG (py_vi_entry_dict, "clip_bytes",                      vi_entry->clip_bytes);
-			PY_DICTSET_BYTEARRSIZE(py_vi_entry_dict, "protected_region",          vi_entry->protected_region, VIDEO_INDEX_PROTECTED_REGION_BYTES);
-			PY_DICTSET_BYTEARRSIZE(py_vi_entry_dict, "discretionary_region",      vi_entry->discretionary_region, VIDEO_INDEX_DISCRETIONARY_REGION_BYTES);
-			
-			PyList_SET_ITEM(py_array_out, i, py_vi_entry_dict); 	// steals reference 'py_ti_entry_dict'
+static PyObject *clean_mef_channel_metadata(PyObject *self, PyObject *args) {
+    CHANNEL     *channel;
+    PyObject    *py_channel_obj;
 
-			// next entry
-			vi_entry += 1;
-			
-		}
-		
-	}
+    // --- Parse the input --- 
+    if (!PyArg_ParseTuple(args,"O",
+                          &py_channel_obj)){
+        return NULL;
+    }
+    channel = (CHANNEL *) PyArray_DATA((PyArrayObject *) py_channel_obj);
+    free_channel(channel, MEF_TRUE);
 
-    return py_array_out;
+    Py_RETURN_NONE;
 }
 
-PyObject *create_mef3_TOC(SEGMENT *segment) {
+static PyObject *clean_mef_segment_metadata(PyObject *self, PyObject *args) {
+    SEGMENT     *segment;
+    PyObject    *py_segment_obj;
 
-    PyArrayObject *py_array_out;
-    TIME_SERIES_INDEX     *tsi;
+    // --- Parse the input --- 
+    if (!PyArg_ParseTuple(args,"O",
+                          &py_segment_obj)){
+        return NULL;
+    }
+    segment = (SEGMENT *) PyArray_DATA((PyArrayObject *) py_segment_obj);
+    free_segment(segment, MEF_TRUE);
 
-    si8     number_of_entries;
-    si8     prev_time, prev_sample, start_time, start_sample, samp_time_diff, seg_start_sample;
-    ui4     n_samples;
-    sf8     fs;
-    si8     *numpy_arr_data;
-    npy_intp dims[2];
-    si4     i;
-    
-    // initialize Numpy
-    import_array();
+    Py_RETURN_NONE;
+}
 
-    number_of_entries = segment->time_series_indices_fps->universal_header->number_of_entries;
-    tsi = segment->time_series_indices_fps->time_series_indices;
-    fs = segment->metadata_fps->metadata.time_series_section_2->sampling_frequency;
-    prev_time = tsi->start_time;
-    prev_sample = tsi->start_sample;
-    seg_start_sample = segment->metadata_fps->metadata.time_series_section_2->start_sample;
+/************************************************************************************/
+/*******************************  Mapper functions  *********************************/
+/************************************************************************************/
 
-    // Create NumPy array and get pointer to data
-    dims[0] = 4;
-    dims[1] = number_of_entries;
-    
-    py_array_out = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_INT64);
-    numpy_arr_data = (si8 *) PyArray_GETPTR2(py_array_out, 0, 0);
 
-    for(i = 0; i < number_of_entries; i++) {
+/* Set of functions that map mef3 structures into python dictionaries and are
+hidden from the python api. Structures are in the same order as in meflib.h.*/
 
-        start_time = tsi->start_time;
-        start_sample = tsi->start_sample;
-        start_sample += seg_start_sample;
-        n_samples = tsi->number_of_samples;
-
-        // Have we found a discontinuity?
-        numpy_arr_data = (si8 *) PyArray_GETPTR2(py_array_out, 0, i);
-        samp_time_diff = (si8) (((start_time - prev_time) - (1e6 * (start_sample - prev_sample)) / fs));
-        if (samp_time_diff < (si8) (1e6/fs))
-            samp_time_diff = 0;
-        if  ((samp_time_diff != 0) | (i == 0)) // First entry is dicontinuity by definition
-            *numpy_arr_data = 1;
-        else
-            *numpy_arr_data = 0;
+/* Notes for self - size_type X Python conversions
+mef3    Py_BuildValue   Python2C
+si1     "b"             (char) PyLong_AsLong
+ui1     "B"             (unsigned char) PyLong_AsLong
+si2     "h"             (short) PyLong_AsLong
+ui2     "H"             (unsigned short)PyLong_AsLong
+si4     "i"             (int) PyLong_AsLong
+ui4     "I"             (unsigned int) PyLong_AsLong
+si8     "l"             PyLong_AsLong
+ui8     "k"             PyLong_AsUnsignedLong
+sf4     "f"             (float) PyFloat_AsDouble
+sf8     "d"             PyFloat_AsDouble
+sf16     ?
 
-        // Number of samples of the block
-        numpy_arr_data = (si8 *) PyArray_GETPTR2(py_array_out, 1, i);
-        *numpy_arr_data = (si8) n_samples;
+---- for strings a bit more complicated
 
-        // Start sample
-        numpy_arr_data = (si8 *) PyArray_GETPTR2(py_array_out, 2, i);
-        *numpy_arr_data = (si8) start_sample;
+temp_UTF_str = PyUnicode_AsEncodedString(temp_o, "utf-8","strict"); // Encode to UTF-8 python objects
+temp_str_bytes = PyBytes_AS_STRING(temp_UTF_str); // Get the *char 
+MEF_strcpy(rh->type_string, temp_str_bytes); // assign to char that we want
 
-        // Start time
-        numpy_arr_data = (si8 *) PyArray_GETPTR2(py_array_out, 3, i);
-        *numpy_arr_data = (si8) start_time;
+*/
 
-        prev_time = start_time;
-        prev_sample = start_sample;
-        
-        tsi++;
-    }
+/*****************************  Python to Mef struct  *******************************/
 
-    return (PyObject *) py_array_out;
-}
+// UNIVERSAL_HEADER *map_python_uh(PyObject *)
+// {
+// }
 
-// Map segment
-PyObject *map_mef3_segment(SEGMENT *segment, si1 map_indices_flag, si1 copy_metadata_to_dict) {
-    
-    PyObject *metadata_dict;
-    PyObject *records_dict;
-    PyObject *uh_dict;
-    PyObject *uhs_dict;
-    PyObject *TOC;
-	PyObject *py_md1, *py_tmd2 ,*py_vmd2, *py_md3;
-	PyObject *py_uh_ts_data, *py_uh_ts_indices, *py_uh_v_indices;
-	PyObject *py_ts_indices, *py_v_indices;
-    si8   number_of_entries;
+// METADATA_SECTION_1 *map_python_md1(PyObject *md1_dict)
+// {
+// }
 
-    // create python output dictionary
-    metadata_dict = PyDict_New();
-	
-	//
-	// map segment specific metadata
-	// 
-	
-	PyObject    *py_array_out;
-	if (!copy_metadata_to_dict) {
-		// numpy structure
-		
-		import_array();
+void    map_python_tmd2(PyObject *tmd2_arr, TIME_SERIES_METADATA_SECTION_2 *tmd2) {
+    memcpy(tmd2, PyArray_DATA((PyArrayObject *) tmd2_arr), sizeof(TIME_SERIES_METADATA_SECTION_2));
+    return;
+}
 
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {sizeof(SEGMENT)};
-		PyArray_Descr    *descr;
-		
-		descr = (PyArray_Descr *) create_segment_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) segment, NPY_ARRAY_DEFAULT, Py_None);
-		
-	} else {
-		// python dictionary out
-		
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-	
+void    map_python_vmd2(PyObject *vmd2_arr, VIDEO_METADATA_SECTION_2 *vmd2) {
+    memcpy(vmd2, PyArray_DATA((PyArrayObject *) vmd2_arr), sizeof(VIDEO_METADATA_SECTION_2));
+    return;
+}
 
-		//
-		PY_DICTSET_BUILD(py_array_out, "channel_type",              "i", segment->channel_type);
-		
-		// Note 1: segment->metadata_fps, segment->time_series_data_fps, segment->time_series_indices_fps and segment->video_indices_fps not mapped.
-		//         'create_session_dtype' outputs the raw bytes of FILE_PROCESSING_STRUCT structs, not much sense in mapping, skip
-		
-		// Note 2: segment->record_data_fps and segment->record_indices_fps not mapped.
-		// 	       'create_session_dtype' outputs the raw bytes of a FILE_PROCESSING_STRUCT struct for these, but
-		//          the actual information is mapped below in ['records_info']['record_data'] and ['records_info']['record_indices']
-		//          so it doesn't make sense to map the _fps
-		
-		PY_DICTSET_FUNC (py_array_out, "name",                           map_mef3_decode_maxbytes_to_string(segment->name, MEF_SEGMENT_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "path",                           map_mef3_decode_maxbytes_to_string(segment->path, MEF_FULL_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "channel_name",                   map_mef3_decode_maxbytes_to_string(segment->channel_name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "session_name",                   map_mef3_decode_maxbytes_to_string(segment->session_name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",               segment->level_UUID, UUID_BYTES);
-		
-	}
-	
-	// add (segment specific metadata) numpy structure or dictionary to main dictionary
-	PyDict_SetItemString(metadata_dict, "segment_specific_metadata", py_array_out); 
-	Py_DECREF(py_array_out);	py_array_out = NULL;
+void    map_python_vi(PyObject *vi_arr, VIDEO_INDEX *vi) {
+    memcpy(vi, PyArray_DATA((PyArrayObject *) vi_arr), sizeof(VIDEO_INDEX)*PyArray_SHAPE((PyArrayObject *) vi_arr)[0]);
+    return;
+}
 
+void    map_python_md3(PyObject *md3_arr, METADATA_SECTION_3 *md3) {
+    memcpy(md3, PyArray_DATA((PyArrayObject *) md3_arr), sizeof(METADATA_SECTION_3));
+    return;
+}
 
-	//
-	//
-	//
-	
-    // Read segment records if present and add it to metadata
-    if ((segment->record_indices_fps != NULL) & (segment->record_data_fps != NULL)){
-        records_dict = map_mef3_records(segment->record_indices_fps, segment->record_data_fps, copy_metadata_to_dict);
-        PyDict_SetItemString(metadata_dict, "records_info", records_dict);
-        Py_DECREF(records_dict);	records_dict = NULL;
-    }
+// SEGMENT, CHANNEL, SESSION are constructed from the above when reading
 
-    // create section 1 dictionary
-	py_md1 = map_mef3_md1(segment->metadata_fps->metadata.section_1, copy_metadata_to_dict);
-    PyDict_SetItemString(metadata_dict, "section_1", py_md1);
-	Py_DECREF(py_md1);	py_md1 = NULL;
+/**************************  Python record struct to Mef  ****************************/
 
-    // Create section 2 dictionary
-    switch (segment->channel_type){
-        case TIME_SERIES_CHANNEL_TYPE:
-			py_tmd2 = map_mef3_tmd2(segment->metadata_fps->metadata.time_series_section_2, copy_metadata_to_dict);
-            PyDict_SetItemString(metadata_dict, "section_2", py_tmd2);
-			Py_DECREF(py_tmd2);	py_tmd2 = NULL;
-            break;
-        case VIDEO_CHANNEL_TYPE:
-			py_vmd2 = map_mef3_vmd2(segment->metadata_fps->metadata.video_section_2, copy_metadata_to_dict);
-            PyDict_SetItemString(metadata_dict, "section_2", py_vmd2);
-			Py_DECREF(py_vmd2);	py_vmd2 = NULL;
-            break;
-        default:
-            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
-            PyErr_Occurred();
-            return NULL;
-    }
-    
-    // create section 3 dictionary
-	py_md3 = map_mef3_md3(segment->metadata_fps->metadata.section_3, copy_metadata_to_dict);
-    PyDict_SetItemString(metadata_dict, "section_3", py_md3);
-	Py_DECREF(py_md3);	py_md3 = NULL;
 
+void    map_python_rh(PyObject *rh_arr, RECORD_HEADER  *rh) {
+    memcpy(rh, PyArray_DATA((PyArrayObject *) rh_arr), sizeof(RECORD_HEADER));
+    return;
+}
 
-    // TODO - this should be a list - there is more indices in indices file!!!!
-    // Set the TOC to NULL so that the logic works
-    TOC = NULL;
+void    map_python_EDFA_type(PyObject *EDFA_type_arr, MEFREC_EDFA_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) EDFA_type_arr), PyArray_ITEMSIZE((PyArrayObject *) EDFA_type_arr));
+    return;
+}
 
-    // create indices dictionary
-    switch (segment->channel_type) {
-        case TIME_SERIES_CHANNEL_TYPE:
-            number_of_entries = segment->time_series_indices_fps->universal_header->number_of_entries;
+void    map_python_LNTP_type(PyObject *LNTP_type_arr, MEFREC_LNTP_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) LNTP_type_arr), PyArray_ITEMSIZE((PyArrayObject *) LNTP_type_arr));
+    return;
+}
 
-			py_ts_indices = map_mef3_ti(segment->time_series_indices_fps->time_series_indices, number_of_entries, copy_metadata_to_dict);
-            PyDict_SetItemString(metadata_dict, "indices", py_ts_indices);
-			Py_DECREF(py_ts_indices);	py_ts_indices = NULL;
-
-            // Create TOC
-            TOC = create_mef3_TOC(segment);
+void    map_python_Siez_type(PyObject *Siez_type_arr, MEFREC_Seiz_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) Siez_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Siez_type_arr));
+    return;
+}
 
-            break;
-        case VIDEO_CHANNEL_TYPE:
-            number_of_entries = segment->video_indices_fps->universal_header->number_of_entries;
+// NOTE: void r_type because we are mapping all entries
+void    map_python_Siez_ch_type(PyObject *Siez_ch_type_arr, si1 *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) Siez_ch_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Siez_ch_type_arr) * PyArray_SIZE((PyArrayObject *) Siez_ch_type_arr));
+    return;
+}   
 
-			py_v_indices = map_mef3_vi(segment->video_indices_fps->video_indices, number_of_entries, copy_metadata_to_dict);
-            PyDict_SetItemString(metadata_dict, "indices", py_v_indices);
-			Py_DECREF(py_v_indices);	py_v_indices = NULL;
+void    map_python_CSti_type(PyObject *CSti_type_arr, MEFREC_CSti_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) CSti_type_arr), PyArray_ITEMSIZE((PyArrayObject *) CSti_type_arr));
+    return;
+}
 
-            break;
-        default:
-            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
-            PyErr_Occurred();
-            return NULL;
-    }
-    
-    if (TOC != NULL) {
-        PyDict_SetItemString(metadata_dict, "TOC", TOC);
-		Py_DECREF(TOC);	TOC = NULL;
-	}
+void    map_python_ESti_type(PyObject *ESti_type_arr, MEFREC_ESti_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) ESti_type_arr), PyArray_ITEMSIZE((PyArrayObject *) ESti_type_arr));
+    return;
+}
 
-    // Get universal headers
-    uhs_dict = PyDict_New();
+void    map_python_Curs_type(PyObject *Curs_type_arr, MEFREC_Curs_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) Curs_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Curs_type_arr));
+    return;
+}
 
-    // Metadata
-    uh_dict = map_mef3_uh(segment->metadata_fps->universal_header, copy_metadata_to_dict);
-    PyDict_SetItemString(uhs_dict, "metadata", uh_dict);
-	Py_DECREF(uh_dict);	uh_dict = NULL;
+void    map_python_Epoc_type(PyObject *Epoc_type_arr, MEFREC_Epoc_1_0  *r_type) {
+    memcpy(r_type, PyArray_DATA((PyArrayObject *) Epoc_type_arr), PyArray_ITEMSIZE((PyArrayObject *) Epoc_type_arr));
+    return;
+}
 
-    // Data an indices universal headers
-    switch (segment->channel_type) {
-        case TIME_SERIES_CHANNEL_TYPE:
-			
-			py_uh_ts_data = map_mef3_uh(segment->time_series_data_fps->universal_header, copy_metadata_to_dict);
-            PyDict_SetItemString(uhs_dict, "time_series_data", py_uh_ts_data);
-			Py_DECREF(py_uh_ts_data);	py_uh_ts_data = NULL;
-			
-			py_uh_ts_indices = map_mef3_uh(segment->time_series_indices_fps->universal_header, copy_metadata_to_dict);
-            PyDict_SetItemString(uhs_dict, "time_series_indices", py_uh_ts_indices);
-			Py_DECREF(py_uh_ts_indices);	py_uh_ts_indices = NULL;
-			
-            break;
-        case VIDEO_CHANNEL_TYPE:
-		
-			py_uh_v_indices = map_mef3_uh(segment->video_indices_fps->universal_header, copy_metadata_to_dict);
-            PyDict_SetItemString(uhs_dict, "video_indices", py_uh_v_indices);
-			Py_DECREF(py_uh_v_indices);	py_uh_v_indices = NULL;
-			
-            break;
-        default:
-            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
-            PyErr_Occurred();
-            return NULL;
-    }
 
-    PyDict_SetItemString(metadata_dict, "universal_headers", uhs_dict);
-	Py_DECREF(uhs_dict);	uhs_dict = NULL;
+/*****************************  Mef struct to Python  *******************************/
 
-    return metadata_dict;
+// map a char array with a maximum number of byets) to a Python string
+PyObject *map_mef3_decode_maxbytes_to_string(const char *s, size_t max_size) {
+	size_t str_len = strnlen(s, max_size);
+	return map_mef3_decode_sizebytes_to_string(s, str_len);
 }
 
-// Map channel
-// Note: this funtion also loops through segments
-PyObject *map_mef3_channel(CHANNEL *channel, si1 map_indices_flag, si1 copy_metadata_to_dict) {
-
-    PyObject *metadata_dict;
-    PyObject *records_dict;
-    PyObject *segment_dict;
-    PyObject *segments_all_dict;
-    PyObject *py_md1, *py_tmd2 ,*py_vmd2, *py_md3;
+// map a char array (while indicating the number of bytes) to a Python string
+PyObject *map_mef3_decode_sizebytes_to_string(const char *s, size_t size) {
+	PyObject *py_text;
 	
-    si4   i;
-    SEGMENT *segment;
-
-    // create python output dictionary
-    metadata_dict = PyDict_New();
+	// try to decode as strict UTF-8 (perhaps missing UTF-8 follow up bytes and escaped hexidecimals)
+	py_text = PyUnicode_Decode(s, size, "utf-8", "strict");
+	if (py_text == NULL)
+		PyErr_Clear();
+	else
+		return py_text;
+	
+	/*
+	// try to decode as strict latin-1
+	py_text = PyUnicode_Decode(s, size, "latin-1", "strict");
+	if (py_text == NULL)
+		PyErr_Clear();
+	else
+		return py_text;
+	*/
+	
+	// try to decode as UTF-8 with backslashreplace
+	py_text = PyUnicode_Decode(s, size, "utf-8", "backslashreplace");
+	if (py_text == NULL)
+		PyErr_Clear();
+	else
+		return py_text;
 
-	//
-	// map channel specific metadata
-	// 
+	// try to decode as UTF-8 with ignore
+	py_text = PyUnicode_Decode(s, size, "utf-8", "ignore");
+	if (py_text == NULL)
+		PyErr_Clear();
+	else
+		return py_text;
 	
+	// return empty string
+	return Py_BuildValue("s", "");
+	
+}
+
+PyObject *map_mef3_uh(UNIVERSAL_HEADER *uh, si1 copy_metadata_to_dict) {
 	PyObject    *py_array_out;
+	
 	if (!copy_metadata_to_dict) {
 		// numpy structure
-
+		
 		import_array();
 		
 		npy_intp dims[] = {1};
-		npy_intp strides[] = {sizeof(CHANNEL)};
+		npy_intp strides[] = {UNIVERSAL_HEADER_BYTES};
 		PyArray_Descr    *descr;
-    
-		descr = (PyArray_Descr *) create_channel_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) channel, NPY_ARRAY_DEFAULT, Py_None);
+
+		descr = (PyArray_Descr *) create_uh_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) uh, NPY_ARRAY_DEFAULT, Py_None);
 		
 	} else {
-		// python dictionary out
-		
+		// python dictionary
+
 		py_array_out = PyDict_New();
 		PyObject *py_value_obj;
 		
-		PY_DICTSET_BUILD(py_array_out, "channel_type",              "i", channel->channel_type);
-		
-		// Note 1: channel->metadata not mapped. 'create_session_dtype' outputs the raw bytes 
-		//         of a METADATA struct, not much sense in mapping, skip
+		PY_DICTSET_BUILD(py_array_out, "header_CRC",             "I", uh->header_CRC)
+		PY_DICTSET_BUILD(py_array_out, "body_CRC",               "I", uh->body_CRC);
+		PY_DICTSET_BUILD(py_array_out, "file_type_string",       "s", uh->file_type_string);
+		PY_DICTSET_BUILD(py_array_out, "mef_version_major",      "B", uh->mef_version_major);
+		PY_DICTSET_BUILD(py_array_out, "mef_version_minor",      "B", uh->mef_version_minor);
+		PY_DICTSET_BUILD(py_array_out, "byte_order_code",        "B", uh->byte_order_code);
+		PY_DICTSET_LONG (py_array_out, "start_time",                  uh->start_time);
+		PY_DICTSET_LONG (py_array_out, "end_time",                    uh->end_time);
+		PY_DICTSET_LONG (py_array_out, "number_of_entries",           uh->number_of_entries);
+		PY_DICTSET_LONG (py_array_out, "maximum_entry_size",          uh->maximum_entry_size);
+		PY_DICTSET_BUILD(py_array_out, "segment_number",         "i", uh->segment_number);
+		PY_DICTSET_FUNC (py_array_out, "channel_name",                map_mef3_decode_maxbytes_to_string(uh->channel_name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "session_name",                map_mef3_decode_maxbytes_to_string(uh->session_name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "anonymized_name",             map_mef3_decode_maxbytes_to_string(uh->anonymized_name, UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES));
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",            uh->level_UUID, UUID_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "file_UUID",             uh->file_UUID, UUID_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "provenance_UUID",       uh->provenance_UUID, UUID_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_1_password_validation_field",   uh->level_1_password_validation_field, PASSWORD_VALIDATION_FIELD_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_2_password_validation_field",   uh->level_2_password_validation_field, PASSWORD_VALIDATION_FIELD_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",      uh->protected_region, UNIVERSAL_HEADER_PROTECTED_REGION_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",  uh->discretionary_region, UNIVERSAL_HEADER_DISCRETIONARY_REGION_BYTES);
 		
-		// Note 2: channel->record_data_fps and channel->record_indices_fps not mapped.
-		// 	       'create_session_dtype' outputs the raw bytes of a FILE_PROCESSING_STRUCT struct for these, but
-		//          the actual information is mapped below in ['records_info']['record_data'] and ['records_info']['record_indices']
-		//          so it doesn't make sense to map the _fps
+	}
+
+    return py_array_out;
+}
+
+PyObject *map_mef3_md1(METADATA_SECTION_1 *md1, si1 copy_metadata_to_dict) {
+	PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure
+
+		import_array();
 		
-		// Note 3: channel->segments not mapped. 'create_session_dtype' outputs the raw bytes 
-		//         of SEGMENT structs, not much sense in mapping, skip
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {METADATA_SECTION_1_BYTES};
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_md1_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) md1, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary
+
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
 		
-		PY_DICTSET_LONG (py_array_out, "number_of_segments",             channel->number_of_segments);
-		PY_DICTSET_FUNC (py_array_out, "path",                           map_mef3_decode_maxbytes_to_string(channel->path, MEF_FULL_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "name",                           map_mef3_decode_maxbytes_to_string(channel->name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "extension",                      map_mef3_decode_maxbytes_to_string(channel->extension, TYPE_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "session_name",                   map_mef3_decode_maxbytes_to_string(channel->session_name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",               channel->level_UUID, UUID_BYTES);
-		PY_DICTSET_FUNC (py_array_out, "anonymized_name",                map_mef3_decode_maxbytes_to_string(channel->anonymized_name, UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES));
-		PY_DICTSET_LONG (py_array_out, "maximum_number_of_records",      channel->maximum_number_of_records);
-		PY_DICTSET_LONG (py_array_out, "maximum_record_bytes",           channel->maximum_record_bytes);
-		PY_DICTSET_LONG (py_array_out, "earliest_start_time",            channel->earliest_start_time);
-		PY_DICTSET_LONG (py_array_out, "latest_end_time",                channel->latest_end_time);
+		PY_DICTSET_BUILD(py_array_out, "section_2_encryption",   "b", md1->section_2_encryption);
+		PY_DICTSET_BUILD(py_array_out, "section_3_encryption",   "b", md1->section_3_encryption);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",      md1->protected_region, METADATA_SECTION_1_PROTECTED_REGION_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",  md1->discretionary_region, METADATA_SECTION_1_DISCRETIONARY_REGION_BYTES);
 		
 	}
 	
-    // add (channel specific metadata) numpy structure or dictionary to main dictionary
-    PyDict_SetItemString(metadata_dict, "channel_specific_metadata", py_array_out);
-	Py_DECREF(py_array_out);	py_array_out = NULL;
-	
+    return py_array_out;
+}
+
+PyObject *map_mef3_tmd2(TIME_SERIES_METADATA_SECTION_2 *tmd2, si1 copy_metadata_to_dict) {
+	PyObject    *py_array_out;
 	
-	//
-	//
-	//
+	if (!copy_metadata_to_dict) {
+		// numpy structure
 	
-    // Read channel records if present and add it to metadata
-    if ((channel->record_indices_fps != NULL) & (channel->record_data_fps != NULL)){
-        records_dict = map_mef3_records(channel->record_indices_fps, channel->record_data_fps, copy_metadata_to_dict);
-        PyDict_SetItemString(metadata_dict, "records_info", records_dict);
-		Py_DECREF(records_dict);	records_dict = NULL;
-    }
-
-	// create section 1 dictionary
-	py_md1 = map_mef3_md1(channel->metadata.section_1, copy_metadata_to_dict);
-    PyDict_SetItemString(metadata_dict, "section_1", py_md1);
-	Py_DECREF(py_md1);	py_md1 = NULL;
-    
-    // create section 2 dictionary
-    switch (channel->channel_type){
-        case TIME_SERIES_CHANNEL_TYPE:
+		import_array();
 		
-			py_tmd2 = map_mef3_tmd2(channel->metadata.time_series_section_2, copy_metadata_to_dict);
-            PyDict_SetItemString(metadata_dict, "section_2", py_tmd2);
-			Py_DECREF(py_tmd2);	py_tmd2 = NULL;
-			
-            break;
-        case VIDEO_CHANNEL_TYPE:
-		
-			py_vmd2 = map_mef3_vmd2(channel->metadata.video_section_2, copy_metadata_to_dict);
-            PyDict_SetItemString(metadata_dict, "section_2", py_vmd2);
-			Py_DECREF(py_vmd2);	py_vmd2 = NULL;
-			
-            break;
-        default:
-            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
-            PyErr_Occurred();
-            return NULL;
-    }
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {METADATA_SECTION_2_BYTES};
+		PyArray_Descr    *descr;
 
-    // create section 3 dictionary
-	py_md3 = map_mef3_md3(channel->metadata.section_3, copy_metadata_to_dict);
-    PyDict_SetItemString(metadata_dict, "section_3", py_md3);
-	Py_DECREF(py_md3);	py_md3 = NULL;
-    
-	// map all segments
-	if (channel->number_of_segments > 0) {
-		
-		segments_all_dict = PyDict_New();
-		
-		// Loop over segments
-		for (i = 0; i < channel->number_of_segments; ++i) {
-			
-			// Get the channel pointer
-			segment = channel->segments + i;
-			
-			// map the segment and add to dictionary
-			segment_dict = map_mef3_segment(segment, map_indices_flag, copy_metadata_to_dict);
-			PyDict_SetItemString(segments_all_dict, segment->name, segment_dict);
-			Py_DECREF(segment_dict);	segment_dict = NULL;
-			
-		}
+		descr = (PyArray_Descr *) create_tmd2_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) tmd2, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary
+
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
 		
-		PyDict_SetItemString(metadata_dict, "segments", segments_all_dict);
-		Py_DECREF(segments_all_dict);	segments_all_dict = NULL;
+		PY_DICTSET_FUNC (py_array_out, "channel_description",                 map_mef3_decode_maxbytes_to_string(tmd2->channel_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "session_description",                 map_mef3_decode_maxbytes_to_string(tmd2->session_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
+		PY_DICTSET_LONG (py_array_out, "recording_duration",                  tmd2->recording_duration);
+
+		PY_DICTSET_FUNC (py_array_out, "reference_description",               map_mef3_decode_maxbytes_to_string(tmd2->reference_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
+		PY_DICTSET_LONG (py_array_out, "acquisition_channel_number",          tmd2->acquisition_channel_number);
+		PY_DICTSET_BUILD(py_array_out, "sampling_frequency",             "d", tmd2->sampling_frequency);
+		PY_DICTSET_BUILD(py_array_out, "low_frequency_filter_setting",   "d", tmd2->low_frequency_filter_setting);
+		PY_DICTSET_BUILD(py_array_out, "high_frequency_filter_setting",  "d", tmd2->high_frequency_filter_setting);
+		PY_DICTSET_BUILD(py_array_out, "notch_filter_frequency_setting", "d", tmd2->notch_filter_frequency_setting);
+		PY_DICTSET_BUILD(py_array_out, "AC_line_frequency",              "d", tmd2->AC_line_frequency);
+		PY_DICTSET_BUILD(py_array_out, "units_conversion_factor",        "d", tmd2->units_conversion_factor);
+		PY_DICTSET_FUNC (py_array_out, "units_description",                   map_mef3_decode_maxbytes_to_string(tmd2->units_description, TIME_SERIES_METADATA_UNITS_DESCRIPTION_BYTES));
+		PY_DICTSET_BUILD(py_array_out, "maximum_native_sample_value",    "d", tmd2->maximum_native_sample_value);
+		PY_DICTSET_BUILD(py_array_out, "minimum_native_sample_value",    "d", tmd2->minimum_native_sample_value);
+		PY_DICTSET_LONG (py_array_out, "start_sample",                        tmd2->start_sample);
+		PY_DICTSET_LONG (py_array_out, "number_of_samples",                   tmd2->number_of_samples);
+		PY_DICTSET_LONG (py_array_out, "number_of_blocks",                    tmd2->number_of_blocks);
+		PY_DICTSET_LONG (py_array_out, "maximum_block_bytes",                 tmd2->maximum_block_bytes);		
+		PY_DICTSET_BUILD(py_array_out, "maximum_block_samples",          "I", tmd2->maximum_block_samples);
+		PY_DICTSET_BUILD(py_array_out, "maximum_difference_bytes",       "I", tmd2->maximum_difference_bytes);
+		PY_DICTSET_LONG (py_array_out, "block_interval",                      tmd2->block_interval);
+		PY_DICTSET_LONG (py_array_out, "number_of_discontinuities",           tmd2->number_of_discontinuities);
+		PY_DICTSET_LONG (py_array_out, "maximum_contiguous_blocks",           tmd2->maximum_contiguous_blocks);
+		PY_DICTSET_LONG (py_array_out, "maximum_contiguous_block_bytes",      tmd2->maximum_contiguous_block_bytes);
+		PY_DICTSET_LONG (py_array_out, "maximum_contiguous_samples",          tmd2->maximum_contiguous_samples);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",              tmd2->protected_region, TIME_SERIES_METADATA_SECTION_2_PROTECTED_REGION_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",          tmd2->discretionary_region, TIME_SERIES_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
 		
 	}
 	
-    return metadata_dict;
+    return py_array_out;
 }
 
-// Map session
-// Note: this funtion also loops through channels
-PyObject *map_mef3_session(SESSION *session, si1 map_indices_flag, si1 copy_metadata_to_dict) {
+PyObject *map_mef3_vmd2(VIDEO_METADATA_SECTION_2 *vmd2, si1 copy_metadata_to_dict) {
+	PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure
 
-    PyObject *metadata_dict;
-    PyObject *records_dict;
+		import_array();
 
-    PyObject *ts_metadata;
-	PyObject *ts_all_dict;
-    PyObject *ts_dict;
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {METADATA_SECTION_2_BYTES};
+		PyArray_Descr    *descr;
 
-    PyObject *v_metadata;
-    PyObject *v_all_dict;
-	PyObject *v_dict;
-	PyObject *py_md1, *py_tmd2 ,*py_vmd2, *py_md3;
-    
-    si4   i;
-    CHANNEL *channel;
+		descr = (PyArray_Descr *) create_vmd2_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) vmd2, NPY_ARRAY_DEFAULT, Py_None);
 
-    // Create python output dictionary
-    metadata_dict = PyDict_New();
-    
-	
-	//
-	// map session specific metadata
-	// 
-	
-	PyObject    *py_array_out;
-	if (!copy_metadata_to_dict) {
-		// Numpy structure out
-		
-		import_array();			
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {sizeof(SESSION)};
-		
-		PyArray_Descr *descr = (PyArray_Descr *) create_session_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) session, NPY_ARRAY_DEFAULT, Py_None);
-		
 	} else {
-		// python dictionary out
-		
+		// python dictionary
+
 		py_array_out = PyDict_New();
 		PyObject *py_value_obj;
 		
-		PY_DICTSET_BUILD(py_array_out, "number_of_time_series_channels", "i", session->number_of_time_series_channels);
-		PY_DICTSET_BUILD(py_array_out, "number_of_video_channels",       "i", session->number_of_video_channels);
-		
-		// Note 1: session->time_series_metadata and session->video_metadata not mapped. 
-		//         'create_session_dtype' outputs the raw bytes of a METADATA struct, not much sense in mapping, skip
-		
-		// Note 2: session->time_series_channels and session->video_channels not mapped.
-		//         'create_session_dtype' outputs the raw bytes of a CHANNEL struct, not much sense in mapping, skip
+		PY_DICTSET_FUNC (py_array_out, "channel_description",                 map_mef3_decode_maxbytes_to_string(vmd2->channel_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "session_description",                 map_mef3_decode_maxbytes_to_string(vmd2->session_description, METADATA_CHANNEL_DESCRIPTION_BYTES));
+		PY_DICTSET_LONG (py_array_out, "recording_duration",                  vmd2->recording_duration);
 		
-		// Note 3: session->record_data_fps and session->record_indices_fps not mapped.
-		// 	       'create_session_dtype' outputs the raw bytes of a FILE_PROCESSING_STRUCT struct for these, but
-		//          the actual information is mapped below in ['records_info']['record_data'] and ['records_info']['record_indices']
-		//          so it doesn't make sense to map the _fps
+		PY_DICTSET_LONG (py_array_out, "horizontal_resolution",               vmd2->horizontal_resolution);
+		PY_DICTSET_LONG (py_array_out, "vertical_resolution",                 vmd2->vertical_resolution);
+		PY_DICTSET_BUILD(py_array_out, "frame_rate",                     "d", vmd2->frame_rate);
+		PY_DICTSET_LONG (py_array_out, "number_of_clips",                     vmd2->number_of_clips);
+		PY_DICTSET_LONG (py_array_out, "maximum_clip_bytes",                  vmd2->maximum_clip_bytes);
+		PY_DICTSET_FUNC (py_array_out, "video_format",                        map_mef3_decode_maxbytes_to_string(vmd2->video_format, VIDEO_METADATA_VIDEO_FORMAT_BYTES));
+		PY_DICTSET_BUILD(py_array_out, "video_file_CRC",                 "I", vmd2->video_file_CRC);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",              vmd2->protected_region, VIDEO_METADATA_SECTION_2_PROTECTED_REGION_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",          vmd2->discretionary_region, VIDEO_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
 		
-
-		PY_DICTSET_FUNC (py_array_out, "name",                           map_mef3_decode_maxbytes_to_string(session->name, MEF_BASE_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "path",                           map_mef3_decode_maxbytes_to_string(session->path, MEF_FULL_FILE_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "anonymized_name",                map_mef3_decode_maxbytes_to_string(session->anonymized_name, UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES));
-		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",               session->level_UUID, UUID_BYTES);
-		PY_DICTSET_LONG (py_array_out, "maximum_number_of_records",      session->maximum_number_of_records);
-		PY_DICTSET_LONG (py_array_out, "maximum_record_bytes",           session->maximum_record_bytes);
-		PY_DICTSET_LONG (py_array_out, "earliest_start_time",            session->earliest_start_time);
-		PY_DICTSET_LONG (py_array_out, "latest_end_time",                session->latest_end_time);
-
 	}
-
-	// add (session specific metadata) numpy structure or dictionary to main dictionary
-	PyDict_SetItemString(metadata_dict, "session_specific_metadata", py_array_out);
-	Py_DECREF(py_array_out);	py_array_out = NULL;
 	
+    return py_array_out;
+}
 
-	//
-	//
-	//
-	
-	// read session records if present and add it to metadata
-	if ((session->record_indices_fps != NULL) & (session->record_data_fps != NULL)){
-		records_dict = map_mef3_records(session->record_indices_fps, session->record_data_fps, copy_metadata_to_dict);
-		PyDict_SetItemString(metadata_dict, "records_info", records_dict);
-		Py_DECREF(records_dict);	records_dict = NULL;
-	}
+PyObject *map_mef3_md3(METADATA_SECTION_3 *md3, si1 copy_metadata_to_dict) {
+	PyObject    *py_array_out;
 	
-	// get time series metadata
-	if (session->number_of_time_series_channels > 0) {
+	if (!copy_metadata_to_dict) {
+		// numpy structure
 		
-		// create dictionary
-		ts_metadata = PyDict_New();
+		import_array();
 
-		// create section time series 1 dictionary
-		py_md1 = map_mef3_md1(session->time_series_metadata.section_1, copy_metadata_to_dict);
-		PyDict_SetItemString(ts_metadata, "section_1", py_md1);
-		Py_DECREF(py_md1);	py_md1 = NULL;
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {METADATA_SECTION_3_BYTES};
+		PyArray_Descr    *descr;
 
-		// create section time series 2 dictionary
-		py_tmd2 = map_mef3_tmd2(session->time_series_metadata.time_series_section_2, copy_metadata_to_dict);
-		PyDict_SetItemString(ts_metadata, "section_2", py_tmd2);
-		Py_DECREF(py_tmd2);	py_tmd2 = NULL;
-		
-		// create section time series 3 dictionary
-		py_md3 = map_mef3_md3(session->time_series_metadata.section_3, copy_metadata_to_dict);
-		PyDict_SetItemString(ts_metadata, "section_3", py_md3);
-		Py_DECREF(py_md3);	py_md3 = NULL;
-		
-		// 
-		PyDict_SetItemString(metadata_dict, "time_series_metadata", ts_metadata); 
-		Py_DECREF(ts_metadata);	ts_metadata = NULL;
-	}
+		descr = (PyArray_Descr *) create_md3_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) md3, NPY_ARRAY_DEFAULT, Py_None);
 
-	// get video metadata
-	if (session->number_of_video_channels > 0) {
-		
-		// create dictionary
-		v_metadata = PyDict_New();
+	} else {
+		// python dictionary
 
-		// create section video 1 dictionary
-		py_md1 = map_mef3_md1(session->video_metadata.section_1, copy_metadata_to_dict);
-		PyDict_SetItemString(v_metadata, "section_1", py_md1);
-		Py_DECREF(py_md1);	py_md1 = NULL;
-		
-		// create section video 2 dictionary
-		py_vmd2 = map_mef3_vmd2(session->video_metadata.video_section_2, copy_metadata_to_dict);
-		PyDict_SetItemString(v_metadata, "section_2", py_vmd2);
-		Py_DECREF(py_vmd2);	py_vmd2 = NULL;
-		
-		// create section video 3 dictionary
-		py_md3 = map_mef3_md3(session->video_metadata.section_3, copy_metadata_to_dict);
-		PyDict_SetItemString(v_metadata, "section_3", py_md3);
-		Py_DECREF(py_md3);	py_md3 = NULL;
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
 		
-		//
-		PyDict_SetItemString(metadata_dict, "video_metadata", v_metadata); 
-		Py_DECREF(v_metadata);	v_metadata = NULL;
+		PY_DICTSET_LONG (py_array_out, "recording_time_offset",       md3->recording_time_offset);
+		PY_DICTSET_LONG (py_array_out, "DST_start_time",              md3->DST_start_time);
+		PY_DICTSET_LONG (py_array_out, "DST_end_time",                md3->DST_end_time);
+		PY_DICTSET_BUILD(py_array_out, "GMT_offset",             "i", md3->GMT_offset);
+		PY_DICTSET_FUNC (py_array_out, "subject_name_1",              map_mef3_decode_maxbytes_to_string(md3->subject_name_1, METADATA_SUBJECT_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "subject_name_2",              map_mef3_decode_maxbytes_to_string(md3->subject_name_2, METADATA_SUBJECT_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "subject_ID",                  map_mef3_decode_maxbytes_to_string(md3->subject_ID, METADATA_SUBJECT_ID_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "recording_location",          map_mef3_decode_maxbytes_to_string(md3->recording_location, METADATA_RECORDING_LOCATION_BYTES));
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "protected_region",      md3->protected_region, METADATA_SECTION_3_PROTECTED_REGION_BYTES);
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "discretionary_region",  md3->discretionary_region, METADATA_SECTION_3_DISCRETIONARY_REGION_BYTES);
 		
 	}
 	
-	if (session->number_of_time_series_channels > 0) {
-		ts_all_dict = PyDict_New();
-		
-		// Loop over time series channels
-		for (i = 0; i < session->number_of_time_series_channels; ++i) {
-			
-			// get the channel pointer
-			channel = session->time_series_channels + i;
-			
-			// map the channel and add to dictionary
-			ts_dict = map_mef3_channel(channel, map_indices_flag, copy_metadata_to_dict);
-			PyDict_SetItemString(ts_all_dict, channel->name, ts_dict);
-			Py_DECREF(ts_dict);	ts_dict = NULL;
+    return py_array_out;
+}
+
+// TODO - call number of entries from the parent dtype
+PyObject *map_mef3_ti(TIME_SERIES_INDEX *ti, si8 number_of_entries, si1 copy_metadata_to_dict) {
+	PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure
+			
+		import_array();
+
+		npy_intp dims[] = {number_of_entries};
+		npy_intp strides[] = {TIME_SERIES_INDEX_BYTES};
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_ti_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) ti, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary
+
+		py_array_out = PyList_New(number_of_entries);
+		PyObject *py_value_obj;
+		PyObject *py_ti_entry_dict;
+
+		TIME_SERIES_INDEX *ti_entry = ti;
+		for (int i = 0; i < number_of_entries; ++i) {
+
+			py_ti_entry_dict = PyDict_New();
+
+			PY_DICTSET_LONG (py_ti_entry_dict, "file_offset",                           ti_entry->file_offset);
+			PY_DICTSET_LONG (py_ti_entry_dict, "start_time",                            ti_entry->start_time);
+			PY_DICTSET_LONG (py_ti_entry_dict, "start_sample",                          ti_entry->start_sample);
+			PY_DICTSET_BUILD(py_ti_entry_dict, "number_of_samples",                "I", ti_entry->number_of_samples);
+			PY_DICTSET_BUILD(py_ti_entry_dict, "block_bytes",                      "I", ti_entry->block_bytes);
+			PY_DICTSET_BUILD(py_ti_entry_dict, "maximum_sample_value",             "i", ti_entry->maximum_sample_value);
+			PY_DICTSET_BUILD(py_ti_entry_dict, "minimum_sample_value",             "i", ti_entry->minimum_sample_value);
+			PY_DICTSET_BYTEARRSIZE(py_ti_entry_dict, "protected_region",                ti_entry->protected_region, TIME_SERIES_INDEX_PROTECTED_REGION_BYTES);
+			PY_DICTSET_BUILD(py_ti_entry_dict, "RED_block_flags",                  "B", ti_entry->RED_block_flags);
+			PY_DICTSET_BYTEARRSIZE(py_ti_entry_dict, "RED_block_protected_region",      ti_entry->RED_block_protected_region, RED_BLOCK_PROTECTED_REGION_BYTES);
+			PY_DICTSET_BYTEARRSIZE(py_ti_entry_dict, "RED_block_discretionary_region",  ti_entry->RED_block_discretionary_region, RED_BLOCK_DISCRETIONARY_REGION_BYTES);
+			
+			PyList_SET_ITEM(py_array_out, i, py_ti_entry_dict); 	// steals reference 'py_ti_entry_dict'
+
+			// next entry
+			ti_entry += 1;
 			
 		}
 		
-		PyDict_SetItemString(metadata_dict, "time_series_channels", ts_all_dict);
-		Py_DECREF(ts_all_dict);	ts_all_dict = NULL;
 	}
+	
+    return py_array_out;
+}
 
-	if (session->number_of_time_series_channels > 0) {
-		v_all_dict = PyDict_New();
-		
-		// loop over video channels
-		for (i = 0; i < session->number_of_video_channels; ++i){
+// TODO - call number of entries from the parent dtype
+PyObject *map_mef3_vi(VIDEO_INDEX *vi, si8 number_of_entries, si1 copy_metadata_to_dict) {
+	PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure
 			
-			// get the channel pointer
-			channel = session->video_channels + i;
+		import_array();
+
+		npy_intp dims[] = {number_of_entries};
+		npy_intp strides[] = {VIDEO_INDEX_BYTES};
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_vi_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) vi, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary
+
+		py_array_out = PyList_New(number_of_entries);
+		PyObject *py_value_obj;
+		PyObject *py_vi_entry_dict;
+
+		VIDEO_INDEX *vi_entry = vi;
+		for (int i = 0; i < number_of_entries; ++i) {
+
+			py_vi_entry_dict = PyDict_New();
+
+			PY_DICTSET_LONG (py_vi_entry_dict, "start_time",                      vi_entry->start_time);
+			PY_DICTSET_LONG (py_vi_entry_dict, "end_time",                        vi_entry->end_time);
+			PY_DICTSET_BUILD(py_vi_entry_dict, "start_frame",                "I", vi_entry->start_frame);
+			PY_DICTSET_BUILD(py_vi_entry_dict, "end_frame",                  "I", vi_entry->end_frame);
+			PY_DICTSET_LONG (py_vi_entry_dict, "file_offset",                     vi_entry->file_offset);
+			PY_DICTSET_LONG (py_vi_entry_dict, "clip_bytes",                      vi_entry->clip_bytes);
+			PY_DICTSET_BYTEARRSIZE(py_vi_entry_dict, "protected_region",          vi_entry->protected_region, VIDEO_INDEX_PROTECTED_REGION_BYTES);
+			PY_DICTSET_BYTEARRSIZE(py_vi_entry_dict, "discretionary_region",      vi_entry->discretionary_region, VIDEO_INDEX_DISCRETIONARY_REGION_BYTES);
 			
-			// map the channel and add to dictionary
-			v_dict = map_mef3_channel(channel, map_indices_flag, copy_metadata_to_dict);
-			PyDict_SetItemString(v_all_dict, channel->name, v_dict);
-			Py_DECREF(v_dict);	v_dict = NULL;
+			PyList_SET_ITEM(py_array_out, i, py_vi_entry_dict); 	// steals reference 'py_ti_entry_dict'
+
+			// next entry
+			vi_entry += 1;
 			
 		}
-
-		PyDict_SetItemString(metadata_dict, "video_channels", v_all_dict);
-		Py_DECREF(v_all_dict);	v_all_dict = NULL;
+		
 	}
 
-    return metadata_dict;
+    return py_array_out;
 }
 
-/**************************  Mef record struct to Python  ****************************/
+PyObject *create_mef3_TOC(SEGMENT *segment) {
 
-// Runs through records and puts them in a dictionary
-PyObject *map_mef3_records(FILE_PROCESSING_STRUCT *ri_fps, FILE_PROCESSING_STRUCT *rd_fps, si1 copy_metadata_to_dict) {
+    PyArrayObject *py_array_out;
 
-    // Ditionary
-    PyObject    *record_info_dict;
-    PyObject    *all_record_list;
-    PyObject    *record_dict;
-    PyObject    *uhs_dict;
-    PyObject    *uh_dict;
+    si8     number_of_entries;
+    npy_intp dims[2];
+    
+    // initialize Numpy
+    import_array();
 
-    ui1    *rd;
-    si4     i;
-    si8     number_of_records;
+    number_of_entries = segment->time_series_indices_fps->universal_header->number_of_entries;
 
-    RECORD_HEADER   *rh;
- 
-    // Set up output dictionary
-    record_info_dict = PyDict_New();
+    // Create NumPy array and fill it
+    dims[0] = 4;
+    dims[1] = number_of_entries;
+    
+    py_array_out = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_INT64);
+    if (py_array_out == NULL)
+        return NULL;
+    fill_segment_toc_c(segment, (si8 *) PyArray_DATA(py_array_out), number_of_entries);
 
-    // get and map record universal headers
-    uhs_dict = PyDict_New();
-	
-    uh_dict = map_mef3_uh(ri_fps->universal_header, copy_metadata_to_dict);
-    PyDict_SetItemString(uhs_dict, "record_indices", uh_dict);
-	Py_DECREF(uh_dict);		uh_dict = NULL;
-	
-    uh_dict = map_mef3_uh(rd_fps->universal_header, copy_metadata_to_dict);
-    PyDict_SetItemString(uhs_dict, "record_data", uh_dict);
-	Py_DECREF(uh_dict);		uh_dict = NULL;
-	
-    PyDict_SetItemString(record_info_dict, "universal_headers", uhs_dict);
-	Py_DECREF(uhs_dict);	uhs_dict = NULL;
+    return (PyObject *) py_array_out;
+}
 
-    // Create list for records
-    number_of_records = ri_fps->universal_header->number_of_entries;
-    all_record_list = PyList_New(number_of_records);
+void fill_segment_toc_c(SEGMENT *segment, si8 *toc, si8 n_columns)
+{
+    // fills the table of contents of the segment blocks into the rows of a [4, n_columns] array starting at toc
+    TIME_SERIES_INDEX     *tsi;
+    si8     number_of_entries, i;
+    si8     prev_time, prev_sample, start_time, start_sample, seg_start_sample;
+    sf8     fs;
 
-    // map each record (header and body)
-	// Note: Not mapping record indices (ri_fps->record_indices, map_mef3_ri).
-	//       Could have been used to filter read records, but will be done in python now
-    rd = rd_fps->raw_data + UNIVERSAL_HEADER_BYTES;
-    for (i = 0; i < number_of_records; ++i) {
+    number_of_entries = segment->time_series_indices_fps->universal_header->number_of_entries;
+    tsi = segment->time_series_indices_fps->time_series_indices;
+    fs = segment->metadata_fps->metadata.time_series_section_2->sampling_frequency;
+    seg_start_sample = segment->metadata_fps->metadata.time_series_section_2->start_sample;
+    prev_time = (number_of_entries > 0) ? tsi->start_time : 0;
+    prev_sample = (number_of_entries > 0) ? tsi->start_sample + seg_start_sample : 0;
 
-        rh = (RECORD_HEADER *) rd;
-        record_dict = map_mef3_rh(rh, copy_metadata_to_dict);
-		
-		// Note: ASK Matt / Dan. Could also be type_string, 
-        PyList_SET_ITEM(all_record_list, i, record_dict); 	// steals reference to object coming out of map_mef3_rh
+    for (i = 0; i < number_of_entries; i++, tsi++) {
+        start_time = tsi->start_time;
+        start_sample = tsi->start_sample + seg_start_sample;
 
-        rd += (RECORD_HEADER_BYTES + rh->bytes);
-        
+        // Have we found a discontinuity? First entry is dicontinuity by definition
+        toc[i] = (i == 0) ? 1 : toc_discontinuity_c(prev_time, prev_sample, start_time, start_sample, fs);
+
+        toc[n_columns + i] = (si8) tsi->number_of_samples;
+        toc[(2 * n_columns) + i] = start_sample;
+        toc[(3 * n_columns) + i] = start_time;
+
+        prev_time = start_time;
+        prev_sample = start_sample;
     }
+}
 
-    PyDict_SetItemString(record_info_dict, "records", all_record_list);
-	Py_DECREF(all_record_list);	all_record_list = NULL;
-	
-    return record_info_dict;
+si8 toc_discontinuity_c(si8 prev_time, si8 prev_sample, si8 start_time, si8 start_sample, sf8 fs)
+{
+    // 1 if the block starting at start_time / start_sample does not follow the block starting at prev_time / prev_sample
+    si8     samp_time_diff;
+
+    samp_time_diff = (si8) (((start_time - prev_time) - (1e6 * (start_sample - prev_sample)) / fs));
+    if (samp_time_diff < (si8) (1e6/fs))
+        samp_time_diff = 0;
+
+    return (samp_time_diff != 0) ? 1 : 0;
 }
 
-// map a record
-PyObject *map_mef3_rh(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+si8 toc_range_start_c(si8 *toc, si8 n_blocks, sf8 fs, si8 i)
+{
+    // 1 if block i of a [4, n_blocks] table of contents starts a contiguous range, flagged blocks are
+    // checked against the previous block because the first block of every segment is flagged
+    if (i == 0)
+        return 1;
+    if (!toc[i])
+        return 0;
+
+    return toc_discontinuity_c(toc[(3 * n_blocks) + i - 1], toc[(2 * n_blocks) + i - 1],
+                               toc[(3 * n_blocks) + i], toc[(2 * n_blocks) + i], fs);
+}
+
+si8 toc_ranges_c(si8 *toc, si8 n_blocks, sf8 fs, si8 *ranges, si8 n_columns)
+{
+    // reduces a [4, n_blocks] table of contents to the rows of a [3, n_columns] array of contiguous ranges
+    // (start time, end time, number of samples), returns the number of ranges
+    si8     i, r;
+
+    r = -1;
+    for (i = 0; i < n_blocks; i++) {
+        if (toc_range_start_c(toc, n_blocks, fs, i)) {
+            if (++r >= n_columns)
+                break;
+            ranges[r] = toc[(3 * n_blocks) + i];
+            ranges[(2 * n_columns) + r] = 0;
+        }
+        ranges[n_columns + r] = toc[(3 * n_blocks) + i] + (si8) (((sf8) toc[n_blocks + i] / fs) * 1e6);
+        ranges[(2 * n_columns) + r] += toc[n_blocks + i];
+    }
+
+    return (r < n_columns) ? r + 1 : n_columns;
+}
+
+// Map segment
+PyObject *map_mef3_segment(SEGMENT *segment, si1 map_indices_flag, si1 copy_metadata_to_dict) {
+    
+    PyObject *metadata_dict;
+    PyObject *records_dict;
+    PyObject *uh_dict;
+    PyObject *uhs_dict;
+    PyObject *TOC;
+	PyObject *py_md1, *py_tmd2 ,*py_vmd2, *py_md3;
+	PyObject *py_uh_ts_data, *py_uh_ts_indices, *py_uh_v_indices;
+	PyObject *py_ts_indices, *py_v_indices;
+    si8   number_of_entries;
+
+    // create python output dictionary
+    metadata_dict = PyDict_New();
 	
-	PyObject *py_value_obj;
-	PyObject    *py_array_out;
-	MEFREC_Seiz_1_0 *sz;
-	ui4     *type_str_int, type_code;
-		
-	// Create output dictionary   
-	PyObject *rh_dict = PyDict_New();
+	//
+	// map segment specific metadata
+	// 
 	
+	PyObject    *py_array_out;
 	if (!copy_metadata_to_dict) {
-		// numpy structure out
+		// numpy structure
 		
 		import_array();
+
 		npy_intp dims[] = {1};
-		npy_intp strides[] = {RECORD_HEADER_BYTES};
+		npy_intp strides[] = {sizeof(SEGMENT)};
+		PyArray_Descr    *descr;
+		
+		descr = (PyArray_Descr *) create_segment_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) segment, NPY_ARRAY_DEFAULT, Py_None);
 		
-		PyArray_Descr *descr = (PyArray_Descr *) create_rh_dtype();
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) rh, 1, Py_None);
-
 	} else {
 		// python dictionary out
 		
 		py_array_out = PyDict_New();
-		
-		PY_DICTSET_BUILD(py_array_out, "record_CRC",             "I", rh->record_CRC);
-		PY_DICTSET_BUILD(py_array_out, "type_string",            "s", rh->type_string);
-		PY_DICTSET_BUILD(py_array_out, "version_major",          "B", rh->version_major);
-		PY_DICTSET_BUILD(py_array_out, "version_minor",          "B", rh->version_minor);
-		PY_DICTSET_BUILD(py_array_out, "encryption",             "b", rh->encryption);
-		PY_DICTSET_BUILD(py_array_out, "bytes",                  "I", rh->bytes);
-		PY_DICTSET_LONG (py_array_out, "time",                        rh->time);
-
-	}	
+		PyObject *py_value_obj;
+	
 
-	PyDict_SetItemString(rh_dict, "record_header", py_array_out);
-	Py_DECREF(py_array_out);	py_array_out = NULL;
+		//
+		PY_DICTSET_BUILD(py_array_out, "channel_type",              "i", segment->channel_type);
+		
+		// Note 1: segment->metadata_fps, segment->time_series_data_fps, segment->time_series_indices_fps and segment->video_indices_fps not mapped.
+		//         'create_session_dtype' outputs the raw bytes of FILE_PROCESSING_STRUCT structs, not much sense in mapping, skip
+		
+		// Note 2: segment->record_data_fps and segment->record_indices_fps not mapped.
+		// 	       'create_session_dtype' outputs the raw bytes of a FILE_PROCESSING_STRUCT struct for these, but
+		//          the actual information is mapped below in ['records_info']['record_data'] and ['records_info']['record_indices']
+		//          so it doesn't make sense to map the _fps
+		
+		PY_DICTSET_FUNC (py_array_out, "name",                           map_mef3_decode_maxbytes_to_string(segment->name, MEF_SEGMENT_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "path",                           map_mef3_decode_maxbytes_to_string(segment->path, MEF_FULL_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "channel_name",                   map_mef3_decode_maxbytes_to_string(segment->channel_name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "session_name",                   map_mef3_decode_maxbytes_to_string(segment->session_name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",               segment->level_UUID, UUID_BYTES);
+		
+	}
 	
+	// add (segment specific metadata) numpy structure or dictionary to main dictionary
+	PyDict_SetItemString(metadata_dict, "segment_specific_metadata", py_array_out); 
+	Py_DECREF(py_array_out);	py_array_out = NULL;
+
+
 	//
-    type_str_int = (ui4 *) rh->type_string;
-    type_code = *type_str_int;
-    switch (type_code) {
-        case MEFREC_Note_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Note_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_EDFA_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_EDFA_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_LNTP_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_LNTP_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_Seiz_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Seiz_type(rh, copy_metadata_to_dict));
-            sz = (MEFREC_Seiz_1_0 *) ((ui1 *) rh + MEFREC_Seiz_1_0_OFFSET);
-            if (sz->number_of_channels > 0)
-                PY_DICTSET_FUNC(rh_dict, "record_subbody", map_mef3_Seiz_ch_type(rh, sz->number_of_channels, copy_metadata_to_dict));
-            break;
-        case MEFREC_CSti_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_CSti_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_ESti_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_ESti_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_SyLg_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_SyLg_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_Curs_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Curs_type(rh, copy_metadata_to_dict));
-            break;
-        case MEFREC_Epoc_TYPE_CODE:
-            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Epoc_type(rh, copy_metadata_to_dict));
+	//
+	//
+	
+    // Read segment records if present and add it to metadata
+    if ((segment->record_indices_fps != NULL) & (segment->record_data_fps != NULL)){
+        records_dict = map_mef3_records(segment->record_indices_fps, segment->record_data_fps, copy_metadata_to_dict);
+        PyDict_SetItemString(metadata_dict, "records_info", records_dict);
+        Py_DECREF(records_dict);	records_dict = NULL;
+    }
+
+    // create section 1 dictionary
+	py_md1 = map_mef3_md1(segment->metadata_fps->metadata.section_1, copy_metadata_to_dict);
+    PyDict_SetItemString(metadata_dict, "section_1", py_md1);
+	Py_DECREF(py_md1);	py_md1 = NULL;
+
+    // Create section 2 dictionary
+    switch (segment->channel_type){
+        case TIME_SERIES_CHANNEL_TYPE:
+			py_tmd2 = map_mef3_tmd2(segment->metadata_fps->metadata.time_series_section_2, copy_metadata_to_dict);
+            PyDict_SetItemString(metadata_dict, "section_2", py_tmd2);
+			Py_DECREF(py_tmd2);	py_tmd2 = NULL;
             break;
-        case MEFREC_UnRc_TYPE_CODE:
-            //PyErr_SetString(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
-            PyErr_Format(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
-            PyErr_Occurred();
+        case VIDEO_CHANNEL_TYPE:
+			py_vmd2 = map_mef3_vmd2(segment->metadata_fps->metadata.video_section_2, copy_metadata_to_dict);
+            PyDict_SetItemString(metadata_dict, "section_2", py_vmd2);
+			Py_DECREF(py_vmd2);	py_vmd2 = NULL;
             break;
         default:
-            //PyErr_SetString(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
-            PyErr_Format(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
+            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
             PyErr_Occurred();
-            break;
+            return NULL;
     }
+    
+    // create section 3 dictionary
+	py_md3 = map_mef3_md3(segment->metadata_fps->metadata.section_3, copy_metadata_to_dict);
+    PyDict_SetItemString(metadata_dict, "section_3", py_md3);
+	Py_DECREF(py_md3);	py_md3 = NULL;
 
-    return rh_dict;
-}
 
-PyObject *map_mef3_ri(RECORD_INDEX *ri) {
-    
-    PyObject *ri_dict;
-    PyObject *py_value_obj;
+    // TODO - this should be a list - there is more indices in indices file!!!!
+    // Set the TOC to NULL so that the logic works
+    TOC = NULL;
 
-    // Create output dictionary   
-    ri_dict = PyDict_New();
+    // create indices dictionary
+    switch (segment->channel_type) {
+        case TIME_SERIES_CHANNEL_TYPE:
+            number_of_entries = segment->time_series_indices_fps->universal_header->number_of_entries;
 
-    // Insert entries into dictionary
-    if (ri->type_string[0]) {
-        PY_DICTSET_BUILD(ri_dict, "type_string",          "s", ri->type_string);
-    } else
-        PyDict_SetItemString(ri_dict, "type_string",      Py_None);
+			py_ts_indices = map_mef3_ti(segment->time_series_indices_fps->time_series_indices, number_of_entries, copy_metadata_to_dict);
+            PyDict_SetItemString(metadata_dict, "indices", py_ts_indices);
+			Py_DECREF(py_ts_indices);	py_ts_indices = NULL;
 
-    if (ri->version_major != RECORD_INDEX_VERSION_MAJOR_NO_ENTRY) {
-        PY_DICTSET_BUILD(ri_dict, "version_major",        "B", ri->version_major);
-    } else
-        PyDict_SetItemString(ri_dict, "version_major",    Py_None);
+            // Create TOC
+            TOC = create_mef3_TOC(segment);
 
-    if (ri->version_minor != RECORD_INDEX_VERSION_MINOR_NO_ENTRY) {
-        PY_DICTSET_BUILD(ri_dict, "version_minor",        "B", ri->version_minor);
-    } else
-        PyDict_SetItemString(ri_dict, "version_minor",    Py_None);
+            break;
+        case VIDEO_CHANNEL_TYPE:
+            number_of_entries = segment->video_indices_fps->universal_header->number_of_entries;
 
-    if (ri->encryption != ENCRYPTION_LEVEL_NO_ENTRY) {
-        PY_DICTSET_BUILD(ri_dict, "encryption",           "b", ri->encryption);
-    } else
-        PyDict_SetItemString(ri_dict, "encryption",       Py_None);
+			py_v_indices = map_mef3_vi(segment->video_indices_fps->video_indices, number_of_entries, copy_metadata_to_dict);
+            PyDict_SetItemString(metadata_dict, "indices", py_v_indices);
+			Py_DECREF(py_v_indices);	py_v_indices = NULL;
 
-    if (ri->file_offset != RECORD_INDEX_FILE_OFFSET_NO_ENTRY) {
-		PY_DICTSET_LONG (ri_dict, "file_offset",               ri->file_offset);
-    } else
-        PyDict_SetItemString(ri_dict, "file_offset",      Py_None);
+            break;
+        default:
+            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
+            PyErr_Occurred();
+            return NULL;
+    }
+    
+    if (TOC != NULL) {
+        PyDict_SetItemString(metadata_dict, "TOC", TOC);
+		Py_DECREF(TOC);	TOC = NULL;
+	}
 
-    if (ri->time != RECORD_INDEX_TIME_NO_ENTRY) {
-		//PY_DICTSET_LONG (ri_dict, "time",                      ABS(ri->time_));
-		PY_DICTSET_LONG (ri_dict, "time",                      ri->time);
-    } else
-        PyDict_SetItemString(ri_dict, "time",             Py_None);
+    // Get universal headers
+    uhs_dict = PyDict_New();
 
-    return ri_dict;
+    // Metadata
+    uh_dict = map_mef3_uh(segment->metadata_fps->universal_header, copy_metadata_to_dict);
+    PyDict_SetItemString(uhs_dict, "metadata", uh_dict);
+	Py_DECREF(uh_dict);	uh_dict = NULL;
+
+    // Data an indices universal headers
+    switch (segment->channel_type) {
+        case TIME_SERIES_CHANNEL_TYPE:
+			
+			py_uh_ts_data = map_mef3_uh(segment->time_series_data_fps->universal_header, copy_metadata_to_dict);
+            PyDict_SetItemString(uhs_dict, "time_series_data", py_uh_ts_data);
+			Py_DECREF(py_uh_ts_data);	py_uh_ts_data = NULL;
+			
+			py_uh_ts_indices = map_mef3_uh(segment->time_series_indices_fps->universal_header, copy_metadata_to_dict);
+            PyDict_SetItemString(uhs_dict, "time_series_indices", py_uh_ts_indices);
+			Py_DECREF(py_uh_ts_indices);	py_uh_ts_indices = NULL;
+			
+            break;
+        case VIDEO_CHANNEL_TYPE:
+		
+			py_uh_v_indices = map_mef3_uh(segment->video_indices_fps->universal_header, copy_metadata_to_dict);
+            PyDict_SetItemString(uhs_dict, "video_indices", py_uh_v_indices);
+			Py_DECREF(py_uh_v_indices);	py_uh_v_indices = NULL;
+			
+            break;
+        default:
+            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
+            PyErr_Occurred();
+            return NULL;
+    }
+
+    PyDict_SetItemString(metadata_dict, "universal_headers", uhs_dict);
+	Py_DECREF(uhs_dict);	uhs_dict = NULL;
+
+    return metadata_dict;
 }
 
-PyObject *map_mef3_Note_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+// Map channel
+// Note: this funtion also loops through segments
+PyObject *map_mef3_channel(CHANNEL *channel, si1 map_indices_flag, si1 copy_metadata_to_dict) {
 
-    PyObject    *py_array_out;
-	si1     *body_p;
-	ui4     str_len;
+    PyObject *metadata_dict;
+    PyObject *records_dict;
+    PyObject *segment_dict;
+    PyObject *segments_all_dict;
+    PyObject *py_md1, *py_tmd2 ,*py_vmd2, *py_md3;
 	
-	body_p = (si1 *) rh + MEFREC_Note_1_0_TEXT_OFFSET;
-	str_len = (ui4) strlen(body_p);
+    si4   i;
+    SEGMENT *segment;
+
+    // create python output dictionary
+    metadata_dict = PyDict_New();
+
+	//
+	// map channel specific metadata
+	// 
 	
+	PyObject    *py_array_out;
 	if (!copy_metadata_to_dict) {
-		// numpy structure out
-		
-		import_array();
+		// numpy structure
 
+		import_array();
+		
 		npy_intp dims[] = {1};
-		npy_intp strides[] = {rh->bytes};
+		npy_intp strides[] = {sizeof(CHANNEL)};
 		PyArray_Descr    *descr;
-
-		descr = (PyArray_Descr *) create_note_dtype_c(str_len);
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+    
+		descr = (PyArray_Descr *) create_channel_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) channel, NPY_ARRAY_DEFAULT, Py_None);
 		
 	} else {
 		// python dictionary out
-	
+		
 		py_array_out = PyDict_New();
 		PyObject *py_value_obj;
 		
-		PY_DICTSET_FUNC(py_array_out, "text", map_mef3_decode_sizebytes_to_string(body_p, str_len));
+		PY_DICTSET_BUILD(py_array_out, "channel_type",              "i", channel->channel_type);
 		
-	}
-	
-    return py_array_out;
-}
-
-PyObject *map_mef3_EDFA_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
-
-    PyObject    *py_array_out;
-    si1     *body_p;
-    ui4     str_len;
-
-    body_p = (si1 *) rh + MEFREC_EDFA_1_0_OFFSET;
-    str_len = (ui4) strlen(body_p + MEFREC_EDFA_1_0_BYTES);
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure out
+		// Note 1: channel->metadata not mapped. 'create_session_dtype' outputs the raw bytes 
+		//         of a METADATA struct, not much sense in mapping, skip
 		
-		import_array();
-
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {rh->bytes};
-		PyArray_Descr    *descr;
-
-		descr = (PyArray_Descr *) create_edfa_dtype_c(str_len);
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
-
-	} else {
-		// python dictionary out
-			
-		MEFREC_EDFA_1_0	*edfa = (MEFREC_EDFA_1_0 *) (rh + MEFREC_EDFA_1_0_OFFSET);
+		// Note 2: channel->record_data_fps and channel->record_indices_fps not mapped.
+		// 	       'create_session_dtype' outputs the raw bytes of a FILE_PROCESSING_STRUCT struct for these, but
+		//          the actual information is mapped below in ['records_info']['record_data'] and ['records_info']['record_indices']
+		//          so it doesn't make sense to map the _fps
 		
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
+		// Note 3: channel->segments not mapped. 'create_session_dtype' outputs the raw bytes 
+		//         of SEGMENT structs, not much sense in mapping, skip
 		
-		PY_DICTSET_LONG (py_array_out, "duration",           edfa->duration);
-		PY_DICTSET_FUNC (py_array_out, "text", 			     map_mef3_decode_sizebytes_to_string(body_p + MEFREC_EDFA_1_0_BYTES, str_len));
+		PY_DICTSET_LONG (py_array_out, "number_of_segments",             channel->number_of_segments);
+		PY_DICTSET_FUNC (py_array_out, "path",                           map_mef3_decode_maxbytes_to_string(channel->path, MEF_FULL_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "name",                           map_mef3_decode_maxbytes_to_string(channel->name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "extension",                      map_mef3_decode_maxbytes_to_string(channel->extension, TYPE_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "session_name",                   map_mef3_decode_maxbytes_to_string(channel->session_name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",               channel->level_UUID, UUID_BYTES);
+		PY_DICTSET_FUNC (py_array_out, "anonymized_name",                map_mef3_decode_maxbytes_to_string(channel->anonymized_name, UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES));
+		PY_DICTSET_LONG (py_array_out, "maximum_number_of_records",      channel->maximum_number_of_records);
+		PY_DICTSET_LONG (py_array_out, "maximum_record_bytes",           channel->maximum_record_bytes);
+		PY_DICTSET_LONG (py_array_out, "earliest_start_time",            channel->earliest_start_time);
+		PY_DICTSET_LONG (py_array_out, "latest_end_time",                channel->latest_end_time);
 		
 	}
 	
-	return py_array_out;
-}
-
-PyObject *map_mef3_LNTP_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
-
-    PyObject    *py_array_out;
-    
-	if (!copy_metadata_to_dict) {
-		// numpy structure out
+    // add (channel specific metadata) numpy structure or dictionary to main dictionary
+    PyDict_SetItemString(metadata_dict, "channel_specific_metadata", py_array_out);
+	Py_DECREF(py_array_out);	py_array_out = NULL;
 	
-		import_array();
-
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {rh->bytes};
-		si1     *body_p;
-		PyArray_Descr    *descr;
-		ui4     template_size;
 	
-		template_size = rh->bytes - MEFREC_LNTP_1_0_BYTES;	
-		
-		descr = (PyArray_Descr *) create_lntp_dtype_c(template_size);
-		body_p = (si1 *) rh + MEFREC_LNTP_1_0_OFFSET;
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+	//
+	//
+	//
+	
+    // Read channel records if present and add it to metadata
+    if ((channel->record_indices_fps != NULL) & (channel->record_data_fps != NULL)){
+        records_dict = map_mef3_records(channel->record_indices_fps, channel->record_data_fps, copy_metadata_to_dict);
+        PyDict_SetItemString(metadata_dict, "records_info", records_dict);
+		Py_DECREF(records_dict);	records_dict = NULL;
+    }
 
-	} else {
-		// python dictionary out
+	// create section 1 dictionary
+	py_md1 = map_mef3_md1(channel->metadata.section_1, copy_metadata_to_dict);
+    PyDict_SetItemString(metadata_dict, "section_1", py_md1);
+	Py_DECREF(py_md1);	py_md1 = NULL;
+    
+    // create section 2 dictionary
+    switch (channel->channel_type){
+        case TIME_SERIES_CHANNEL_TYPE:
 		
-		MEFREC_LNTP_1_0	*lntp = (MEFREC_LNTP_1_0 *) ((ui1 *) rh + MEFREC_LNTP_1_0_OFFSET);
-		si4		*template = (si4 *) rh + MEFREC_LNTP_1_0_TEMPLATE_OFFSET;
+			py_tmd2 = map_mef3_tmd2(channel->metadata.time_series_section_2, copy_metadata_to_dict);
+            PyDict_SetItemString(metadata_dict, "section_2", py_tmd2);
+			Py_DECREF(py_tmd2);	py_tmd2 = NULL;
+			
+            break;
+        case VIDEO_CHANNEL_TYPE:
 		
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
+			py_vmd2 = map_mef3_vmd2(channel->metadata.video_section_2, copy_metadata_to_dict);
+            PyDict_SetItemString(metadata_dict, "section_2", py_vmd2);
+			Py_DECREF(py_vmd2);	py_vmd2 = NULL;
+			
+            break;
+        default:
+            PyErr_SetString(PyExc_RuntimeError, "Unrecognized channel type, exiting...");
+            PyErr_Occurred();
+            return NULL;
+    }
+
+    // create section 3 dictionary
+	py_md3 = map_mef3_md3(channel->metadata.section_3, copy_metadata_to_dict);
+    PyDict_SetItemString(metadata_dict, "section_3", py_md3);
+	Py_DECREF(py_md3);	py_md3 = NULL;
+    
+	// map all segments
+	if (channel->number_of_segments > 0) {
 		
-		PY_DICTSET_LONG (py_array_out, "length",                      lntp->length);
+		segments_all_dict = PyDict_New();
 		
-		// template
-		// Note: commented out because discrepancy between show_mefrec_LNTP_type (si4) and create_lntp_dtype_c (i8), need to verify/test
-		//PyObject* template_list = PyList_New(lntp->length);
-		//for(int i = 0; i < lntp->length; i++)
-		//  PyList_SET_ITEM(list, i, Py_BuildValue("i", template[i])); 	// steals reference to object coming out of Py_BuildValue
-		//PyDict_SetItemString(py_array_out, "template",                  template_list);
-		//Py_DECREF(template_list);
+		// Loop over segments
+		for (i = 0; i < channel->number_of_segments; ++i) {
+			
+			// Get the channel pointer
+			segment = channel->segments + i;
+			
+			// map the segment and add to dictionary
+			segment_dict = map_mef3_segment(segment, map_indices_flag, copy_metadata_to_dict);
+			PyDict_SetItemString(segments_all_dict, segment->name, segment_dict);
+			Py_DECREF(segment_dict);	segment_dict = NULL;
+			
+		}
+		
+		PyDict_SetItemString(metadata_dict, "segments", segments_all_dict);
+		Py_DECREF(segments_all_dict);	segments_all_dict = NULL;
 		
 	}
 	
-    return py_array_out;
+    return metadata_dict;
 }
 
-PyObject *map_mef3_Seiz_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+// Map session
+// Note: this funtion also loops through channels
+PyObject *map_mef3_session(SESSION *session, si1 map_indices_flag, si1 copy_metadata_to_dict) {
 
-    PyObject    *py_array_out;
+    PyObject *metadata_dict;
+    PyObject *records_dict;
+
+    PyObject *ts_metadata;
+	PyObject *ts_all_dict;
+    PyObject *ts_dict;
+
+    PyObject *v_metadata;
+    PyObject *v_all_dict;
+	PyObject *v_dict;
+	PyObject *py_md1, *py_tmd2 ,*py_vmd2, *py_md3;
+    
+    si4   i;
+    CHANNEL *channel;
+
+    // Create python output dictionary
+    metadata_dict = PyDict_New();
+    
+	
+	//
+	// map session specific metadata
+	// 
 	
+	PyObject    *py_array_out;
 	if (!copy_metadata_to_dict) {
-		// numpy structure out
+		// Numpy structure out
 		
-		import_array();
-
+		import_array();			
 		npy_intp dims[] = {1};
-		npy_intp strides[] = {MEFREC_Seiz_1_0_BYTES};
-		si1     *body_p;
-		PyArray_Descr    *descr;
+		npy_intp strides[] = {sizeof(SESSION)};
+		
+		PyArray_Descr *descr = (PyArray_Descr *) create_session_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) session, NPY_ARRAY_DEFAULT, Py_None);
 		
-		descr = (PyArray_Descr *) create_seiz_dtype();
-		body_p = (si1 *) rh + MEFREC_Seiz_1_0_OFFSET;
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
-
 	} else {
 		// python dictionary out
 		
-		MEFREC_Seiz_1_0		*seizure = (MEFREC_Seiz_1_0 *) ((ui1 *) rh + MEFREC_Seiz_1_0_OFFSET);
-		
 		py_array_out = PyDict_New();
 		PyObject *py_value_obj;
 		
-		PY_DICTSET_LONG (py_array_out, "earliest_onset",              seizure->earliest_onset);
-		PY_DICTSET_LONG (py_array_out, "latest_offset",               seizure->latest_offset);
-		PY_DICTSET_LONG (py_array_out, "duration",                    seizure->duration);
-		PY_DICTSET_BUILD(py_array_out, "number_of_channels",     "i", seizure->number_of_channels);
-		PY_DICTSET_BUILD(py_array_out, "onset_code",             "i", seizure->onset_code);
-		PY_DICTSET_FUNC (py_array_out, "marker_name_1",               map_mef3_decode_maxbytes_to_string(seizure->marker_name_1, MEFREC_Seiz_1_0_MARKER_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "marker_name_2",               map_mef3_decode_maxbytes_to_string(seizure->marker_name_2, MEFREC_Seiz_1_0_MARKER_NAME_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "annotation",                  map_mef3_decode_maxbytes_to_string(seizure->annotation, MEFREC_Seiz_1_0_ANNOTATION_BYTES));
+		PY_DICTSET_BUILD(py_array_out, "number_of_time_series_channels", "i", session->number_of_time_series_channels);
+		PY_DICTSET_BUILD(py_array_out, "number_of_video_channels",       "i", session->number_of_video_channels);
 		
-	}
-	
-    return py_array_out;
-}
-
-PyObject *map_mef3_Seiz_ch_type(RECORD_HEADER *rh, si4 number_of_channels, si1 copy_metadata_to_dict) {
-
-    PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure out	
+		// Note 1: session->time_series_metadata and session->video_metadata not mapped. 
+		//         'create_session_dtype' outputs the raw bytes of a METADATA struct, not much sense in mapping, skip
 		
-		import_array();
+		// Note 2: session->time_series_channels and session->video_channels not mapped.
+		//         'create_session_dtype' outputs the raw bytes of a CHANNEL struct, not much sense in mapping, skip
 		
-		npy_intp dims[] = {number_of_channels};
-		npy_intp strides[] = {MEFREC_Seiz_1_0_CHANNEL_BYTES};
-		si1     *body_p;
-		PyArray_Descr    *descr;
+		// Note 3: session->record_data_fps and session->record_indices_fps not mapped.
+		// 	       'create_session_dtype' outputs the raw bytes of a FILE_PROCESSING_STRUCT struct for these, but
+		//          the actual information is mapped below in ['records_info']['record_data'] and ['records_info']['record_indices']
+		//          so it doesn't make sense to map the _fps
 		
-		descr = (PyArray_Descr *) create_seiz_ch_dtype();
-		body_p = (si1 *) rh + MEFREC_Seiz_1_0_CHANNELS_OFFSET;
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
 
-	} else {
-		// python dictionary out
-		
-		MEFREC_Seiz_1_0_CHANNEL	*seiz_channels = (MEFREC_Seiz_1_0_CHANNEL *) ((ui1 *) rh + MEFREC_Seiz_1_0_CHANNELS_OFFSET);
-		
-		py_array_out = PyList_New(number_of_channels);
-		for(int i = 0; i < number_of_channels; i++) {
-			
-			PyObject *py_dict_seiz_channel = PyDict_New();	
-			PyObject *py_value_obj;
-			
-			PY_DICTSET_FUNC (py_dict_seiz_channel, "name",                map_mef3_decode_maxbytes_to_string(seiz_channels[i].name, MEF_BASE_FILE_NAME_BYTES));
-			PY_DICTSET_LONG (py_dict_seiz_channel, "onset",               seiz_channels[i].onset);
-			PY_DICTSET_LONG (py_dict_seiz_channel, "offset",              seiz_channels[i].offset);
-				
-			PyList_SET_ITEM(py_array_out, i, py_dict_seiz_channel); 	// steals reference to object py_dict_seiz_channel
-			
-		}
-		
+		PY_DICTSET_FUNC (py_array_out, "name",                           map_mef3_decode_maxbytes_to_string(session->name, MEF_BASE_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "path",                           map_mef3_decode_maxbytes_to_string(session->path, MEF_FULL_FILE_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "anonymized_name",                map_mef3_decode_maxbytes_to_string(session->anonymized_name, UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES));
+		PY_DICTSET_BYTEARRSIZE(py_array_out, "level_UUID",               session->level_UUID, UUID_BYTES);
+		PY_DICTSET_LONG (py_array_out, "maximum_number_of_records",      session->maximum_number_of_records);
+		PY_DICTSET_LONG (py_array_out, "maximum_record_bytes",           session->maximum_record_bytes);
+		PY_DICTSET_LONG (py_array_out, "earliest_start_time",            session->earliest_start_time);
+		PY_DICTSET_LONG (py_array_out, "latest_end_time",                session->latest_end_time);
+
 	}
-	
-    return py_array_out;
-}
 
-PyObject *map_mef3_CSti_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+	// add (session specific metadata) numpy structure or dictionary to main dictionary
+	PyDict_SetItemString(metadata_dict, "session_specific_metadata", py_array_out);
+	Py_DECREF(py_array_out);	py_array_out = NULL;
+	
 
-    PyObject    *py_array_out;
+	//
+	//
+	//
 	
-	if (!copy_metadata_to_dict) {
-		// numpy structure out
+	// read session records if present and add it to metadata
+	if ((session->record_indices_fps != NULL) & (session->record_data_fps != NULL)){
+		records_dict = map_mef3_records(session->record_indices_fps, session->record_data_fps, copy_metadata_to_dict);
+		PyDict_SetItemString(metadata_dict, "records_info", records_dict);
+		Py_DECREF(records_dict);	records_dict = NULL;
+	}
+	
+	// get time series metadata
+	if (session->number_of_time_series_channels > 0) {
 		
-		import_array();
+		// create dictionary
+		ts_metadata = PyDict_New();
+
+		// create section time series 1 dictionary
+		py_md1 = map_mef3_md1(session->time_series_metadata.section_1, copy_metadata_to_dict);
+		PyDict_SetItemString(ts_metadata, "section_1", py_md1);
+		Py_DECREF(py_md1);	py_md1 = NULL;
+
+		// create section time series 2 dictionary
+		py_tmd2 = map_mef3_tmd2(session->time_series_metadata.time_series_section_2, copy_metadata_to_dict);
+		PyDict_SetItemString(ts_metadata, "section_2", py_tmd2);
+		Py_DECREF(py_tmd2);	py_tmd2 = NULL;
 		
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {MEFREC_CSti_1_0_BYTES};
-		si1     *body_p;
-		PyArray_Descr    *descr;
+		// create section time series 3 dictionary
+		py_md3 = map_mef3_md3(session->time_series_metadata.section_3, copy_metadata_to_dict);
+		PyDict_SetItemString(ts_metadata, "section_3", py_md3);
+		Py_DECREF(py_md3);	py_md3 = NULL;
 		
-		descr = (PyArray_Descr *) create_csti_dtype();
-		body_p = (si1 *) rh + MEFREC_CSti_1_0_OFFSET;
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+		// 
+		PyDict_SetItemString(metadata_dict, "time_series_metadata", ts_metadata); 
+		Py_DECREF(ts_metadata);	ts_metadata = NULL;
+	}
 
-	} else {
-		// python dictionary out
+	// get video metadata
+	if (session->number_of_video_channels > 0) {
 		
-		MEFREC_CSti_1_0	*cog_stim = (MEFREC_CSti_1_0 *) ((ui1 *) rh + MEFREC_CSti_1_0_OFFSET);
+		// create dictionary
+		v_metadata = PyDict_New();
+
+		// create section video 1 dictionary
+		py_md1 = map_mef3_md1(session->video_metadata.section_1, copy_metadata_to_dict);
+		PyDict_SetItemString(v_metadata, "section_1", py_md1);
+		Py_DECREF(py_md1);	py_md1 = NULL;
 		
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
+		// create section video 2 dictionary
+		py_vmd2 = map_mef3_vmd2(session->video_metadata.video_section_2, copy_metadata_to_dict);
+		PyDict_SetItemString(v_metadata, "section_2", py_vmd2);
+		Py_DECREF(py_vmd2);	py_vmd2 = NULL;
 		
-		PY_DICTSET_FUNC (py_array_out, "task_type",                   map_mef3_decode_maxbytes_to_string(cog_stim->task_type, MEFREC_CSti_1_0_TASK_TYPE_BYTES));
-		PY_DICTSET_LONG (py_array_out, "stimulus_duration",           cog_stim->stimulus_duration);
-		PY_DICTSET_FUNC (py_array_out, "stimulus_type",               map_mef3_decode_maxbytes_to_string(cog_stim->stimulus_type, MEFREC_CSti_1_0_STIMULUS_TYPE_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "patient_response",            map_mef3_decode_maxbytes_to_string(cog_stim->patient_response, MEFREC_CSti_1_0_PATIENT_RESPONSE_BYTES));
+		// create section video 3 dictionary
+		py_md3 = map_mef3_md3(session->video_metadata.section_3, copy_metadata_to_dict);
+		PyDict_SetItemString(v_metadata, "section_3", py_md3);
+		Py_DECREF(py_md3);	py_md3 = NULL;
+		
+		//
+		PyDict_SetItemString(metadata_dict, "video_metadata", v_metadata); 
+		Py_DECREF(v_metadata);	v_metadata = NULL;
 		
 	}
 	
-    return py_array_out;
-}
-
-PyObject *map_mef3_ESti_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
-
-    PyObject    *py_array_out;
-	
-	if (!copy_metadata_to_dict) {
-		// numpy structure out	
-	
-		import_array();
+	if (session->number_of_time_series_channels > 0) {
+		ts_all_dict = PyDict_New();
 		
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {MEFREC_ESti_1_0_BYTES};
-		si1     *body_p;	
-		PyArray_Descr    *descr;
+		// Loop over time series channels
+		for (i = 0; i < session->number_of_time_series_channels; ++i) {
+			
+			// get the channel pointer
+			channel = session->time_series_channels + i;
+			
+			// map the channel and add to dictionary
+			ts_dict = map_mef3_channel(channel, map_indices_flag, copy_metadata_to_dict);
+			PyDict_SetItemString(ts_all_dict, channel->name, ts_dict);
+			Py_DECREF(ts_dict);	ts_dict = NULL;
+			
+		}
 		
-		descr = (PyArray_Descr *) create_esti_dtype();
-		body_p = (si1 *) rh + MEFREC_ESti_1_0_OFFSET;
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+		PyDict_SetItemString(metadata_dict, "time_series_channels", ts_all_dict);
+		Py_DECREF(ts_all_dict);	ts_all_dict = NULL;
+	}
 
-	} else {
-		// python dictionary out
-		
-		MEFREC_ESti_1_0	*el_stim = (MEFREC_ESti_1_0 *) ((ui1 *) rh + MEFREC_ESti_1_0_OFFSET);
-		
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_BUILD(py_array_out, "amplitude",              "d", el_stim->amplitude);
-		PY_DICTSET_BUILD(py_array_out, "frequency",              "d", el_stim->frequency);
-		PY_DICTSET_LONG (py_array_out, "pulse_width",                 el_stim->pulse_width);
-		PY_DICTSET_BUILD(py_array_out, "ampunit_code",           "i", el_stim->ampunit_code);
-		PY_DICTSET_BUILD(py_array_out, "mode_code",              "i", el_stim->mode_code);
-		PY_DICTSET_FUNC (py_array_out, "waveform",                    map_mef3_decode_maxbytes_to_string(el_stim->waveform, MEFREC_ESti_1_0_WAVEFORM_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "anode",                       map_mef3_decode_maxbytes_to_string(el_stim->anode, MEFREC_ESti_1_0_ANODE_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "catode",                      map_mef3_decode_maxbytes_to_string(el_stim->catode, MEFREC_ESti_1_0_CATODE_BYTES));
+	if (session->number_of_time_series_channels > 0) {
+		v_all_dict = PyDict_New();
 		
+		// loop over video channels
+		for (i = 0; i < session->number_of_video_channels; ++i){
+			
+			// get the channel pointer
+			channel = session->video_channels + i;
+			
+			// map the channel and add to dictionary
+			v_dict = map_mef3_channel(channel, map_indices_flag, copy_metadata_to_dict);
+			PyDict_SetItemString(v_all_dict, channel->name, v_dict);
+			Py_DECREF(v_dict);	v_dict = NULL;
+			
+		}
+
+		PyDict_SetItemString(metadata_dict, "video_channels", v_all_dict);
+		Py_DECREF(v_all_dict);	v_all_dict = NULL;
 	}
-	
-    return py_array_out;
+
+    return metadata_dict;
 }
 
-PyObject *map_mef3_SyLg_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+/**************************  Mef record struct to Python  ****************************/
 
-    PyObject    *py_array_out;
-	si1     *body_p;
-	ui4     str_len;
+// Runs through records and puts them in a dictionary
+PyObject *map_mef3_records(FILE_PROCESSING_STRUCT *ri_fps, FILE_PROCESSING_STRUCT *rd_fps, si1 copy_metadata_to_dict) {
+
+    // Ditionary
+    PyObject    *record_info_dict;
+    PyObject    *all_record_list;
+    PyObject    *record_dict;
+    PyObject    *uhs_dict;
+    PyObject    *uh_dict;
+
+    ui1    *rd;
+    si4     i;
+    si8     number_of_records;
+
+    RECORD_HEADER   *rh;
+ 
+    // Set up output dictionary
+    record_info_dict = PyDict_New();
+
+    // get and map record universal headers
+    uhs_dict = PyDict_New();
 	
-	body_p = (si1 *) rh + MEFREC_SyLg_1_0_TEXT_OFFSET;
-	str_len = (ui4) strlen(body_p);
+    uh_dict = map_mef3_uh(ri_fps->universal_header, copy_metadata_to_dict);
+    PyDict_SetItemString(uhs_dict, "record_indices", uh_dict);
+	Py_DECREF(uh_dict);		uh_dict = NULL;
 	
-	if (!copy_metadata_to_dict) {
-		// numpy structure out	
-		
-		import_array();
+    uh_dict = map_mef3_uh(rd_fps->universal_header, copy_metadata_to_dict);
+    PyDict_SetItemString(uhs_dict, "record_data", uh_dict);
+	Py_DECREF(uh_dict);		uh_dict = NULL;
+	
+    PyDict_SetItemString(record_info_dict, "universal_headers", uhs_dict);
+	Py_DECREF(uhs_dict);	uhs_dict = NULL;
 
-		npy_intp dims[] = {1};
-		npy_intp strides[] = {rh->bytes};
-		PyArray_Descr    *descr;
-		
-		descr = (PyArray_Descr *) create_sylg_dtype_c(str_len);
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+    // Create list for records
+    number_of_records = ri_fps->universal_header->number_of_entries;
+    all_record_list = PyList_New(number_of_records);
 
-	} else {
-		// python dictionary out
+    // map each record (header and body)
+	// Note: Not mapping record indices (ri_fps->record_indices, map_mef3_ri).
+	//       Could have been used to filter read records, but will be done in python now
+    rd = rd_fps->raw_data + UNIVERSAL_HEADER_BYTES;
+    for (i = 0; i < number_of_records; ++i) {
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		PY_DICTSET_FUNC(py_array_out, "text", map_mef3_decode_sizebytes_to_string(body_p, str_len));
+        rh = (RECORD_HEADER *) rd;
+        record_dict = map_mef3_rh(rh, copy_metadata_to_dict);
 		
-	}
-	
-	return py_array_out;
+		// Note: ASK Matt / Dan. Could also be type_string, 
+        PyList_SET_ITEM(all_record_list, i, record_dict); 	// steals reference to object coming out of map_mef3_rh
 
-}
+        rd += (RECORD_HEADER_BYTES + rh->bytes);
+        
+    }
 
-PyObject *map_mef3_Curs_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+    PyDict_SetItemString(record_info_dict, "records", all_record_list);
+	Py_DECREF(all_record_list);	all_record_list = NULL;
+	
+    return record_info_dict;
+}
 
-    PyObject    *py_array_out;
+// map a record
+PyObject *map_mef3_rh(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+	
+	PyObject *py_value_obj;
+	PyObject    *py_array_out;
+	MEFREC_Seiz_1_0 *sz;
+	ui4     *type_str_int, type_code;
+		
+	// Create output dictionary   
+	PyObject *rh_dict = PyDict_New();
 	
 	if (!copy_metadata_to_dict) {
-		// numpy structure out	
-			
+		// numpy structure out
+		
 		import_array();
-
 		npy_intp dims[] = {1};
-		npy_intp strides[] = {MEFREC_Curs_1_0_BYTES};
-		si1     *body_p;
-		PyArray_Descr    *descr;
-
-		descr = (PyArray_Descr *) create_curs_dtype();
-		body_p = (si1 *) rh + MEFREC_Curs_1_0_OFFSET;
-		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+		npy_intp strides[] = {RECORD_HEADER_BYTES};
 		
+		PyArray_Descr *descr = (PyArray_Descr *) create_rh_dtype();
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) rh, 1, Py_None);
+
 	} else {
 		// python dictionary out
-
-		MEFREC_Curs_1_0	*cursor = (MEFREC_Curs_1_0 *) ((ui1 *) rh + MEFREC_Curs_1_0_OFFSET);
 		
 		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
 		
-		PY_DICTSET_LONG (py_array_out, "id_number",                   cursor->id_number);
-		PY_DICTSET_LONG (py_array_out, "trace_timestamp",             cursor->trace_timestamp);
-		PY_DICTSET_LONG (py_array_out, "latency",                     cursor->latency);
-		PY_DICTSET_BUILD(py_array_out, "value",                  "d", cursor->value);
-		PY_DICTSET_FUNC (py_array_out, "name",                        map_mef3_decode_maxbytes_to_string(cursor->name, MEFREC_Curs_1_0_NAME_BYTES));
-		
-	}
-	
+		PY_DICTSET_BUILD(py_array_out, "record_CRC",             "I", rh->record_CRC);
+		PY_DICTSET_BUILD(py_array_out, "type_string",            "s", rh->type_string);
+		PY_DICTSET_BUILD(py_array_out, "version_major",          "B", rh->version_major);
+		PY_DICTSET_BUILD(py_array_out, "version_minor",          "B", rh->version_minor);
+		PY_DICTSET_BUILD(py_array_out, "encryption",             "b", rh->encryption);
+		PY_DICTSET_BUILD(py_array_out, "bytes",                  "I", rh->bytes);
+		PY_DICTSET_LONG (py_array_out, "time",                        rh->time);
+
+	}	
+
+	PyDict_SetItemString(rh_dict, "record_header", py_array_out);
+	Py_DECREF(py_array_out);	py_array_out = NULL;
+	
+	//
+    type_str_int = (ui4 *) rh->type_string;
+    type_code = *type_str_int;
+    switch (type_code) {
+        case MEFREC_Note_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Note_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_EDFA_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_EDFA_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_LNTP_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_LNTP_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_Seiz_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Seiz_type(rh, copy_metadata_to_dict));
+            sz = (MEFREC_Seiz_1_0 *) ((ui1 *) rh + MEFREC_Seiz_1_0_OFFSET);
+            if (sz->number_of_channels > 0)
+                PY_DICTSET_FUNC(rh_dict, "record_subbody", map_mef3_Seiz_ch_type(rh, sz->number_of_channels, copy_metadata_to_dict));
+            break;
+        case MEFREC_CSti_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_CSti_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_ESti_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_ESti_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_SyLg_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_SyLg_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_Curs_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Curs_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_Epoc_TYPE_CODE:
+            PY_DICTSET_FUNC(rh_dict, "record_body", map_mef3_Epoc_type(rh, copy_metadata_to_dict));
+            break;
+        case MEFREC_UnRc_TYPE_CODE:
+            //PyErr_SetString(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
+            PyErr_Format(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
+            PyErr_Occurred();
+            break;
+        default:
+            //PyErr_SetString(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
+            PyErr_Format(PyExc_RuntimeError, "\"%s\" (0x%x) is an unrecognized record type\n", rh->type_string, type_code);
+            PyErr_Occurred();
+            break;
+    }
+
+    return rh_dict;
+}
+
+PyObject *map_mef3_ri(RECORD_INDEX *ri) {
+    
+    PyObject *ri_dict;
+    PyObject *py_value_obj;
+
+    // Create output dictionary   
+    ri_dict = PyDict_New();
+
+    // Insert entries into dictionary
+    if (ri->type_string[0]) {
+        PY_DICTSET_BUILD(ri_dict, "type_string",          "s", ri->type_string);
+    } else
+        PyDict_SetItemString(ri_dict, "type_string",      Py_None);
+
+    if (ri->version_major != RECORD_INDEX_VERSION_MAJOR_NO_ENTRY) {
+        PY_DICTSET_BUILD(ri_dict, "version_major",        "B", ri->version_major);
+    } else
+        PyDict_SetItemString(ri_dict, "version_major",    Py_None);
+
+    if (ri->version_minor != RECORD_INDEX_VERSION_MINOR_NO_ENTRY) {
+        PY_DICTSET_BUILD(ri_dict, "version_minor",        "B", ri->version_minor);
+    } else
+        PyDict_SetItemString(ri_dict, "version_minor",    Py_None);
+
+    if (ri->encryption != ENCRYPTION_LEVEL_NO_ENTRY) {
+        PY_DICTSET_BUILD(ri_dict, "encryption",           "b", ri->encryption);
+    } else
+        PyDict_SetItemString(ri_dict, "encryption",       Py_None);
+
+    if (ri->file_offset != RECORD_INDEX_FILE_OFFSET_NO_ENTRY) {
+		PY_DICTSET_LONG (ri_dict, "file_offset",               ri->file_offset);
+    } else
+        PyDict_SetItemString(ri_dict, "file_offset",      Py_None);
+
+    if (ri->time != RECORD_INDEX_TIME_NO_ENTRY) {
+		//PY_DICTSET_LONG (ri_dict, "time",                      ABS(ri->time_));
+		PY_DICTSET_LONG (ri_dict, "time",                      ri->time);
+    } else
+        PyDict_SetItemString(ri_dict, "time",             Py_None);
+
+    return ri_dict;
+}
+
+PyObject *map_mef3_Note_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	si1     *body_p;
+	ui4     str_len;
+	
+	body_p = (si1 *) rh + MEFREC_Note_1_0_TEXT_OFFSET;
+	str_len = (ui4) strlen(body_p);
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out
+		
+		import_array();
+
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {rh->bytes};
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_note_dtype_c(str_len);
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+		
+	} else {
+		// python dictionary out
+	
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_FUNC(py_array_out, "text", map_mef3_decode_sizebytes_to_string(body_p, str_len));
+		
+	}
+	
     return py_array_out;
 }
 
-PyObject *map_mef3_Epoc_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+PyObject *map_mef3_EDFA_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
 
     PyObject    *py_array_out;
+    si1     *body_p;
+    ui4     str_len;
+
+    body_p = (si1 *) rh + MEFREC_EDFA_1_0_OFFSET;
+    str_len = (ui4) strlen(body_p + MEFREC_EDFA_1_0_BYTES);
 	
 	if (!copy_metadata_to_dict) {
-		// numpy structure out	
+		// numpy structure out
 		
 		import_array();
 
 		npy_intp dims[] = {1};
-		npy_intp strides[] = {MEFREC_Epoc_1_0_BYTES};	
+		npy_intp strides[] = {rh->bytes};
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_edfa_dtype_c(str_len);
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary out
+			
+		MEFREC_EDFA_1_0	*edfa = (MEFREC_EDFA_1_0 *) (rh + MEFREC_EDFA_1_0_OFFSET);
+		
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_LONG (py_array_out, "duration",           edfa->duration);
+		PY_DICTSET_FUNC (py_array_out, "text", 			     map_mef3_decode_sizebytes_to_string(body_p + MEFREC_EDFA_1_0_BYTES, str_len));
+		
+	}
+	
+	return py_array_out;
+}
+
+PyObject *map_mef3_LNTP_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+    
+	if (!copy_metadata_to_dict) {
+		// numpy structure out
+	
+		import_array();
+
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {rh->bytes};
 		si1     *body_p;
 		PyArray_Descr    *descr;
+		ui4     template_size;
+	
+		template_size = rh->bytes - MEFREC_LNTP_1_0_BYTES;	
+		
+		descr = (PyArray_Descr *) create_lntp_dtype_c(template_size);
+		body_p = (si1 *) rh + MEFREC_LNTP_1_0_OFFSET;
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
 
-		descr = (PyArray_Descr *) create_epoc_dtype();
-		body_p = (si1 *) rh + MEFREC_Epoc_1_0_OFFSET;
+	} else {
+		// python dictionary out
+		
+		MEFREC_LNTP_1_0	*lntp = (MEFREC_LNTP_1_0 *) ((ui1 *) rh + MEFREC_LNTP_1_0_OFFSET);
+		si4		*template = (si4 *) rh + MEFREC_LNTP_1_0_TEMPLATE_OFFSET;
+		
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_LONG (py_array_out, "length",                      lntp->length);
+		
+		// template
+		// Note: commented out because discrepancy between show_mefrec_LNTP_type (si4) and create_lntp_dtype_c (i8), need to verify/test
+		//PyObject* template_list = PyList_New(lntp->length);
+		//for(int i = 0; i < lntp->length; i++)
+		//  PyList_SET_ITEM(list, i, Py_BuildValue("i", template[i])); 	// steals reference to object coming out of Py_BuildValue
+		//PyDict_SetItemString(py_array_out, "template",                  template_list);
+		//Py_DECREF(template_list);
+		
+	}
+	
+    return py_array_out;
+}
+
+PyObject *map_mef3_Seiz_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out
+		
+		import_array();
+
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {MEFREC_Seiz_1_0_BYTES};
+		si1     *body_p;
+		PyArray_Descr    *descr;
+		
+		descr = (PyArray_Descr *) create_seiz_dtype();
+		body_p = (si1 *) rh + MEFREC_Seiz_1_0_OFFSET;
 		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
 
 	} else {
 		// python dictionary out
+		
+		MEFREC_Seiz_1_0		*seizure = (MEFREC_Seiz_1_0 *) ((ui1 *) rh + MEFREC_Seiz_1_0_OFFSET);
+		
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_LONG (py_array_out, "earliest_onset",              seizure->earliest_onset);
+		PY_DICTSET_LONG (py_array_out, "latest_offset",               seizure->latest_offset);
+		PY_DICTSET_LONG (py_array_out, "duration",                    seizure->duration);
+		PY_DICTSET_BUILD(py_array_out, "number_of_channels",     "i", seizure->number_of_channels);
+		PY_DICTSET_BUILD(py_array_out, "onset_code",             "i", seizure->onset_code);
+		PY_DICTSET_FUNC (py_array_out, "marker_name_1",               map_mef3_decode_maxbytes_to_string(seizure->marker_name_1, MEFREC_Seiz_1_0_MARKER_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "marker_name_2",               map_mef3_decode_maxbytes_to_string(seizure->marker_name_2, MEFREC_Seiz_1_0_MARKER_NAME_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "annotation",                  map_mef3_decode_maxbytes_to_string(seizure->annotation, MEFREC_Seiz_1_0_ANNOTATION_BYTES));
+		
+	}
+	
+    return py_array_out;
+}
+
+PyObject *map_mef3_Seiz_ch_type(RECORD_HEADER *rh, si4 number_of_channels, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out	
+		
+		import_array();
+		
+		npy_intp dims[] = {number_of_channels};
+		npy_intp strides[] = {MEFREC_Seiz_1_0_CHANNEL_BYTES};
+		si1     *body_p;
+		PyArray_Descr    *descr;
+		
+		descr = (PyArray_Descr *) create_seiz_ch_dtype();
+		body_p = (si1 *) rh + MEFREC_Seiz_1_0_CHANNELS_OFFSET;
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary out
+		
+		MEFREC_Seiz_1_0_CHANNEL	*seiz_channels = (MEFREC_Seiz_1_0_CHANNEL *) ((ui1 *) rh + MEFREC_Seiz_1_0_CHANNELS_OFFSET);
+		
+		py_array_out = PyList_New(number_of_channels);
+		for(int i = 0; i < number_of_channels; i++) {
+			
+			PyObject *py_dict_seiz_channel = PyDict_New();	
+			PyObject *py_value_obj;
+			
+			PY_DICTSET_FUNC (py_dict_seiz_channel, "name",                map_mef3_decode_maxbytes_to_string(seiz_channels[i].name, MEF_BASE_FILE_NAME_BYTES));
+			PY_DICTSET_LONG (py_dict_seiz_channel, "onset",               seiz_channels[i].onset);
+			PY_DICTSET_LONG (py_dict_seiz_channel, "offset",              seiz_channels[i].offset);
+				
+			PyList_SET_ITEM(py_array_out, i, py_dict_seiz_channel); 	// steals reference to object py_dict_seiz_channel
+			
+		}
+		
+	}
+	
+    return py_array_out;
+}
+
+PyObject *map_mef3_CSti_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out
+		
+		import_array();
+		
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {MEFREC_CSti_1_0_BYTES};
+		si1     *body_p;
+		PyArray_Descr    *descr;
+		
+		descr = (PyArray_Descr *) create_csti_dtype();
+		body_p = (si1 *) rh + MEFREC_CSti_1_0_OFFSET;
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary out
+		
+		MEFREC_CSti_1_0	*cog_stim = (MEFREC_CSti_1_0 *) ((ui1 *) rh + MEFREC_CSti_1_0_OFFSET);
+		
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_FUNC (py_array_out, "task_type",                   map_mef3_decode_maxbytes_to_string(cog_stim->task_type, MEFREC_CSti_1_0_TASK_TYPE_BYTES));
+		PY_DICTSET_LONG (py_array_out, "stimulus_duration",           cog_stim->stimulus_duration);
+		PY_DICTSET_FUNC (py_array_out, "stimulus_type",               map_mef3_decode_maxbytes_to_string(cog_stim->stimulus_type, MEFREC_CSti_1_0_STIMULUS_TYPE_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "patient_response",            map_mef3_decode_maxbytes_to_string(cog_stim->patient_response, MEFREC_CSti_1_0_PATIENT_RESPONSE_BYTES));
+		
+	}
+	
+    return py_array_out;
+}
+
+PyObject *map_mef3_ESti_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out	
+	
+		import_array();
+		
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {MEFREC_ESti_1_0_BYTES};
+		si1     *body_p;	
+		PyArray_Descr    *descr;
+		
+		descr = (PyArray_Descr *) create_esti_dtype();
+		body_p = (si1 *) rh + MEFREC_ESti_1_0_OFFSET;
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary out
+		
+		MEFREC_ESti_1_0	*el_stim = (MEFREC_ESti_1_0 *) ((ui1 *) rh + MEFREC_ESti_1_0_OFFSET);
+		
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_BUILD(py_array_out, "amplitude",              "d", el_stim->amplitude);
+		PY_DICTSET_BUILD(py_array_out, "frequency",              "d", el_stim->frequency);
+		PY_DICTSET_LONG (py_array_out, "pulse_width",                 el_stim->pulse_width);
+		PY_DICTSET_BUILD(py_array_out, "ampunit_code",           "i", el_stim->ampunit_code);
+		PY_DICTSET_BUILD(py_array_out, "mode_code",              "i", el_stim->mode_code);
+		PY_DICTSET_FUNC (py_array_out, "waveform",                    map_mef3_decode_maxbytes_to_string(el_stim->waveform, MEFREC_ESti_1_0_WAVEFORM_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "anode",                       map_mef3_decode_maxbytes_to_string(el_stim->anode, MEFREC_ESti_1_0_ANODE_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "catode",                      map_mef3_decode_maxbytes_to_string(el_stim->catode, MEFREC_ESti_1_0_CATODE_BYTES));
+		
+	}
+	
+    return py_array_out;
+}
+
+PyObject *map_mef3_SyLg_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	si1     *body_p;
+	ui4     str_len;
+	
+	body_p = (si1 *) rh + MEFREC_SyLg_1_0_TEXT_OFFSET;
+	str_len = (ui4) strlen(body_p);
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out	
+		
+		import_array();
+
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {rh->bytes};
+		PyArray_Descr    *descr;
+		
+		descr = (PyArray_Descr *) create_sylg_dtype_c(str_len);
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary out
+
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_FUNC(py_array_out, "text", map_mef3_decode_sizebytes_to_string(body_p, str_len));
+		
+	}
+	
+	return py_array_out;
+
+}
+
+PyObject *map_mef3_Curs_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out	
+			
+		import_array();
+
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {MEFREC_Curs_1_0_BYTES};
+		si1     *body_p;
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_curs_dtype();
+		body_p = (si1 *) rh + MEFREC_Curs_1_0_OFFSET;
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+		
+	} else {
+		// python dictionary out
+
+		MEFREC_Curs_1_0	*cursor = (MEFREC_Curs_1_0 *) ((ui1 *) rh + MEFREC_Curs_1_0_OFFSET);
+		
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		PY_DICTSET_LONG (py_array_out, "id_number",                   cursor->id_number);
+		PY_DICTSET_LONG (py_array_out, "trace_timestamp",             cursor->trace_timestamp);
+		PY_DICTSET_LONG (py_array_out, "latency",                     cursor->latency);
+		PY_DICTSET_BUILD(py_array_out, "value",                  "d", cursor->value);
+		PY_DICTSET_FUNC (py_array_out, "name",                        map_mef3_decode_maxbytes_to_string(cursor->name, MEFREC_Curs_1_0_NAME_BYTES));
+		
+	}
+	
+    return py_array_out;
+}
+
+PyObject *map_mef3_Epoc_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict) {
+
+    PyObject    *py_array_out;
+	
+	if (!copy_metadata_to_dict) {
+		// numpy structure out	
+		
+		import_array();
+
+		npy_intp dims[] = {1};
+		npy_intp strides[] = {MEFREC_Epoc_1_0_BYTES};	
+		si1     *body_p;
+		PyArray_Descr    *descr;
+
+		descr = (PyArray_Descr *) create_epoc_dtype();
+		body_p = (si1 *) rh + MEFREC_Epoc_1_0_OFFSET;
+		py_array_out = PyArray_NewFromDescr(&PyArray_Type, descr, 1, dims, strides, (void *) body_p, NPY_ARRAY_DEFAULT, Py_None);
+
+	} else {
+		// python dictionary out
+
+		MEFREC_Epoc_1_0	*epoch = (MEFREC_Epoc_1_0 *) ((ui1 *) rh + MEFREC_Epoc_1_0_OFFSET);
+
+		py_array_out = PyDict_New();
+		PyObject *py_value_obj;
+		
+		
+		PY_DICTSET_LONG (py_array_out, "id_number",                   epoch->id_number);
+		PY_DICTSET_LONG (py_array_out, "timestamp",                   epoch->timestamp);
+		PY_DICTSET_LONG (py_array_out, "end_timestamp",               epoch->end_timestamp);
+		PY_DICTSET_LONG (py_array_out, "duration",                    epoch->duration);
+		PY_DICTSET_FUNC (py_array_out, "epoch_type",                  map_mef3_decode_maxbytes_to_string(epoch->epoch_type, MEFREC_Epoc_1_0_EPOCH_TYPE_BYTES));
+		PY_DICTSET_FUNC (py_array_out, "text",                        map_mef3_decode_maxbytes_to_string(epoch->text, MEFREC_Epoc_1_0_TEXT_BYTES));
+		
+	}
+	
+    return py_array_out;
+}
+
+/**************************  Numpy data types  ****************************/
+
+// Records
+static PyObject *create_rh_dtype() {
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s)]",
+
+                       "record_CRC", "u4",
+                       "type_string", "S", TYPE_BYTES,
+                       "version_major", "u1",
+                       "version_minor", "u1",
+                       "encryption", "i1",
+                       "bytes", "u4",
+                       "time", "i8");
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+    return (PyObject *) descr;
+}
+
+static PyObject *create_ri_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s)]",
+
+                       "type_string", "S", TYPE_BYTES,
+                       "version_major", "u1",
+                       "version_minor", "u1",
+                       "encryption", "i1",
+                       "file_offset", "i8",
+                       "time", "i8");
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_edfa_dtype(PyObject *self, PyObject *args) {
+
+    si8     text_len;
+
+    if (!PyArg_ParseTuple(args,"i",
+                          &text_len)){
+        return NULL;
+    }
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i)]",
+
+                       "duration", "i8",
+                       "text", "S", text_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_edfa_dtype_c(ui4 text_len) {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i)]",
+
+                       "duration", "i8",
+                       "text", "S", text_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+// // NOTE: not sure this is correct
+static PyObject *create_lntp_dtype(PyObject *self, PyObject *args) {
+    si8     template_len;
+
+    if (!PyArg_ParseTuple(args,"i",
+                          &template_len)){
+        return NULL;
+    }
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i)]",
+
+                       "length", "i8",
+                       "template", "i8", template_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_lntp_dtype_c(ui4 template_len) {
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i)]",
+
+                       "length", "i8",
+                       "template", "i8", template_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_note_dtype(PyObject *self, PyObject *args) {
+    si8     text_len;
+
+    if (!PyArg_ParseTuple(args,"i",
+                          &text_len)){
+        return NULL;
+    }
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i)]",
+
+                       "text", "S", text_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_note_dtype_c(ui4 text_len) {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i)]",
+
+                       "text", "S", text_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_seiz_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                       "earliest_onset", "i8",
+                       "latest_offset", "i8",
+                       "duration", "i8",
+                       "number_of_channels", "i4",
+                       "onset_code", "i4",
+                       "marker_name_1", "S", MEFREC_Seiz_1_0_MARKER_NAME_BYTES,
+                       "marker_name_2", "S", MEFREC_Seiz_1_0_MARKER_NAME_BYTES,
+                       "annotation", "S", MEFREC_Seiz_1_0_ANNOTATION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_seiz_ch_dtype() {
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i),\
+                         (s, s),\
+                         (s, s)]",
+
+                       "name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "onset", "i8",
+                       "offset", "i8");
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_sylg_dtype(PyObject *self, PyObject *args) {
+    si8     text_len;
+
+    if (!PyArg_ParseTuple(args,"i",
+                          &text_len)){
+        return NULL;
+    }
+
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i)]",
+
+                       "text", "S", text_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_sylg_dtype_c(ui4 text_len) {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i)]",
+
+                       "text", "S", text_len);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_csti_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                        "task_type", "S", MEFREC_CSti_1_0_TASK_TYPE_BYTES,
+                        "stimulus_duration", "i8",
+                        "stimulus_type", "S", MEFREC_CSti_1_0_STIMULUS_TYPE_BYTES,
+                        "patient_response", "S", MEFREC_CSti_1_0_PATIENT_RESPONSE_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_esti_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                        "amplitude", "f8",
+                        "frequency", "f8",
+                        "pulse_width", "i8",
+                        "ampunit_code", "i4",
+                        "mode_code", "i4",
+                        "waveform", "S", MEFREC_ESti_1_0_WAVEFORM_BYTES,
+                        "anode", "S", MEFREC_ESti_1_0_ANODE_BYTES,
+                        "catode", "S", MEFREC_ESti_1_0_CATODE_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_curs_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i)]",
+
+                        "id_number", "i8",
+                        "trace_timestamp", "i8",
+                        "latency", "i8",
+                        "value", "f8",
+                        "name", "S", MEFREC_Curs_1_0_NAME_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_epoc_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                        "id_number", "i8",
+                        "timestamp", "i8",
+                        "end_timestamp", "i8",
+                        "duration", "i8",
+                        "epoch_type", "S", MEFREC_Epoc_1_0_EPOCH_TYPE_BYTES,
+                        "text", "S", MEFREC_Epoc_1_0_TEXT_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_record_table_dtype_c(si4 type_idx) {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyObject    *body;
+    PyArray_Descr    *descr;
+
+    // Build the body - fixed fields of the record type, offsets into the buffer of the variable length parts
+    switch (type_idx) {
+        case RECORD_TABLE_NOTE:
+        case RECORD_TABLE_SYLG:
+            body = Py_BuildValue("[(s, s),\
+                                   (s, s)]",
+
+                                 "text_offset", "i8",
+                                 "text_length", "i8");
+            break;
+        case RECORD_TABLE_EDFA:
+            body = Py_BuildValue("[(s, s),\
+                                   (s, s),\
+                                   (s, s)]",
+
+                                 "duration", "i8",
+                                 "text_offset", "i8",
+                                 "text_length", "i8");
+            break;
+        case RECORD_TABLE_LNTP:
+            body = Py_BuildValue("[(s, s),\
+                                   (s, s)]",
+
+                                 "length", "i8",
+                                 "template_offset", "i8");
+            break;
+        case RECORD_TABLE_SEIZ:
+            body = Py_BuildValue("[(s, s),\
+                                   (s, s),\
+                                   (s, s),\
+                                   (s, s),\
+                                   (s, s),\
+                                   (s, s, i),\
+                                   (s, s, i),\
+                                   (s, s, i),\
+                                   (s, s)]",
+
+                                 "earliest_onset", "i8",
+                                 "latest_offset", "i8",
+                                 "duration", "i8",
+                                 "number_of_channels", "i4",
+                                 "onset_code", "i4",
+                                 "marker_name_1", "S", MEFREC_Seiz_1_0_MARKER_NAME_BYTES,
+                                 "marker_name_2", "S", MEFREC_Seiz_1_0_MARKER_NAME_BYTES,
+                                 "annotation", "S", MEFREC_Seiz_1_0_ANNOTATION_BYTES,
+                                 "channel_offset", "i8");
+            break;
+        case RECORD_TABLE_CSTI:
+            body = create_csti_dtype();
+            break;
+        case RECORD_TABLE_ESTI:
+            body = create_esti_dtype();
+            break;
+        case RECORD_TABLE_CURS:
+            body = create_curs_dtype();
+            break;
+        case RECORD_TABLE_EPOC:
+            body = create_epoc_dtype();
+            break;
+        default:
+            return NULL;
+    }
+    if (body == NULL)
+        return NULL;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, N)]",
+
+                       "time", "i8",
+                       "type_string", "S", TYPE_BYTES,
+                       "version_major", "u1",
+                       "version_minor", "u1",
+                       "encryption", "i1",
+                       "body", body);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+// Library
+static PyObject *create_uh_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                       "header_CRC", "u4",
+                       "body_CRC", "u4",
+                       "file_type_string", "S", TYPE_BYTES,
+                       "mef_version_major", "u1",
+                       "mef_version_minor", "u1",
+                       "byte_order_code", "u1",
+
+                       "start_time", "i8",
+                       "end_time", "i8",
+                       "number_of_entries", "i8",
+                       "maximum_entry_size", "i8",
+                       "segment_number", "i4",
+
+                       "channel_name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "session_name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "anonymized_name", "S", UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES,
+
+                       "level_UUID", "V", UUID_BYTES,
+                       "file_UUID", "V", UUID_BYTES,
+                       "provenance_UUID", "V", UUID_BYTES,
+                       "level_1_password_validation_field", "V", PASSWORD_VALIDATION_FIELD_BYTES,
+                       "level_2_password_validation_field", "V", PASSWORD_VALIDATION_FIELD_BYTES,
+                       "protected_region", "V", UNIVERSAL_HEADER_PROTECTED_REGION_BYTES,
+                       "discretionary_region", "V", UNIVERSAL_HEADER_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_md1_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                       "section_2_encryption", "i1",
+                       "section_3_encryption", "i1",
+                       "protected_region", "V", METADATA_SECTION_1_PROTECTED_REGION_BYTES,
+                       "discretionary_region", "V", METADATA_SECTION_1_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_tmd2_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+                       // type-independent fields
+                       "channel_description", "S", METADATA_CHANNEL_DESCRIPTION_BYTES,
+                       "session_description", "S", METADATA_SESSION_DESCRIPTION_BYTES,
+                       "recording_duration", "i8",
+                       // type-specific fields
+                       "reference_description", "S", METADATA_CHANNEL_DESCRIPTION_BYTES,
+                       "acquisition_channel_number", "i8",
+                       "sampling_frequency", "f8",
+                       "low_frequency_filter_setting", "f8",
+                       "high_frequency_filter_setting", "f8",
+                       "notch_filter_frequency_setting", "f8",
+                       "AC_line_frequency", "f8",
+                       "units_conversion_factor", "f8",
+                       "units_description", "S", TIME_SERIES_METADATA_UNITS_DESCRIPTION_BYTES,
+                       "maximum_native_sample_value", "f8",
+                       "minimum_native_sample_value", "f8",
+                       "start_sample", "i8",
+                       "number_of_samples", "i8",
+                       "number_of_blocks", "i8",
+                       "maximum_block_bytes", "i8",
+                       "maximum_block_samples", "u4",
+                       "maximum_difference_bytes", "u4",
+                       "block_interval", "i8",
+                       "number_of_discontinuities", "i8",
+                       "maximum_contiguous_blocks", "i8",
+                       "maximum_contiguous_block_bytes", "i8",
+                       "maximum_contiguous_samples", "i8",
+                       "protected_region", "V", TIME_SERIES_METADATA_SECTION_2_PROTECTED_REGION_BYTES,
+                       "discretionary_region", "V", TIME_SERIES_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_vmd2_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s, i),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+                       // type-independent fields
+                       "channel_description", "S", METADATA_CHANNEL_DESCRIPTION_BYTES,
+                       "session_description", "S", METADATA_SESSION_DESCRIPTION_BYTES,
+                       "recording_duration", "i8",
+                       // type-specific fields
+                       "horizontal_resolution", "i8",
+                       "vertical_resolution", "i8",
+                       "frame_rate", "f8",
+                       "number_of_clips", "i8",
+                       "maximum_clip_bytes", "i8",
+                       "video_format", "S", VIDEO_METADATA_VIDEO_FORMAT_BYTES,
+                       "video_file_CRC", "u4",
+                       "protected_region", "V", VIDEO_METADATA_SECTION_2_PROTECTED_REGION_BYTES,
+                       "discretionary_region", "V", VIDEO_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_md3_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i)]",
+
+                       "recording_time_offset", "i8",
+                       "DST_start_time", "i8",
+                       "DST_end_time", "i8",
+                       "GMT_offset", "i4",
+                       "subject_name_1", "S", METADATA_SUBJECT_NAME_BYTES,
+                       "subject_name_2", "S", METADATA_SUBJECT_NAME_BYTES,
+                       "subject_ID", "S", METADATA_SUBJECT_ID_BYTES,
+                       "recording_location", "S", METADATA_RECORDING_LOCATION_BYTES,
+                       "protected_region", "V", METADATA_SECTION_3_PROTECTED_REGION_BYTES,
+                       "discretionary_region", "V", METADATA_SECTION_3_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_ti_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+                       "file_offset", "i8",
+                       "start_time", "i8",
+                       "start_sample", "i8",
+                       "number_of_samples", "u4",
+                       "block_bytes", "u4",
+                       "maximum_sample_value", "i4",
+                       "minimum_sample_value", "i4",
+
+                       "protected_region", "V", TIME_SERIES_INDEX_PROTECTED_REGION_BYTES,
+                       "RED_block_flags", "u1",
+                       "RED_block_protected_region", "V", RED_BLOCK_PROTECTED_REGION_BYTES,
+                       "RED_block_discretionary_region", "V", RED_BLOCK_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_vi_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i)]",
+                       "start_time", "i8",
+                       "end_time", "i8",
+                       "start_frame", "u4",
+                       "end_frame", "u4",
+                       "file_offset", "i8",
+                       "clip_bytes", "i8",
+                       "protected_region", "V", VIDEO_INDEX_PROTECTED_REGION_BYTES,
+                       "discretionary_region", "V", VIDEO_INDEX_DISCRETIONARY_REGION_BYTES);
+
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
+
+    return (PyObject *) descr;
+}
+
+static PyObject *create_segment_dtype() {
+    import_array();
+
+    // Numpy array out
+    PyObject    *op;
+    PyArray_Descr    *descr;
+
+    // Build dictionary
+    op = Py_BuildValue("[(s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i)]",
+                       "channel_type", "i4",
+                       "metadata_fps", "V", sizeof (void *),
+                       "time_series_data_fps", "V", sizeof (void *),
+                       "time_series_indices_fps", "V", sizeof (void *),
+                       "video_indices_fps", "V", sizeof (void *),
+                       "record_data_fps", "V", sizeof (void *),
+                       "record_indices_fps", "V", sizeof (void *),
+                       "name", "S", MEF_SEGMENT_BASE_FILE_NAME_BYTES,
+                       "path", "S", MEF_FULL_FILE_NAME_BYTES,
+                       "channel_name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "session_name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "level_UUID", "V", UUID_BYTES);
 
-		MEFREC_Epoc_1_0	*epoch = (MEFREC_Epoc_1_0 *) ((ui1 *) rh + MEFREC_Epoc_1_0_OFFSET);
+    PyArray_DescrConverter(op, &descr);
+    Py_DECREF(op);
 
-		py_array_out = PyDict_New();
-		PyObject *py_value_obj;
-		
-		
-		PY_DICTSET_LONG (py_array_out, "id_number",                   epoch->id_number);
-		PY_DICTSET_LONG (py_array_out, "timestamp",                   epoch->timestamp);
-		PY_DICTSET_LONG (py_array_out, "end_timestamp",               epoch->end_timestamp);
-		PY_DICTSET_LONG (py_array_out, "duration",                    epoch->duration);
-		PY_DICTSET_FUNC (py_array_out, "epoch_type",                  map_mef3_decode_maxbytes_to_string(epoch->epoch_type, MEFREC_Epoc_1_0_EPOCH_TYPE_BYTES));
-		PY_DICTSET_FUNC (py_array_out, "text",                        map_mef3_decode_maxbytes_to_string(epoch->text, MEFREC_Epoc_1_0_TEXT_BYTES));
-		
-	}
-	
-    return py_array_out;
+    return (PyObject *) descr;
 }
 
-/**************************  Numpy data types  ****************************/
-
-// Records
-static PyObject *create_rh_dtype() {
-
+static PyObject *create_channel_dtype() {
     import_array();
 
     // Numpy array out
@@ -4020,27 +5913,46 @@ static PyObject *create_rh_dtype() {
 
     // Build dictionary
     op = Py_BuildValue("[(s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
                          (s, s, i),\
                          (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
                          (s, s),\
                          (s, s),\
                          (s, s),\
                          (s, s)]",
+                       "channel_type", "i4",
+                       "metadata", "V", sizeof (METADATA),
+                       "record_data_fps", "V", sizeof (void *),
+                       "record_indices_fps", "V", sizeof (void *),
+                       "number_of_segments", "i8",
+                       "segments", "V", sizeof (void *),
+                       "path", "S", MEF_FULL_FILE_NAME_BYTES,
+                       "name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "extension", "S", TYPE_BYTES,
+                       "session_name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "level_UUID", "V", UUID_BYTES,
+                       "anonymized_name", "S", UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES,
+                       "maximum_number_of_records", "i8",
+                       "maximum_record_bytes", "i8",
+                       "earliest_start_time", "i8",
+                       "latest_end_time", "i8");
 
-                       "record_CRC", "u4",
-                       "type_string", "S", TYPE_BYTES,
-                       "version_major", "u1",
-                       "version_minor", "u1",
-                       "encryption", "i1",
-                       "bytes", "u4",
-                       "time", "i8");
 
     PyArray_DescrConverter(op, &descr);
     Py_DECREF(op);
+
     return (PyObject *) descr;
 }
 
-static PyObject *create_ri_dtype() {
+static PyObject *create_session_dtype() {
     import_array();
 
     // Numpy array out
@@ -4050,960 +5962,2175 @@ static PyObject *create_ri_dtype() {
     // Build dictionary
     op = Py_BuildValue("[(s, s, i),\
                          (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
+                         (s, s, i),\
                          (s, s),\
                          (s, s),\
                          (s, s),\
                          (s, s)]",
+                       "time_series_metadata", "V", sizeof (METADATA),
+                       "number_of_time_series_channels", "i4",
+                       "time_series_channels", "V", sizeof (void *),
+
+                       "video_metadata", "V", sizeof (METADATA),
+                       "number_of_video_channels", "i4",
+                       "video_channels", "V", sizeof (void *),
+
+                       "record_data_fps", "V", sizeof (void *),
+                       "record_indices_fps", "V", sizeof (void *),
+
+                       "name", "S", MEF_BASE_FILE_NAME_BYTES,
+                       "path", "S", MEF_FULL_FILE_NAME_BYTES,
+                       "anonymized_name", "S", UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES,
+                       "level_UUID", "V", UUID_BYTES,
+
+                       "maximum_number_of_records", "i8",
+                       "maximum_record_bytes", "i8",
+                       "earliest_start_time", "i8",
+                       "latest_end_time", "i8");
 
-                       "type_string", "S", TYPE_BYTES,
-                       "version_major", "u1",
-                       "version_minor", "u1",
-                       "encryption", "i1",
-                       "file_offset", "i8",
-                       "time", "i8");
 
     PyArray_DescrConverter(op, &descr);
     Py_DECREF(op);
 
-    return (PyObject *) descr;
-}
+    return (PyObject *) descr;
+}
+
+/**************************  Other helper functions  ****************************/
+
+si4 check_block_crc(ui1* block_hdr_ptr, ui4 max_samps, ui1* total_data_ptr, ui8 total_data_bytes)
+{
+    ui8 offset_into_data, remaining_buf_size;
+    si1 CRC_valid;
+    RED_BLOCK_HEADER* block_header;
+    
+    offset_into_data = block_hdr_ptr - total_data_ptr;
+    remaining_buf_size = total_data_bytes - offset_into_data;
+    
+    // check if remaining buffer at least contains the RED block header
+    if (remaining_buf_size < RED_BLOCK_HEADER_BYTES)
+        return 0;
+    
+    block_header = (RED_BLOCK_HEADER*) block_hdr_ptr;
+    
+    // check if entire block, based on size specified in header, can possibly fit in the remaining buffer
+    if (block_header->block_bytes > remaining_buf_size)
+        return 0;
+    
+    // check if size specified in header is absurdly large
+    if (block_header->block_bytes > RED_MAX_COMPRESSED_BYTES(max_samps, 1))
+        return 0;
+	
+    // check if size specified in header is too small to be valid
+    if (block_header->block_bytes < RED_BLOCK_HEADER_BYTES)
+        return 0;
+    
+    // at this point we know we have enough data to actually run the CRC calculation, so do it
+    CRC_valid = CRC_validate((ui1*) block_header + CRC_BYTES, block_header->block_bytes - CRC_BYTES, block_header->block_CRC);
+    
+    // return output of CRC heck
+    if (CRC_valid == MEF_TRUE)
+        return 1;
+    else
+        return 0;
+}
+
+si4 extract_segment_number(si1 *segment_name)
+{
+    si1     *c;
+    si4     segment_number;
+
+    // move pointer to the end of the string
+    c = segment_name + strlen(segment_name) - 1;
+
+    // Get to the dash
+    while(*--c == '-'){
+        if (*c == '/'){
+            PyErr_SetString(PyExc_RuntimeError, "Segment name not in valid form XXX-000000");
+            PyErr_Occurred();
+            return -1;
+        }
+    }
+    c++;
+
+    segment_number = (si4) strtol(c, NULL, 10);
+
+    return segment_number;
+}
+
+si8 block_key_c(SEGMENT *segment, si8 block, si4 by_sample, si8 recording_time_offset)
+{
+    // sort key of a block - absolute start sample or start time without the recording time offset
+    TIME_SERIES_INDEX *tsi;
+    si8 key;
+
+    tsi = segment->time_series_indices_fps->time_series_indices + block;
+    if (by_sample)
+        return segment->metadata_fps->metadata.time_series_section_2->start_sample + tsi->start_sample;
+
+    key = tsi->start_time;
+    remove_recording_time_offset_c(&key, recording_time_offset);
+    return key;
+}
+
+si8 find_block_c(SEGMENT *segment, si8 value, si4 by_sample, si8 recording_time_offset)
+{
+    // binary search for the last block starting at or before value, -1 if value precedes the segment
+    si8 lo, hi, mid;
+
+    lo = 0;
+    hi = segment->metadata_fps->metadata.time_series_section_2->number_of_blocks;
+    while (lo < hi) {
+        mid = lo + ((hi - lo) / 2);
+        if (block_key_c(segment, mid, by_sample, recording_time_offset) <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo - 1;
+}
+
+si4 find_channel_block_c(CHANNEL *channel, si8 value, si4 by_sample, si8 recording_time_offset, si4 *segment_idx, si8 *block_idx)
+{
+    // Two level binary search (segments, then blocks) for the last block of the channel starting at or before value.
+    // Segment indices are sorted, so no separate channel level index is needed.
+    // Returns MEF_FALSE if value precedes the first block of the channel.
+    si4 lo, hi, mid, m, found;
+
+    found = -1;
+    lo = 0;
+    hi = (si4) channel->number_of_segments - 1;
+    while (lo <= hi) {
+        mid = lo + ((hi - lo) / 2);
+
+        // segments without blocks do not take part in the search
+        m = mid;
+        while ((m <= hi) && (channel->segments[m].metadata_fps->metadata.time_series_section_2->number_of_blocks < 1))
+            m++;
+        if (m > hi) {
+            hi = mid - 1;
+            continue;
+        }
+
+        if (block_key_c(channel->segments + m, 0, by_sample, recording_time_offset) <= value) {
+            found = m;
+            lo = m + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    if (found == -1)
+        return MEF_FALSE;
+
+    *segment_idx = found;
+    *block_idx = find_block_c(channel->segments + found, value, by_sample, recording_time_offset);
+
+    return MEF_TRUE;
+}
+
+si8 sample_for_uutc_c(si8 uutc, CHANNEL *channel)
+{
+    ui8 sample;
+    sf8 native_samp_freq;
+    ui8 prev_sample_number;
+    si8 prev_time;
+    si8 next_sample_number;
+    si4 seg_idx, n_segments;
+    si8 block_idx;
+    SEGMENT *segment;
+    
+    native_samp_freq = channel->metadata.time_series_section_2->sampling_frequency;
+    n_segments = (si4) channel->number_of_segments;
+    prev_sample_number = channel->segments[0].metadata_fps->metadata.time_series_section_2->start_sample;
+    prev_time = channel->segments[0].time_series_indices_fps->time_series_indices[0].start_time;
+
+    // next_sample_number is the end of the last segment, unless a block starting after uutc exists
+    next_sample_number = channel->segments[n_segments - 1].metadata_fps->metadata.time_series_section_2->start_sample +
+                         channel->segments[n_segments - 1].metadata_fps->metadata.time_series_section_2->number_of_samples;
+
+    if (find_channel_block_c(channel, uutc, MEF_FALSE, 0, &seg_idx, &block_idx) == MEF_FALSE) {
+        seg_idx = -1;
+    } else {
+        segment = channel->segments + seg_idx;
+        prev_sample_number = block_key_c(segment, block_idx, MEF_TRUE, 0);
+        prev_time = segment->time_series_indices_fps->time_series_indices[block_idx].start_time;
+        if (block_idx + 1 < segment->metadata_fps->metadata.time_series_section_2->number_of_blocks) {
+            next_sample_number = block_key_c(segment, block_idx + 1, MEF_TRUE, 0);
+            goto done;
+        }
+    }
+
+    // the following block is the first block of the next segment with data
+    for (seg_idx++; seg_idx < n_segments; seg_idx++) {
+        segment = channel->segments + seg_idx;
+        if (segment->metadata_fps->metadata.time_series_section_2->number_of_blocks > 0) {
+            next_sample_number = block_key_c(segment, 0, MEF_TRUE, 0);
+            break;
+        }
+    }
+    
+done:
+    
+    sample = prev_sample_number + (ui8) (((((sf8) (uutc - prev_time)) / 1000000.0) * native_samp_freq) + 0.5);
+    if (sample > next_sample_number)
+        sample = next_sample_number;  // prevent it from going too far
+    
+    return(sample);
+}
+
+si8 uutc_for_sample_c(si8 sample, CHANNEL *channel)
+{
+    ui8 uutc;
+    sf8 native_samp_freq;
+    ui8 prev_sample_number; 
+    si8 prev_time;
+    si4 seg_idx;
+    si8 block_idx;
+
+
+    native_samp_freq = channel->metadata.time_series_section_2->sampling_frequency;
+    prev_sample_number = channel->segments[0].metadata_fps->metadata.time_series_section_2->start_sample;
+    prev_time = channel->segments[0].time_series_indices_fps->time_series_indices[0].start_time;
+
+    if (find_channel_block_c(channel, sample, MEF_TRUE, 0, &seg_idx, &block_idx) == MEF_TRUE) {
+        prev_sample_number = block_key_c(channel->segments + seg_idx, block_idx, MEF_TRUE, 0);
+        prev_time = channel->segments[seg_idx].time_series_indices_fps->time_series_indices[block_idx].start_time;
+    }
+
+    uutc = prev_time + (ui8) ((((sf8) (sample - prev_sample_number) / native_samp_freq) * 1000000.0) + 0.5);
+    
+    return(uutc);
+}
+
+void remove_recording_time_offset_c(si8 *time, si8 recording_time_offset)
+{
+    // same as meflib's remove_recording_time_offset() but without touching MEF_globals
+    if (*time != UUTC_NO_ENTRY)
+        *time = *time - recording_time_offset;
+}
+
+si4 read_ts_data_c(CHANNEL *channel, si8 start, si8 end, si4 times_specified, si4 keep_files_open, si4 use_mmap, si4 *decomp_data, ui4 num_samps, TS_READ_STATUS *status)
+{
+    // NOTE: this function runs without the GIL - no Python API calls allowed in here
+
+    ui4     i, j;
+    ui4 n_segments;
+    si4 start_segment, end_segment;
+    si8     start_time, end_time;
+    si8     start_samp, end_samp;
+    si8     recording_time_offset;
+    
+    ui8  total_data_bytes, bytes_to_read;
+    ui8 start_idx, end_idx, num_blocks, first_idx, n_blocks_in_segment;
+    ui1 *compressed_data_buffer, *cdp;
+    void *map_base;
+    ui8  map_bytes;
+    si8  segment_start_sample, segment_end_sample;
+    si8  segment_start_time, segment_end_time;
+    si8  file_offset, file_end;
+    si4  lo, hi, mid;
+    si8  samp, block_idx;
+    SEGMENT *segment;
+    ui8 n_read;
+    RED_PROCESSING_STRUCT   *rps;
+    si4 sample_counter;
+    ui4 max_samps;
+    si4 *temp_data_buf;
+    
+    si4 offset_into_output_buffer;
+    si8 block_start_time_offset;
+    
+    si4 crc_block_failure, blocks_decoded;
+    si1 last_block_decoded_flag;
+
+    memset(status, 0, sizeof(TS_READ_STATUS));
+    status->short_read_segment = -1;
+    status->start_segment = status->end_segment = -1;
 
-static PyObject *create_edfa_dtype(PyObject *self, PyObject *args) {
+    memset_int(decomp_data, RED_NAN, num_samps);
 
-    si8     text_len;
+    // recording time offset is taken from the channel, MEF_globals are shared between threads
+    recording_time_offset = channel->metadata.section_3->recording_time_offset;
 
-    if (!PyArg_ParseTuple(args,"i",
-                          &text_len)){
-        return NULL;
+    if (times_specified) {
+        start_time = start;
+        end_time = end;
+        start_samp = sample_for_uutc_c(start_time, channel);
+        end_samp = sample_for_uutc_c(end_time, channel);
+    } else {
+        start_samp = start;
+        end_samp = end;
+        start_time = uutc_for_sample_c(start_samp, channel);
+        end_time = uutc_for_sample_c(end_samp, channel);
     }
+ 
+    // Binary search for the start and stop segments
+    n_segments = (ui4) channel->number_of_segments;
+    start_segment = end_segment = -1;
 
-    import_array();
+    if (times_specified) {
+        // start segment is the first segment whose ending is past the start time,
+        // stop segment is the last segment starting before the end time
+        lo = 0;
+        hi = (si4) n_segments;
+        while (lo < hi) {
+            mid = lo + ((hi - lo) / 2);
+            segment_end_time = channel->segments[mid].time_series_data_fps->universal_header->end_time;
+            remove_recording_time_offset_c(&segment_end_time, recording_time_offset);
+            if (segment_end_time >= start_time)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        if (lo < (si4) n_segments) {
+            start_segment = end_segment = lo;
+
+            hi = (si4) n_segments;
+            while (lo < hi) {
+                mid = lo + ((hi - lo) / 2);
+                segment_start_time = channel->segments[mid].time_series_data_fps->universal_header->start_time;
+                remove_recording_time_offset_c(&segment_start_time, recording_time_offset);
+                if (segment_start_time <= end_time)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo - 1 > end_segment)
+                end_segment = lo - 1;
+        }
+    } else {
+        // last segment starting at or before the sample, if the sample is within the segment
+        for (j = 0; j < 2; j++) {
+            samp = (j == 0) ? start_samp : end_samp;
+            lo = 0;
+            hi = (si4) n_segments;
+            while (lo < hi) {
+                mid = lo + ((hi - lo) / 2);
+                if (channel->segments[mid].metadata_fps->metadata.time_series_section_2->start_sample <= samp)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo == 0)
+                continue;
+            segment_start_sample = channel->segments[lo - 1].metadata_fps->metadata.time_series_section_2->start_sample;
+            segment_end_sample   = segment_start_sample + channel->segments[lo - 1].metadata_fps->metadata.time_series_section_2->number_of_samples;
+            if (samp > segment_end_sample)
+                continue;
+            if (j == 0)
+                start_segment = lo - 1;
+            else
+                end_segment = lo - 1;
+        }
+    }
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    // nothing to decode - the output stays filled with NaNs
+    if ((start_segment == -1) || (end_segment == -1) || (end_segment < start_segment))
+        return status->error;
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s, i)]",
+    status->start_segment = start_segment;
+    status->end_segment = end_segment;
+    
+    // find start block in start segment and stop block in stop segment
+    start_idx = end_idx = 0;
+    block_idx = find_block_c(channel->segments + start_segment, start_time, MEF_FALSE, recording_time_offset);
+    if (block_idx > 0)
+        start_idx = (ui8) block_idx;
+    block_idx = find_block_c(channel->segments + end_segment, end_time, MEF_FALSE, recording_time_offset);
+    if (block_idx > 0)
+        end_idx = (ui8) block_idx;
+    
+    // find total_data_bytes and num_blocks, so we can allocate buffers
+    total_data_bytes = 0;
+    num_blocks = 0;
+    for (i = start_segment; i <= (ui4) end_segment; i++) {
+        segment = channel->segments + i;
+        n_blocks_in_segment = (ui8) segment->metadata_fps->metadata.time_series_section_2->number_of_blocks;
+        first_idx = (i == (ui4) start_segment) ? start_idx : 0;
+
+        file_offset = segment->time_series_indices_fps->time_series_indices[first_idx].file_offset;
+        if ((start_segment != end_segment) && (file_offset < UNIVERSAL_HEADER_BYTES)) {
+            status->error = TS_READ_INVALID_OFFSET;
+            return status->error;
+        }
 
-                       "duration", "i8",
-                       "text", "S", text_len);
+        if ((i == (ui4) end_segment) && (end_idx < n_blocks_in_segment - 1)) {
+            file_end = segment->time_series_indices_fps->time_series_indices[end_idx+1].file_offset;
+            num_blocks += end_idx - first_idx + 1;
+        } else {
+            // case where the block span goes to the end of the segment
+            file_end = segment->time_series_data_fps->file_length;
+            num_blocks += ((i == (ui4) end_segment) ? end_idx + 1 : n_blocks_in_segment) - first_idx;
+        }
+        total_data_bytes += file_end - file_offset;
+    }
+    
+    // a span within one segment can be decoded in place from a mapping of the data file
+    compressed_data_buffer = NULL;
+    map_base = NULL;
+    map_bytes = 0;
+    if (use_mmap && (start_segment == end_segment)) {
+        segment = channel->segments + start_segment;
+        bytes_to_read = total_data_bytes;
+        compressed_data_buffer = map_fps_bytes_c(segment->time_series_data_fps, segment->time_series_indices_fps->time_series_indices[start_idx].file_offset,
+                                                 &bytes_to_read, &map_base, &map_bytes);
+        // truncated file - blocks past the end fail the CRC check
+        if ((compressed_data_buffer != NULL) && (bytes_to_read != total_data_bytes)) {
+            status->short_read_segment = start_segment;
+            total_data_bytes = bytes_to_read;
+        }
+    }
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    // allocate buffers
+    if (compressed_data_buffer == NULL)
+        compressed_data_buffer = (ui1 *) malloc((size_t) total_data_bytes);
+    if (compressed_data_buffer == NULL) {
+        status->error = TS_READ_MEMORY_ERROR;
+        return status->error;
+    }
+    cdp = compressed_data_buffer;
+    
+    // read in RED data
+    for (i = start_segment; (map_base == NULL) && (i <= (ui4) end_segment); i++) {
+        segment = channel->segments + i;
+        n_blocks_in_segment = (ui8) segment->metadata_fps->metadata.time_series_section_2->number_of_blocks;
+        first_idx = (i == (ui4) start_segment) ? start_idx : 0;
+
+        file_offset = segment->time_series_indices_fps->time_series_indices[first_idx].file_offset;
+        if ((i == (ui4) end_segment) && (end_idx < n_blocks_in_segment - 1))
+            file_end = segment->time_series_indices_fps->time_series_indices[end_idx+1].file_offset;
+        else
+            file_end = segment->time_series_data_fps->file_length;
+        bytes_to_read = file_end - file_offset;
 
-    return (PyObject *) descr;
-}
+        n_read = read_fps_bytes_c(segment->time_series_data_fps, file_offset, bytes_to_read, cdp, keep_files_open);
+        if (n_read != bytes_to_read)
+            status->short_read_segment = i;
+        cdp += n_read;
+    }
+        
+    // set up RED processing struct
+    cdp = compressed_data_buffer;
+    max_samps = channel->metadata.time_series_section_2->maximum_block_samples;
+    
+    // create RED processing struct
+    rps = (RED_PROCESSING_STRUCT *) calloc((size_t) 1, sizeof(RED_PROCESSING_STRUCT));
+    temp_data_buf = (si4 *) malloc((max_samps * 1.1) * sizeof(si4));
+    if (rps != NULL)
+        rps->difference_buffer = (si1 *) calloc((size_t) RED_MAX_DIFFERENCE_BYTES(max_samps) + 1, sizeof(ui1));
+    if ((rps == NULL) || (rps->difference_buffer == NULL) || (temp_data_buf == NULL)) {
+        if (rps != NULL)
+            free (rps->difference_buffer);
+        free (rps);
+        free (temp_data_buf);
+        if (map_base != NULL)
+            unmap_fps_bytes_c(map_base, map_bytes);
+        else
+            free (compressed_data_buffer);
+        status->error = TS_READ_MEMORY_ERROR;
+        return status->error;
+    }
+    rps->compression.mode = RED_DECOMPRESSION;
+    //rps->directives.return_block_extrema = MEF_TRUE;
+    
+    sample_counter = 0;
+    
+    crc_block_failure = 0;
+    blocks_decoded = 0;
+    
+	// decode the first block
+    rps->decompressed_ptr = rps->decompressed_data = temp_data_buf;
+    rps->compressed_data = cdp;
+    rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
+    if (!check_block_crc((ui1*)(rps->block_header), max_samps, compressed_data_buffer, total_data_bytes)) {
+        crc_block_failure++;
+        last_block_decoded_flag = 0;
+        cdp += rps->block_header->block_bytes;
+    } else {
+        // RED_decode() offsets the header time using MEF_globals, so take it before decoding
+        block_start_time_offset = rps->block_header->start_time;
+        remove_recording_time_offset_c(&block_start_time_offset, recording_time_offset);
 
-static PyObject *create_edfa_dtype_c(ui4 text_len) {
-    import_array();
+        RED_decode(rps);
+        cdp += rps->block_header->block_bytes;
+        blocks_decoded++;
+        last_block_decoded_flag = 1;
+        
+        if (times_specified) {
+            if ((block_start_time_offset - start_time) >= 0)
+                offset_into_output_buffer = (si4) ((((block_start_time_offset - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) + 0.5);
+            else
+                offset_into_output_buffer = (si4) ((((block_start_time_offset - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) - 0.5);
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+        } else
+            offset_into_output_buffer = (si4) (channel->segments[start_segment].metadata_fps->metadata.time_series_section_2->start_sample +
+                                               channel->segments[start_segment].time_series_indices_fps->time_series_indices[start_idx].start_sample) - start_samp;
+        
+        // copy requested samples from first block to output buffer
+        offset_into_output_buffer = copy_block_samples_c(decomp_data, num_samps, offset_into_output_buffer, temp_data_buf, rps->block_header->number_of_samples);
+		sample_counter = offset_into_output_buffer;
+    }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s, i)]",
+    
+    // decode blocks in between the first and the last
+    for (i = 1; i < num_blocks - 1; i++) {
+        rps->compressed_data = cdp;
+        rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
+        // check that block fits fully within output array
+        // this should be true, but it's possible a stray block exists out-of-order, or with a bad timestamp
+        
+        // we need to manually remove offset, since we are using the time value of the block bevore decoding the block
+        // (normally the offset is removed during the decoding process)
 
-                       "duration", "i8",
-                       "text", "S", text_len);
+        if ((rps->block_header->block_bytes == 0) || !check_block_crc((ui1*)(rps->block_header), max_samps, compressed_data_buffer, total_data_bytes)) {
+            crc_block_failure++;
+            
+            // two-in-a-row bad block CRCs - this is probably an unrecoverable situation, so just stop decoding.
+            if (last_block_decoded_flag == 0)
+                goto done_decoding;
+            
+            // set a flag, and keep trying successive blocks.
+            last_block_decoded_flag = 0;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        } else {
 
-    return (PyObject *) descr;
-}
+            if (times_specified) {
+                block_start_time_offset = rps->block_header->start_time;
+                remove_recording_time_offset_c(&block_start_time_offset, recording_time_offset);
+                
+                // The next two checks see if the block contains out-of-bounds samples.
+                // In that case, skip the block and move on
+                if (block_start_time_offset < start_time) {
+                    cdp += rps->block_header->block_bytes;
+                    continue;
+                }
+                if (block_start_time_offset + ((rps->block_header->number_of_samples / channel->metadata.time_series_section_2->sampling_frequency) * 1e6) >= end_time) {
+                    // Comment this out for now, it creates a strange boundary condition
+                    // cdp += rps->block_header->block_bytes;
+                    continue;
+                }
+                
+                rps->decompressed_ptr = rps->decompressed_data = decomp_data + (int)((((block_start_time_offset - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) + 0.5);
 
-// // NOTE: not sure this is correct
-static PyObject *create_lntp_dtype(PyObject *self, PyObject *args) {
-    si8     template_len;
+            } else {
 
-    if (!PyArg_ParseTuple(args,"i",
-                          &template_len)){
-        return NULL;
+                // prevent buffer overflow
+                if ((sample_counter + rps->block_header->number_of_samples) > num_samps)
+                    goto done_decoding;
+                
+                rps->decompressed_ptr = rps->decompressed_data = decomp_data + sample_counter;
+            }
+            
+            RED_decode(rps);
+            sample_counter += rps->block_header->number_of_samples;
+            blocks_decoded++;
+            last_block_decoded_flag = 1;
+        }
+		
+        cdp += rps->block_header->block_bytes;
     }
+    
+	// decode last block to temp array
+    if (num_blocks > 1) {
+        rps->compressed_data = cdp;
+        rps->block_header = (RED_BLOCK_HEADER *) rps->compressed_data;
+        rps->decompressed_ptr = rps->decompressed_data = temp_data_buf;
+        if (!check_block_crc((ui1*)(rps->block_header), max_samps, compressed_data_buffer, total_data_bytes)) {
+			crc_block_failure++;
+            goto done_decoding;
+        }
 
-    import_array();
-
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
-
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s, i)]",
-
-                       "length", "i8",
-                       "template", "i8", template_len);
+        block_start_time_offset = rps->block_header->start_time;
+        remove_recording_time_offset_c(&block_start_time_offset, recording_time_offset);
+        
+        RED_decode(rps);
+        blocks_decoded++;
+        last_block_decoded_flag = 1;
+        
+        if (times_specified) {
+            if ((block_start_time_offset - start_time) >= 0)
+                offset_into_output_buffer = (si4) ((((block_start_time_offset - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) + 0.5);
+            else
+                offset_into_output_buffer = (si4) ((((block_start_time_offset - start_time) / 1000000.0) * channel->metadata.time_series_section_2->sampling_frequency) - 0.5);
+        } else
+            offset_into_output_buffer = sample_counter;
+        
+        // copy requested samples from last block to output buffer
+        offset_into_output_buffer = copy_block_samples_c(decomp_data, num_samps, offset_into_output_buffer, temp_data_buf, rps->block_header->number_of_samples);
+    }
+    
+done_decoding:
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    status->crc_block_failure = crc_block_failure;
+    status->blocks_skipped = num_blocks - blocks_decoded;
+    
+    // we're done with the compressed data, get rid of it
+    free (temp_data_buf);
+    if (map_base != NULL)
+        unmap_fps_bytes_c(map_base, map_bytes);
+    else
+        free (compressed_data_buffer);
+    free (rps->difference_buffer);
+    free (rps);
 
-    return (PyObject *) descr;
+    return status->error;
 }
 
-static PyObject *create_lntp_dtype_c(ui4 template_len) {
-
-    import_array();
-
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+si4 ts_iterator_load_block_c(TS_DATA_ITERATOR *it)
+{
+    // Decodes the next block of the channel into decomp_buffer, refilling the compressed buffer
+    // with as many consecutive blocks as fit when needed. Returns 0 at the end of the channel.
+    // No Python API calls - runs without the GIL.
+    SEGMENT *segment;
+    TIME_SERIES_INDEX *tsi;
+    si8     n_blocks, block_offset, block_end, fill_end, k;
+    ui1     *new_buffer;
+    ui8     n_read;
+
+    while (1) {
+        if (it->segment_idx >= it->channel->number_of_segments)
+            return 0;
+
+        segment = it->channel->segments + it->segment_idx;
+        n_blocks = segment->metadata_fps->metadata.time_series_section_2->number_of_blocks;
+        if (it->block_idx >= n_blocks) {
+            it->segment_idx++;
+            it->block_idx = 0;
+            continue;
+        }
+        break;
+    }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s, i)]",
+    tsi = segment->time_series_indices_fps->time_series_indices;
+    block_offset = tsi[it->block_idx].file_offset;
+    block_end = (it->block_idx + 1 < n_blocks) ? tsi[it->block_idx + 1].file_offset : segment->time_series_data_fps->file_length;
+
+    // refill the compressed buffer if the block is not in it
+    if ((it->buffer_segment != it->segment_idx) || (block_offset < it->buffer_file_offset) ||
+        (block_end > it->buffer_file_offset + it->buffer_data_bytes)) {
+
+        if (it->buffer_segment != it->segment_idx) {
+            if (it->fp != NULL)
+                fclose(it->fp);
+            it->fp = fopen(segment->time_series_data_fps->full_file_name, "rb");
+            it->buffer_segment = it->segment_idx;
+        }
 
-                       "length", "i8",
-                       "template", "i8", template_len);
+        // grow the buffer for an unexpectedly large block
+        if (block_end - block_offset > it->buffer_capacity) {
+            new_buffer = (ui1 *) realloc(it->compressed_buffer, (size_t) (block_end - block_offset));
+            if (new_buffer != NULL) {
+                it->compressed_buffer = new_buffer;
+                it->buffer_capacity = block_end - block_offset;
+            }
+        }
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        fill_end = block_end;
+        for (k = it->block_idx + 1; k < n_blocks; k++) {
+            block_end = (k + 1 < n_blocks) ? tsi[k + 1].file_offset : segment->time_series_data_fps->file_length;
+            if (block_end - block_offset > it->buffer_capacity)
+                break;
+            fill_end = block_end;
+        }
+        if (fill_end - block_offset > it->buffer_capacity)
+            fill_end = block_offset + it->buffer_capacity;
+
+        n_read = 0;
+        if (it->fp != NULL) {
+            #ifdef _WIN32
+                _fseeki64(it->fp, block_offset, SEEK_SET);
+            #else
+                fseek(it->fp, block_offset, SEEK_SET);
+            #endif
+            n_read = fread(it->compressed_buffer, sizeof(ui1), (size_t) (fill_end - block_offset), it->fp);
+        }
+        it->buffer_file_offset = block_offset;
+        it->buffer_data_bytes = (si8) n_read;
+    }
 
-    return (PyObject *) descr;
-}
+    it->rps->compressed_data = it->compressed_buffer + (block_offset - it->buffer_file_offset);
+    it->rps->block_header = (RED_BLOCK_HEADER *) it->rps->compressed_data;
+    it->rps->decompressed_ptr = it->rps->decompressed_data = it->decomp_buffer;
 
-static PyObject *create_note_dtype(PyObject *self, PyObject *args) {
-    si8     text_len;
+    it->decomp_len = tsi[it->block_idx].number_of_samples;
+    if (it->decomp_len > it->max_samps)
+        it->decomp_len = it->max_samps;
+    it->decomp_pos = 0;
 
-    if (!PyArg_ParseTuple(args,"i",
-                          &text_len)){
-        return NULL;
+    if (check_block_crc((ui1 *) it->rps->block_header, it->max_samps, it->compressed_buffer, (ui8) it->buffer_data_bytes)) {
+        RED_decode(it->rps);
+    } else {
+        it->crc_failures++;
+        memset_int(it->decomp_buffer, RED_NAN, it->decomp_len);
     }
 
-    import_array();
+    it->block_idx++;
+
+    return 1;
+}
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+si8 ts_iterator_fill_c(TS_DATA_ITERATOR *it, sf8 *out, si8 n_out)
+{
+    // Copies up to n_out decoded samples into out, decoding further blocks as needed
+    si8     n_filled, n;
+    si4     *src;
+
+    n_filled = 0;
+    while (n_filled < n_out) {
+        if (it->decomp_pos >= it->decomp_len)
+            if (!ts_iterator_load_block_c(it))
+                break;
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i)]",
+        n = it->decomp_len - it->decomp_pos;
+        if (n > n_out - n_filled)
+            n = n_out - n_filled;
 
-                       "text", "S", text_len);
+        src = it->decomp_buffer + it->decomp_pos;
+        convert_ts_data_c(src, (ui8) n, (ui1 *) (out + n_filled), sizeof(sf8), NPY_FLOAT64, 1.0);
+        n_filled += n;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        it->decomp_pos += (ui4) n;
+    }
 
-    return (PyObject *) descr;
+    return n_filled;
 }
 
-static PyObject *create_note_dtype_c(ui4 text_len) {
-    import_array();
+void ts_iterator_free_c(TS_DATA_ITERATOR *it)
+{
+    if (it->fp != NULL)
+        fclose(it->fp);
+    it->fp = NULL;
+    it->buffer_segment = -1;
+
+    if (it->rps != NULL)
+        free (it->rps->difference_buffer);
+    free (it->rps);
+    it->rps = NULL;
+    free (it->compressed_buffer);
+    it->compressed_buffer = NULL;
+    free (it->decomp_buffer);
+    it->decomp_buffer = NULL;
+    it->decomp_len = it->decomp_pos = 0;
+}
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+#ifndef _WIN32
+static pthread_mutex_t fps_open_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i)]",
+ui8 read_fps_bytes_c(FILE_PROCESSING_STRUCT *fps, si8 file_offset, ui8 n_bytes, ui1 *buffer, si4 keep_file_open)
+{
+    // Reads n_bytes from file_offset of the file without touching the shared file position.
+    // With keep_file_open the file is opened once, stored in the fps and read with pread() by all threads,
+    // it is closed when the metadata are freed. Otherwise (and always on Windows) a private handle is used.
+    FILE    *fp;
+    ui8     n_read;
+    #ifndef _WIN32
+        si4     fd;
+        ssize_t nb;
+    #endif
+
+    n_read = 0;
+
+    #ifndef _WIN32
+    if (keep_file_open) {
+        pthread_mutex_lock(&fps_open_mutex);
+        if (fps->fp == NULL) {
+            fps->fp = fopen(fps->full_file_name, "rb");
+            if (fps->fp != NULL)
+                fps->fd = fileno(fps->fp);
+        }
+        fd = (fps->fp != NULL) ? fps->fd : -1;
+        pthread_mutex_unlock(&fps_open_mutex);
+
+        if (fd >= 0) {
+            while (n_read < n_bytes) {
+                nb = pread(fd, buffer + n_read, (size_t) (n_bytes - n_read), (off_t) (file_offset + n_read));
+                if (nb <= 0)
+                    break;
+                n_read += (ui8) nb;
+            }
+            return n_read;
+        }
+    }
+    #endif
+
+    fp = fopen(fps->full_file_name, "rb");
+    if (fp == NULL)
+        return n_read;
+    #ifdef _WIN32
+        _fseeki64(fp, file_offset, SEEK_SET);
+    #else
+        fseek(fp, file_offset, SEEK_SET);
+    #endif
+    n_read = fread(buffer, sizeof(ui1), (size_t) n_bytes, fp);
+    fclose(fp);
 
-                       "text", "S", text_len);
+    return n_read;
+}
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+ui1 *map_fps_bytes_c(FILE_PROCESSING_STRUCT *fps, si8 file_offset, ui8 *n_bytes, void **map_base, ui8 *map_bytes)
+{
+    // Maps n_bytes from file_offset of the file and returns the pointer to file_offset, NULL if the file
+    // can not be mapped (the caller then reads it). n_bytes is clipped to the end of the file.
+    // The mapping is private and writable - RED_decode() modifies block headers in place, the touched
+    // pages are copied, the rest is shared through the page cache. Not available on Windows.
+    #ifdef _WIN32
+        return NULL;
+    #else
+        si4     fd;
+        struct stat st;
+        si8     page_size, map_offset;
+        void    *base;
 
-    return (PyObject *) descr;
-}
+        *map_base = NULL;
+        *map_bytes = 0;
 
-static PyObject *create_seiz_dtype() {
-    import_array();
+        fd = open(fps->full_file_name, O_RDONLY);
+        if (fd < 0)
+            return NULL;
+        if (fstat(fd, &st) != 0 || (si8) st.st_size <= file_offset) {
+            close(fd);
+            return NULL;
+        }
+        if ((si8) *n_bytes > (si8) st.st_size - file_offset)
+            *n_bytes = (ui8) ((si8) st.st_size - file_offset);
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+        // the mapping has to start on a page boundary
+        page_size = (si8) sysconf(_SC_PAGESIZE);
+        map_offset = file_offset - (file_offset % page_size);
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i)]",
+        base = mmap(NULL, (size_t) (*n_bytes + (file_offset - map_offset)), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t) map_offset);
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+        if (base == MAP_FAILED)
+            return NULL;
 
-                       "earliest_onset", "i8",
-                       "latest_offset", "i8",
-                       "duration", "i8",
-                       "number_of_channels", "i4",
-                       "onset_code", "i4",
-                       "marker_name_1", "S", MEFREC_Seiz_1_0_MARKER_NAME_BYTES,
-                       "marker_name_2", "S", MEFREC_Seiz_1_0_MARKER_NAME_BYTES,
-                       "annotation", "S", MEFREC_Seiz_1_0_ANNOTATION_BYTES);
+        *map_base = base;
+        *map_bytes = *n_bytes + (ui8) (file_offset - map_offset);
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        return (ui1 *) base + (file_offset - map_offset);
+    #endif
+}
 
-    return (PyObject *) descr;
+void unmap_fps_bytes_c(void *map_base, ui8 map_bytes)
+{
+    #ifndef _WIN32
+        munmap(map_base, (size_t) map_bytes);
+    #endif
 }
 
-static PyObject *create_seiz_ch_dtype() {
+si4 parse_lossy_params_c(PyObject *py_params, RED_LOSSY_PARAMS *params)
+{
+    // Fills the lossy compression settings from a python dictionary (None - defaults), returns -1 and sets the error if invalid
+    PyObject    *temp_o, *temp_UTF_str;
+    si1         *mode;
 
-    import_array();
+    params->mode = RED_MEAN_RESIDUAL_RATIO;
+    params->goal_mean_residual_ratio = RED_LOSSY_DEFAULT_MEAN_RESIDUAL_RATIO;
+    params->goal_compression_ratio = RED_LOSSY_DEFAULT_COMPRESSION_RATIO;
+    params->goal_tolerance = RED_LOSSY_DEFAULT_TOLERANCE;
+    params->detrend_data = MEF_TRUE;
+    params->require_normality = MEF_TRUE;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    if (py_params == NULL || py_params == Py_None)
+        return 0;
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i),\
-                         (s, s),\
-                         (s, s)]",
+    if (!PyDict_Check(py_params)) {
+        PyErr_SetString(PyExc_RuntimeError, "Lossy parameters have to be a dictionary, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-                       "name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "onset", "i8",
-                       "offset", "i8");
+    temp_o = PyDict_GetItemString(py_params, "mode");
+    if (temp_o != NULL) {
+        if (!PyUnicode_Check(temp_o)) {
+            PyErr_SetString(PyExc_RuntimeError, "Lossy compression mode has to be 'mean_residual_ratio' or 'compression_ratio', exiting...");
+            PyErr_Occurred();
+            return -1;
+        }
+        temp_UTF_str = PyUnicode_AsEncodedString(temp_o, "utf-8", "strict");
+        mode = PyBytes_AS_STRING(temp_UTF_str);
+        if (!strcmp(mode, "mean_residual_ratio"))
+            params->mode = RED_MEAN_RESIDUAL_RATIO;
+        else if (!strcmp(mode, "compression_ratio"))
+            params->mode = RED_COMPRESSION_RATIO;
+        else
+            params->mode = -1;
+        Py_DECREF(temp_UTF_str);    temp_UTF_str = NULL;
+        if (params->mode < 0) {
+            PyErr_SetString(PyExc_RuntimeError, "Lossy compression mode has to be 'mean_residual_ratio' or 'compression_ratio', exiting...");
+            PyErr_Occurred();
+            return -1;
+        }
+    }
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    temp_o = PyDict_GetItemString(py_params, "goal_mean_residual_ratio");
+    if (temp_o != NULL)
+        params->goal_mean_residual_ratio = PyFloat_AsDouble(temp_o);
+    temp_o = PyDict_GetItemString(py_params, "goal_compression_ratio");
+    if (temp_o != NULL)
+        params->goal_compression_ratio = PyFloat_AsDouble(temp_o);
+    temp_o = PyDict_GetItemString(py_params, "goal_tolerance");
+    if (temp_o != NULL)
+        params->goal_tolerance = PyFloat_AsDouble(temp_o);
+    temp_o = PyDict_GetItemString(py_params, "detrend_data");
+    if (temp_o != NULL)
+        params->detrend_data = PyObject_IsTrue(temp_o) ? MEF_TRUE : MEF_FALSE;
+    temp_o = PyDict_GetItemString(py_params, "require_normality");
+    if (temp_o != NULL)
+        params->require_normality = PyObject_IsTrue(temp_o) ? MEF_TRUE : MEF_FALSE;
+    if (PyErr_Occurred())
+        return -1;
+
+    if (params->goal_mean_residual_ratio <= 0.0 || params->goal_compression_ratio <= 0.0 || params->goal_tolerance <= 0.0) {
+        PyErr_SetString(PyExc_RuntimeError, "Lossy compression goals and tolerance have to be positive, exiting...");
+        PyErr_Occurred();
+        return -1;
+    }
 
-    return (PyObject *) descr;
+    return 0;
 }
 
-static PyObject *create_sylg_dtype(PyObject *self, PyObject *args) {
-    si8     text_len;
+RED_PROCESSING_STRUCT *allocate_encoder_rps_c(si8 samps_per_mef_block, RED_LOSSY_PARAMS *lossy, PASSWORD_DATA *pwd)
+{
+    // lossy == NULL - lossless compression
+    RED_PROCESSING_STRUCT   *rps;
 
-    if (!PyArg_ParseTuple(args,"i",
-                          &text_len)){
-        return NULL;
+    if (lossy != NULL) {
+        rps = RED_allocate_processing_struct(samps_per_mef_block, 0, samps_per_mef_block, RED_MAX_DIFFERENCE_BYTES(samps_per_mef_block), samps_per_mef_block, samps_per_mef_block, pwd);
+        rps->compression.mode = lossy->mode;
+        rps->directives.detrend_data = lossy->detrend_data;
+        rps->directives.require_normality = lossy->require_normality;
+        rps->compression.goal_mean_residual_ratio = lossy->goal_mean_residual_ratio;
+        rps->compression.goal_compression_ratio = lossy->goal_compression_ratio;
+        rps->compression.goal_tolerance = lossy->goal_tolerance;
+    } else {
+        rps = RED_allocate_processing_struct(samps_per_mef_block, 0, 0, RED_MAX_DIFFERENCE_BYTES(samps_per_mef_block), 0, 0, pwd);
     }
 
-    import_array();
+    return rps;
+}
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+void free_encoder_rps_c(RED_PROCESSING_STRUCT *rps)
+{
+    // compressed and original data belong to the caller
+    rps->block_header = NULL;
+    rps->compressed_data = NULL;
+    rps->original_data = NULL;
+    rps->original_ptr = NULL;
+    RED_free_processing_struct(rps);
+}
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i)]",
+void encode_blocks_worker_c(void *arg)
+{
+    // NOTE: runs without the GIL - encodes blocks first_block, first_block + block_step, ... of the batch
+    RED_ENCODE_WORKER   *worker;
+    RED_PROCESSING_STRUCT   *rps;
+    RED_BLOCK_HEADER    *block_header;
+    TIME_SERIES_INDEX   *tsi;
+    si8     i, first, block_samps, block_start_time;
 
-                       "text", "S", text_len);
+    worker = (RED_ENCODE_WORKER *) arg;
+    rps = worker->rps;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    for (i = worker->first_block; i < worker->n_blocks; i += worker->block_step) {
+        if (worker->block_starts != NULL) {
+            first = worker->block_starts[i] - worker->block_starts[0];
+            block_samps = worker->block_starts[i + 1] - worker->block_starts[i];
+            block_start_time = worker->start_time + (si8) (((sf8) worker->block_starts[i] / worker->sampling_frequency) * 1e6);
+        } else {
+            first = i * (si8) worker->block_samps;
+            block_samps = worker->n_samples - first;
+            if (block_samps > (si8) worker->block_samps)
+                block_samps = (si8) worker->block_samps;
+            block_start_time = worker->start_time + (i * worker->time_inc);
+        }
 
-    return (PyObject *) descr;
-}
+        block_header = (RED_BLOCK_HEADER *) (worker->blocks + (i * worker->slot_bytes));
+        rps->block_header = block_header;
+        rps->compressed_data = (ui1 *) block_header;
+        if (worker->src != NULL) {
+            worker->n_clipped += convert_to_si4_c(worker->src + (first * worker->src_stride), worker->src_stride, worker->src_type, worker->scale, worker->conv_buffer, block_samps);
+            rps->original_data = rps->original_ptr = worker->conv_buffer;
+        } else {
+            rps->original_data = rps->original_ptr = worker->data + first;
+        }
+        rps->directives.discontinuity = (worker->discontinuity && (i == 0)) ? MEF_TRUE : MEF_FALSE;
 
-static PyObject *create_sylg_dtype_c(ui4 text_len) {
-    import_array();
+        block_header->flags = 0;
+        block_header->number_of_samples = (ui4) block_samps;
+        block_header->start_time = block_start_time;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+        (void) RED_encode(rps);
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i)]",
+        tsi = worker->tsi + i;
+        tsi->block_bytes = block_header->block_bytes;
+        tsi->start_time = block_header->start_time;
+        tsi->number_of_samples = block_samps;
+        RED_find_extrema(rps->original_ptr, (si8) block_samps, tsi);
+        tsi->RED_block_flags = block_header->flags;
+        if (worker->residual_ratios != NULL)
+            worker->residual_ratios[i] = rps->compression.actual_mean_residual_ratio;
+    }
+}
 
-                       "text", "S", text_len);
+si8 ts_writer_encode_c(TS_SEGMENT_WRITER *w, si4 encode_partial)
+{
+    // NOTE: runs without the GIL - encodes the buffered full blocks (and the remainder if encode_partial)
+    // and appends them and their indices to the files, returns the number of blocks written
+    RED_BLOCK_HEADER    *block_header;
+    TIME_SERIES_INDEX   *tsi;
+    si8     n_full_blocks, n_encode, consumed, batch_n_blocks, n_written, i;
+    si4     n_threads;
+
+    // RED_encode() applies the writer's recording time offset from MEF_globals
+    lock_mef_globals_c(w->recording_time_offset, MEF_FALSE);
+
+    n_full_blocks = w->n_samples / (si8) w->block_samps;
+    n_encode = n_full_blocks;
+    if (encode_partial && (w->n_samples % (si8) w->block_samps))
+        n_encode++;
+
+    consumed = 0;
+    for (n_written = 0; n_written < n_encode; n_written += batch_n_blocks) {
+
+        batch_n_blocks = n_encode - n_written;
+        if (batch_n_blocks > w->max_batch_blocks)
+            batch_n_blocks = w->max_batch_blocks;
+        n_threads = w->n_threads;
+        if ((si8) n_threads > batch_n_blocks)
+            n_threads = (si4) batch_n_blocks;
+
+        for (i = 0; i < n_threads; i++) {
+            w->workers[i].data = w->samples + consumed;
+            w->workers[i].n_blocks = batch_n_blocks;
+            w->workers[i].n_samples = w->n_samples - consumed;
+            w->workers[i].start_time = w->next_block_time;
+            // only the first block of a contiguous range is a discontinuity
+            w->workers[i].discontinuity = w->discontinuity;
+            w->workers[i].block_step = n_threads;
+        }
+        w->discontinuity = MEF_FALSE;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        run_parallel_c(encode_blocks_worker_c, (void *) w->workers, sizeof(RED_ENCODE_WORKER), n_threads);
 
-    return (PyObject *) descr;
-}
+        for (i = 0, tsi = w->batch_tsi; i < batch_n_blocks; i++, tsi++) {
+            block_header = (RED_BLOCK_HEADER *) (w->batch_blocks + (i * w->workers[0].slot_bytes));
+            // the rest of the index was filled in by the workers
+            ts_writer_append_block_c(w, block_header, tsi);
+            w->next_block_time += w->time_inc;
+        }
 
-static PyObject *create_csti_dtype() {
-    import_array();
+        consumed += batch_n_blocks * (si8) w->block_samps;
+    }
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    // keep the remainder for the next write
+    if (consumed > w->n_samples)
+        consumed = w->n_samples;
+    if (consumed > 0) {
+        memmove(w->samples, w->samples + consumed, (size_t) ((w->n_samples - consumed) * sizeof(si4)));
+        w->n_samples -= consumed;
+    }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
+    unlock_mef_globals_c();
 
-                        "task_type", "S", MEFREC_CSti_1_0_TASK_TYPE_BYTES,
-                        "stimulus_duration", "i8",
-                        "stimulus_type", "S", MEFREC_CSti_1_0_STIMULUS_TYPE_BYTES,
-                        "patient_response", "S", MEFREC_CSti_1_0_PATIENT_RESPONSE_BYTES);
+    return n_written;
+}
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+void ts_writer_append_block_c(TS_SEGMENT_WRITER *w, RED_BLOCK_HEADER *block_header, TIME_SERIES_INDEX *tsi)
+{
+    // NOTE: runs without the GIL - appends an encoded block and its index entry (file offset and start sample
+    // are filled in here) and updates the CRCs and the metadata
+    TIME_SERIES_METADATA_SECTION_2  *tmd2;
+    si8     block_start_time;
+
+    tmd2 = w->metadata_fps->metadata.time_series_section_2;
+
+    w->ts_data_fps->universal_header->body_CRC = CRC_update((ui1 *) block_header, block_header->block_bytes, w->ts_data_fps->universal_header->body_CRC);
+    e_fwrite((void *) block_header, sizeof(ui1), block_header->block_bytes, w->ts_data_fps->fp, w->ts_data_fps->full_file_name, __FUNCTION__, __LINE__, EXIT_ON_FAIL);
+
+    // time series indices
+    tsi->file_offset = w->file_offset;
+    w->file_offset += tsi->block_bytes;
+    tsi->start_sample = w->n_written_samples;
+    w->n_written_samples += tsi->number_of_samples;
+    if (w->max_samp < tsi->maximum_sample_value)
+        w->max_samp = tsi->maximum_sample_value;
+    if (w->min_samp > tsi->minimum_sample_value)
+        w->min_samp = tsi->minimum_sample_value;
+
+    w->ts_idx_fps->universal_header->body_CRC = CRC_update((ui1 *) tsi, TIME_SERIES_INDEX_BYTES, w->ts_idx_fps->universal_header->body_CRC);
+    e_fwrite((void *) tsi, sizeof(ui1), TIME_SERIES_INDEX_BYTES, w->ts_idx_fps->fp, w->ts_idx_fps->full_file_name, __FUNCTION__, __LINE__, EXIT_ON_FAIL);
+
+    // contiguous ranges
+    if (tsi->RED_block_flags & RED_DISCONTINUITY_MASK) {
+        w->n_discontinuities++;
+        w->contiguous_blocks = 0;
+        w->contiguous_block_bytes = 0;
+        w->contiguous_samples = 0;
+    }
+    w->contiguous_blocks++;
+    w->contiguous_block_bytes += tsi->block_bytes;
+    w->contiguous_samples += tsi->number_of_samples;
+    if (tmd2->maximum_contiguous_blocks < w->contiguous_blocks)
+        tmd2->maximum_contiguous_blocks = w->contiguous_blocks;
+    if (tmd2->maximum_contiguous_block_bytes < w->contiguous_block_bytes)
+        tmd2->maximum_contiguous_block_bytes = w->contiguous_block_bytes;
+    if (tmd2->maximum_contiguous_samples < w->contiguous_samples)
+        tmd2->maximum_contiguous_samples = w->contiguous_samples;
 
-    return (PyObject *) descr;
+    // update metadata
+    if (tmd2->maximum_block_bytes < block_header->block_bytes)
+        tmd2->maximum_block_bytes = block_header->block_bytes;
+    if (tmd2->maximum_difference_bytes < block_header->difference_bytes)
+        tmd2->maximum_difference_bytes = block_header->difference_bytes;
+
+    if (w->max_block_samps < tsi->number_of_samples)
+        w->max_block_samps = tsi->number_of_samples;
+    // the writer keeps its times without the recording time offset that RED_encode applied to the block
+    block_start_time = tsi->start_time;
+    remove_recording_time_offset_c(&block_start_time, w->recording_time_offset);
+    w->end_time = block_start_time + (si8) (((sf8) tsi->number_of_samples / tmd2->sampling_frequency) * (sf8) 1e6);
+    w->n_blocks++;
+    w->blocks_since_flush++;
 }
 
-static PyObject *create_esti_dtype() {
-    import_array();
+si4 ts_writer_copy_blocks_c(TS_SEGMENT_WRITER *w, CHANNEL *channel, si8 first_block, si8 n_blocks)
+{
+    // NOTE: runs without the GIL - appends encoded blocks of a read channel byte for byte, only the index entries
+    // and the discontinuity flags (with the CRC of a block whose flag changes) are rewritten
+    SEGMENT     *segment;
+    PASSWORD_DATA   *src_pwd;
+    TIME_SERIES_INDEX   *src_tsi, tsi;
+    RED_BLOCK_HEADER    *block_header;
+    ui1     *buffer, *bp, flags;
+    si8     seg_n_blocks, seg_first, n_copy, remaining, chunk_n_blocks, file_offset, file_end, period, block_start_time, i, j;
+    si4     seg_idx, discontinuity;
+
+    if (first_block < 0 || n_blocks < 0)
+        return TS_COPY_INVALID_RANGE;
+
+    // the block times are copied with the recording time offset applied, it has to be the writer's
+    if (n_blocks > 0 && channel->metadata.section_3->recording_time_offset != w->recording_time_offset)
+        return TS_COPY_OFFSET_MISMATCH;
+
+    // check the range and that the encrypted blocks decrypt with the writer's keys before anything is written
+    seg_first = first_block;
+    remaining = n_blocks;
+    for (seg_idx = 0; (seg_idx < channel->number_of_segments) && (remaining > 0); seg_idx++) {
+        segment = channel->segments + seg_idx;
+        seg_n_blocks = segment->metadata_fps->metadata.time_series_section_2->number_of_blocks;
+        if (seg_first >= seg_n_blocks) {
+            seg_first -= seg_n_blocks;
+            continue;
+        }
+        n_copy = (remaining < seg_n_blocks - seg_first) ? remaining : seg_n_blocks - seg_first;
+        src_pwd = segment->metadata_fps->password_data;
+        src_tsi = segment->time_series_indices_fps->time_series_indices + seg_first;
+        for (i = 0; i < n_copy; i++) {
+            flags = src_tsi[i].RED_block_flags;
+            if ((flags & RED_LEVEL_1_ENCRYPTION_MASK) && ((src_pwd == NULL) || memcmp(src_pwd->level_1_encryption_key, w->password_data.level_1_encryption_key, ENCRYPTION_KEY_BYTES)))
+                return TS_COPY_KEY_MISMATCH;
+            if ((flags & RED_LEVEL_2_ENCRYPTION_MASK) && ((src_pwd == NULL) || memcmp(src_pwd->level_2_encryption_key, w->password_data.level_2_encryption_key, ENCRYPTION_KEY_BYTES)))
+                return TS_COPY_KEY_MISMATCH;
+        }
+        remaining -= n_copy;
+        seg_first = 0;
+    }
+    if (remaining > 0)
+        return TS_COPY_INVALID_RANGE;
+    if (n_blocks == 0)
+        return TS_COPY_OK;
+
+    // the buffered samples become the last (shorter) block before the copied ones
+    (void) ts_writer_encode_c(w, MEF_TRUE);
+
+    buffer = NULL;
+    period = (si8) (1e6 / w->metadata_fps->metadata.time_series_section_2->sampling_frequency);
+    seg_first = first_block;
+    remaining = n_blocks;
+    for (seg_idx = 0; (seg_idx < channel->number_of_segments) && (remaining > 0); seg_idx++) {
+        segment = channel->segments + seg_idx;
+        seg_n_blocks = segment->metadata_fps->metadata.time_series_section_2->number_of_blocks;
+        if (seg_first >= seg_n_blocks) {
+            seg_first -= seg_n_blocks;
+            continue;
+        }
+        n_copy = (remaining < seg_n_blocks - seg_first) ? remaining : seg_n_blocks - seg_first;
+        src_tsi = segment->time_series_indices_fps->time_series_indices;
+
+        for (i = seg_first; i < seg_first + n_copy; i += chunk_n_blocks) {
+            chunk_n_blocks = seg_first + n_copy - i;
+            if (chunk_n_blocks > TS_WRITER_COPY_BLOCKS)
+                chunk_n_blocks = TS_WRITER_COPY_BLOCKS;
+
+            // blocks follow each other in the data file
+            file_offset = src_tsi[i].file_offset;
+            file_end = src_tsi[i + chunk_n_blocks - 1].file_offset + src_tsi[i + chunk_n_blocks - 1].block_bytes;
+            free(buffer);
+            buffer = (ui1 *) malloc((size_t) (file_end - file_offset));
+            if (buffer == NULL)
+                return TS_COPY_MEMORY_ERROR;
+            if (read_fps_bytes_c(segment->time_series_data_fps, file_offset, (ui8) (file_end - file_offset), buffer, MEF_FALSE) != (ui8) (file_end - file_offset)) {
+                free(buffer);
+                return TS_COPY_READ_ERROR;
+            }
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+            for (j = i; j < i + chunk_n_blocks; j++) {
+                bp = buffer + (src_tsi[j].file_offset - file_offset);
+                block_header = (RED_BLOCK_HEADER *) bp;
+                if ((src_tsi[j].file_offset < file_offset) || (block_header->block_bytes != src_tsi[j].block_bytes) || (src_tsi[j].file_offset + block_header->block_bytes > file_end)) {
+                    free(buffer);
+                    return TS_COPY_READ_ERROR;
+                }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i)]",
+                // the first block and blocks after a gap start a contiguous range
+                block_start_time = block_header->start_time;
+                remove_recording_time_offset_c(&block_start_time, w->recording_time_offset);
+                if ((w->n_blocks > 0) && (block_start_time - w->end_time <= -period)) {
+                    free(buffer);
+                    return TS_COPY_OVERLAP;
+                }
+                discontinuity = (w->discontinuity || (w->n_blocks == 0) || (block_start_time - w->end_time >= period)) ? MEF_TRUE : MEF_FALSE;
+                w->discontinuity = MEF_FALSE;
+                flags = discontinuity ? (block_header->flags | RED_DISCONTINUITY_MASK) : (block_header->flags & ~RED_DISCONTINUITY_MASK);
+                if (flags != block_header->flags) {
+                    block_header->flags = flags;
+                    block_header->block_CRC = CRC_calculate(bp + CRC_BYTES, block_header->block_bytes - CRC_BYTES);
+                }
 
-                        "amplitude", "f8",
-                        "frequency", "f8",
-                        "pulse_width", "i8",
-                        "ampunit_code", "i4",
-                        "mode_code", "i4",
-                        "waveform", "S", MEFREC_ESti_1_0_WAVEFORM_BYTES,
-                        "anode", "S", MEFREC_ESti_1_0_ANODE_BYTES,
-                        "catode", "S", MEFREC_ESti_1_0_CATODE_BYTES);
+                tsi = src_tsi[j];
+                tsi.start_time = block_header->start_time;
+                tsi.number_of_samples = block_header->number_of_samples;
+                tsi.RED_block_flags = block_header->flags;
+                ts_writer_append_block_c(w, block_header, &tsi);
+            }
+        }
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        remaining -= n_copy;
+        seg_first = 0;
+    }
+    free(buffer);
 
-    return (PyObject *) descr;
+    // samples written next continue the copied blocks
+    w->next_block_time = w->end_time;
+
+    return TS_COPY_OK;
 }
 
-static PyObject *create_curs_dtype() {
-    import_array();
+void ts_writer_flush_c(TS_SEGMENT_WRITER *w)
+{
+    // NOTE: runs without the GIL - rewrites the universal headers of the data and indices files and the metadata file
+    // to reflect the blocks written so far
+    TIME_SERIES_METADATA_SECTION_2  *tmd2;
+    FILE_PROCESSING_STRUCT  *fps;
+    si4     i;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    tmd2 = w->metadata_fps->metadata.time_series_section_2;
+    lock_mef_globals_c(w->recording_time_offset, MEF_FALSE);
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i)]",
+    // update metadata
+    tmd2->number_of_samples = w->n_written_samples;
+    tmd2->recording_duration = (si8) (((sf8) tmd2->number_of_samples / (sf8) tmd2->sampling_frequency) * 1e6);
+    tmd2->number_of_blocks = w->n_blocks;
+    tmd2->maximum_block_samples = w->max_block_samps;
+    tmd2->number_of_discontinuities = w->n_discontinuities;
+    if (w->n_blocks > 0) {
+        if (tmd2->units_conversion_factor >= 0.0) {
+            tmd2->maximum_native_sample_value = (sf8) w->max_samp * tmd2->units_conversion_factor;
+            tmd2->minimum_native_sample_value = (sf8) w->min_samp * tmd2->units_conversion_factor;
+        } else {
+            tmd2->maximum_native_sample_value = (sf8) w->min_samp * tmd2->units_conversion_factor;
+            tmd2->minimum_native_sample_value = (sf8) w->max_samp * tmd2->units_conversion_factor;
+        }
+    }
+    w->metadata_fps->universal_header->end_time = w->end_time;
+
+    // re-write the universal headers of the ts-data and ts-indices files
+    w->ts_data_fps->universal_header->number_of_entries = w->n_blocks;
+    w->ts_data_fps->universal_header->maximum_entry_size = w->max_block_samps;
+    w->ts_idx_fps->universal_header->number_of_entries = w->n_blocks;
+    for (i = 0; i < 2; i++) {
+        fps = (i == 0) ? w->ts_data_fps : w->ts_idx_fps;
+        fps->universal_header->start_time = w->metadata_fps->universal_header->start_time;
+        fps->universal_header->end_time = w->end_time;
+        fps->universal_header->header_CRC = CRC_calculate(fps->raw_data + CRC_BYTES, UNIVERSAL_HEADER_BYTES - CRC_BYTES);
+        e_fseek(fps->fp, 0, SEEK_SET, fps->full_file_name, __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
+        e_fwrite(fps->universal_header, sizeof(ui1), UNIVERSAL_HEADER_BYTES, fps->fp, fps->full_file_name, __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
+        e_fseek(fps->fp, 0, SEEK_END, fps->full_file_name, __FUNCTION__, __LINE__, MEF_globals->behavior_on_fail);
+        fflush(fps->fp);
+    }
 
-                        "id_number", "i8",
-                        "trace_timestamp", "i8",
-                        "latency", "i8",
-                        "value", "f8",
-                        "name", "S", MEFREC_Curs_1_0_NAME_BYTES);
+    // write/update the time-series metadata file - write_MEF_file() encrypts the raw data in place
+    memcpy(w->metadata_snapshot, w->metadata_fps->raw_data, (size_t) w->metadata_fps->raw_data_bytes);
+    write_MEF_file(w->metadata_fps);
+    memcpy(w->metadata_fps->raw_data, w->metadata_snapshot, (size_t) w->metadata_fps->raw_data_bytes);
+    unlock_mef_globals_c();
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    w->blocks_since_flush = 0;
+}
 
-    return (PyObject *) descr;
+void ts_writer_free_c(TS_SEGMENT_WRITER *w)
+{
+    si4     i;
+
+    if (w->ts_data_fps != NULL) {
+        if (w->ts_data_fps->fp != NULL)
+            fclose(w->ts_data_fps->fp);
+        w->ts_data_fps->fp = NULL;
+        w->ts_data_fps->password_data = NULL;
+        free_file_processing_struct(w->ts_data_fps);
+        w->ts_data_fps = NULL;
+    }
+    if (w->ts_idx_fps != NULL) {
+        if (w->ts_idx_fps->fp != NULL)
+            fclose(w->ts_idx_fps->fp);
+        w->ts_idx_fps->fp = NULL;
+        w->ts_idx_fps->password_data = NULL;
+        free_file_processing_struct(w->ts_idx_fps);
+        w->ts_idx_fps = NULL;
+    }
+    if (w->metadata_fps != NULL) {
+        w->metadata_fps->password_data = NULL;
+        free_file_processing_struct(w->metadata_fps);
+        w->metadata_fps = NULL;
+    }
+    if (w->gen_fps != NULL) {
+        free_file_processing_struct(w->gen_fps);
+        w->gen_fps = NULL;
+    }
+    if (w->workers != NULL) {
+        for (i = 0; i < w->n_threads; i++)
+            if (w->workers[i].rps != NULL)
+                free_encoder_rps_c(w->workers[i].rps);
+        free (w->workers);
+        w->workers = NULL;
+    }
+    free (w->batch_blocks);
+    w->batch_blocks = NULL;
+    free (w->batch_tsi);
+    w->batch_tsi = NULL;
+    free (w->samples);
+    w->samples = NULL;
+    free (w->metadata_snapshot);
+    w->metadata_snapshot = NULL;
+    w->n_samples = 0;
 }
 
-static PyObject *create_epoc_dtype() {
-    import_array();
+void read_ts_worker_c(void *arg)
+{
+    TS_READ_WORKER  *worker;
+    TS_READ_JOB     *job;
+    si4     i;
+    si8     j, n_copy;
+    ui4     max_samps;
+    si4     *decomp_data;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    worker = (TS_READ_WORKER *) arg;
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
+    // one decoding buffer for all jobs of this worker
+    max_samps = 0;
+    for (i = worker->first_job; i < worker->n_jobs; i += worker->job_step)
+        if (worker->jobs[i].num_samps > max_samps)
+            max_samps = worker->jobs[i].num_samps;
+    decomp_data = (si4 *) malloc((size_t) ((max_samps + 1) * sizeof(si4)));
 
-                        "id_number", "i8",
-                        "timestamp", "i8",
-                        "end_timestamp", "i8",
-                        "duration", "i8",
-                        "epoch_type", "S", MEFREC_Epoc_1_0_EPOCH_TYPE_BYTES,
-                        "text", "S", MEFREC_Epoc_1_0_TEXT_BYTES);
+    for (i = worker->first_job; i < worker->n_jobs; i += worker->job_step) {
+        job = worker->jobs + i;
+        job->status.short_read_segment = -1;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+        for (j = 0; j < job->row_len; j++)
+            job->row[j] = NPY_NAN;
 
-    return (PyObject *) descr;
-}
+        if (job->num_samps == 0)
+            continue;
 
-// Library
-static PyObject *create_uh_dtype() {
-    import_array();
+        if (decomp_data == NULL) {
+            job->status.error = TS_READ_MEMORY_ERROR;
+            continue;
+        }
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+        (void) read_ts_data_c(job->channel, job->start, job->end, worker->times_specified, worker->keep_files_open, worker->use_mmap, decomp_data, job->num_samps, &job->status);
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i)]",
+        // RED NaNs become NaNs, scaled in the same pass
+        n_copy = (si8) job->num_samps;
+        if (job->row_offset + n_copy > job->row_len)
+            n_copy = job->row_len - job->row_offset;
+        if (n_copy > 0)
+            convert_ts_data_c(decomp_data, (ui8) n_copy, (ui1 *) (job->row + job->row_offset), sizeof(sf8), NPY_FLOAT64, job->scale);
+    }
 
-                       "header_CRC", "u4",
-                       "body_CRC", "u4",
-                       "file_type_string", "S", TYPE_BYTES,
-                       "mef_version_major", "u1",
-                       "mef_version_minor", "u1",
-                       "byte_order_code", "u1",
+    free (decomp_data);
+}
 
-                       "start_time", "i8",
-                       "end_time", "i8",
-                       "number_of_entries", "i8",
-                       "maximum_entry_size", "i8",
-                       "segment_number", "i4",
+si4 get_cpu_count_c(void)
+{
+    si4 n_cpus;
 
-                       "channel_name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "session_name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "anonymized_name", "S", UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES,
+    #ifdef _WIN32
+        SYSTEM_INFO sys_info;
+        GetSystemInfo(&sys_info);
+        n_cpus = (si4) sys_info.dwNumberOfProcessors;
+    #else
+        n_cpus = (si4) sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
 
-                       "level_UUID", "V", UUID_BYTES,
-                       "file_UUID", "V", UUID_BYTES,
-                       "provenance_UUID", "V", UUID_BYTES,
-                       "level_1_password_validation_field", "V", PASSWORD_VALIDATION_FIELD_BYTES,
-                       "level_2_password_validation_field", "V", PASSWORD_VALIDATION_FIELD_BYTES,
-                       "protected_region", "V", UNIVERSAL_HEADER_PROTECTED_REGION_BYTES,
-                       "discretionary_region", "V", UNIVERSAL_HEADER_DISCRETIONARY_REGION_BYTES);
+    if (n_cpus < 1)
+        n_cpus = 1;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    return n_cpus;
+}
 
-    return (PyObject *) descr;
+#ifdef _WIN32
+static DWORD WINAPI parallel_task_entry(LPVOID arg)
+{
+    ((PARALLEL_TASK *) arg)->worker(((PARALLEL_TASK *) arg)->arg);
+    return 0;
 }
+#else
+static void *parallel_task_entry(void *arg)
+{
+    ((PARALLEL_TASK *) arg)->worker(((PARALLEL_TASK *) arg)->arg);
+    return NULL;
+}
+#endif
 
-static PyObject *create_md1_dtype() {
-    import_array();
+void run_parallel_c(PARALLEL_WORKER_FUNCTION worker, void *args, size_t arg_bytes, si4 n_threads)
+{
+    // Runs worker on n_threads argument structs laid out in args (arg_bytes apart) and waits for all of them.
+    // Tasks whose thread cannot be started are run in the calling thread.
+    si4     i, n_started;
+    si1     *started;
+    PARALLEL_TASK   *tasks;
+    #ifdef _WIN32
+        HANDLE      *threads;
+    #else
+        pthread_t   *threads;
+    #endif
+
+    if (n_threads <= 1) {
+        for (i = 0; i < n_threads; i++)
+            worker((si1 *) args + (i * arg_bytes));
+        return;
+    }
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    tasks = (PARALLEL_TASK *) calloc((size_t) n_threads, sizeof(PARALLEL_TASK));
+    threads = calloc((size_t) n_threads, sizeof(*threads));
+    started = (si1 *) calloc((size_t) n_threads, sizeof(si1));
+    if (tasks == NULL || threads == NULL || started == NULL) {
+        free (tasks);
+        free (threads);
+        free (started);
+        for (i = 0; i < n_threads; i++)
+            worker((si1 *) args + (i * arg_bytes));
+        return;
+    }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
+    // the calling thread takes the first task itself
+    n_started = 0;
+    for (i = 1; i < n_threads; i++) {
+        tasks[i].worker = worker;
+        tasks[i].arg = (si1 *) args + (i * arg_bytes);
+        #ifdef _WIN32
+            threads[i] = CreateThread(NULL, 0, parallel_task_entry, tasks + i, 0, NULL);
+            started[i] = (threads[i] != NULL);
+        #else
+            started[i] = (pthread_create(threads + i, NULL, parallel_task_entry, tasks + i) == 0);
+        #endif
+        if (started[i])
+            n_started++;
+        else
+            worker(tasks[i].arg);
+    }
 
-                       "section_2_encryption", "i1",
-                       "section_3_encryption", "i1",
-                       "protected_region", "V", METADATA_SECTION_1_PROTECTED_REGION_BYTES,
-                       "discretionary_region", "V", METADATA_SECTION_1_DISCRETIONARY_REGION_BYTES);
+    worker(args);
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    for (i = 1; i < n_threads; i++) {
+        if (!started[i])
+            continue;
+        #ifdef _WIN32
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        #else
+            pthread_join(threads[i], NULL);
+        #endif
+    }
 
-    return (PyObject *) descr;
+    free (tasks);
+    free (threads);
+    free (started);
 }
 
-static PyObject *create_tmd2_dtype() {
-    import_array();
+// MEF_globals are shared by all threads - RED_encode() and write_MEF_file() apply the recording time offset from them
+// and meflib reports failures according to their behavior_on_fail. Threads writing with the same offset share them,
+// a thread with another offset (or changing the behavior) waits until they are released.
+#ifdef _WIN32
+static SRWLOCK mef_globals_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE mef_globals_released = CONDITION_VARIABLE_INIT;
+#else
+static pthread_mutex_t mef_globals_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mef_globals_released = PTHREAD_COND_INITIALIZER;
+#endif
+static si4 mef_globals_users = 0;     // -1 while held exclusively
+static si8 mef_globals_offset = 0;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+void lock_mef_globals_c(si8 recording_time_offset, si4 exclusive)
+{
+    // NOTE: waits for the other users, has to be called without the GIL
+    #ifdef _WIN32
+        AcquireSRWLockExclusive(&mef_globals_lock);
+        while (mef_globals_users < 0 || (mef_globals_users > 0 && (exclusive || mef_globals_offset != recording_time_offset)))
+            SleepConditionVariableSRW(&mef_globals_released, &mef_globals_lock, INFINITE, 0);
+    #else
+        pthread_mutex_lock(&mef_globals_mutex);
+        while (mef_globals_users < 0 || (mef_globals_users > 0 && (exclusive || mef_globals_offset != recording_time_offset)))
+            pthread_cond_wait(&mef_globals_released, &mef_globals_mutex);
+    #endif
+
+    if (exclusive) {
+        mef_globals_users = -1;
+    } else {
+        mef_globals_users++;
+        mef_globals_offset = recording_time_offset;
+        MEF_globals->recording_time_offset = recording_time_offset;
+    }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
-                       // type-independent fields
-                       "channel_description", "S", METADATA_CHANNEL_DESCRIPTION_BYTES,
-                       "session_description", "S", METADATA_SESSION_DESCRIPTION_BYTES,
-                       "recording_duration", "i8",
-                       // type-specific fields
-                       "reference_description", "S", METADATA_CHANNEL_DESCRIPTION_BYTES,
-                       "acquisition_channel_number", "i8",
-                       "sampling_frequency", "f8",
-                       "low_frequency_filter_setting", "f8",
-                       "high_frequency_filter_setting", "f8",
-                       "notch_filter_frequency_setting", "f8",
-                       "AC_line_frequency", "f8",
-                       "units_conversion_factor", "f8",
-                       "units_description", "S", TIME_SERIES_METADATA_UNITS_DESCRIPTION_BYTES,
-                       "maximum_native_sample_value", "f8",
-                       "minimum_native_sample_value", "f8",
-                       "start_sample", "i8",
-                       "number_of_samples", "i8",
-                       "number_of_blocks", "i8",
-                       "maximum_block_bytes", "i8",
-                       "maximum_block_samples", "u4",
-                       "maximum_difference_bytes", "u4",
-                       "block_interval", "i8",
-                       "number_of_discontinuities", "i8",
-                       "maximum_contiguous_blocks", "i8",
-                       "maximum_contiguous_block_bytes", "i8",
-                       "maximum_contiguous_samples", "i8",
-                       "protected_region", "V", TIME_SERIES_METADATA_SECTION_2_PROTECTED_REGION_BYTES,
-                       "discretionary_region", "V", TIME_SERIES_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
+    #ifdef _WIN32
+        ReleaseSRWLockExclusive(&mef_globals_lock);
+    #else
+        pthread_mutex_unlock(&mef_globals_mutex);
+    #endif
+}
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+void unlock_mef_globals_c(void)
+{
+    #ifdef _WIN32
+        AcquireSRWLockExclusive(&mef_globals_lock);
+    #else
+        pthread_mutex_lock(&mef_globals_mutex);
+    #endif
+
+    if (mef_globals_users < 0)
+        mef_globals_users = 0;
+    else if (mef_globals_users > 0)
+        mef_globals_users--;
+
+    if (mef_globals_users == 0) {
+        #ifdef _WIN32
+            WakeAllConditionVariable(&mef_globals_released);
+        #else
+            pthread_cond_broadcast(&mef_globals_released);
+        #endif
+    }
 
-    return (PyObject *) descr;
+    #ifdef _WIN32
+        ReleaseSRWLockExclusive(&mef_globals_lock);
+    #else
+        pthread_mutex_unlock(&mef_globals_mutex);
+    #endif
 }
 
-static PyObject *create_vmd2_dtype() {
-    import_array();
+void suppress_mef_errors_c(void)
+{
+    // NOTE: called with the GIL, meflib calls that follow run without error output until restore_mef_errors_c()
+    Py_BEGIN_ALLOW_THREADS
+    lock_mef_globals_c(0, MEF_TRUE);
+    Py_END_ALLOW_THREADS
+    MEF_globals->behavior_on_fail = SUPPRESS_ERROR_OUTPUT;
+}
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+void restore_mef_errors_c(void)
+{
+    MEF_globals->behavior_on_fail = EXIT_ON_FAIL;
+    unlock_mef_globals_c();
+}
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
-                       // type-independent fields
-                       "channel_description", "S", METADATA_CHANNEL_DESCRIPTION_BYTES,
-                       "session_description", "S", METADATA_SESSION_DESCRIPTION_BYTES,
-                       "recording_duration", "i8",
-                       // type-specific fields
-                       "horizontal_resolution", "i8",
-                       "vertical_resolution", "i8",
-                       "frame_rate", "f8",
-                       "number_of_clips", "i8",
-                       "maximum_clip_bytes", "i8",
-                       "video_format", "S", VIDEO_METADATA_VIDEO_FORMAT_BYTES,
-                       "video_file_CRC", "u4",
-                       "protected_region", "V", VIDEO_METADATA_SECTION_2_PROTECTED_REGION_BYTES,
-                       "discretionary_region", "V", VIDEO_METADATA_SECTION_2_DISCRETIONARY_REGION_BYTES);
+si8 list_metadata_files_c(si1 *dir_path, si4 depth, si1 ***paths, si8 *n_paths, si8 *capacity)
+{
+    // Appends the metadata, indices and record files of a session (depth 0), channel (1) or segment (2) directory
+    // and of the directories below it to the path list, returns the number of paths listed. Not available on Windows.
+    #ifdef _WIN32
+        return 0;
+    #else
+        DIR     *dir;
+        struct dirent   *entry;
+        si1     path[MEF_FULL_FILE_NAME_BYTES];
+        si1     **new_paths;
+        si1     *ext;
+        si8     n_listed;
+
+        dir = opendir(dir_path);
+        if (dir == NULL)
+            return 0;
+
+        n_listed = 0;
+        while ((entry = readdir(dir)) != NULL) {
+            ext = strrchr(entry->d_name, '.');
+            if ((ext == NULL) || (ext == entry->d_name))
+                continue;
+            ext++;
+            MEF_snprintf(path, MEF_FULL_FILE_NAME_BYTES, "%s/%s", dir_path, entry->d_name);
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+            // channel and segment directories
+            if ((depth == 0 && (!strcmp(ext, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING) || !strcmp(ext, VIDEO_CHANNEL_DIRECTORY_TYPE_STRING)))
+                || (depth == 1 && !strcmp(ext, SEGMENT_DIRECTORY_TYPE_STRING))) {
+                n_listed += list_metadata_files_c(path, depth + 1, paths, n_paths, capacity);
+                continue;
+            }
 
-    return (PyObject *) descr;
+            if (strcmp(ext, TIME_SERIES_METADATA_FILE_TYPE_STRING) && strcmp(ext, TIME_SERIES_INDICES_FILE_TYPE_STRING)
+                && strcmp(ext, VIDEO_METADATA_FILE_TYPE_STRING) && strcmp(ext, VIDEO_INDICES_FILE_TYPE_STRING)
+                && strcmp(ext, RECORD_INDICES_FILE_TYPE_STRING) && strcmp(ext, RECORD_DATA_FILE_TYPE_STRING))
+                continue;
+
+            if (*n_paths == *capacity) {
+                new_paths = (si1 **) realloc(*paths, (size_t) ((*capacity * 2 + 64) * sizeof(si1 *)));
+                if (new_paths == NULL)
+                    break;
+                *paths = new_paths;
+                *capacity = *capacity * 2 + 64;
+            }
+            (*paths)[*n_paths] = strdup(path);
+            if ((*paths)[*n_paths] == NULL)
+                break;
+            (*n_paths)++;
+            n_listed++;
+        }
+        closedir(dir);
+
+        return n_listed;
+    #endif
 }
 
-static PyObject *create_md3_dtype() {
-    import_array();
+void prefetch_worker_c(void *arg)
+{
+    // reads the files of the worker into a scratch buffer, the contents are kept by the page cache
+    PREFETCH_WORKER     *worker;
+    FILE    *fp;
+    ui1     *buffer;
+    si8     i;
+
+    worker = (PREFETCH_WORKER *) arg;
+    buffer = (ui1 *) malloc((size_t) PREFETCH_BUFFER_BYTES);
+    if (buffer == NULL)
+        return;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    for (i = worker->first; i < worker->n_paths; i += worker->step) {
+        fp = fopen(worker->paths[i], "rb");
+        if (fp == NULL)
+            continue;
+        while (fread(buffer, sizeof(ui1), (size_t) PREFETCH_BUFFER_BYTES, fp) == (size_t) PREFETCH_BUFFER_BYTES)
+            ;
+        fclose(fp);
+        worker->n_read++;
+    }
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i)]",
+    free(buffer);
+}
 
-                       "recording_time_offset", "i8",
-                       "DST_start_time", "i8",
-                       "DST_end_time", "i8",
-                       "GMT_offset", "i4",
-                       "subject_name_1", "S", METADATA_SUBJECT_NAME_BYTES,
-                       "subject_name_2", "S", METADATA_SUBJECT_NAME_BYTES,
-                       "subject_ID", "S", METADATA_SUBJECT_ID_BYTES,
-                       "recording_location", "S", METADATA_RECORDING_LOCATION_BYTES,
-                       "protected_region", "V", METADATA_SECTION_3_PROTECTED_REGION_BYTES,
-                       "discretionary_region", "V", METADATA_SECTION_3_DISCRETIONARY_REGION_BYTES);
+si8 prefetch_session_files_c(si1 *session_path, si4 n_threads)
+{
+    // NOTE: runs without the GIL - reads the metadata, indices and record files of the session with n_threads threads,
+    // returns the number of files read
+    PREFETCH_WORKER     *workers;
+    si1     **paths;
+    si8     n_paths, capacity, n_read, i;
+
+    paths = NULL;
+    n_paths = capacity = 0;
+    (void) list_metadata_files_c(session_path, 0, &paths, &n_paths, &capacity);
+
+    n_read = 0;
+    if ((si8) n_threads > n_paths)
+        n_threads = (si4) n_paths;
+    workers = (n_threads > 0) ? (PREFETCH_WORKER *) calloc((size_t) n_threads, sizeof(PREFETCH_WORKER)) : NULL;
+    if (workers != NULL) {
+        for (i = 0; i < n_threads; i++) {
+            workers[i].paths = paths;
+            workers[i].n_paths = n_paths;
+            workers[i].first = i;
+            workers[i].step = n_threads;
+        }
+        run_parallel_c(prefetch_worker_c, (void *) workers, sizeof(PREFETCH_WORKER), n_threads);
+        for (i = 0; i < n_threads; i++)
+            n_read += workers[i].n_read;
+        free(workers);
+    }
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+    for (i = 0; i < n_paths; i++)
+        free(paths[i]);
+    free(paths);
 
-    return (PyObject *) descr;
+    return n_read;
 }
 
-static PyObject *create_ti_dtype() {
-    import_array();
+/**************************  SIMD kernels  ****************************/
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+// Conversion of decoded samples to floats (RED_NAN -> NaN, scaling) and int fills.
+// init_simd_kernels_c() points the kernels at the widest instruction set the CPU supports,
+// the scalar versions are the fallback on other CPUs and architectures.
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
-                       "file_offset", "i8",
-                       "start_time", "i8",
-                       "start_sample", "i8",
-                       "number_of_samples", "u4",
-                       "block_bytes", "u4",
-                       "maximum_sample_value", "i4",
-                       "minimum_sample_value", "i4",
+static void convert_sf8_scalar_c(si4 *src, ui8 n, sf8 *dst, sf8 scale)
+{
+    ui8 i;
 
-                       "protected_region", "V", TIME_SERIES_INDEX_PROTECTED_REGION_BYTES,
-                       "RED_block_flags", "u1",
-                       "RED_block_protected_region", "V", RED_BLOCK_PROTECTED_REGION_BYTES,
-                       "RED_block_discretionary_region", "V", RED_BLOCK_DISCRETIONARY_REGION_BYTES);
+    for (i = 0; i < n; i++)
+        dst[i] = (src[i] == RED_NAN) ? NPY_NAN : (sf8) src[i] * scale;
+}
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+static void convert_sf4_scalar_c(si4 *src, ui8 n, sf4 *dst, sf8 scale)
+{
+    ui8 i;
 
-    return (PyObject *) descr;
+    for (i = 0; i < n; i++)
+        dst[i] = (src[i] == RED_NAN) ? NPY_NANF : (sf4) ((sf8) src[i] * scale);
 }
 
-static PyObject *create_vi_dtype() {
-    import_array();
+static void fill_si4_scalar_c(si4 *ptr, si4 value, ui8 n)
+{
+    ui8 i;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    for (i = 0; i < n; i++)
+        ptr[i] = value;
+}
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i)]",
-                       "start_time", "i8",
-                       "end_time", "i8",
-                       "start_frame", "u4",
-                       "end_frame", "u4",
-                       "file_offset", "i8",
-                       "clip_bytes", "i8",
-                       "protected_region", "V", VIDEO_INDEX_PROTECTED_REGION_BYTES,
-                       "discretionary_region", "V", VIDEO_INDEX_DISCRETIONARY_REGION_BYTES);
+#ifdef PYMEF_X86_SIMD
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+#ifdef _MSC_VER
+    #define PYMEF_TARGET(isa)
+#else
+    #define PYMEF_TARGET(isa) __attribute__((target(isa)))
+#endif
 
-    return (PyObject *) descr;
+PYMEF_TARGET("sse4.1")
+static void convert_sf8_sse41_c(si4 *src, ui8 n, sf8 *dst, sf8 scale)
+{
+    ui8     i;
+    __m128i nan_i, samps, nan_mask;
+    __m128d scale_v, nan_v, vals;
+
+    nan_i = _mm_set1_epi32(RED_NAN);
+    scale_v = _mm_set1_pd(scale);
+    nan_v = _mm_set1_pd(NPY_NAN);
+    for (i = 0; i + 2 <= n; i += 2) {
+        samps = _mm_loadl_epi64((__m128i *) (src + i));
+        nan_mask = _mm_cvtepi32_epi64(_mm_cmpeq_epi32(samps, nan_i));
+        vals = _mm_mul_pd(_mm_cvtepi32_pd(samps), scale_v);
+        _mm_storeu_pd(dst + i, _mm_blendv_pd(vals, nan_v, _mm_castsi128_pd(nan_mask)));
+    }
+    convert_sf8_scalar_c(src + i, n - i, dst + i, scale);
 }
 
-static PyObject *create_segment_dtype() {
-    import_array();
+PYMEF_TARGET("sse4.1")
+static void convert_sf4_sse41_c(si4 *src, ui8 n, sf4 *dst, sf8 scale)
+{
+    ui8     i;
+    __m128i nan_i, samps, nan_mask;
+    __m128d scale_v;
+    __m128  vals;
+
+    nan_i = _mm_set1_epi32(RED_NAN);
+    scale_v = _mm_set1_pd(scale);
+    for (i = 0; i + 4 <= n; i += 4) {
+        samps = _mm_loadu_si128((__m128i *) (src + i));
+        nan_mask = _mm_cmpeq_epi32(samps, nan_i);
+        vals = _mm_movelh_ps(_mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(samps), scale_v)),
+                             _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(samps, 8)), scale_v)));
+        _mm_storeu_ps(dst + i, _mm_blendv_ps(vals, _mm_set1_ps(NPY_NANF), _mm_castsi128_ps(nan_mask)));
+    }
+    convert_sf4_scalar_c(src + i, n - i, dst + i, scale);
+}
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+PYMEF_TARGET("sse4.1")
+static void fill_si4_sse41_c(si4 *ptr, si4 value, ui8 n)
+{
+    ui8     i;
+    __m128i val_v;
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i)]",
-                       "channel_type", "i4",
-                       "metadata_fps", "V", sizeof (void *),
-                       "time_series_data_fps", "V", sizeof (void *),
-                       "time_series_indices_fps", "V", sizeof (void *),
-                       "video_indices_fps", "V", sizeof (void *),
-                       "record_data_fps", "V", sizeof (void *),
-                       "record_indices_fps", "V", sizeof (void *),
-                       "name", "S", MEF_SEGMENT_BASE_FILE_NAME_BYTES,
-                       "path", "S", MEF_FULL_FILE_NAME_BYTES,
-                       "channel_name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "session_name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "level_UUID", "V", UUID_BYTES);
+    val_v = _mm_set1_epi32(value);
+    for (i = 0; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i *) (ptr + i), val_v);
+    fill_si4_scalar_c(ptr + i, value, n - i);
+}
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+PYMEF_TARGET("avx2")
+static void convert_sf8_avx2_c(si4 *src, ui8 n, sf8 *dst, sf8 scale)
+{
+    ui8     i;
+    __m128i nan_i, samps;
+    __m256i nan_mask;
+    __m256d scale_v, nan_v, vals;
+
+    nan_i = _mm_set1_epi32(RED_NAN);
+    scale_v = _mm256_set1_pd(scale);
+    nan_v = _mm256_set1_pd(NPY_NAN);
+    for (i = 0; i + 4 <= n; i += 4) {
+        samps = _mm_loadu_si128((__m128i *) (src + i));
+        nan_mask = _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(samps, nan_i));
+        vals = _mm256_mul_pd(_mm256_cvtepi32_pd(samps), scale_v);
+        _mm256_storeu_pd(dst + i, _mm256_blendv_pd(vals, nan_v, _mm256_castsi256_pd(nan_mask)));
+    }
+    convert_sf8_scalar_c(src + i, n - i, dst + i, scale);
+}
 
-    return (PyObject *) descr;
+PYMEF_TARGET("avx2")
+static void convert_sf4_avx2_c(si4 *src, ui8 n, sf4 *dst, sf8 scale)
+{
+    ui8     i;
+    __m128i nan_i, samps, nan_mask;
+    __m256d scale_v;
+    __m128  vals;
+
+    nan_i = _mm_set1_epi32(RED_NAN);
+    scale_v = _mm256_set1_pd(scale);
+    for (i = 0; i + 4 <= n; i += 4) {
+        samps = _mm_loadu_si128((__m128i *) (src + i));
+        nan_mask = _mm_cmpeq_epi32(samps, nan_i);
+        vals = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtepi32_pd(samps), scale_v));
+        _mm_storeu_ps(dst + i, _mm_blendv_ps(vals, _mm_set1_ps(NPY_NANF), _mm_castsi128_ps(nan_mask)));
+    }
+    convert_sf4_scalar_c(src + i, n - i, dst + i, scale);
 }
 
-static PyObject *create_channel_dtype() {
-    import_array();
+PYMEF_TARGET("avx2")
+static void fill_si4_avx2_c(si4 *ptr, si4 value, ui8 n)
+{
+    ui8     i;
+    __m256i val_v;
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+    val_v = _mm256_set1_epi32(value);
+    for (i = 0; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i *) (ptr + i), val_v);
+    fill_si4_scalar_c(ptr + i, value, n - i);
+}
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s)]",
-                       "channel_type", "i4",
-                       "metadata", "V", sizeof (METADATA),
-                       "record_data_fps", "V", sizeof (void *),
-                       "record_indices_fps", "V", sizeof (void *),
-                       "number_of_segments", "i8",
-                       "segments", "V", sizeof (void *),
-                       "path", "S", MEF_FULL_FILE_NAME_BYTES,
-                       "name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "extension", "S", TYPE_BYTES,
-                       "session_name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "level_UUID", "V", UUID_BYTES,
-                       "anonymized_name", "S", UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES,
-                       "maximum_number_of_records", "i8",
-                       "maximum_record_bytes", "i8",
-                       "earliest_start_time", "i8",
-                       "latest_end_time", "i8");
+#endif  // PYMEF_X86_SIMD
 
+static void (*convert_sf8_kernel)(si4 *src, ui8 n, sf8 *dst, sf8 scale) = convert_sf8_scalar_c;
+static void (*convert_sf4_kernel)(si4 *src, ui8 n, sf4 *dst, sf8 scale) = convert_sf4_scalar_c;
+static void (*fill_si4_kernel)(si4 *ptr, si4 value, ui8 n) = fill_si4_scalar_c;
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+void init_simd_kernels_c(void)
+{
+    si4 has_sse41, has_avx2;
 
-    return (PyObject *) descr;
-}
+    has_sse41 = has_avx2 = 0;
 
-static PyObject *create_session_dtype() {
-    import_array();
+#if defined(PYMEF_X86_SIMD) && defined(_MSC_VER)
+    {
+        int info[4];
+
+        __cpuid(info, 0);
+        if (info[0] >= 7) {
+            __cpuid(info, 1);
+            has_sse41 = (info[2] >> 19) & 1;
+            // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+            if (((info[2] >> 27) & 1) && ((_xgetbv(0) & 6) == 6)) {
+                __cpuidex(info, 7, 0);
+                has_avx2 = (info[1] >> 5) & 1;
+            }
+        }
+    }
+#elif defined(PYMEF_X86_SIMD)
+    __builtin_cpu_init();
+    has_sse41 = __builtin_cpu_supports("sse4.1");
+    has_avx2 = __builtin_cpu_supports("avx2");
+#endif
 
-    // Numpy array out
-    PyObject    *op;
-    PyArray_Descr    *descr;
+#ifdef PYMEF_X86_SIMD
+    if (has_avx2) {
+        convert_sf8_kernel = convert_sf8_avx2_c;
+        convert_sf4_kernel = convert_sf4_avx2_c;
+        fill_si4_kernel = fill_si4_avx2_c;
+    } else if (has_sse41) {
+        convert_sf8_kernel = convert_sf8_sse41_c;
+        convert_sf4_kernel = convert_sf4_sse41_c;
+        fill_si4_kernel = fill_si4_sse41_c;
+    }
+#endif
 
-    // Build dictionary
-    op = Py_BuildValue("[(s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s, i),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s),\
-                         (s, s)]",
-                       "time_series_metadata", "V", sizeof (METADATA),
-                       "number_of_time_series_channels", "i4",
-                       "time_series_channels", "V", sizeof (void *),
+    return;
+}
 
-                       "video_metadata", "V", sizeof (METADATA),
-                       "number_of_video_channels", "i4",
-                       "video_channels", "V", sizeof (void *),
+si4 copy_block_samples_c(si4 *dst, ui4 num_samps, si4 offset, si4 *src, ui4 n)
+{
+    // Copies the part of a decoded block of n samples starting at output offset that falls into
+    // [0, num_samps) and returns the output offset after the block (clipped to num_samps)
+    si8 first, last, end;
 
-                       "record_data_fps", "V", sizeof (void *),
-                       "record_indices_fps", "V", sizeof (void *),
+    first = (offset < 0) ? -((si8) offset) : 0;
+    last = (si8) n;
+    if ((si8) offset + last > (si8) num_samps)
+        last = (si8) num_samps - (si8) offset;
 
-                       "name", "S", MEF_BASE_FILE_NAME_BYTES,
-                       "path", "S", MEF_FULL_FILE_NAME_BYTES,
-                       "anonymized_name", "S", UNIVERSAL_HEADER_ANONYMIZED_NAME_BYTES,
-                       "level_UUID", "V", UUID_BYTES,
+    if (last > first)
+        memcpy(dst + offset + first, src + first, (size_t) (last - first) * sizeof(si4));
 
-                       "maximum_number_of_records", "i8",
-                       "maximum_record_bytes", "i8",
-                       "earliest_start_time", "i8",
-                       "latest_end_time", "i8");
+    end = (si8) offset + (si8) n;
+    if (end > (si8) num_samps)
+        end = ((si8) offset > (si8) num_samps) ? (si8) offset : (si8) num_samps;
 
+    return (si4) end;
+}
 
-    PyArray_DescrConverter(op, &descr);
-    Py_DECREF(op);
+void convert_ts_data_c(si4 *src, ui8 n, ui1 *dst, si8 dst_stride, si4 dst_type, sf8 scale)
+{
+    // Copies decoded samples into a (possibly strided) int32, float32 or float64 output,
+    // RED_NAN becomes NaN in float outputs, float outputs are multiplied by scale
+    ui8 i;
+
+    switch (dst_type) {
+        case NPY_INT32:
+            if (dst_stride == sizeof(si4)) {
+                memcpy(dst, src, (size_t) n * sizeof(si4));
+                break;
+            }
+            for (i = 0; i < n; i++, dst += dst_stride)
+                *((si4 *) dst) = src[i];
+            break;
+        case NPY_FLOAT32:
+            if (dst_stride == sizeof(sf4)) {
+                convert_sf4_kernel(src, n, (sf4 *) dst, scale);
+                break;
+            }
+            for (i = 0; i < n; i++, dst += dst_stride)
+                *((sf4 *) dst) = (src[i] == RED_NAN) ? NPY_NANF : (sf4) ((sf8) src[i] * scale);
+            break;
+        default:
+            if (dst_stride == sizeof(sf8)) {
+                convert_sf8_kernel(src, n, (sf8 *) dst, scale);
+                break;
+            }
+            for (i = 0; i < n; i++, dst += dst_stride)
+                *((sf8 *) dst) = (src[i] == RED_NAN) ? NPY_NAN : (sf8) src[i] * scale;
+            break;
+    }
+}
+
+si4 writer_sample_type_c(PyObject *raw_data)
+{
+    // NumPy type of a 1D array the writers can convert to si4, -1 if not supported
+    PyArrayObject   *arr;
+
+    if (!PyArray_Check(raw_data))
+        return -1;
+    arr = (PyArrayObject *) raw_data;
+    if (PyArray_NDIM(arr) != 1 || !PyArray_ISALIGNED(arr) || !PyArray_ISNOTSWAPPED(arr))
+        return -1;
+
+    switch (PyArray_DESCR(arr)->kind) {
+        case 'i':
+            switch (PyArray_ITEMSIZE(arr)) {
+                case 1: return NPY_INT8;
+                case 2: return NPY_INT16;
+                case 4: return NPY_INT32;
+                case 8: return NPY_INT64;
+            }
+            break;
+        case 'u':
+            switch (PyArray_ITEMSIZE(arr)) {
+                case 1: return NPY_UINT8;
+                case 2: return NPY_UINT16;
+                case 4: return NPY_UINT32;
+                case 8: return NPY_UINT64;
+            }
+            break;
+        case 'f':
+            switch (PyArray_ITEMSIZE(arr)) {
+                case 4: return NPY_FLOAT32;
+                case 8: return NPY_FLOAT64;
+            }
+            break;
+    }
 
-    return (PyObject *) descr;
+    return -1;
 }
 
-/**************************  Other helper functions  ****************************/
+#define CONVERT_INT_TO_SI4(c_type) \
+    for (i = 0; i < n; i++, src += src_stride) { \
+        v = (si8) *((c_type *) src); \
+        if (v > PYMEF_MAX_SAMPLE_VALUE) { v = PYMEF_MAX_SAMPLE_VALUE; n_clipped++; } \
+        else if (v < PYMEF_MIN_SAMPLE_VALUE) { v = PYMEF_MIN_SAMPLE_VALUE; n_clipped++; } \
+        dst[i] = (si4) v; \
+    }
 
-si4 check_block_crc(ui1* block_hdr_ptr, ui4 max_samps, ui1* total_data_ptr, ui8 total_data_bytes)
-{
-    ui8 offset_into_data, remaining_buf_size;
-    si1 CRC_valid;
-    RED_BLOCK_HEADER* block_header;
-    
-    offset_into_data = block_hdr_ptr - total_data_ptr;
-    remaining_buf_size = total_data_bytes - offset_into_data;
-    
-    // check if remaining buffer at least contains the RED block header
-    if (remaining_buf_size < RED_BLOCK_HEADER_BYTES)
-        return 0;
-    
-    block_header = (RED_BLOCK_HEADER*) block_hdr_ptr;
-    
-    // check if entire block, based on size specified in header, can possibly fit in the remaining buffer
-    if (block_header->block_bytes > remaining_buf_size)
-        return 0;
-    
-    // check if size specified in header is absurdly large
-    if (block_header->block_bytes > RED_MAX_COMPRESSED_BYTES(max_samps, 1))
-        return 0;
-	
-    // check if size specified in header is too small to be valid
-    if (block_header->block_bytes < RED_BLOCK_HEADER_BYTES)
-        return 0;
-    
-    // at this point we know we have enough data to actually run the CRC calculation, so do it
-    CRC_valid = CRC_validate((ui1*) block_header + CRC_BYTES, block_header->block_bytes - CRC_BYTES, block_header->block_CRC);
-    
-    // return output of CRC heck
-    if (CRC_valid == MEF_TRUE)
-        return 1;
-    else
-        return 0;
-}
+#define CONVERT_FLOAT_TO_SI4(c_type) \
+    for (i = 0; i < n; i++, src += src_stride) { \
+        f = (sf8) *((c_type *) src) * scale; \
+        if (f != f) { dst[i] = RED_NAN; continue; } \
+        if (f > (sf8) PYMEF_MAX_SAMPLE_VALUE) { f = (sf8) PYMEF_MAX_SAMPLE_VALUE; n_clipped++; } \
+        else if (f < (sf8) PYMEF_MIN_SAMPLE_VALUE) { f = (sf8) PYMEF_MIN_SAMPLE_VALUE; n_clipped++; } \
+        dst[i] = (si4) floor(f + 0.5); \
+    }
 
-si4 extract_segment_number(si1 *segment_name)
+si8 convert_to_si4_c(ui1 *src, si8 src_stride, si4 src_type, sf8 scale, si4 *dst, si8 n)
 {
-    si1     *c;
-    si4     segment_number;
-
-    // move pointer to the end of the string
-    c = segment_name + strlen(segment_name) - 1;
-
-    // Get to the dash
-    while(*--c == '-'){
-        if (*c == '/'){
-            PyErr_SetString(PyExc_RuntimeError, "Segment name not in valid form XXX-000000");
-            PyErr_Occurred();
-            return -1;
+    // Converts n (possibly strided) samples of src_type to si4 - multiplied by scale and rounded, NaN (and unscaled
+    // int32 RED_NAN) becomes RED_NAN, values out of the si4 sample range are clipped, returns the number of clipped samples
+    si8     i, v, n_clipped;
+    sf8     f;
+
+    n_clipped = 0;
+
+    // integers are converted exactly if not scaled
+    if (scale == 1.0) {
+        switch (src_type) {
+            case NPY_INT8:      CONVERT_INT_TO_SI4(npy_int8); return n_clipped;
+            case NPY_UINT8:     CONVERT_INT_TO_SI4(ui1); return n_clipped;
+            case NPY_INT16:     CONVERT_INT_TO_SI4(si2); return n_clipped;
+            case NPY_UINT16:    CONVERT_INT_TO_SI4(ui2); return n_clipped;
+            case NPY_INT32:
+                // RED_NAN marks missing samples and is kept, as write_mef_ts_data_and_indices does for int32 data
+                for (i = 0; i < n; i++, src += src_stride) {
+                    v = (si8) *((si4 *) src);
+                    if (v > PYMEF_MAX_SAMPLE_VALUE) { v = PYMEF_MAX_SAMPLE_VALUE; n_clipped++; }
+                    else if (v < PYMEF_MIN_SAMPLE_VALUE && v != RED_NAN) { v = PYMEF_MIN_SAMPLE_VALUE; n_clipped++; }
+                    dst[i] = (si4) v;
+                }
+                return n_clipped;
+            case NPY_UINT32:    CONVERT_INT_TO_SI4(ui4); return n_clipped;
+            case NPY_INT64:     CONVERT_INT_TO_SI4(si8); return n_clipped;
+            case NPY_UINT64:
+                for (i = 0; i < n; i++, src += src_stride) {
+                    if (*((ui8 *) src) > (ui8) PYMEF_MAX_SAMPLE_VALUE) {
+                        dst[i] = PYMEF_MAX_SAMPLE_VALUE;
+                        n_clipped++;
+                    } else {
+                        dst[i] = (si4) *((ui8 *) src);
+                    }
+                }
+                return n_clipped;
         }
     }
-    c++;
 
-    segment_number = (si4) strtol(c, NULL, 10);
+    switch (src_type) {
+        case NPY_INT8:      CONVERT_FLOAT_TO_SI4(npy_int8); break;
+        case NPY_UINT8:     CONVERT_FLOAT_TO_SI4(ui1); break;
+        case NPY_INT16:     CONVERT_FLOAT_TO_SI4(si2); break;
+        case NPY_UINT16:    CONVERT_FLOAT_TO_SI4(ui2); break;
+        case NPY_INT32:     CONVERT_FLOAT_TO_SI4(si4); break;
+        case NPY_UINT32:    CONVERT_FLOAT_TO_SI4(ui4); break;
+        case NPY_INT64:     CONVERT_FLOAT_TO_SI4(si8); break;
+        case NPY_UINT64:    CONVERT_FLOAT_TO_SI4(ui8); break;
+        case NPY_FLOAT32:   CONVERT_FLOAT_TO_SI4(sf4); break;
+        default:            CONVERT_FLOAT_TO_SI4(sf8); break;
+    }
 
-    return segment_number;
+    return n_clipped;
 }
 
-si8 sample_for_uutc_c(si8 uutc, CHANNEL *channel)
+si8 plan_adaptive_blocks_c(ui1 *src, si8 src_stride, si4 src_type, sf8 scale, si8 n_samples, si8 target_block_bytes, si8 min_block_samps, si8 max_block_samps, si8 *block_starts)
 {
-    ui8 i, j, sample;
-    sf8 native_samp_freq;
-    ui8 prev_sample_number;
-    si8 prev_time, seg_start_sample;
-    si8 next_sample_number;
-    
-    native_samp_freq = channel->metadata.time_series_section_2->sampling_frequency;
-    prev_sample_number = channel->segments[0].metadata_fps->metadata.time_series_section_2->start_sample;
-    prev_time = channel->segments[0].time_series_indices_fps->time_series_indices[0].start_time;
-    
-    for (j = 0; j < (ui8) channel->number_of_segments; j++)
-    {
-        seg_start_sample = channel->segments[j].metadata_fps->metadata.time_series_section_2->start_sample;
-        
-        // initialize next_sample_number to end of current segment, in case we're on the last segment and we
-        // go all the way to the end of the segment.
-        // Otherwise this value will get overridden later on
-        next_sample_number = seg_start_sample + channel->segments[j].metadata_fps->metadata.time_series_section_2->number_of_samples;
-        
-        for (i = 0; i < (ui8) channel->segments[j].metadata_fps->metadata.time_series_section_2->number_of_blocks; ++i) {
-            if (channel->segments[j].time_series_indices_fps->time_series_indices[i].start_time > uutc)
-            {
-                next_sample_number = channel->segments[j].time_series_indices_fps->time_series_indices[i].start_sample + seg_start_sample;
-                goto done;
+    // NOTE: runs without the GIL - splits the samples into blocks of about target_block_bytes (0 - no byte target)
+    // and of min_block_samps to max_block_samps samples, a block is also closed where the signal statistics change.
+    // The encoded size is estimated from the differences - 1 byte if they fit in si1, 5 bytes (keysample) otherwise.
+    // Fills block_starts (n_blocks + 1 entries, the last is n_samples) and returns the number of blocks.
+    si4     window[ADAPTIVE_BLOCK_WINDOW];
+    si8     n_blocks, pos, j, wn, diff, cur_samps, cur_bytes, win_bytes, cost;
+    si4     prev;
+
+    n_blocks = 0;
+    cur_samps = 0;
+    cur_bytes = RED_BLOCK_HEADER_BYTES;
+    prev = 0;
+
+    for (pos = 0; pos < n_samples; pos += wn) {
+        wn = n_samples - pos;
+        if (wn > ADAPTIVE_BLOCK_WINDOW)
+            wn = ADAPTIVE_BLOCK_WINDOW;
+        (void) convert_to_si4_c(src + (pos * src_stride), src_stride, src_type, scale, window, wn);
+
+        // the window differs from the block so far - start a new block with it
+        if (cur_samps >= min_block_samps) {
+            win_bytes = 0;
+            for (j = 0; j < wn; j++) {
+                diff = (si8) window[j] - (si8) ((j == 0) ? prev : window[j - 1]);
+                win_bytes += (diff > 127 || diff < -127) ? 5 : 1;
+            }
+            if ((win_bytes * cur_samps > ADAPTIVE_BLOCK_STAT_RATIO * (cur_bytes - RED_BLOCK_HEADER_BYTES) * wn) ||
+                (win_bytes * cur_samps * ADAPTIVE_BLOCK_STAT_RATIO < (cur_bytes - RED_BLOCK_HEADER_BYTES) * wn)) {
+                block_starts[n_blocks++] = pos - cur_samps;
+                cur_samps = 0;
+                cur_bytes = RED_BLOCK_HEADER_BYTES;
+            }
+        }
+
+        for (j = 0; j < wn; j++) {
+            diff = (si8) window[j] - (si8) prev;
+            cost = (cur_samps == 0 || diff > 127 || diff < -127) ? 5 : 1;
+            prev = window[j];
+
+            if ((cur_samps == max_block_samps) ||
+                (target_block_bytes > 0 && cur_samps >= min_block_samps && cur_bytes + cost > target_block_bytes)) {
+                block_starts[n_blocks++] = pos + j - cur_samps;
+                cur_samps = 0;
+                cur_bytes = RED_BLOCK_HEADER_BYTES;
+                cost = 5;
             }
-            prev_sample_number = channel->segments[j].time_series_indices_fps->time_series_indices[i].start_sample + seg_start_sample;
-            prev_time = channel->segments[j].time_series_indices_fps->time_series_indices[i].start_time;
+            cur_bytes += cost;
+            cur_samps++;
         }
     }
-    
-done:
-    
-    sample = prev_sample_number + (ui8) (((((sf8) (uutc - prev_time)) / 1000000.0) * native_samp_freq) + 0.5);
-    if (sample > next_sample_number)
-        sample = next_sample_number;  // prevent it from going too far
-    
-    return(sample);
+
+    if (cur_samps > 0)
+        block_starts[n_blocks++] = n_samples - cur_samps;
+    block_starts[n_blocks] = n_samples;
+
+    return n_blocks;
 }
 
-si8 uutc_for_sample_c(si8 sample, CHANNEL *channel)
+si8 count_gaps_c(si4 *data, si8 n)
 {
-    ui8 i, j, uutc;
-    sf8 native_samp_freq;
-    ui8 prev_sample_number; 
-    si8 prev_time, seg_start_sample;
+    // number of runs of RED_NAN samples
+    si8 i, n_gaps;
 
+    n_gaps = 0;
+    for (i = 0; i < n; i++)
+        if (data[i] == RED_NAN && (i == 0 || data[i - 1] != RED_NAN))
+            n_gaps++;
 
-    native_samp_freq = channel->metadata.time_series_section_2->sampling_frequency;
-    prev_sample_number = channel->segments[0].metadata_fps->metadata.time_series_section_2->start_sample;
-    prev_time = channel->segments[0].time_series_indices_fps->time_series_indices[0].start_time;
+    return n_gaps;
+}
 
-    for (j = 0; j < (ui8) channel->number_of_segments; j++)
-    {
-        seg_start_sample = channel->segments[j].metadata_fps->metadata.time_series_section_2->start_sample;
-        for (i = 0; i < (ui8) channel->segments[j].metadata_fps->metadata.time_series_section_2->number_of_blocks; ++i){
-            if (channel->segments[j].time_series_indices_fps->time_series_indices[i].start_sample + seg_start_sample > sample)
-                goto done;
-            prev_sample_number = channel->segments[j].time_series_indices_fps->time_series_indices[i].start_sample + seg_start_sample;
-            prev_time = channel->segments[j].time_series_indices_fps->time_series_indices[i].start_time;
-        }
+void fill_gap_intervals_c(si4 *data, si8 n, si8 *intervals)
+{
+    // [start, stop) of each run of RED_NAN samples, intervals has 2 * count_gaps_c() entries
+    si8 i;
+
+    for (i = 0; i < n; i++) {
+        if (data[i] != RED_NAN)
+            continue;
+        *intervals++ = i;
+        while (i < n && data[i] == RED_NAN)
+            i++;
+        *intervals++ = i;
     }
+}
 
-    done:
-        uutc = prev_time + (ui8) ((((sf8) (sample - prev_sample_number) / native_samp_freq) * 1000000.0) + 0.5);
-    
-    return(uutc);
+void fill_gap_mask_c(si4 *data, si8 n, ui1 *mask)
+{
+    si8 i;
+
+    for (i = 0; i < n; i++)
+        mask[i] = (data[i] == RED_NAN);
 }
 
 void memset_int(si4 *ptr, si4 value, size_t num)
 {
-    si4 *temp_ptr;
-    int i;
-    
     if (num < 1)
         return;
-    
-    temp_ptr = ptr;
-    for (i=0;i<num;i++)
-    {
-        memcpy(temp_ptr, &value, sizeof(si4));
-        temp_ptr++;
-    }
+
+    fill_si4_kernel(ptr, value, (ui8) num);
 }
 
 static PyObject *check_mef_password(PyObject *self, PyObject *args) {
@@ -5017,12 +8144,7 @@ static PyObject *check_mef_password(PyObject *self, PyObject *args) {
     si1     *password;
     PyObject    *temp_UTF_str;
 
-    si1         password_bytes[PASSWORD_BYTES];
-    ui1         sha[SHA256_OUTPUT_SIZE];
-    si1         level_1_cumsum,level_2_cumsum;
-    si1         putative_level_1_password_bytes[PASSWORD_BYTES];
-    si4         i;
-
+    si4         result;
     size_t      nb;
 
     FILE *fp;
@@ -5035,9 +8157,6 @@ static PyObject *check_mef_password(PyObject *self, PyObject *args) {
         return NULL;
     }
     
-    // initialize MEF library
-    (void) initialize_meflib();
-	
 	// password entries
     if (PyUnicode_Check(py_password_obj)) {
         temp_UTF_str = PyUnicode_AsEncodedString(py_password_obj, "utf-8", "strict");
@@ -5057,17 +8176,157 @@ static PyObject *check_mef_password(PyObject *self, PyObject *args) {
     uh = (UNIVERSAL_HEADER *) calloc(1, sizeof(UNIVERSAL_HEADER));
     
     // Read file universal header
+    nb = 0;
     fp = fopen(py_mef_file_path,"rb");
-    nb = fread((void *) uh, sizeof(UNIVERSAL_HEADER), 1, fp);
-    fclose(fp);
+    if (fp != NULL) {
+        nb = fread((void *) uh, sizeof(UNIVERSAL_HEADER), 1, fp);
+        fclose(fp);
+    }
     if (nb != 1) {
         PyErr_SetString(PyExc_RuntimeError, "Error reading file, exiting...");
         PyErr_Occurred();
         free(uh);
-		free_meflib();
         return NULL;
     }
 
+    result = validate_password_c(uh, password);
+
+    // clean up
+    free(uh);
+
+    return PyLong_FromLong(result);
+}
+
+static PyObject *check_mef_passwords(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+    // user arguments
+    PyObject    *py_file_paths;
+    PyObject    *py_password_obj;
+    si4 n_threads = 0; // default - sequential
+
+    // function specific
+    si1     password_arr[PASSWORD_BYTES] = {0};
+    si1     *temp_str_bytes;
+    si1     *password;
+    PyObject    *temp_UTF_str;
+    PyObject    *py_seq, *py_path_bytes;
+    HEADER_READ_WORKER  *workers;
+    UNIVERSAL_HEADER    *uhs, **uh_ptrs;
+    si1     **paths;
+    ui1     *read_ok;
+    si8     n_paths, n_uhs, i;
+    si4     result;
+
+    // --- Parse the input ---
+    static char* keywords[] = {"file_paths", "password", "n_threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|i", keywords,
+                                     &py_file_paths,
+                                     &py_password_obj,
+                                     &n_threads)) {
+        return NULL;
+    }
+
+    // password entries
+    if (PyUnicode_Check(py_password_obj)) {
+        temp_UTF_str = PyUnicode_AsEncodedString(py_password_obj, "utf-8", "strict");
+        temp_str_bytes = PyBytes_AS_STRING(temp_UTF_str);
+
+        if (!*temp_str_bytes)
+            password = NULL;
+        else
+            password = strcpy(password_arr, temp_str_bytes);
+
+		Py_DECREF(temp_UTF_str);	temp_UTF_str = NULL;
+    } else {
+        password = NULL;
+    }
+
+    py_seq = PySequence_Fast(py_file_paths, "file_paths must be a sequence of paths, exiting...");
+    if (py_seq == NULL)
+        return NULL;
+    n_paths = (si8) PySequence_Fast_GET_SIZE(py_seq);
+
+    paths = (si1 **) calloc((size_t) n_paths + 1, sizeof(si1 *));
+    uhs = (UNIVERSAL_HEADER *) calloc((size_t) n_paths + 1, sizeof(UNIVERSAL_HEADER));
+    uh_ptrs = (UNIVERSAL_HEADER **) calloc((size_t) n_paths + 1, sizeof(UNIVERSAL_HEADER *));
+    read_ok = (ui1 *) calloc((size_t) n_paths + 1, sizeof(ui1));
+    if (paths == NULL || uhs == NULL || uh_ptrs == NULL || read_ok == NULL) {
+        Py_DECREF(py_seq);
+        free(paths); free(uhs); free(uh_ptrs); free(read_ok);
+        PyErr_SetString(PyExc_RuntimeError, "Could not allocate universal headers, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+
+    for (i = 0; i < n_paths; i++) {
+        if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(py_seq, i), &py_path_bytes))
+            break;
+        paths[i] = strdup(PyBytes_AS_STRING(py_path_bytes));
+        Py_DECREF(py_path_bytes);
+    }
+    Py_DECREF(py_seq);
+    if (i < n_paths) {
+        for (i = 0; i < n_paths; i++)
+            free(paths[i]);
+        free(paths); free(uhs); free(uh_ptrs); free(read_ok);
+        return NULL;
+    }
+
+    // read the universal headers, concurrently if requested
+    if (n_threads < 1)
+        n_threads = 1;
+    if ((si8) n_threads > n_paths)
+        n_threads = (n_paths > 0) ? (si4) n_paths : 1;
+    workers = (HEADER_READ_WORKER *) calloc((size_t) n_threads, sizeof(HEADER_READ_WORKER));
+    if (workers != NULL) {
+        for (i = 0; i < n_threads; i++) {
+            workers[i].paths = paths;
+            workers[i].n_paths = n_paths;
+            workers[i].first = i;
+            workers[i].step = n_threads;
+            workers[i].uhs = uhs;
+            workers[i].read_ok = read_ok;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        if (n_threads > 1)
+            run_parallel_c(header_read_worker_c, (void *) workers, sizeof(HEADER_READ_WORKER), n_threads);
+        else
+            header_read_worker_c((void *) workers);
+        Py_END_ALLOW_THREADS
+        free(workers);
+    }
+
+    for (i = 0, n_uhs = 0; i < n_paths; i++) {
+        if (read_ok[i])
+            uh_ptrs[n_uhs++] = uhs + i;
+        free(paths[i]);
+    }
+    free(paths);
+
+    if (n_uhs < n_paths) {
+        free(uhs); free(uh_ptrs); free(read_ok);
+        PyErr_SetString(PyExc_RuntimeError, "Error reading file, exiting...");
+        PyErr_Occurred();
+        return NULL;
+    }
+
+    result = validate_headers_password_c(uh_ptrs, n_uhs, password);
+
+    free(uhs); free(uh_ptrs); free(read_ok);
+
+    return PyLong_FromLong(result);
+}
+
+si4 validate_password_c(UNIVERSAL_HEADER *uh, si1 *password)
+{
+    // checks the password against the validation fields of the universal header - extracted from process_pasword_data
+    // returns -1 wrong password, 0 data not encrypted, 1 level 1 password, 2 level 2 password
+    si1         password_bytes[PASSWORD_BYTES];
+    ui1         sha[SHA256_OUTPUT_SIZE];
+    si1         level_1_cumsum,level_2_cumsum;
+    si1         putative_level_1_password_bytes[PASSWORD_BYTES];
+    si4         i;
+
     // If password is NULL check if the file is not encrypted
     if (password == NULL) {
         level_1_cumsum = 0;
@@ -5079,18 +8338,12 @@ static PyObject *check_mef_password(PyObject *self, PyObject *args) {
             level_2_cumsum += uh->level_1_password_validation_field[i];
         }
 
-        // clean up
-        free(uh);
-		free_meflib();
-        
-        if (level_1_cumsum | level_2_cumsum) {
-            return PyLong_FromLong(-1); // Wrong password
-        } else {
-            return PyLong_FromLong(0); // Data not encrypted
-        }
+        if (level_1_cumsum | level_2_cumsum)
+            return -1; // Wrong password
+        else
+            return 0; // Data not encrypted
     }
 
-    // Check the password - extracted from process_pasword_data
     extract_terminal_password_bytes(password, password_bytes);
     
     // check for level 1 access
@@ -5102,12 +8355,8 @@ static PyObject *check_mef_password(PyObject *self, PyObject *args) {
         if (sha[i] != uh->level_1_password_validation_field[i])
             break;
     }
-    if (i == PASSWORD_BYTES) {  // Level 1 password valid - cannot be level 2 password
-        // clean up
-        free(uh);
-		free_meflib();
-        return PyLong_FromLong(1);
-    }
+    if (i == PASSWORD_BYTES)  // Level 1 password valid - cannot be level 2 password
+        return 1;
     
     // invalid level 1 => check if level 2 password
     for (i = 0; i < PASSWORD_BYTES; ++i)  // xor with level 2 password validation field
@@ -5121,21 +8370,217 @@ static PyObject *check_mef_password(PyObject *self, PyObject *args) {
         if (sha[i] != uh->level_1_password_validation_field[i])
             break;
     }
-    if (i == PASSWORD_VALIDATION_FIELD_BYTES) { // Level 2 password valid
-        // Clean up
-        free(uh);
-		free_meflib();
-        return PyLong_FromLong(2);
+    if (i == PASSWORD_VALIDATION_FIELD_BYTES) // Level 2 password valid
+        return 2;
+
+    if (level_1_cumsum | level_2_cumsum)
+        return -1; // Wrong password
+    else
+        return 0; // Data not encrypted
+}
+
+si4 validate_headers_password_c(UNIVERSAL_HEADER **uhs, si8 n_uhs, si1 *password)
+{
+    // checks the password once per distinct pair of validation fields of the headers, files written with the same
+    // passwords share the fields. Returns -1 if the password is wrong for any of them, otherwise the lowest result.
+    UNIVERSAL_HEADER    **distinct;
+    si8     n_distinct, i, j;
+    si4     result, lowest;
+
+    if (n_uhs < 1)
+        return 0;
+
+    distinct = (UNIVERSAL_HEADER **) malloc((size_t) n_uhs * sizeof(UNIVERSAL_HEADER *));
+    if (distinct == NULL)
+        return -1;
+
+    lowest = 2;
+    n_distinct = 0;
+    for (i = 0; i < n_uhs; i++) {
+        if (uhs[i] == NULL)
+            continue;
+        for (j = 0; j < n_distinct; j++)
+            if (!memcmp(uhs[i]->level_1_password_validation_field, distinct[j]->level_1_password_validation_field, PASSWORD_VALIDATION_FIELD_BYTES)
+                && !memcmp(uhs[i]->level_2_password_validation_field, distinct[j]->level_2_password_validation_field, PASSWORD_VALIDATION_FIELD_BYTES))
+                break;
+        if (j < n_distinct)
+            continue;
+        distinct[n_distinct++] = uhs[i];
+
+        result = validate_password_c(uhs[i], password);
+        if (result < lowest)
+            lowest = result;
+        if (lowest < 0)
+            break;
     }
+    free(distinct);
 
-    // clean up
-    free(uh);
-	free_meflib();
-	
-    if (level_1_cumsum | level_2_cumsum) {
-        return PyLong_FromLong(-1); // Wrong password
-    } else {
-        return PyLong_FromLong(0); // Data not encrypted
-    } 
-	
+    return lowest;
+}
+
+si8 add_fps_header_c(FILE_PROCESSING_STRUCT *fps, UNIVERSAL_HEADER **uhs, si8 n_uhs)
+{
+    if (fps != NULL && fps->universal_header != NULL)
+        uhs[n_uhs++] = fps->universal_header;
+
+    return n_uhs;
+}
+
+si8 collect_channel_headers_c(CHANNEL *channel, UNIVERSAL_HEADER **uhs, si8 n_uhs)
+{
+    // appends the universal headers read with the channel to uhs, which has room for 2 + 6 * number_of_segments
+    SEGMENT     *segment;
+    si8         i;
+
+    n_uhs = add_fps_header_c(channel->record_data_fps, uhs, n_uhs);
+    n_uhs = add_fps_header_c(channel->record_indices_fps, uhs, n_uhs);
+    for (i = 0; i < channel->number_of_segments; i++) {
+        segment = channel->segments + i;
+        n_uhs = add_fps_header_c(segment->metadata_fps, uhs, n_uhs);
+        n_uhs = add_fps_header_c(segment->time_series_data_fps, uhs, n_uhs);
+        n_uhs = add_fps_header_c(segment->time_series_indices_fps, uhs, n_uhs);
+        n_uhs = add_fps_header_c(segment->video_indices_fps, uhs, n_uhs);
+        n_uhs = add_fps_header_c(segment->record_data_fps, uhs, n_uhs);
+        n_uhs = add_fps_header_c(segment->record_indices_fps, uhs, n_uhs);
+    }
+
+    return n_uhs;
+}
+
+si4 check_channel_password_c(CHANNEL *channel, si1 *password)
+{
+    // checks the password on the headers of the files read with the channel, no files are opened
+    UNIVERSAL_HEADER    **uhs;
+    si8     n_uhs;
+    si4     result;
+
+    uhs = (UNIVERSAL_HEADER **) malloc((size_t) (2 + 6 * channel->number_of_segments) * sizeof(UNIVERSAL_HEADER *));
+    if (uhs == NULL)
+        return -1;
+    n_uhs = collect_channel_headers_c(channel, uhs, 0);
+    result = validate_headers_password_c(uhs, n_uhs, password);
+    free(uhs);
+
+    return result;
+}
+
+si4 check_session_password_c(SESSION *session, si1 *password)
+{
+    // checks the password on the headers of the files read with the session, no files are opened
+    UNIVERSAL_HEADER    **uhs;
+    si8     n_uhs, max_uhs, i;
+    si4     result;
+
+    max_uhs = 2;
+    for (i = 0; i < session->number_of_time_series_channels; i++)
+        max_uhs += 2 + 6 * session->time_series_channels[i].number_of_segments;
+    for (i = 0; i < session->number_of_video_channels; i++)
+        max_uhs += 2 + 6 * session->video_channels[i].number_of_segments;
+
+    uhs = (UNIVERSAL_HEADER **) malloc((size_t) max_uhs * sizeof(UNIVERSAL_HEADER *));
+    if (uhs == NULL)
+        return -1;
+
+    n_uhs = add_fps_header_c(session->record_data_fps, uhs, 0);
+    n_uhs = add_fps_header_c(session->record_indices_fps, uhs, n_uhs);
+    for (i = 0; i < session->number_of_time_series_channels; i++)
+        n_uhs = collect_channel_headers_c(session->time_series_channels + i, uhs, n_uhs);
+    for (i = 0; i < session->number_of_video_channels; i++)
+        n_uhs = collect_channel_headers_c(session->video_channels + i, uhs, n_uhs);
+
+    result = validate_headers_password_c(uhs, n_uhs, password);
+    free(uhs);
+
+    return result;
+}
+
+void header_read_worker_c(void *arg)
+{
+    // reads the universal headers of the files of the worker
+    HEADER_READ_WORKER  *worker;
+    FILE    *fp;
+    si8     i;
+
+    worker = (HEADER_READ_WORKER *) arg;
+
+    for (i = worker->first; i < worker->n_paths; i += worker->step) {
+        fp = fopen(worker->paths[i], "rb");
+        if (fp == NULL)
+            continue;
+        if (fread((void *) (worker->uhs + i), sizeof(UNIVERSAL_HEADER), 1, fp) == 1)
+            worker->read_ok[i] = 1;
+        fclose(fp);
+    }
+}
+
+si4 record_table_type_index_c(ui4 type_code)
+{
+    switch (type_code) {
+        case MEFREC_Note_TYPE_CODE:
+            return RECORD_TABLE_NOTE;
+        case MEFREC_EDFA_TYPE_CODE:
+            return RECORD_TABLE_EDFA;
+        case MEFREC_LNTP_TYPE_CODE:
+            return RECORD_TABLE_LNTP;
+        case MEFREC_Seiz_TYPE_CODE:
+            return RECORD_TABLE_SEIZ;
+        case MEFREC_CSti_TYPE_CODE:
+            return RECORD_TABLE_CSTI;
+        case MEFREC_ESti_TYPE_CODE:
+            return RECORD_TABLE_ESTI;
+        case MEFREC_SyLg_TYPE_CODE:
+            return RECORD_TABLE_SYLG;
+        case MEFREC_Curs_TYPE_CODE:
+            return RECORD_TABLE_CURS;
+        case MEFREC_Epoc_TYPE_CODE:
+            return RECORD_TABLE_EPOC;
+        default:
+            return -1;
+    }
+}
+
+si8 record_table_items_c(RECORD_HEADER *rh, si4 type_idx, ui1 **items)
+{
+    // points items to the variable length part of the record, returns the number of text bytes, template samples
+    // or seizure channels that fit into the record body (0 for fixed size records)
+    ui1     *body_end, *text_end;
+    si8     n_items, max_items;
+
+    body_end = (ui1 *) rh + RECORD_HEADER_BYTES + rh->bytes;
+    *items = NULL;
+
+    switch (type_idx) {
+        case RECORD_TABLE_NOTE:
+            *items = (ui1 *) rh + MEFREC_Note_1_0_TEXT_OFFSET;
+            break;
+        case RECORD_TABLE_SYLG:
+            *items = (ui1 *) rh + MEFREC_SyLg_1_0_TEXT_OFFSET;
+            break;
+        case RECORD_TABLE_EDFA:
+            *items = (ui1 *) rh + MEFREC_EDFA_1_0_OFFSET + MEFREC_EDFA_1_0_BYTES;
+            break;
+        case RECORD_TABLE_LNTP:
+            *items = (ui1 *) rh + MEFREC_LNTP_1_0_TEMPLATE_OFFSET;
+            if (*items > body_end)
+                return 0;
+            n_items = ((MEFREC_LNTP_1_0 *) ((ui1 *) rh + MEFREC_LNTP_1_0_OFFSET))->length;
+            max_items = (si8) (body_end - *items) / (si8) sizeof(si4);
+            return (n_items < 0) ? 0 : ((n_items < max_items) ? n_items : max_items);
+        case RECORD_TABLE_SEIZ:
+            *items = (ui1 *) rh + MEFREC_Seiz_1_0_CHANNELS_OFFSET;
+            if (*items > body_end)
+                return 0;
+            n_items = ((MEFREC_Seiz_1_0 *) ((ui1 *) rh + MEFREC_Seiz_1_0_OFFSET))->number_of_channels;
+            max_items = (si8) (body_end - *items) / MEFREC_Seiz_1_0_CHANNEL_BYTES;
+            return (n_items < 0) ? 0 : ((n_items < max_items) ? n_items : max_items);
+        default:
+            return 0;
+    }
+
+    // text up to the terminating zero
+    if (*items >= body_end)
+        return 0;
+    text_end = (ui1 *) memchr(*items, 0, (size_t) (body_end - *items));
+
+    return (text_end == NULL) ? (si8) (body_end - *items) : (si8) (text_end - *items);
 }
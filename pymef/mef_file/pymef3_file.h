@@ -4,10 +4,263 @@
 
 #include "meflib.h"
 
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <dirent.h>
+#endif
+
+// x86 SIMD kernels are compiled for every build and picked at runtime by CPU detection
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) || (defined(_MSC_VER) && defined(_M_X64))
+    #define PYMEF_X86_SIMD
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
 #define EPSILON 0.0001
 #define FLOAT_EQUAL(x,y) ( ((y - EPSILON) < x) && (x <( y + EPSILON)) )
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 
+/* Time series reading without the GIL */
+
+#define TS_READ_OK              0
+#define TS_READ_INVALID_OFFSET  -1
+#define TS_READ_MEMORY_ERROR    -2
+
+// Result of read_ts_data_c - warnings are raised by the caller once it holds the GIL again
+typedef struct {
+    si4     error;
+    si4     short_read_segment;  // -1 if all bytes were read
+    si4     crc_block_failure;
+    ui8     blocks_skipped;
+    si4     start_segment;
+    si4     end_segment;
+} TS_READ_STATUS;
+
+// One channel of a multi-channel read, decoded into a row of the output array
+typedef struct {
+    CHANNEL         *channel;
+    si8             start;
+    si8             end;
+    ui4             num_samps;      // samples decoded from the channel
+    sf8             *row;           // output row
+    si8             row_len;
+    si8             row_offset;     // where the decoded samples go in the row
+    sf8             scale;          // units conversion fused into the copy to the row
+    TS_READ_STATUS  status;
+} TS_READ_JOB;
+
+// Worker of the internal thread pool - processes jobs first_job, first_job + job_step, ...
+typedef struct {
+    TS_READ_JOB     *jobs;
+    si4             n_jobs;
+    si4             times_specified;
+    si4             keep_files_open;
+    si4             use_mmap;
+    si4             first_job;
+    si4             job_step;
+} TS_READ_WORKER;
+
+// Parallel RED encoding - worker encodes blocks first_block, first_block + block_step, ... of a batch
+// into slots of slot_bytes in blocks and fills their index entries except offsets and start samples
+#define RED_ENCODE_BATCH_BLOCKS     16
+#define TS_WRITER_COPY_BLOCKS       1024    // blocks read at once when copying encoded blocks
+
+/* Results of ts_writer_copy_blocks_c */
+
+#define TS_COPY_OK              0
+#define TS_COPY_KEY_MISMATCH    1   // nothing copied, the blocks have to be decoded
+#define TS_COPY_OFFSET_MISMATCH 2   // nothing copied, the blocks have to be decoded
+#define TS_COPY_INVALID_RANGE   -1
+#define TS_COPY_MEMORY_ERROR    -2
+#define TS_COPY_READ_ERROR      -3
+#define TS_COPY_OVERLAP         -4
+
+// Lossy RED compression settings (lossy_flag) - the defaults are the goals used before they were configurable
+#define RED_LOSSY_DEFAULT_MEAN_RESIDUAL_RATIO   0.10
+#define RED_LOSSY_DEFAULT_COMPRESSION_RATIO     0.05
+#define RED_LOSSY_DEFAULT_TOLERANCE             0.01
+
+typedef struct {
+    si4             mode;           // RED_MEAN_RESIDUAL_RATIO or RED_COMPRESSION_RATIO
+    sf8             goal_mean_residual_ratio;
+    sf8             goal_compression_ratio;
+    sf8             goal_tolerance;
+    si4             detrend_data;
+    si4             require_normality;
+} RED_LOSSY_PARAMS;
+
+// Adaptive block sizing - the signal statistics are compared in windows, a block is closed if the estimated
+// bytes per sample of a window differ ADAPTIVE_BLOCK_STAT_RATIO times from the block, blocks are at least
+// 1 / ADAPTIVE_MIN_BLOCK_FRACTION of samples_per_mef_block long
+#define ADAPTIVE_BLOCK_WINDOW           256
+#define ADAPTIVE_BLOCK_STAT_RATIO       4
+#define ADAPTIVE_MIN_BLOCK_FRACTION     16
+
+// Written samples are clipped to the si4 range without the values reserved for NaN and infinities
+#define PYMEF_MAX_SAMPLE_VALUE      ((si4) 0x7FFFFFFE)
+#define PYMEF_MIN_SAMPLE_VALUE      ((si4) -0x7FFFFFFE)
+
+typedef struct {
+    RED_PROCESSING_STRUCT   *rps;
+    si4             *data;          // samples of the first block of the batch
+    ui1             *src;           // if not NULL - samples of another type / stride converted block by block
+    si8             src_stride;
+    si4             src_type;
+    sf8             scale;
+    si4             *conv_buffer;
+    si8             n_clipped;
+    sf8             *residual_ratios;   // if not NULL - achieved mean residual ratio of each block of the batch
+    si8             *block_starts;      // if not NULL - adaptive blocks, sample of each block of the batch and the end,
+    sf8             sampling_frequency; //     start_time is the time of sample 0
+    ui1             *blocks;
+    si8             slot_bytes;
+    TIME_SERIES_INDEX   *tsi;       // index entries of the batch
+    si8             n_blocks;
+    si8             n_samples;      // samples from the first block of the batch to the end of data
+    ui4             block_samps;
+    si8             start_time;
+    si8             time_inc;
+    si4             discontinuity;  // first block of the batch starts a contiguous range
+    si4             first_block;
+    si4             block_step;
+} RED_ENCODE_WORKER;
+
+typedef void (*PARALLEL_WORKER_FUNCTION)(void *arg);
+
+// Thread entry points carry the worker function and its argument
+typedef struct {
+    PARALLEL_WORKER_FUNCTION    worker;
+    void                        *arg;
+} PARALLEL_TASK;
+
+/* Concurrent metadata prefetch */
+
+#define PREFETCH_BUFFER_BYTES       1048576
+
+// Metadata, indices and record files are read by several threads before meflib reads the session
+// sequentially, so that their open and read latencies overlap and meflib is served from the page cache.
+// Only the I/O is concurrent - meflib decrypts, validates and assembles the session in one thread.
+typedef struct {
+    si1     **paths;
+    si8     n_paths;
+    si8     first;
+    si8     step;
+    si8     n_read;         // files read by the worker
+} PREFETCH_WORKER;
+
+/* Password verification */
+
+// Universal headers of a list of files read concurrently, the password is then checked once per distinct pair
+// of validation fields
+typedef struct {
+    si1     **paths;
+    si8     n_paths;
+    si8     first;
+    si8     step;
+    UNIVERSAL_HEADER    *uhs;
+    ui1     *read_ok;       // set for the headers read completely
+} HEADER_READ_WORKER;
+
+/* Columnar record table */
+
+#define RECORD_TABLE_N_TYPES            9
+#define RECORD_TABLE_ROW_HEADER_BYTES   16      // time, type_string, version_major, version_minor, encryption
+
+#define RECORD_TABLE_NOTE       0
+#define RECORD_TABLE_EDFA       1
+#define RECORD_TABLE_LNTP       2
+#define RECORD_TABLE_SEIZ       3
+#define RECORD_TABLE_CSTI       4
+#define RECORD_TABLE_ESTI       5
+#define RECORD_TABLE_SYLG       6
+#define RECORD_TABLE_CURS       7
+#define RECORD_TABLE_EPOC       8
+
+// Records of one type - one row per record, the variable length parts (text bytes, template samples or
+// seizure channels) of all records are concatenated into one buffer and referenced by offsets from the rows
+typedef struct {
+    si8     n_records;
+    si8     n_items;
+    PyObject    *records;       // numpy arrays
+    PyObject    *buffer;
+    ui1     *row;               // next row to fill
+    si8     item_pos;           // next buffer item to fill
+} RECORD_TABLE_TYPE;
+
+/* Streaming time series iterator */
+
+#define TS_ITERATOR_BUFFER_BYTES    1048576
+
+// Python object decoding a channel block by block with constant memory
+typedef struct {
+    PyObject_HEAD
+    PyObject    *py_channel_obj;        // keeps the channel metadata alive
+    CHANNEL     *channel;
+    si8         chunk_samples;          // 0 - block aligned chunks
+    si8         samples_remaining;
+    si4         segment_idx;            // next block to decode
+    si8         block_idx;
+    FILE        *fp;                    // data file of buffer_segment
+    ui1         *compressed_buffer;     // bounded buffer of consecutive blocks
+    si8         buffer_capacity;
+    si4         buffer_segment;
+    si8         buffer_file_offset;
+    si8         buffer_data_bytes;
+    RED_PROCESSING_STRUCT   *rps;
+    si4         *decomp_buffer;         // last decoded block
+    ui4         max_samps;
+    ui4         decomp_len;
+    ui4         decomp_pos;
+    si8         crc_failures;
+} TS_DATA_ITERATOR;
+
+// Python object writing one time series segment incrementally - samples are buffered into full blocks,
+// blocks and their index entries are appended as they fill up, headers and metadata are rewritten on flush
+typedef struct {
+    PyObject_HEAD
+    PASSWORD_DATA   password_data;          // own copy, meflib keeps the processed password in its globals
+    FILE_PROCESSING_STRUCT  *gen_fps;
+    FILE_PROCESSING_STRUCT  *metadata_fps;
+    FILE_PROCESSING_STRUCT  *ts_data_fps;
+    FILE_PROCESSING_STRUCT  *ts_idx_fps;
+    ui1         *metadata_snapshot;         // plain text metadata, restored after write_MEF_file() encrypts them
+    si8         recording_time_offset;
+    RED_ENCODE_WORKER   *workers;
+    si4         n_threads;
+    ui1         *batch_blocks;
+    TIME_SERIES_INDEX   *batch_tsi;
+    si8         max_batch_blocks;
+    si4         *samples;                   // buffered samples not yet encoded
+    sf8         scale;                      // applied to written samples before rounding to int32
+    si8         n_samples;
+    si8         samples_capacity;
+    ui4         block_samps;
+    ui4         max_block_samps;            // copied blocks can be longer than block_samps
+    si8         time_inc;
+    si8         next_block_time;
+    si4         discontinuity;              // next encoded block starts a contiguous range
+    si8         n_discontinuities;
+    si8         contiguous_blocks;          // current contiguous range
+    si8         contiguous_block_bytes;
+    si8         contiguous_samples;
+    si8         end_time;
+    si8         n_blocks;
+    si8         n_written_samples;
+    si8         file_offset;
+    si4         max_samp;
+    si4         min_samp;
+    si8         flush_blocks;               // 0 - flush only on flush() and close()
+    si8         blocks_since_flush;
+} TS_SEGMENT_WRITER;
+
 /* Python methods definitions and help */
 
 static char pymef3_file_docstring[] =
@@ -84,9 +337,27 @@ static char write_mef_ts_data_and_indices_docstring[] =
      samples_per_mef_block: int\n\
         Number of samples in one MEF RED block.\n\
      raw_data: np.array\n\
-        Numpy 1D array with raw data of dtype int32.\n\
+        Numpy 1D array with raw data of integer or float dtype, may be strided. Samples other than int32\n\
+        are converted block by block, rounded and clipped to the int32 range.\n\
      lossy_flag: bool\n\
-        Flag for optional lossy compression (default=False).";
+        Flag for optional lossy compression (default=False).\n\
+     n_threads: int\n\
+        Number of threads encoding the blocks (default=0 - number of CPUs).\n\
+     scale: float\n\
+        Factor the samples are multiplied by before rounding (default=1.0).\n\
+     lossy_params: dict\n\
+        Lossy compression settings used with lossy_flag (default=None - mean residual ratio 0.10, tolerance 0.01,\n\
+        detrending and normality required). Keys: mode ('mean_residual_ratio' or 'compression_ratio'),\n\
+        goal_mean_residual_ratio, goal_compression_ratio, goal_tolerance, detrend_data, require_normality.\n\
+     target_block_bytes: int\n\
+        Adaptive block sizing (default=-1 - fixed blocks of samples_per_mef_block). Blocks of up to samples_per_mef_block\n\
+        samples are closed when their estimated size reaches target_block_bytes (0 - no byte target) or where the\n\
+        signal statistics change. The longest block is recorded as maximum_block_samples.\n\n\
+     Returns\n\
+     -------\n\
+     report: dict\n\
+        bytes_per_sample - achieved compressed bytes per sample, block_compression_ratios - compressed / original\n\
+        bytes of each block, block_mean_residual_ratios - achieved mean residual ratio of each block (lossy only).";
 
 static char write_mef_v_indices_docstring[] =
     "Function to write MEF3 video indices file.\n\n\
@@ -119,15 +390,25 @@ static char append_ts_data_and_indices_docstring[] =
      samples_per_mef_block: int\n\
         Number of samples in one MEF RED block.\n\
      raw_data: np.array\n\
-        Numpy 1D array with raw data of dtype int32.\n\
+        Numpy 1D array with raw data of integer or float dtype, may be strided. Samples are converted\n\
+        block by block, rounded and clipped to the int32 range.\n\
      discontinuity_flag: bool\n\
         Flag to mark discontinuity at the start of appended data (default=True)\n\
      lossy_flag: bool\n\
-        Flag for optional lossy compression (default=False).";
+        Flag for optional lossy compression (default=False).\n\
+     scale: float\n\
+        Factor the samples are multiplied by before rounding (default=1.0).\n\
+     lossy_params: dict\n\
+        Lossy compression settings used with lossy_flag, see write_mef_ts_data_and_indices.\n\n\
+     Returns\n\
+     -------\n\
+     report: dict\n\
+        Compression report of the appended blocks, see write_mef_ts_data_and_indices.";
 
 /* Documentation to be read in Python - read functions*/
 static char read_mef_ts_data_docstring[] =
-    "Function to read MEF3 time series data.\n\n\
+    "Function to read MEF3 time series data. The GIL is released while the data is\n\
+     read and decoded so that several channels can be read from separate threads.\n\n\
      Parameters\n\
      ----------\n\
      channel_specific_metadata: np.ndarray\n\
@@ -137,11 +418,104 @@ static char read_mef_ts_data_docstring[] =
      end: int\n\
         End sample or uUTC time to be read.\n\
      time_flag: bool\n\
-        Flag to indicate if user is reading by samples or uUTC times (default=False - reading by sample)\n\n\
+        Flag to indicate if user is reading by samples or uUTC times (default=False - reading by sample)\n\
+     keep_files_open: bool\n\
+        Keep the data files open in the metadata structure for subsequent reads,\n\
+        they are closed when the metadata are cleaned (default=False)\n\
+     int32_output: bool\n\
+        Decode directly into an int32 array and return the gaps separately (default=False)\n\
+     gap_mask: bool\n\
+        In int32 mode return the gaps as a boolean mask instead of intervals (default=False)\n\
+     out: np.array\n\
+        Writable 1D int32, float32 or float64 array (or a strided view, e.g. a row of a matrix) of the\n\
+        number of samples read. The data are written into it and it is returned (default=None)\n\
+     use_mmap: bool\n\
+        Decode the blocks in place from a memory mapping of the data file instead of reading\n\
+        them into a buffer (POSIX only, spans within one segment) (default=False)\n\
+     scaled: bool\n\
+        Multiply the data by units_conversion_factor, float outputs only (default=False)\n\
+     float32_output: bool\n\
+        Return float32 instead of float64 data (default=False)\n\n\
      Returns\n\
      -------\n\
      data: np.array\n\
-        1D numpy array (dtype=float) with data. If the data is read by uUTC and a gap is present the missing values are filled with NaNs";
+        1D numpy array (dtype=float) with data. If the data is read by uUTC and a gap is present the missing values are filled with NaNs\n\
+     gaps: np.array\n\
+        Only in int32 mode, where samples in gaps hold RED_NAN (-2147483648). Either int64 array [n_gaps, 2]\n\
+        of [start, stop) sample indices into data, or boolean mask of data length (gap_mask=True)";
+
+static char read_mef_ts_data_channels_docstring[] =
+    "Function to read MEF3 time series data of multiple channels in one window.\n\
+     The channels are decoded in parallel into a single preallocated array.\n\n\
+     Parameters\n\
+     ----------\n\
+     channel_specific_metadata_list: list\n\
+        List of channel metadata\n\
+     start: int\n\
+        Start sample or uUTC time to be read.\n\
+     end: int\n\
+        End sample or uUTC time to be read.\n\
+     times_specified: bool\n\
+        Flag to indicate if user is reading by samples or uUTC times (default=False - reading by sample)\n\
+     n_threads: int\n\
+        Number of decoding threads (default=0 - number of CPUs)\n\
+     keep_files_open: bool\n\
+        Keep the data files open in the metadata structure for subsequent reads,\n\
+        they are closed when the metadata are cleaned (default=False)\n\
+     use_mmap: bool\n\
+        Decode from memory mappings of the data files (default=False)\n\
+     scaled: bool\n\
+        Multiply the data of each channel by its units_conversion_factor (default=False)\n\n\
+     Returns\n\
+     -------\n\
+     data: np.array\n\
+        2D numpy array (dtype=float) [channels, samples]. Samples out of the recording, in gaps or beyond\n\
+        the end of channels with lower sampling frequency are filled with NaNs";
+
+static char ts_data_iterator_docstring[] =
+    "Iterator over MEF3 time series data of one channel. Data are decoded block by block\n\
+     so the memory used does not depend on the length of the channel.\n\n\
+     Parameters\n\
+     ----------\n\
+     channel_specific_metadata: np.ndarray\n\
+        Channel metadata\n\
+     chunk_samples: int\n\
+        Number of samples in each chunk, the last chunk can be shorter (default=0 - one chunk per MEF block)\n\
+     start_sample: int\n\
+        First sample to be read (default=None - start of the channel)\n\
+     end_sample: int\n\
+        End sample (exclusive) to be read (default=None - end of the channel)\n\n\
+     Yields\n\
+     ------\n\
+     data: np.array\n\
+        1D numpy array (dtype=float) with data. Samples of corrupted blocks are NaNs";
+
+static char ts_segment_writer_docstring[] =
+    "Incremental writer of one MEF3 time series segment for live acquisition. Chunks of any length are\n\
+     buffered into full blocks, the blocks and their indices are appended to the files as they fill up.\n\
+     The file headers and the metadata are rewritten every flush_blocks blocks, on flush() and on close(),\n\
+     so the cost of a write does not grow with the size of the segment. The time series metadata file\n\
+     of the segment has to be written first. Can be used as a context manager.\n\n\
+     Parameters\n\
+     ----------\n\
+     target_path: str\n\
+        Path to segment being written.\n\
+     password_1: str\n\
+        Level 1 password.\n\
+     password_2: str\n\
+        Level 2 password.\n\
+     samples_per_mef_block: int\n\
+        Number of samples in one MEF RED block.\n\
+     flush_blocks: int\n\
+        Number of blocks between automatic flushes (default=100, 0 - only on flush() and close()).\n\
+     n_threads: int\n\
+        Number of threads encoding the blocks of one write (default=1).\n\
+     scale: float\n\
+        Factor the written samples are multiplied by before rounding to int32 (default=1.0).\n\n\
+     Notes\n\
+     -----\n\
+     write(data, start_time=None) - chunks passed with a start time that is at least one sample period after\n\
+     the end of the previous chunk close the current block early and start a new block flagged as a discontinuity.";
 
 static char read_mef_session_metadata_docstring[] =
     "Function to read MEF3 session metadata.\n\n\
@@ -154,7 +528,12 @@ static char read_mef_session_metadata_docstring[] =
      map_indices_flag: bool\n\
         Flag to enable the mapping of the time-series and video indices (default=True, map indices)\n\
      copy_metadata_to_dict: bool\n\
-        Flag to copy metadata into a python dictionary structure (True), instead of returning the metadata by reference in Numpy structured datatypes (Default=False)\n\n\
+        Flag to copy metadata into a python dictionary structure (True), instead of returning the metadata by reference in Numpy structured datatypes (Default=False)\n\
+     n_threads: int\n\
+        Number of threads reading the metadata, indices and record files concurrently into the page cache before the session is parsed.\n\
+        The files are only prefetched, decryption, validation and assembly of the session stay sequential in meflib (default=0 - no prefetch, not available on Windows)\n\
+     check_password: bool\n\
+        Verify the password on the universal headers of the read files, RuntimeError is raised if it is invalid (default=False)\n\n\
      Returns\n\
      -------\n\
      session_metadata: dict\n\
@@ -171,7 +550,9 @@ static char read_mef_channel_metadata_docstring[] =
      map_indices_flag: bool\n\
         Flag to enable the mapping of the time-series and video indices (default=True, map indices)\n\
      copy_metadata_to_dict: bool\n\
-        Flag to copy metadata into a python dictionary structure (True), instead of returning the metadata by reference in Numpy structured datatypes (Default=False)\n\n\
+        Flag to copy metadata into a python dictionary structure (True), instead of returning the metadata by reference in Numpy structured datatypes (Default=False)\n\
+     check_password: bool\n\
+        Verify the password on the universal headers of the read files, RuntimeError is raised if it is invalid (default=False)\n\n\
      Returns\n\
      -------\n\
      channel_metadata: dict\n\
@@ -209,6 +590,58 @@ static char check_mef_password_docstring[] =
         - 0 - incorrect password\n\
         - 1 - level 1 password\n\
         - 2 - level 2 password\n";
+static char check_mef_passwords_docstring[] =
+    "Function to check MEF3 password validity on many files. The universal headers are read\n\
+     concurrently and the password is checked once per distinct pair of validation fields.\n\n\
+     Parameters\n\
+     ----------\n\
+     file_paths: list\n\
+        Paths to MEF3 files.\n\
+     password: str\n\
+        Level 1 or level 2 password.\n\
+     n_threads: int\n\
+        Number of threads reading the universal headers (default=0 - sequential)\n\
+     Returns\n\
+     -------\n\
+     password_type: int\n\
+        - -1 - incorrect password for any of the files\n\
+        - 0 - data not encrypted\n\
+        - 1 - level 1 password\n\
+        - 2 - level 2 password\n";
+static char read_mef_channel_toc_docstring[] =
+    "Function to build the table of contents of a whole MEF3 time series channel.\n\n\
+     Parameters\n\
+     ----------\n\
+     channel_specific_metadata: np.array\n\
+        Numpy array of channel dtype (channel_specific_metadata of read channel).\n\
+     ranges_only: bool\n\
+        Return only the contiguous ranges of the channel (default=False).\n\n\
+     Returns\n\
+     -------\n\
+     toc: np.array\n\
+        Array [4, number of blocks] with discontinuity flags, numbers of block samples, start samples\n\
+        and start uUTC times of the blocks of all segments (the first block of every segment is flagged),\n\
+        or with ranges_only array [3, number of ranges] with start uUTC times, end uUTC times and numbers\n\
+        of samples of the contiguous ranges, segments without a gap between them form one range.";
+
+static char read_mef_record_table_docstring[] =
+    "Function to read MEF3 records into columnar tables grouped by record type.\n\n\
+     Parameters\n\
+     ----------\n\
+     target_path: str\n\
+        Path to MEF3 record data file (.rdat).\n\
+     password: str\n\
+        Level 1 or level 2 password.\n\n\
+     Returns\n\
+     -------\n\
+     record_table: dict\n\
+        Dictionary keyed by record type string. Each entry is a dictionary with 'records' - numpy structured\n\
+        array with time, type_string, version_major, version_minor, encryption and body fields, one row per\n\
+        record. Variable length parts are held in one buffer per type referenced from the body:\n\
+        - Note, SyLg, EDFA - 'text' uint8 buffer, body text_offset and text_length in bytes\n\
+        - LNTP - 'template' int32 buffer, body template_offset and length in samples\n\
+        - Seiz - 'channels' seizure channel array, body channel_offset and number_of_channels\n\
+        Unrecognized record types are skipped with a RuntimeWarning.";
 
 /* Pyhon object declaration - write functions*/
 static PyObject *write_mef_data_records(PyObject *self, PyObject *args);
@@ -221,10 +654,29 @@ static PyObject *write_mef_v_indices(PyObject *self, PyObject *args);
 static PyObject *append_ts_data_and_indices(PyObject *self, PyObject *args);
 
 /* Pyhon object declaration - read functions*/
-static PyObject *read_mef_ts_data(PyObject *self, PyObject *args);
+static PyObject *read_mef_ts_data(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *read_mef_ts_data_channels(PyObject *self, PyObject *args, PyObject *kwargs);
 static PyObject *read_mef_session_metadata(PyObject *self, PyObject *args, PyObject* kwargs);
 static PyObject *read_mef_channel_metadata(PyObject *self, PyObject *args, PyObject* kwargs);
 static PyObject *read_mef_segment_metadata(PyObject *self, PyObject *args, PyObject* kwargs);
+static PyObject *read_mef_channel_toc(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *read_mef_record_table(PyObject *self, PyObject *args, PyObject *kwargs);
+
+/* Pyhon object declaration - streaming iterator */
+static int ts_data_iterator_init(TS_DATA_ITERATOR *self, PyObject *args, PyObject *kwargs);
+static void ts_data_iterator_dealloc(TS_DATA_ITERATOR *self);
+static PyObject *ts_data_iterator_next(TS_DATA_ITERATOR *self);
+static PyObject *ts_data_iterator_close(TS_DATA_ITERATOR *self, PyObject *unused);
+
+/* Pyhon object declaration - incremental segment writer */
+static int ts_segment_writer_init(TS_SEGMENT_WRITER *self, PyObject *args, PyObject *kwargs);
+static void ts_segment_writer_dealloc(TS_SEGMENT_WRITER *self);
+static PyObject *ts_segment_writer_write(TS_SEGMENT_WRITER *self, PyObject *args);
+static PyObject *ts_segment_writer_copy_blocks(TS_SEGMENT_WRITER *self, PyObject *args);
+static PyObject *ts_segment_writer_flush(TS_SEGMENT_WRITER *self, PyObject *unused);
+static PyObject *ts_segment_writer_close(TS_SEGMENT_WRITER *self, PyObject *unused);
+static PyObject *ts_segment_writer_enter(TS_SEGMENT_WRITER *self, PyObject *unused);
+static PyObject *ts_segment_writer_exit(TS_SEGMENT_WRITER *self, PyObject *args);
 
 /* Pyhon object declaration - clean functions*/
 static PyObject *clean_mef_session_metadata(PyObject *self, PyObject *args);
@@ -233,6 +685,7 @@ static PyObject *clean_mef_segment_metadata(PyObject *self, PyObject *args);
 
 /* Python object declaration - helper functions */
 static PyObject *check_mef_password(PyObject *self, PyObject *args);
+static PyObject *check_mef_passwords(PyObject *self, PyObject *args, PyObject* kwargs);
 
 /* Python object declaration - numpy data types */
 static PyObject *create_rh_dtype();
@@ -251,6 +704,7 @@ static PyObject *create_csti_dtype();
 static PyObject *create_esti_dtype();
 static PyObject *create_curs_dtype();
 static PyObject *create_epoc_dtype();
+static PyObject *create_record_table_dtype_c(si4 type_idx);
 
 static PyObject *create_uh_dtype();
 static PyObject *create_md1_dtype();
@@ -273,14 +727,18 @@ static PyMethodDef module_methods[] = {
     {"write_mef_ts_data_and_indices", write_mef_ts_data_and_indices, METH_VARARGS, write_mef_ts_data_and_indices_docstring},
     {"write_mef_v_indices", write_mef_v_indices, METH_VARARGS, write_mef_v_indices_docstring},
     {"append_ts_data_and_indices", append_ts_data_and_indices, METH_VARARGS, append_ts_data_and_indices_docstring},
-    {"read_mef_ts_data", read_mef_ts_data, METH_VARARGS, read_mef_ts_data_docstring},
+    {"read_mef_ts_data", (PyCFunction)read_mef_ts_data, METH_VARARGS | METH_KEYWORDS, read_mef_ts_data_docstring},
+    {"read_mef_ts_data_channels", (PyCFunction)read_mef_ts_data_channels, METH_VARARGS | METH_KEYWORDS, read_mef_ts_data_channels_docstring},
     {"read_mef_session_metadata", (PyCFunction)read_mef_session_metadata, METH_VARARGS | METH_KEYWORDS, read_mef_session_metadata_docstring},
     {"read_mef_channel_metadata", (PyCFunction)read_mef_channel_metadata, METH_VARARGS | METH_KEYWORDS, read_mef_channel_metadata_docstring},
     {"read_mef_segment_metadata", (PyCFunction)read_mef_segment_metadata, METH_VARARGS | METH_KEYWORDS, read_mef_segment_metadata_docstring},
+    {"read_mef_channel_toc", (PyCFunction)read_mef_channel_toc, METH_VARARGS | METH_KEYWORDS, read_mef_channel_toc_docstring},
+    {"read_mef_record_table", (PyCFunction)read_mef_record_table, METH_VARARGS | METH_KEYWORDS, read_mef_record_table_docstring},
     {"clean_mef_session_metadata", clean_mef_session_metadata, METH_VARARGS, NULL},
     {"clean_mef_channel_metadata", clean_mef_channel_metadata, METH_VARARGS, NULL},
     {"clean_mef_segment_metadata", clean_mef_segment_metadata, METH_VARARGS, NULL},
     {"check_mef_password", check_mef_password, METH_VARARGS, check_mef_password_docstring},
+    {"check_mef_passwords", (PyCFunction)check_mef_passwords, METH_VARARGS | METH_KEYWORDS, check_mef_passwords_docstring},
 
     // New numpy stuff
     {"create_rh_dtype", create_rh_dtype, METH_VARARGS, NULL},
@@ -312,6 +770,50 @@ static PyMethodDef module_methods[] = {
     {NULL, NULL, 0, NULL}
 };
 
+/* Streaming iterator type */
+static PyMethodDef ts_data_iterator_methods[] = {
+    {"close", (PyCFunction)ts_data_iterator_close, METH_NOARGS, "Close the data file and free the decoding buffers."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject ts_data_iterator_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pymef.mef_file.pymef3_file.TsDataIterator",
+    .tp_doc = ts_data_iterator_docstring,
+    .tp_basicsize = sizeof(TS_DATA_ITERATOR),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) ts_data_iterator_init,
+    .tp_dealloc = (destructor) ts_data_iterator_dealloc,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) ts_data_iterator_next,
+    .tp_methods = ts_data_iterator_methods,
+};
+
+static PyMethodDef ts_segment_writer_methods[] = {
+    {"write", (PyCFunction)ts_segment_writer_write, METH_VARARGS, "Append a chunk of samples (1D integer or float numpy array, clipped to the int32 range). The optional start_time (uUTC) of the chunk starts a new contiguous range if it does not follow the previous chunk."},
+    {"copy_blocks", (PyCFunction)ts_segment_writer_copy_blocks, METH_VARARGS, "Append encoded blocks of a read channel (channel metadata, first channel block, number of blocks) without decoding them. Returns False and copies nothing if the encrypted blocks can not be copied with the writer's passwords or the channel's recording time offset differs from the writer's."},
+    {"flush", (PyCFunction)ts_segment_writer_flush, METH_NOARGS, "Rewrite the file headers and the metadata file."},
+    {"close", (PyCFunction)ts_segment_writer_close, METH_NOARGS, "Write the buffered samples as the last block, flush and close the files."},
+    {"__enter__", (PyCFunction)ts_segment_writer_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)ts_segment_writer_exit, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject ts_segment_writer_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pymef.mef_file.pymef3_file.TsSegmentWriter",
+    .tp_doc = ts_segment_writer_docstring,
+    .tp_basicsize = sizeof(TS_SEGMENT_WRITER),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) ts_segment_writer_init,
+    .tp_dealloc = (destructor) ts_segment_writer_dealloc,
+    .tp_methods = ts_segment_writer_methods,
+};
+
 /* Definition of struct for python 3 */
 static struct PyModuleDef moduledef = {
     PyModuleDef_HEAD_INIT,
@@ -325,17 +827,6 @@ static struct PyModuleDef moduledef = {
     NULL,                /* m_free */
 };
 
-/* Module initialisation */
-PyObject * PyInit_pymef3_file(void)
-{
-    PyObject *m = PyModule_Create(&moduledef);
-
-    if (m == NULL)
-        return NULL;
-
-    return m;
-}
-
 /* Function declarations */
 
 // ---------- Python dictionaries to mef3 -----------
@@ -377,6 +868,10 @@ PyObject *map_mef3_md3(METADATA_SECTION_3 *md3, si1 copy_metadata_to_dict);
 PyObject *map_mef3_ti(TIME_SERIES_INDEX *ti, si8 number_of_entries, si1 copy_metadata_to_dict);
 PyObject *map_mef3_vi(VIDEO_INDEX *vi, si8 number_of_entries, si1 copy_metadata_to_dict);
 PyObject *create_mef3_TOC(SEGMENT *segment);
+void fill_segment_toc_c(SEGMENT *segment, si8 *toc, si8 n_columns);
+si8 toc_discontinuity_c(si8 prev_time, si8 prev_sample, si8 start_time, si8 start_sample, sf8 fs);
+si8 toc_range_start_c(si8 *toc, si8 n_blocks, sf8 fs, si8 i);
+si8 toc_ranges_c(si8 *toc, si8 n_blocks, sf8 fs, si8 *ranges, si8 n_columns);
 
 PyObject *map_mef3_segment(SEGMENT *segment, si1 map_indices_flag, si1 copy_metadata_to_dict);
 PyObject *map_mef3_channel(CHANNEL *channel, si1 map_indices_flag, si1 copy_metadata_to_dict);
@@ -402,7 +897,94 @@ PyObject *map_mef3_Epoc_type(RECORD_HEADER *rh, si1 copy_metadata_to_dict);
 // Helper functions
 si4 check_block_crc(ui1* block_hdr_ptr, ui4 max_samps, ui1* total_data_ptr, ui8 total_data_bytes);
 si4 extract_segment_number(si1 *segment_name);
+si8 block_key_c(SEGMENT *segment, si8 block, si4 by_sample, si8 recording_time_offset);
+si8 find_block_c(SEGMENT *segment, si8 value, si4 by_sample, si8 recording_time_offset);
+si4 find_channel_block_c(CHANNEL *channel, si8 value, si4 by_sample, si8 recording_time_offset, si4 *segment_idx, si8 *block_idx);
 si8 sample_for_uutc_c(si8 uutc, CHANNEL *channel);
 si8 uutc_for_sample_c(si8 sample, CHANNEL *channel);
+void remove_recording_time_offset_c(si8 *time, si8 recording_time_offset);
+si4 read_ts_data_c(CHANNEL *channel, si8 start, si8 end, si4 times_specified, si4 keep_files_open, si4 use_mmap, si4 *decomp_data, ui4 num_samps, TS_READ_STATUS *status);
+ui8 read_fps_bytes_c(FILE_PROCESSING_STRUCT *fps, si8 file_offset, ui8 n_bytes, ui1 *buffer, si4 keep_file_open);
+ui1 *map_fps_bytes_c(FILE_PROCESSING_STRUCT *fps, si8 file_offset, ui8 *n_bytes, void **map_base, ui8 *map_bytes);
+void unmap_fps_bytes_c(void *map_base, ui8 map_bytes);
+si4 ts_iterator_load_block_c(TS_DATA_ITERATOR *it);
+si8 ts_iterator_fill_c(TS_DATA_ITERATOR *it, sf8 *out, si8 n_out);
+void ts_iterator_free_c(TS_DATA_ITERATOR *it);
+si8 ts_writer_encode_c(TS_SEGMENT_WRITER *w, si4 encode_partial);
+void ts_writer_append_block_c(TS_SEGMENT_WRITER *w, RED_BLOCK_HEADER *block_header, TIME_SERIES_INDEX *tsi);
+si4 ts_writer_copy_blocks_c(TS_SEGMENT_WRITER *w, CHANNEL *channel, si8 first_block, si8 n_blocks);
+void ts_writer_flush_c(TS_SEGMENT_WRITER *w);
+void ts_writer_free_c(TS_SEGMENT_WRITER *w);
+si4 parse_lossy_params_c(PyObject *py_params, RED_LOSSY_PARAMS *params);
+RED_PROCESSING_STRUCT *allocate_encoder_rps_c(si8 samps_per_mef_block, RED_LOSSY_PARAMS *lossy, PASSWORD_DATA *pwd);
+void free_encoder_rps_c(RED_PROCESSING_STRUCT *rps);
+void encode_blocks_worker_c(void *arg);
+void read_ts_worker_c(void *arg);
+si4 get_cpu_count_c(void);
+void run_parallel_c(PARALLEL_WORKER_FUNCTION worker, void *args, size_t arg_bytes, si4 n_threads);
+void lock_mef_globals_c(si8 recording_time_offset, si4 exclusive);
+void unlock_mef_globals_c(void);
+void suppress_mef_errors_c(void);
+void restore_mef_errors_c(void);
+si8 list_metadata_files_c(si1 *dir_path, si4 depth, si1 ***paths, si8 *n_paths, si8 *capacity);
+void prefetch_worker_c(void *arg);
+si8 prefetch_session_files_c(si1 *session_path, si4 n_threads);
+si4 validate_password_c(UNIVERSAL_HEADER *uh, si1 *password);
+si4 validate_headers_password_c(UNIVERSAL_HEADER **uhs, si8 n_uhs, si1 *password);
+si8 add_fps_header_c(FILE_PROCESSING_STRUCT *fps, UNIVERSAL_HEADER **uhs, si8 n_uhs);
+si8 collect_channel_headers_c(CHANNEL *channel, UNIVERSAL_HEADER **uhs, si8 n_uhs);
+si4 check_channel_password_c(CHANNEL *channel, si1 *password);
+si4 check_session_password_c(SESSION *session, si1 *password);
+void header_read_worker_c(void *arg);
+si4 record_table_type_index_c(ui4 type_code);
+si8 record_table_items_c(RECORD_HEADER *rh, si4 type_idx, ui1 **items);
+void init_simd_kernels_c(void);
+si4 copy_block_samples_c(si4 *dst, ui4 num_samps, si4 offset, si4 *src, ui4 n);
+void convert_ts_data_c(si4 *src, ui8 n, ui1 *dst, si8 dst_stride, si4 dst_type, sf8 scale);
+si4 writer_sample_type_c(PyObject *raw_data);
+si8 convert_to_si4_c(ui1 *src, si8 src_stride, si4 src_type, sf8 scale, si4 *dst, si8 n);
+si8 plan_adaptive_blocks_c(ui1 *src, si8 src_stride, si4 src_type, sf8 scale, si8 n_samples, si8 target_block_bytes, si8 min_block_samps, si8 max_block_samps, si8 *block_starts);
+si8 count_gaps_c(si4 *data, si8 n);
+void fill_gap_intervals_c(si4 *data, si8 n, si8 *intervals);
+void fill_gap_mask_c(si4 *data, si8 n, ui1 *mask);
 void memset_int(si4 *ptr, si4 value, size_t num);
 void init_numpy(void);
+
+
+/* Module initialisation */
+PyObject * PyInit_pymef3_file(void)
+{
+    PyObject *m;
+
+    if (PyType_Ready(&ts_data_iterator_type) < 0)
+        return NULL;
+    if (PyType_Ready(&ts_segment_writer_type) < 0)
+        return NULL;
+
+    m = PyModule_Create(&moduledef);
+    if (m == NULL)
+        return NULL;
+
+    Py_INCREF(&ts_data_iterator_type);
+    if (PyModule_AddObject(m, "TsDataIterator", (PyObject *) &ts_data_iterator_type) < 0) {
+        Py_DECREF(&ts_data_iterator_type);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&ts_segment_writer_type);
+    if (PyModule_AddObject(m, "TsSegmentWriter", (PyObject *) &ts_segment_writer_type) < 0) {
+        Py_DECREF(&ts_segment_writer_type);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    // meflib globals are set up once and kept for the lifetime of the module,
+    // time series reads and writers holding them (lock_mef_globals_c) run
+    // without the GIL and must not see them freed or re-initialized
+    (void) initialize_meflib();
+
+    init_simd_kernels_c();
+
+    return m;
+}
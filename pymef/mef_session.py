@@ -10,17 +10,27 @@
 import os
 import struct
 import shutil
+import threading
 import warnings
-from multiprocessing import Pool
+from collections.abc import Mapping
+from concurrent.futures import ThreadPoolExecutor, as_completed
 from pathlib import Path
 
 # Third party imports
 import numpy as np
 
 # Local imports
+from pymef.mef_cache import MefMetadataCache
 from pymef.mef_file.pymef3_file import (read_mef_session_metadata,
+                                        read_mef_channel_metadata,
                                         read_mef_ts_data,
+                                        read_mef_ts_data_channels,
+                                        read_mef_channel_toc,
+                                        read_mef_record_table,
+                                        TsDataIterator,
+                                        TsSegmentWriter,
                                         clean_mef_session_metadata,
+                                        clean_mef_channel_metadata,
                                         write_mef_ts_metadata,
                                         write_mef_v_metadata,
                                         write_mef_ts_data_and_indices,
@@ -41,7 +51,8 @@ from pymef.mef_file.pymef3_file import (read_mef_session_metadata,
                                         create_tmd2_dtype,
                                         create_vmd2_dtype,
                                         create_md3_dtype,
-                                        check_mef_password)
+                                        check_mef_password,
+                                        check_mef_passwords)
 from pymef.mef_constants import (
             METADATA_RECORDING_DURATION_NO_ENTRY,
             TIME_SERIES_METADATA_ACQUISITION_CHANNEL_NUMBER_NO_ENTRY,
@@ -83,6 +94,118 @@ MEF_FILE_EXTENSIONS = ['mefd', 'segd',
                        'timd', 'tmet', 'tdat', 'tidx']
 
 
+class _LazyChannels(Mapping):
+    """
+    Channel dictionary of a lazily read session. The channels are listed
+    from the session directory, the metadata of a channel with its segment
+    indices and records are read the first time the channel is accessed.
+    """
+
+    def __init__(self, channel_paths, password):
+        self._paths = channel_paths
+        self._password = password
+        self._channels = {}
+        self._own = set()
+        self._lock = threading.Lock()
+
+    def __getitem__(self, channel):
+        if channel not in self._channels:
+            path = self._paths[channel]
+            with self._lock:
+                if channel not in self._channels:
+                    self._channels[channel] = read_mef_channel_metadata(
+                        path, self._password)
+                    self._own.add(channel)
+        return self._channels[channel]
+
+    def __iter__(self):
+        return iter(self._paths)
+
+    def __len__(self):
+        return len(self._paths)
+
+    def is_loaded(self, channel):
+        return channel in self._channels
+
+    def fill(self, channels):
+        """
+        Takes over the channels of a fully read session that were not
+        read yet.
+        """
+        with self._lock:
+            for channel, channel_md in channels.items():
+                if channel not in self._channels:
+                    self._channels[channel] = channel_md
+
+    def clean(self):
+        """
+        Frees the channels read by the dictionary itself, channels taken
+        over from the session are freed with the session.
+        """
+        with self._lock:
+            for channel in self._own:
+                clean_mef_channel_metadata(
+                    self._channels[channel]['channel_specific_metadata'])
+            self._channels = {}
+            self._own = set()
+
+
+class _LazySessionMetadata(dict):
+    """
+    Session metadata dictionary of a lazily read session. Holds the lazy
+    channel dictionaries, the session level metadata and records (whose
+    session aggregates need all channels) are read with the whole session
+    on first access.
+    """
+
+    SESSION_KEYS = ['session_specific_metadata', 'time_series_metadata',
+                    'video_metadata', 'records_info']
+
+    def __init__(self, session_path, password, process_n=None):
+        super().__init__()
+        self._path = session_path
+        self._password = password
+        self._process_n = process_n
+        self._session_md = None
+
+        ts_paths = {}
+        v_paths = {}
+        for name in sorted(os.listdir(session_path)):
+            if name.endswith('.timd'):
+                ts_paths[name[:-5]] = session_path + name
+            elif name.endswith('.vidd'):
+                v_paths[name[:-5]] = session_path + name
+
+        if len(ts_paths):
+            self['time_series_channels'] = _LazyChannels(ts_paths, password)
+        if len(v_paths):
+            self['video_channels'] = _LazyChannels(v_paths, password)
+
+    def __missing__(self, key):
+        if key not in self.SESSION_KEYS or self._session_md is not None:
+            raise KeyError(key)
+
+        self._session_md = read_mef_session_metadata(
+            self._path, self._password, n_threads=self._process_n or 0)
+        for name, value in self._session_md.items():
+            if name in ('time_series_channels', 'video_channels'):
+                if name in self:
+                    self[name].fill(value)
+            else:
+                self[name] = value
+
+        return self[key]
+
+    def clean(self):
+        for name in ('time_series_channels', 'video_channels'):
+            if name in self:
+                self[name].clean()
+        if self._session_md is not None:
+            clean_mef_session_metadata(
+                self._session_md['session_specific_metadata'])
+            self._session_md = None
+
+
 class MefSession():
     """
     Basic object for operations with mef sessions.
@@ -98,11 +221,39 @@ class MefSession():
     new_session: bool
         whether this is a new session for writing (default=False)
     check_all_passwords: bool
-        check all files or just the first one encoutered(default=True)
+        check all files or just the first one encoutered(default=None -
+        all files unless lazy). A full metadata read checks the headers of
+        the files it reads, the session files are not opened just for the
+        check
+    use_mmap: bool
+        decode time series data from memory mapped data files instead of
+        reading them into buffers (default=False)
+    lazy: bool
+        list the channels only and read the metadata, indices and records
+        of a channel when it is first accessed in session_md, the session
+        level metadata are read (with all channels) on first access
+        (default=False)
+    process_n: int
+        number of threads reading the metadata, indices and record files
+        concurrently before the session metadata are parsed, and the
+        universal headers for the password check. Only the file reads
+        run concurrently, meflib still decrypts, validates and assembles
+        the session sequentially. This hides the file latencies of network
+        filesystems but does not speed up a session that is already in
+        the page cache. The prefetch is not available on Windows
+        (default=None - sequential)
+    cache: bool or str
+        keep the channel TOCs and basic channel info in a memory mapped
+        sidecar cache (True - hidden directory in the session, str - cache
+        directory). A valid cache opens the session lazily, an invalid one
+        or one written with a password of the other access level is
+        rebuilt from the session metadata. The cached section 2 fields are
+        stored unencrypted, section 3 is never cached (default=False)
     """
 
     def __init__(self, session_path, password, read_metadata=True,
-                 new_session=False, check_all_passwords=True):
+                 new_session=False, check_all_passwords=None,
+                 use_mmap=False, lazy=False, process_n=None, cache=False):
 
         if not session_path.endswith('/'):
             session_path += '/'
@@ -112,6 +263,19 @@ class MefSession():
 
         self.path = session_path
         self.password = password
+        self.use_mmap = use_mmap
+        self.lazy = lazy
+        self.process_n = process_n
+
+        # Persistent reading engine, created on first parallel read
+        self._read_engine = None
+        self._read_engine_n = None
+
+        # Sidecar metadata cache
+        self._cache = None
+
+        # Password checked by the metadata reads
+        self._check_all_passwords = False
 
         if new_session:
             os.makedirs(session_path)
@@ -124,11 +288,26 @@ class MefSession():
         # Check if path exists
         if not os.path.exists(session_path):
             raise FileNotFoundError(session_path+' does not exist!')
-        self._check_password(check_all_passwords)
+        if cache:
+            # the cache is kept per access level of the password
+            access_level = self._check_password(False)
+            self._cache = MefMetadataCache(
+                session_path, cache if isinstance(cache, str) else None,
+                access_level)
+            # the cached metadata stand in for the channels until they
+            # are read for data
+            if self._cache.load():
+                self.lazy = True
+
+        if check_all_passwords is None:
+            check_all_passwords = not self.lazy
+        self._check_all_passwords = check_all_passwords
+        if not read_metadata or self.lazy or not check_all_passwords:
+            self._check_password(check_all_passwords)
 
         if read_metadata:
-            self.session_md = read_mef_session_metadata(session_path,
-                                                        password)
+            self.session_md = self._read_session_metadata()
+            self._update_cache()
         else:
             self.session_md = None
 
@@ -162,7 +341,9 @@ class MefSession():
     # ----- Helper functions -----
     def _check_password(self, check_all=True):
         """
-        Checks provided password on all files in the session.
+        Checks provided password on all files in the session. The password
+        is verified once per distinct validation field of the files, whose
+        headers are read with process_n threads.
 
         Parameters
         ----------
@@ -172,8 +353,8 @@ class MefSession():
 
         Returns
         -------
-        result: object
-            None on success
+        result: int
+            Access level of the password (1 or 2)
         """
         mef_files = []
         for path, subdirs, files in os.walk(self.path):
@@ -181,16 +362,18 @@ class MefSession():
                 if any([name.endswith(ext) for ext in MEF_FILE_EXTENSIONS]):
                     mef_files.append(os.path.join(path, name))
 
-        results = np.zeros(len(mef_files))
-        for i, mef_file in enumerate(mef_files):
-            results[i] = check_mef_password(mef_file, self.password)
-            if not check_all:
-                break
+        if check_all:
+            result = check_mef_passwords(mef_files, self.password,
+                                         n_threads=self.process_n or 0)
+        elif len(mef_files):
+            result = check_mef_password(mef_files[0], self.password)
+        else:
+            result = 0
 
-        if np.any(results < 0):
+        if result < 0:
             raise RuntimeError('MEF password is invalid')
 
-        return
+        return result
 
     def _get_channel_md(self, channel):
         """
@@ -210,13 +393,73 @@ class MefSession():
     def _arg_merger(self, args):
         return read_mef_ts_data(*args)
 
+    def _fill_missing(self, out_row):
+        """
+        Fills the output of a read entirely out of the recording, int32
+        outputs cannot hold NaNs and get RED_NAN as the decoder does.
+        """
+        if np.issubdtype(out_row.dtype, np.integer):
+            out_row[:] = np.iinfo(np.int32).min
+        else:
+            out_row[:] = np.nan
+        return out_row
+
+    def _get_read_engine(self, process_n):
+        """
+        Returns the thread pool used for parallel reading. The pool lives
+        as long as the session and data files opened by its reads are kept
+        open until the session is closed.
+
+        Parameters
+        ----------
+        process_n: int
+            Number of reading threads
+
+        Returns
+        -------
+        read_engine: ThreadPoolExecutor
+        """
+        if self._read_engine is not None and self._read_engine_n != process_n:
+            self._read_engine.shutdown(wait=True)
+            self._read_engine = None
+
+        if self._read_engine is None:
+            self._read_engine = ThreadPoolExecutor(
+                process_n, thread_name_prefix='pymef_read')
+            self._read_engine_n = process_n
+
+        return self._read_engine
+
+    def _read_session_metadata(self):
+        if self.lazy:
+            return _LazySessionMetadata(self.path, self.password,
+                                        self.process_n)
+        return read_mef_session_metadata(
+            self.path, self.password, n_threads=self.process_n or 0,
+            check_password=self._check_all_passwords)
+
+    def _update_cache(self):
+        if self._cache is None or self.session_md is None:
+            return
+        if not self._cache.valid and not self._cache.load():
+            self._cache.write(self.session_md, self.get_channel_toc)
+
     def reload(self):
         self.close()
-        self.session_md = read_mef_session_metadata(self.path,
-                                                    self.password)
+        if self._cache is not None:
+            self._cache.load()
+        self.session_md = self._read_session_metadata()
+        self._update_cache()
 
     def close(self):
-        if self.session_md is not None:
+        if self._read_engine is not None:
+            self._read_engine.shutdown(wait=True)
+            self._read_engine = None
+            self._read_engine_n = None
+        if isinstance(self.session_md, _LazySessionMetadata):
+            self.session_md.clean()
+            self.session_md = None
+        elif self.session_md is not None:
             clean_mef_session_metadata(
                 self.session_md['session_specific_metadata'])
             self.session_md = None
@@ -556,7 +799,8 @@ class MefSession():
     def write_mef_ts_segment_data(self, channel, segment_n,
                                   password_1, password_2,
                                   samps_per_mef_block,
-                                  data):
+                                  data, process_n=None, scale=1.0,
+                                  lossy_params=None, target_block_bytes=None):
         """
         Writes new time series data in the specified segment
 
@@ -571,9 +815,35 @@ class MefSession():
         password_2: str
             Level 2 password
         samps_per_mef_block: int
-            Number of samples per mef block
+            Number of samples per mef block, the maximum block length with
+            target_block_bytes
         data: np.array
-            1-D numpy array of type int32
+            1-D numpy array of integer or float type, may be a strided view.
+            Samples are converted block by block, rounded and clipped to
+            the int32 range.
+        process_n: int
+            How many threads use for block encoding (default=None - number
+            of CPUs)
+        scale: float
+            Factor the samples are multiplied by before rounding
+            (default=1.0)
+        lossy_params: dict
+            Lossy RED compression settings, lossless if None (default).
+            Keys: mode ('mean_residual_ratio' or 'compression_ratio'),
+            goal_mean_residual_ratio, goal_compression_ratio,
+            goal_tolerance, detrend_data, require_normality
+        target_block_bytes: int
+            Adaptive block sizing, blocks are closed when their estimated
+            size reaches target_block_bytes (0 - no byte target) or where
+            the signal statistics change (default=None - fixed blocks)
+
+        Returns
+        -------
+        report: dict
+            bytes_per_sample - achieved compressed bytes per sample,
+            block_compression_ratios - compressed / original bytes of each
+            block, block_mean_residual_ratios - achieved mean residual
+            ratio of each block (lossy only)
         """
 
         segment_path = (self.path+channel+'.timd/'
@@ -588,19 +858,24 @@ class MefSession():
         if os.path.exists(tdat_path):
             raise RuntimeError(f"Data file '{tdat_path}' already exists!")
 
-        # lossy compression flag - not used
-        write_mef_ts_data_and_indices(segment_path,
-                                      password_1,
-                                      password_2,
-                                      samps_per_mef_block,
-                                      data,
-                                      0)
+        return write_mef_ts_data_and_indices(segment_path,
+                                             password_1,
+                                             password_2,
+                                             samps_per_mef_block,
+                                             data,
+                                             int(lossy_params is not None),
+                                             process_n or 0,
+                                             scale,
+                                             lossy_params,
+                                             (-1 if target_block_bytes is None
+                                              else target_block_bytes))
 
     def append_mef_ts_segment_data(self, channel, segment_n,
                                    password_1, password_2,
                                    start_time, end_time,
                                    samps_per_mef_block,
-                                   data, discontinuity_flag=False):
+                                   data, discontinuity_flag=False, scale=1.0,
+                                   lossy_params=None):
         """
         Appends new time series metadata in the specified segment
 
@@ -621,9 +896,23 @@ class MefSession():
         samps_per_mef_block: int
             Number of samples per mef block
         data: np.array
-            1-D numpy array of type int32
+            1-D numpy array of integer or float type, may be a strided view.
+            Samples are converted block by block, rounded and clipped to
+            the int32 range.
         discontinuity_flag: bool
             Discontinuity flag for appended data.
+        scale: float
+            Factor the samples are multiplied by before rounding
+            (default=1.0)
+        lossy_params: dict
+            Lossy RED compression settings, lossless if None (default), see
+            write_mef_ts_segment_data
+
+        Returns
+        -------
+        report: dict
+            Compression report of the appended blocks, see
+            write_mef_ts_segment_data
         """
 
         segment_path = (self.path+channel+'.timd/'
@@ -640,15 +929,256 @@ class MefSession():
         else:
             discontinuity_flag = 0
 
-        # lossy compression flag - not used
-        append_ts_data_and_indices(segment_path,
-                                   password_1,
-                                   password_2,
-                                   start_time,
-                                   end_time,
-                                   samps_per_mef_block,
-                                   data,
-                                   discontinuity_flag)
+        return append_ts_data_and_indices(segment_path,
+                                          password_1,
+                                          password_2,
+                                          start_time,
+                                          end_time,
+                                          samps_per_mef_block,
+                                          data,
+                                          discontinuity_flag,
+                                          int(lossy_params is not None),
+                                          scale,
+                                          lossy_params)
+
+    def write_mef_ts_channels(self, channel_map, data,
+                              password_1, password_2, start_time,
+                              section_2_dict, section_3_dict,
+                              samps_per_mef_block=None, segment_n=0,
+                              process_n=None, scale=1.0):
+        """
+        Writes metadata, indices and data of a segment in multiple time
+        series channels. The channels are written concurrently.
+
+        Parameters
+        ----------
+        channel_map: list
+            List of channel names
+        data: np.array or list
+            2-D numpy array [channels, samples] or list of 1-D numpy
+            arrays, one per channel, of integer or float type. Rows are
+            converted block by block, the data are not copied.
+        password_1: str
+            Level 1 password
+        password_2: str
+            Level 2 password
+        start_time: int
+            Start time of the segment, same for all channels
+        section_2_dict: dict or list
+            Dictionary with user specified section_2 fields, same for all
+            channels, or list of dictionaries, one per channel
+        section_3_dict: dict or list
+            Dictionary with user specified section_3 fields, same for all
+            channels, or list of dictionaries, one per channel
+        samps_per_mef_block: int
+            Number of samples per mef block (default=None - channel
+            sampling frequency)
+        segment_n: int
+            Segment number (default=0)
+        process_n: int
+            How many channels are written at once (default=None - number
+            of CPUs)
+        scale: float
+            Factor the samples are multiplied by before rounding
+            (default=1.0)
+        """
+
+        if isinstance(channel_map, str):
+            channel_map = [channel_map]
+            if isinstance(data, np.ndarray) and data.ndim == 1:
+                data = [data]
+
+        if len(data) != len(channel_map):
+            raise RuntimeError('Data have to have one row per channel')
+
+        if isinstance(section_2_dict, dict):
+            section_2_dict = [section_2_dict] * len(channel_map)
+        if isinstance(section_3_dict, dict):
+            section_3_dict = [section_3_dict] * len(channel_map)
+
+        if (len(section_2_dict) != len(channel_map)
+                or len(section_3_dict) != len(channel_map)):
+            raise RuntimeError('Length of section_2 / section_3 list is not'
+                               ' equivalent to the length of channel map')
+
+        if process_n is not None and not isinstance(process_n, int):
+            raise RuntimeError('Process_n argument must be None or int')
+
+        n_cpus = os.cpu_count() or 1
+        if process_n is None:
+            process_n = n_cpus
+        process_n = max(1, min(process_n, len(channel_map)))
+
+        # the remaining cores encode blocks within the channels
+        block_threads = max(1, n_cpus // process_n)
+
+        def write_channel(i):
+            channel = channel_map[i]
+            channel_data = np.asarray(data[i])
+            fs = section_2_dict[i]['sampling_frequency']
+            end_time = int(start_time + (len(channel_data) / fs) * 1e6)
+
+            if samps_per_mef_block is None:
+                spmb = int(fs)
+            else:
+                spmb = samps_per_mef_block
+
+            self.write_mef_ts_segment_metadata(channel, segment_n,
+                                               password_1, password_2,
+                                               start_time, end_time,
+                                               section_2_dict[i],
+                                               section_3_dict[i])
+            self.write_mef_ts_segment_data(channel, segment_n,
+                                           password_1, password_2,
+                                           spmb, channel_data,
+                                           process_n=block_threads,
+                                           scale=scale)
+
+        # encoding runs without the GIL, threads are sufficient,
+        # list() re-raises errors from the channel writers
+        with ThreadPoolExecutor(max_workers=process_n) as executor:
+            list(executor.map(write_channel, range(len(channel_map))))
+
+    def open_ts_segment_writer(self, channel, segment_n,
+                               password_1, password_2, start_time,
+                               section_2_dict, section_3_dict,
+                               samps_per_mef_block, flush_blocks=100,
+                               process_n=None, scale=1.0):
+        """
+        Writes new time series metadata in the specified segment and
+        returns a writer appending data to the segment chunk by chunk.
+        Full blocks are written as they fill up, the rest of the data is
+        written when the writer is closed.
+
+        Parameters
+        ----------
+        channel: str
+            Channel name
+        segment_n: int
+            Segment number
+        password_1: str
+            Level 1 password
+        password_2: str
+            Level 2 password
+        start_time: int
+            Start time of the segment
+        section_2_dict: dict
+            Dictionary with user specified section_2 fileds
+        section_3_dict: dict
+            Dictionary with user specified section_3 fileds
+        samps_per_mef_block: int
+            Number of samples per mef block
+        flush_blocks: int
+            Number of blocks after which the file headers and metadata are
+            updated (default=100, 0 - only on flush() and close())
+        process_n: int
+            How many threads use for block encoding (default=None - number
+            of CPUs)
+        scale: float
+            Factor the samples are multiplied by before rounding
+            (default=1.0)
+
+        Returns
+        -------
+        writer: TsSegmentWriter
+            Writer with write(data), flush() and close() methods, data are
+            1-D numpy arrays of integer or float type. Can be used as
+            a context manager.
+        """
+
+        segment_path = (self.path+channel+'.timd/'
+                        + channel+'-'+str(segment_n).zfill(6)+'.segd/')
+
+        tdat_path = segment_path+channel+'-'+str(segment_n).zfill(6)+'.tdat'
+
+        if os.path.exists(tdat_path):
+            raise RuntimeError(f"Data file '{tdat_path}' already exists!")
+
+        # the end time is updated by the writer
+        self.write_mef_ts_segment_metadata(channel, segment_n,
+                                           password_1, password_2,
+                                           start_time, start_time,
+                                           section_2_dict, section_3_dict)
+
+        return TsSegmentWriter(segment_path, password_1, password_2,
+                               samps_per_mef_block, flush_blocks,
+                               process_n or 0, scale)
+
+    def write_mef_ts_segment_data_times(self, channel, segment_n,
+                                        password_1, password_2,
+                                        section_2_dict, section_3_dict,
+                                        samps_per_mef_block, data, times,
+                                        process_n=None):
+        """
+        Writes metadata, indices and data of a new segment with
+        discontinuities in one pass. Blocks are split at the gaps so that
+        the first block after each gap is flagged as a discontinuity.
+
+        Parameters
+        ----------
+        channel: str
+            Channel name
+        segment_n: int
+            Segment number
+        password_1: str
+            Level 1 password
+        password_2: str
+            Level 2 password
+        section_2_dict: dict
+            Dictionary with user specified section_2 fileds
+        section_3_dict: dict
+            Dictionary with user specified section_3 fileds
+        samps_per_mef_block: int
+            Number of samples per mef block
+        data: np.array or list
+            1-D numpy array of integer or float type or list of 1-D numpy
+            arrays (chunks)
+        times: np.array or list
+            uUTC timestamp of each sample if data is an array, start times
+            of the chunks if data is a list. Times have to be strictly
+            increasing, gaps of at least one sample period start a new
+            contiguous range.
+        process_n: int
+            How many threads use for block encoding (default=None - number
+            of CPUs)
+        """
+
+        fs = section_2_dict['sampling_frequency']
+        times = np.asarray(times, dtype=np.int64)
+
+        if not len(times):
+            raise RuntimeError('No timestamps, there is no data to write')
+        if np.any(np.diff(times) <= 0):
+            raise RuntimeError('Timestamps have to be strictly increasing')
+
+        if isinstance(data, np.ndarray):
+            if len(times) != len(data):
+                raise RuntimeError('Number of timestamps has to be equal to'
+                                   ' the number of samples')
+            # chunk boundaries where the sample spacing exceeds the period
+            period = 1e6 / fs
+            breaks = np.flatnonzero(np.diff(times) - period >= period) + 1
+            chunks = np.split(data, breaks)
+            chunk_times = times[np.concatenate([[0], breaks])]
+        else:
+            if len(times) != len(data):
+                raise RuntimeError('Number of chunk start times has to be'
+                                   ' equal to the number of chunks')
+            chunks = data
+            chunk_times = times
+
+        writer = self.open_ts_segment_writer(channel, segment_n,
+                                             password_1, password_2,
+                                             int(chunk_times[0]),
+                                             section_2_dict, section_3_dict,
+                                             samps_per_mef_block,
+                                             flush_blocks=0,
+                                             process_n=process_n)
+        with writer:
+            # chunks go to the writer as they are, it converts and clips
+            # any integer or float type
+            for chunk, chunk_time in zip(chunks, chunk_times):
+                writer.write(np.asarray(chunk), int(chunk_time))
 
     def write_mef_v_segment_metadata(self, channel, segment_n,
                                      password_1, password_2,
@@ -896,9 +1426,12 @@ class MefSession():
 
     def create_slice_session(self, slice_session_path, slice_start_stop,
                              password_1, password_2, samps_per_mef_block=None,
-                             time_unit='uutc'):
+                             time_unit='uutc', process_n=None, progress=None):
         """
         Function to create slice of the mef session (time series only).
+        Blocks lying entirely within the slice are copied without decoding,
+        only the samples of the partially covered blocks at the edges of
+        the slice and of its contiguous ranges are re-encoded.
 
         Parameters
         ----------
@@ -911,8 +1444,20 @@ class MefSession():
         password_2: str
             Level 2 password
         samps_per_mef_block: int
-            Number of samples for mef block. Default=channel sampling
-            frequency
+            Number of samples for re-encoded mef blocks. Default=channel
+            sampling frequency
+        process_n: int
+            How many channels are sliced concurrently (default=None -
+            number of CPUs)
+        progress: callable
+            Called as progress(channel, n_done, n_channels) each time
+            a channel is finished (default=None)
+
+        Notes
+        -----
+        Encrypted blocks are copied only if the passwords of the slice
+        match the passwords they were encrypted with, otherwise they are
+        decoded and re-encoded.
         """
 
         if not slice_session_path.endswith('/'):
@@ -924,119 +1469,170 @@ class MefSession():
         if not any([isinstance(x, (int, np.int32, np.int64)) for x in slice_start_stop]):
             raise ValueError("Start and stop must be integers.")
 
-        channels_dict = self.session_md['time_series_channels']
+        slice_start, slice_stop = [int(x) for x in slice_start_stop]
+
+        if process_n is not None and not isinstance(process_n, int):
+            raise RuntimeError('Process_n argument must be None or int')
+
+        channels = list(self.session_md['time_series_channels'].keys())
+        if not len(channels):
+            return
+
+        if process_n is None:
+            process_n = os.cpu_count() or 1
+        process_n = max(1, min(process_n, len(channels)))
+
+        # channels are independent, reading, encoding and copying run
+        # without the GIL so threads are sufficient. The segment writers
+        # hold the meflib globals with their recording time offset while
+        # encoding, channels with different offsets are encoded in turn.
+        with ThreadPoolExecutor(max_workers=process_n) as executor:
+            futures = {executor.submit(self._slice_channel, channel,
+                                       slice_session_path, slice_start,
+                                       slice_stop, password_1, password_2,
+                                       samps_per_mef_block): channel
+                       for channel in channels}
+            for n_done, future in enumerate(as_completed(futures), 1):
+                # re-raises errors from the channel
+                future.result()
+                if progress is not None:
+                    progress(futures[future], n_done, len(channels))
+
+    def _slice_channel(self, channel, slice_session_path, slice_start,
+                       slice_stop, password_1, password_2,
+                       samps_per_mef_block):
+        """
+        Writes the slice of one channel into the first segment of the channel
+        in the slice session, see create_slice_session.
+        """
 
         segment_n = 0
-        for channel, ch_md in channels_dict.items():
-            
-            toc = self.get_channel_toc(channel)
-            
-            toc_start_idx = np.where(toc[0] == 1)[0]
-            toc_start_times = toc[-1, toc_start_idx]
-            toc_stop_times = toc[-1, toc_start_idx[1:]-1] + ((toc[1, toc_start_idx[1:]-1]/5000)*1e6).astype(int)
-            toc_stop_times = np.concatenate([toc_stop_times, self.session_md['session_specific_metadata']['latest_end_time']])
-            
-            toc_slices = np.stack([toc_start_times, toc_stop_times], axis=1)
-            toc_slices = toc_slices[((toc_slices[:, 1] > slice_start_stop[0])
-                                     & (toc_slices[:, 0] < slice_start_stop[1]))]
-
-            if toc_slices[0, 0] < slice_start_stop[0]:
-                toc_slices[0, 0] = slice_start_stop[0]
-
-            if toc_slices[-1, 1] > slice_start_stop[1]:
-                toc_slices[-1, 1] = slice_start_stop[1]
-
-            segment_path = (slice_session_path+channel+'.timd/'
-                            + channel+'-'+str(segment_n).zfill(6)+'.segd/')
-            
-            os.makedirs(segment_path, exist_ok=True)
-
-            tmet_path = (segment_path+channel+'-'+str(segment_n).zfill(6)
-                         + '.tmet')
-
-            if os.path.exists(tmet_path):
-                raise RuntimeError('Metadata file '+tmet_path
-                                   + ' already exists!')
-
-            section_2 = ch_md['section_2'].copy()
+        ch_md = self.session_md['time_series_channels'][channel]
+        section_2 = ch_md['section_2'].copy()
+        fs = float(section_2['sampling_frequency'][0])
 
-            if samps_per_mef_block is None:
-                spmb = int(section_2['sampling_frequency'][0])
-            else:
-                spmb = samps_per_mef_block
+        toc = self.get_channel_toc(channel)
+        block_ends = toc[3] + ((toc[1] / fs) * 1e6).astype('int64')
 
-            is_first_write = True
-            
-            for ss in toc_slices:
+        # contiguous ranges of blocks within the slice
+        range_firsts = np.where(toc[0] == 1)[0]
+        range_lasts = np.concatenate([range_firsts[1:],
+                                      [toc.shape[1]]]) - 1
+        in_slice = ((block_ends[range_lasts] > slice_start)
+                    & (toc[3, range_firsts] < slice_stop))
 
-                if is_first_write is True:
-                
-                    # Zero out the machine generated fields
-                    section_2['recording_duration'] = toc_slices[-1, -1] - toc_slices[0, 0]
-                    section_2['maximum_native_sample_value'] = 0.0
-                    section_2['minimum_native_sample_value'] = 0.0
-                    section_2['number_of_blocks'] = 0
-                    section_2['maximum_block_bytes'] = 0
-                    section_2['maximum_block_samples'] = 0
-                    section_2['maximum_difference_bytes'] = 0
-                    section_2['block_interval'] = 0
-                    section_2['maximum_contiguous_blocks'] = 0
-                    section_2['maximum_contiguous_block_bytes'] = 0
-                    section_2['maximum_contiguous_samples'] = 0
-                    section_2['number_of_samples'] = 0
-                
-                    section_3 = ch_md['section_3'].copy()
+        segment_path = (slice_session_path+channel+'.timd/'
+                        + channel+'-'+str(segment_n).zfill(6)+'.segd/')
 
-                    write_mef_ts_metadata(segment_path,
-                                          password_1,
-                                          password_2,
-                                          slice_start_stop[0],
-                                          slice_start_stop[1],
-                                          section_2,
-                                          section_3)
+        os.makedirs(segment_path, exist_ok=True)
 
-                    data = self.read_ts_channels_uutc(channel, [int(x) for x in ss])
-                
-                    tdat_path = (segment_path+channel+'-'+str(segment_n).zfill(6)
-                                 + '.tdat')
-                
-                    if os.path.exists(tdat_path):
-                        raise RuntimeError('Data file '+tdat_path+' already exists!')
+        tmet_path = (segment_path+channel+'-'+str(segment_n).zfill(6)
+                     + '.tmet')
 
-                    if np.sum(np.isnan(data)) == len(data):
-                        print(f"Signal of channel {channel} in time {ss} is empty. Skipping...")
-                        continue
-                
-                    # lossy compression flag - not used
-                    write_mef_ts_data_and_indices(segment_path,
-                                                  password_1,
-                                                  password_2,
-                                                  spmb,
-                                                  data.astype('int32'),
-                                                  0)
-                    
-                    is_first_write = False
-                        
-                else:
-                    
-                    data = self.read_ts_channels_uutc(channel, [int(x) for x in ss])
-                    if np.sum(np.isnan(data)) == len(data):
-                        print(f"Signal of channel {channel} in time {ss} is empty. Skipping...")
-                        continue
-                    append_ts_data_and_indices(segment_path,
-                                               password_1,
-                                               password_2,
-                                               int(ss[0]),
-                                               int(ss[1]),
-                                               spmb,
-                                               data.astype('int32'),
-                                               True)
+        if os.path.exists(tmet_path):
+            raise RuntimeError('Metadata file '+tmet_path
+                               + ' already exists!')
+
+        if not np.any(in_slice):
+            print(f"No data written for channel {channel}. Deleting...")
+            shutil.rmtree(slice_session_path+channel+'.timd/')
+            return
+
+        if samps_per_mef_block is None:
+            spmb = int(section_2['sampling_frequency'][0])
+        else:
+            spmb = samps_per_mef_block
+
+        # Zero out the machine generated fields
+        section_2['recording_duration'] = slice_stop - slice_start
+        section_2['maximum_native_sample_value'] = 0.0
+        section_2['minimum_native_sample_value'] = 0.0
+        section_2['number_of_blocks'] = 0
+        section_2['maximum_block_bytes'] = 0
+        section_2['maximum_block_samples'] = 0
+        section_2['maximum_difference_bytes'] = 0
+        section_2['block_interval'] = 0
+        section_2['maximum_contiguous_blocks'] = 0
+        section_2['maximum_contiguous_block_bytes'] = 0
+        section_2['maximum_contiguous_samples'] = 0
+        section_2['number_of_samples'] = 0
+
+        # the recording time offset is kept so that the blocks can be
+        # copied as they are
+        section_3 = ch_md['section_3'].copy()
 
-            # Once finished check if we have written any data at all
-            if not os.path.exists(tdat_path):
-                print(f"No data written for channel {channel}. Deleting...")
-                shutil.rmtree(slice_session_path+channel+'.timd/')
+        write_mef_ts_metadata(segment_path,
+                              password_1,
+                              password_2,
+                              slice_start,
+                              slice_stop,
+                              section_2,
+                              section_3)
 
+        channel_md = self._get_channel_md(channel)
+
+        def sample_at(t, first, last):
+            # first sample at or after time t within the range
+            b = first + np.searchsorted(toc[3, first:last+1], t,
+                                        side='right') - 1
+            b = min(max(b, first), last)
+            offset = int(np.ceil((t - toc[3, b]) * fs / 1e6))
+            return int(toc[2, b] + min(max(offset, 0), toc[1, b]))
+
+        def time_of(sample, first, last):
+            b = first + np.searchsorted(toc[2, first:last+1], sample,
+                                        side='right') - 1
+            b = min(max(b, first), last)
+            return int(toc[3, b] + ((sample - toc[2, b]) / fs) * 1e6)
+
+        def write_samples(writer, start, stop, first, last):
+            # samples of missing or corrupted blocks are not written, the
+            # samples after them start a new contiguous range
+            data, gaps = read_mef_ts_data(channel_md, start, stop,
+                                          int32_output=True,
+                                          use_mmap=self.use_mmap)
+            piece_start = 0
+            for gap_start, gap_stop in list(gaps) + [[len(data), len(data)]]:
+                if gap_start > piece_start:
+                    writer.write(data[piece_start:gap_start],
+                                 time_of(start + piece_start, first, last))
+                piece_start = gap_stop
+
+        with TsSegmentWriter(segment_path, password_1, password_2,
+                             spmb, 0, 1) as writer:
+
+            for first, last in zip(range_firsts[in_slice],
+                                   range_lasts[in_slice]):
+
+                start = sample_at(slice_start, first, last)
+                stop = sample_at(slice_stop, first, last)
+
+                # blocks covered entirely by the slice
+                covered = np.arange(first, last+1)
+                covered = covered[(toc[2, covered] >= start)
+                                  & (toc[2, covered] + toc[1, covered]
+                                     <= stop)]
+
+                pieces = [[start, stop]]
+                if len(covered):
+                    copy_start = int(toc[2, covered[0]])
+                    copy_stop = int(toc[2, covered[-1]]
+                                    + toc[1, covered[-1]])
+                    pieces = [[start, copy_start], [copy_stop, stop]]
+
+                if pieces[0][1] > pieces[0][0]:
+                    write_samples(writer, *pieces[0], first, last)
+
+                if len(covered):
+                    if not writer.copy_blocks(channel_md,
+                                              int(covered[0]),
+                                              len(covered)):
+                        # encrypted with different passwords
+                        write_samples(writer, copy_start, copy_stop,
+                                      first, last)
+
+                    if pieces[1][1] > pieces[1][0]:
+                        write_samples(writer, *pieces[1], first, last)
 
     # ----- Data reading functions -----
     def _create_dict_record(self, np_record):
@@ -1225,7 +1821,68 @@ class MefSession():
 
         return python_dict_list
 
-    def get_channel_toc(self, channel):
+    def read_record_table(self, channel=None, segment_n=None,
+                          channel_type='ts'):
+        """
+        Returns MEF records as columnar numpy tables grouped by record
+        type. Unlike read_records no python object is created per record.
+
+        Parameters
+        ----------
+        channel: str
+            Session channel, if not specified, session records will be read
+            (default = None)
+        segment_n: int
+            Segment number, if not specified, channel records will be read
+            (default = None)
+        channel_type: str
+            Type of the channel - "ts" time series, "v" video
+            (default = "ts")
+
+        Returns
+        -------
+        record_table: dict
+            Dictionary keyed by record type ("Note", "Seiz", ...), each
+            entry is a dictionary with:
+            - records - structured array with time, type_string and body
+              fields, one row per record
+            - text - uint8 buffer with the texts of Note, SyLg and EDFA
+              records, record i is
+              text[body['text_offset'][i]:][:body['text_length'][i]]
+            - template - int32 buffer with the LNTP templates
+              (body['template_offset'], body['length'])
+            - channels - array of the Seiz record channels
+              (body['channel_offset'], body['number_of_channels'])
+        """
+
+        if channel is None and segment_n is not None:
+            raise ValueError('Channel has to be set if segment is set')
+
+        dir_path = self.path
+        if channel is not None:
+            if channel_type == 'ts':
+                dir_path += channel+'.timd/'
+            elif channel_type == 'v':
+                dir_path += channel+'.vidd/'
+            else:
+                raise ValueError('Invalid channel_type, allowed options are:'
+                                 '"ts" or "v"')
+            if not os.path.exists(dir_path):
+                raise ValueError("No channel %s in this session" % channel)
+        if segment_n is not None:
+            segment = channel+'-'+str(segment_n).zfill(6)
+            dir_path += segment+'.segd/'
+            if not os.path.exists(dir_path):
+                raise ValueError("No segment %s in this session" % segment)
+
+        level_name = os.path.basename(dir_path[:-1]).rsplit('.', 1)[0]
+        records_path = dir_path + level_name + '.rdat'
+        if not os.path.exists(records_path):
+            return {}
+
+        return read_mef_record_table(records_path, self.password)
+
+    def get_channel_toc(self, channel, ranges_only=False):
         """
         Returns discontinuities accross segments.
 
@@ -1233,6 +1890,8 @@ class MefSession():
         ----------
         channel: str
             Channel to calculate TOC on
+        ranges_only: bool
+            Return only the contiguous ranges of the channel (default=False)
 
         Returns
         -------
@@ -1242,24 +1901,20 @@ class MefSession():
               - [1,:] = n block samples
               - [2,:] = start samples
               - [3,:] = start uutc times
+            or with ranges_only
+              - [0,:] = range start uutc times
+              - [1,:] = range end uutc times
+              - [2,:] = n range samples
         """
 
-        channel_md = self.session_md['time_series_channels'][channel]
-        toc = np.empty([4, 0], dtype='int64')
-
-        # Sort the segments to eliminate dictionary randomness
-        segs = list(channel_md['segments'].keys())
-        segs.sort()
-        for segment_name in segs:
-            seg_toc = channel_md['segments'][segment_name]['TOC']
+        if self._cache is not None and self._cache.has_channel(channel):
+            return self._cache.get_channel_toc(channel, ranges_only)
 
-            # Join into channel TOC
-            toc = np.concatenate([toc, seg_toc], axis=1)
+        return read_mef_channel_toc(self._get_channel_md(channel),
+                                    ranges_only=ranges_only)
 
-
-        return toc
-
-    def read_ts_channels_sample(self, channel_map, sample_map, process_n=None):
+    def read_ts_channels_sample(self, channel_map, sample_map, process_n=None,
+                                scaled=False):
         """
         Reads desired channels in desired sample segment
 
@@ -1272,7 +1927,10 @@ class MefSession():
             to channel_map. if there is only one entry the same range is
             applied to all channels
         process_n: int
-            How many processes use for reading (default=None)
+            How many threads use for reading (default=None)
+        scaled: bool
+            Multiply the data by units_conversion_factor while decoding
+            (default=False)
 
         Returns
         -------
@@ -1306,16 +1964,16 @@ class MefSession():
             raise RuntimeError('Process_n argument must be None or int')
 
         if process_n is not None:
-            mp = Pool(process_n)
-
             iterator = []
             for channel, sample_ss in zip(channel_map, sample_map):
 
                 iterator.append([self._get_channel_md(channel),
-                                 sample_ss[0], sample_ss[1]])
+                                 sample_ss[0], sample_ss[1], False, True,
+                                 False, False, None, scaled, self.use_mmap])
 
-            data_list = mp.map(self._arg_merger, iterator)
-            mp.terminate()
+            # read_mef_ts_data releases the GIL, threads are sufficient
+            read_engine = self._get_read_engine(process_n)
+            data_list = list(read_engine.map(self._arg_merger, iterator))
             if is_chan_str:
                 return data_list[0]
             else:
@@ -1323,7 +1981,8 @@ class MefSession():
 
         for channel, sample_ss in zip(channel_map, sample_map):
             data = read_mef_ts_data(self._get_channel_md(channel),
-                                    sample_ss[0], sample_ss[1])
+                                    sample_ss[0], sample_ss[1],
+                                    scaled=scaled, use_mmap=self.use_mmap)
             data_list.append(data)
 
         if is_chan_str:
@@ -1332,7 +1991,7 @@ class MefSession():
             return data_list
 
     def read_ts_channels_uutc(self, channel_map, uutc_map, process_n=None,
-                              out_nans=True):
+                              out_nans=True, out=None, scaled=False):
         """
         Reads desired channels in desired time segment. Missing data at
         discontinuities are filled with NaNs.
@@ -1346,10 +2005,19 @@ class MefSession():
             to channel_map. if there is only one entry the same range is
             applied to all channels
         process_n: int
-            How many processes use for reading (defualt = None)
+            How many threads use for reading (defualt = None)
         out_nans: bool
             Whether to return an array of np.nan if the uutc times for
             channel are completely out of start and end times
+        out: np.array or list
+            Preallocated writable output - 2D array [channels, samples] or
+            list of 1D arrays (1D array when channel_map is str). int32,
+            float32 and float64 outputs, including strided views, are
+            filled in place, missing int32 samples are RED_NAN
+            (-2**31) (default=None)
+        scaled: bool
+            Multiply the data by units_conversion_factor while decoding
+            (default=False)
 
         Returns
         -------
@@ -1382,25 +2050,42 @@ class MefSession():
         if process_n is not None and not isinstance(process_n, int):
             raise RuntimeError('Process_n argument must be Nnoe or int')
 
-        if process_n is not None:
-            mp = Pool(process_n)
+        if out is None:
+            out_rows = [None] * len(channel_map)
+        elif is_chan_str and isinstance(out, np.ndarray) and out.ndim == 1:
+            out_rows = [out]
+        else:
+            if len(out) != len(channel_map):
+                raise RuntimeError('Output has to have one row per channel')
+            out_rows = [out[i] for i in range(len(channel_map))]
 
+        if process_n is not None:
             iterator = []
-            for channel, sample_ss in zip(channel_map, uutc_map):
+            for channel, sample_ss, out_row in zip(channel_map, uutc_map,
+                                                   out_rows):
                 iterator.append([self._get_channel_md(channel),
-                                 sample_ss[0], sample_ss[1], True])
-
-            data_list = mp.map(self._arg_merger, iterator)
-            mp.terminate()
+                                 sample_ss[0], sample_ss[1], True, True,
+                                 False, False, out_row, scaled,
+                                 self.use_mmap])
+
+            # read_mef_ts_data releases the GIL, threads are sufficient
+            read_engine = self._get_read_engine(process_n)
+            data_list = list(read_engine.map(self._arg_merger, iterator))
+            for i, out_row in enumerate(out_rows):
+                if out_row is not None and data_list[i] is None:
+                    data_list[i] = self._fill_missing(out_row)
             if is_chan_str:
                 return data_list[0]
             else:
                 return data_list
 
-        for channel, uutc_ss in zip(channel_map, uutc_map):
+        for channel, uutc_ss, out_row in zip(channel_map, uutc_map, out_rows):
             data = read_mef_ts_data(self._get_channel_md(channel),
-                                    uutc_ss[0], uutc_ss[1], True)
-            if out_nans and data is None:
+                                    uutc_ss[0], uutc_ss[1], True, out=out_row,
+                                    scaled=scaled, use_mmap=self.use_mmap)
+            if out_row is not None and data is None:
+                data = self._fill_missing(out_row)
+            elif out_nans and data is None:
                 channel_md = self.session_md['time_series_channels'][channel]
                 size = ((np.diff(uutc_ss) / 1e6)[0] * channel_md['section_2']['sampling_frequency'][0])
                 data = np.empty(int(size))
@@ -1412,6 +2097,87 @@ class MefSession():
         else:
             return data_list
 
+    def read_ts_channels_array(self, channel_map, start_stop,
+                               time_unit='uutc', process_n=None,
+                               scaled=False):
+        """
+        Reads desired channels in one window into a single 2D array. The
+        channels are decoded in parallel and the data are written directly
+        into the output array.
+
+        Parameters
+        ----------
+        channel_map: str or list
+            Channel or list of channels to be read
+        start_stop: list
+            [start, stop] of the window, same for all channels. None reads
+            from the start / to the end of the channels.
+        time_unit: str
+            'uutc' or 'sample' (default='uutc')
+        process_n: int
+            How many threads use for reading (default=None - number of CPUs)
+        scaled: bool
+            Multiply the data by units_conversion_factor of each channel
+            while decoding (default=False)
+
+        Returns
+        -------
+        data: np.array(dtype=np.float64)
+            Numpy array [channels, samples]. Missing data (gaps, out of
+            recording, lower sampling frequency channels) are filled with NaNs
+        """
+
+        if not isinstance(channel_map, (list, np.ndarray, str)):
+            raise TypeError('Channel map has to be list, array or str')
+
+        if isinstance(channel_map, str):
+            channel_map = [channel_map]
+
+        if time_unit not in ('uutc', 'sample'):
+            raise RuntimeError("Time unit has to be 'uutc' or 'sample'")
+
+        if process_n is not None and not isinstance(process_n, int):
+            raise RuntimeError('Process_n argument must be None or int')
+
+        channel_mds = [self._get_channel_md(channel)
+                       for channel in channel_map]
+
+        return read_mef_ts_data_channels(channel_mds,
+                                         start_stop[0], start_stop[1],
+                                         times_specified=time_unit == 'uutc',
+                                         n_threads=process_n or 0,
+                                         keep_files_open=True,
+                                         use_mmap=self.use_mmap,
+                                         scaled=scaled)
+
+    def iter_ts_channel(self, channel, chunk_samples=None,
+                        sample_ss=(None, None)):
+        """
+        Iterates over time series data of a channel in chunks. Data are
+        decoded block by block so the memory used does not depend on the
+        length of the channel.
+
+        Parameters
+        ----------
+        channel: str
+            Channel to be read
+        chunk_samples: int
+            Number of samples in each chunk, the last chunk can be shorter
+            (default=None - one chunk per MEF block)
+        sample_ss: list
+            [start, stop] samples to be iterated over (default=[None, None] -
+            the whole channel)
+
+        Returns
+        -------
+        iterator: TsDataIterator
+            Iterator yielding np.array(dtype=np.float64) chunks
+        """
+
+        return TsDataIterator(self._get_channel_md(channel),
+                              chunk_samples or 0,
+                              sample_ss[0], sample_ss[1])
+
     def read_ts_channel_basic_info(self):
         """
         Reads session time series channel names
@@ -1435,16 +2201,22 @@ class MefSession():
         channel_infos = []
         for channel in channel_list:
 
-            channel_md = self.session_md['time_series_channels'][channel]
-            channel_md_spec = channel_md['channel_specific_metadata']
-            channel_md_s2 = channel_md['section_2']
+            if self._cache is not None and self._cache.has_channel(channel):
+                channel_md_s2 = self._cache.get_section_2(channel)
+                times = self._cache.get_times(channel)
+                start_time = times[0:1]
+                end_time = times[1:2]
+            else:
+                channel_md = self.session_md['time_series_channels'][channel]
+                channel_md_spec = channel_md['channel_specific_metadata']
+                channel_md_s2 = channel_md['section_2']
+                start_time = channel_md_spec['earliest_start_time']
+                end_time = channel_md_spec['latest_end_time']
 
             fsamp = channel_md_s2['sampling_frequency']
             nsamp = channel_md_s2['number_of_samples']
             ufact = channel_md_s2['units_conversion_factor']
             unit = channel_md_s2['units_description']
-            start_time = channel_md_spec['earliest_start_time']
-            end_time = channel_md_spec['latest_end_time']
             ch_desc = channel_md_s2['channel_description']
 
             channel_infos.append({'name': channel, 'fsamp': fsamp,
@@ -19,6 +19,7 @@ United States
 """
 
 # Standard library imports
+import os
 import unittest
 import tempfile
 import warnings
@@ -619,6 +620,62 @@ class TestStringMethods(unittest.TestCase):
         self.assertEqual(np.sum(self.raw_data_all),
                          np.sum(read_data))
 
+    def test_time_series_data_threads(self):
+
+        channels = [self.ts_channel] * 4
+        read_data = self.ms.read_ts_channels_sample(channels,
+                                                    [None, None],
+                                                    process_n=4)
+
+        for data in read_data:
+            self.assertEqual(np.sum(self.raw_data_all),
+                             np.sum(data))
+
+    def test_read_engine_reuse(self):
+
+        channels = [self.ts_channel] * 2
+        self.ms.read_ts_channels_uutc(channels, [None, None], process_n=2)
+        read_engine = self.ms._read_engine
+        read_data = self.ms.read_ts_channels_uutc(channels, [None, None],
+                                                  process_n=2)
+
+        self.assertIs(read_engine, self.ms._read_engine)
+        for data in read_data:
+            self.assertEqual(np.nansum(self.raw_data_all),
+                             np.nansum(data))
+
+    def test_time_series_data_array(self):
+
+        channels = [self.ts_channel] * 3
+        read_data = self.ms.read_ts_channels_array(channels,
+                                                   [None, None],
+                                                   time_unit='sample',
+                                                   process_n=2)
+
+        self.assertEqual((3, len(self.raw_data_all)), read_data.shape)
+        for data in read_data:
+            self.assertEqual(np.sum(self.raw_data_all),
+                             np.sum(data))
+
+    def test_time_series_data_iterator(self):
+
+        chunks = list(self.ms.iter_ts_channel(self.ts_channel,
+                                              chunk_samples=3000))
+        read_data = np.concatenate(chunks)
+
+        self.assertEqual(len(self.raw_data_all), len(read_data))
+        self.assertTrue(np.array_equal(self.raw_data_all, read_data))
+        self.assertTrue(all(len(chunk) == 3000 for chunk in chunks[:-1]))
+
+        # Block aligned chunks from the middle of the channel
+        start = self.samps_per_mef_block + 100
+        end = 3 * self.samps_per_mef_block
+        chunks = list(self.ms.iter_ts_channel(self.ts_channel,
+                                              sample_ss=[start, end]))
+        self.assertEqual(self.samps_per_mef_block - 100, len(chunks[0]))
+        self.assertTrue(np.array_equal(self.raw_data_all[start:end],
+                                       np.concatenate(chunks)))
+
     # ----- Data reading tests -----
 
     # Reading by sample
@@ -830,6 +887,131 @@ class TestStringMethods(unittest.TestCase):
 
         self.assertEqual(N_nans, read_N_nans)
 
+    def test_uutc_in_second_segment(self):
+
+        seg2_start = int(self.end_time + (1e6*self.secs_to_append)
+                         + int(1e6*self.discont_length))
+
+        start = int(seg2_start + 1e6)
+        end = int(seg2_start + 2e6)
+
+        data = self.ms.read_ts_channels_uutc(self.ts_channel,
+                                             [start, end])
+
+        fs = self.sampling_frequency
+        self.assertTrue(np.array_equal(self.raw_data_seg_2[fs:2*fs], data))
+
+    def test_int32_output_gaps(self):
+
+        discont_start_time = int(self.end_time) + int(1e6*self.secs_to_append)
+
+        start = int(discont_start_time - 5e5)
+        end = int(discont_start_time + 5e5)
+
+        channel_md = self.ms._get_channel_md(self.ts_channel)
+        data, gaps = pymef3_file.read_mef_ts_data(channel_md, start, end,
+                                                  True, int32_output=True)
+        ref_data = self.ms.read_ts_channels_uutc(self.ts_channel,
+                                                 [start, end])
+
+        self.assertEqual(np.int32, data.dtype)
+        N_nans = int((5e5 / 1e6) * self.sampling_frequency)
+        self.assertEqual([[len(data) - N_nans, len(data)]], gaps.tolist())
+        valid = ~np.isnan(ref_data)
+        self.assertTrue(np.array_equal(ref_data[valid], data[valid]))
+
+        _, mask = pymef3_file.read_mef_ts_data(channel_md, start, end,
+                                               True, int32_output=True,
+                                               gap_mask=True)
+        self.assertTrue(np.array_equal(~valid, mask))
+
+    def test_preallocated_output(self):
+
+        start = int(self.start_time + 1e6)
+        end = int(self.start_time + 2e6)
+
+        ref_data = self.ms.read_ts_channels_uutc(self.ts_channel, [start, end])
+
+        # Strided views into a bigger buffer
+        buffer = np.zeros([2, 2 * len(ref_data)], np.float32)
+        out = buffer[:, ::2]
+        data = self.ms.read_ts_channels_uutc([self.ts_channel,
+                                              self.ts_channel],
+                                             [start, end], out=out)
+        self.assertTrue(np.shares_memory(data[1], buffer))
+        self.assertTrue(np.array_equal(ref_data.astype(np.float32), out[0]))
+        self.assertTrue(np.array_equal(out[0], out[1]))
+        self.assertTrue(np.all(buffer[:, 1::2] == 0))
+
+        out = np.zeros(len(ref_data), np.int32)
+        channel_md = self.ms._get_channel_md(self.ts_channel)
+        pymef3_file.read_mef_ts_data(channel_md, start, end, True, out=out)
+        self.assertTrue(np.array_equal(ref_data, out))
+
+        try:
+            pymef3_file.read_mef_ts_data(channel_md, start, end, True,
+                                         out=np.zeros(len(ref_data) + 1))
+            self.fail('Output of wrong length accepted')
+        except RuntimeError:
+            pass
+
+    def test_preallocated_output_out_of_file(self):
+
+        start = int(self.start_time - 3e6)
+        end = int(self.start_time - 2e6)
+        n_samples = int(self.sampling_frequency)
+
+        # int32 outputs get RED_NAN instead of NaNs
+        out = np.zeros([2, n_samples], np.int32)
+        self.ms.read_ts_channels_uutc([self.ts_channel, self.ts_channel],
+                                      [start, end], out=out)
+        self.assertTrue(np.all(out == np.iinfo(np.int32).min))
+        out = np.zeros([2, n_samples], np.int32)
+        self.ms.read_ts_channels_uutc([self.ts_channel, self.ts_channel],
+                                      [start, end], out=out, process_n=2)
+        self.assertTrue(np.all(out == np.iinfo(np.int32).min))
+
+        out = np.zeros(n_samples, np.float32)
+        self.ms.read_ts_channels_uutc(self.ts_channel, [start, end], out=out)
+        self.assertTrue(np.all(np.isnan(out)))
+
+    def test_scaled_output(self):
+
+        ufact = self.smd['time_series_channels'][self.ts_channel]['section_2']['units_conversion_factor']
+
+        ref_data = self.ms.read_ts_channels_sample(self.ts_channel, [0, 5000])
+        data = self.ms.read_ts_channels_sample(self.ts_channel, [0, 5000],
+                                               scaled=True)
+        self.assertTrue(np.allclose(ref_data * ufact, data))
+
+        channel_md = self.ms._get_channel_md(self.ts_channel)
+        data = pymef3_file.read_mef_ts_data(channel_md, 0, 5000, scaled=True,
+                                            float32_output=True)
+        self.assertEqual(np.float32, data.dtype)
+        self.assertTrue(np.allclose(ref_data * ufact, data))
+
+        data = self.ms.read_ts_channels_array([self.ts_channel], [0, 5000],
+                                              time_unit='sample',
+                                              scaled=True)
+        self.assertTrue(np.allclose(ref_data * ufact, data[0]))
+
+    def test_mmap_reading(self):
+
+        ms = MefSession(self.mef_session_path, self.pwd_2, use_mmap=True)
+
+        start = int(self.start_time + 1e6)
+        end = int(self.start_time + 2e6)
+
+        ref_data = self.ms.read_ts_channels_uutc(self.ts_channel, [start, end])
+        data = ms.read_ts_channels_uutc(self.ts_channel, [start, end])
+        self.assertTrue(np.array_equal(ref_data, data, equal_nan=True))
+
+        ref_data = self.ms.read_ts_channels_sample(self.ts_channel, [0, None])
+        data = ms.read_ts_channels_sample(self.ts_channel, [0, None])
+        self.assertTrue(np.array_equal(ref_data, data, equal_nan=True))
+
+        ms.close()
+
     def test_start_uutc_bigger_than_end_uutc(self):
         error_text = 'Start time later than end time, exiting...'
 
@@ -840,6 +1022,519 @@ class TestStringMethods(unittest.TestCase):
         except Exception as e:
             self.assertEqual(error_text, str(e))
 
+    def test_parallel_block_encoding(self):
+
+        tdat_bytes = []
+        for channel, process_n in [('ts_serial', 1), ('ts_parallel', 3)]:
+            self.ms.write_mef_ts_segment_metadata(channel, 0,
+                                                  self.pwd_1, self.pwd_2,
+                                                  self.start_time,
+                                                  self.end_time,
+                                                  self.section2_ts_dict,
+                                                  self.section3_dict)
+            self.ms.write_mef_ts_segment_data(channel, 0,
+                                              self.pwd_1, self.pwd_2,
+                                              self.samps_per_mef_block,
+                                              self.raw_data,
+                                              process_n=process_n)
+
+            tdat_path = (self.mef_session_path + '/' + channel + '.timd/'
+                         + channel + '-000000.segd/'
+                         + channel + '-000000.tdat')
+            with open(tdat_path, 'rb') as f:
+                # skip the universal header - it has a random file UUID
+                tdat_bytes.append(f.read()[1024:])
+
+        self.assertEqual(tdat_bytes[0], tdat_bytes[1])
+
+    def test_write_ts_channels(self):
+
+        channels = ['ts_multi_1', 'ts_multi_2', 'ts_multi_3']
+        data = np.stack([self.raw_data, self.raw_data // 2,
+                         -self.raw_data])
+
+        self.ms.write_mef_ts_channels(channels, data,
+                                      self.pwd_1, self.pwd_2,
+                                      self.start_time,
+                                      self.section2_ts_dict,
+                                      self.section3_dict,
+                                      samps_per_mef_block=self.samps_per_mef_block,
+                                      process_n=2)
+
+        ms = MefSession(self.mef_session_path, self.pwd_2)
+        read_data = ms.read_ts_channels_sample(channels, [None, None])
+        for i in range(len(channels)):
+            self.assertTrue(np.array_equal(data[i], read_data[i]))
+        ms.close()
+
+    def test_write_ts_channels_offsets(self):
+
+        # channels with different recording time offsets encoded at once
+        # must not pick up each other's offset
+        channels = ['ts_offset_1', 'ts_offset_2']
+        data = np.stack([self.raw_data, -self.raw_data])
+        section3 = [dict(self.section3_dict), dict(self.section3_dict)]
+        section3[1]['recording_time_offset'] = self.rec_offset - int(1e6)
+
+        with tempfile.TemporaryDirectory() as temp_path:
+            session_path = temp_path + '/offsets.mefd'
+            ms = MefSession(session_path, self.pwd_1, new_session=True)
+            ms.write_mef_ts_channels(channels, data,
+                                     self.pwd_1, self.pwd_2,
+                                     self.start_time,
+                                     self.section2_ts_dict,
+                                     section3,
+                                     samps_per_mef_block=self.samps_per_mef_block,
+                                     process_n=2)
+
+            ms = MefSession(session_path, self.pwd_2)
+            read_data = ms.read_ts_channels_sample(channels, [None, None])
+            tocs = [ms.get_channel_toc(x) for x in channels]
+            ms.close()
+
+        for i in range(len(channels)):
+            self.assertTrue(np.array_equal(data[i], read_data[i]))
+        self.assertEqual(self.start_time, tocs[0][3][0])
+        self.assertTrue(np.array_equal(tocs[0][3], tocs[1][3]))
+
+    def test_ts_segment_writer(self):
+
+        channel = 'ts_streamed'
+        writer = self.ms.open_ts_segment_writer(channel, 0,
+                                                self.pwd_1, self.pwd_2,
+                                                self.start_time,
+                                                self.section2_ts_dict,
+                                                self.section3_dict,
+                                                self.samps_per_mef_block,
+                                                flush_blocks=3)
+        with writer:
+            for i in range(0, len(self.raw_data), 1234):
+                writer.write(self.raw_data[i:i+1234])
+
+        ms = MefSession(self.mef_session_path, self.pwd_2)
+        read_data = ms.read_ts_channels_sample(channel, [None, None])
+        self.assertTrue(np.array_equal(self.raw_data, read_data))
+        ms.close()
+
+    def test_ts_segment_writer_red_nan(self):
+
+        # RED_NAN in int32 chunks marks missing samples, it is not clipped
+        channel = 'ts_red_nan'
+        data = self.raw_data.copy()
+        data[100:200] = np.iinfo(np.int32).min
+        with tempfile.TemporaryDirectory() as temp_path:
+            session_path = temp_path + '/red_nan.mefd'
+            ms = MefSession(session_path, self.pwd_1, new_session=True)
+            writer = ms.open_ts_segment_writer(channel, 0,
+                                               self.pwd_1, self.pwd_2,
+                                               self.start_time,
+                                               self.section2_ts_dict,
+                                               self.section3_dict,
+                                               self.samps_per_mef_block)
+            with warnings.catch_warnings():
+                warnings.simplefilter('error')
+                with writer:
+                    writer.write(data)
+
+            ms = MefSession(session_path, self.pwd_2)
+            read_data = ms.read_ts_channels_sample(channel, [None, None])
+            ms.close()
+
+        self.assertTrue(np.all(np.isnan(read_data[100:200])))
+        valid = ~np.isnan(read_data)
+        self.assertEqual(len(data) - 100, valid.sum())
+        self.assertTrue(np.array_equal(data[valid], read_data[valid]))
+
+    def test_write_ts_data_times(self):
+
+        channel = 'ts_gapped'
+        fs = self.section2_ts_dict['sampling_frequency']
+        n = len(self.raw_data)
+        times = self.start_time + (np.arange(n) * 1e6 / fs).astype(np.int64)
+        # 10 s dropouts after a third and after two thirds of the data
+        times[n // 3:] += int(10e6)
+        times[2 * n // 3:] += int(10e6)
+
+        self.ms.write_mef_ts_segment_data_times(channel, 0,
+                                                self.pwd_1, self.pwd_2,
+                                                self.section2_ts_dict,
+                                                self.section3_dict,
+                                                self.samps_per_mef_block,
+                                                self.raw_data, times)
+
+        ms = MefSession(self.mef_session_path, self.pwd_2)
+        toc = ms.get_channel_toc(channel)
+        self.assertEqual(3, toc[0].sum())
+        disc_samples = toc[2][toc[0] == 1]
+        self.assertTrue(np.array_equal([0, n // 3, 2 * n // 3],
+                                       disc_samples))
+        self.assertTrue(np.array_equal(times[disc_samples],
+                                       toc[3][toc[0] == 1]))
+
+        ranges = ms.get_channel_toc(channel, ranges_only=True)
+        self.assertEqual((3, 3), ranges.shape)
+        self.assertTrue(np.array_equal(times[disc_samples], ranges[0]))
+        self.assertTrue(np.array_equal([n // 3, n // 3, n - 2 * (n // 3)],
+                                       ranges[2]))
+        read_data = ms.read_ts_channels_sample(channel, [None, None])
+        self.assertTrue(np.array_equal(self.raw_data, read_data))
+        ms.close()
+
+        # empty and non-monotonic timestamps are rejected
+        for data, bad_times in [(self.raw_data[:0], times[:0]),
+                                (self.raw_data, times[::-1])]:
+            with self.assertRaises(RuntimeError):
+                self.ms.write_mef_ts_segment_data_times(
+                    'ts_bad_times', 0, self.pwd_1, self.pwd_2,
+                    self.section2_ts_dict, self.section3_dict,
+                    self.samps_per_mef_block, data, bad_times)
+
+    def test_write_ts_data_types(self):
+
+        # strided int64 row of a [samp, ch] matrix, float data with scale
+        matrix = np.stack([self.raw_data.astype(np.int64),
+                           -self.raw_data.astype(np.int64)], axis=1)
+        float_data = self.raw_data / 4.0
+
+        channels = ['ts_int64_strided', 'ts_float_scaled']
+        for channel in channels:
+            self.ms.write_mef_ts_segment_metadata(channel, 0,
+                                                  self.pwd_1, self.pwd_2,
+                                                  self.start_time,
+                                                  self.end_time,
+                                                  self.section2_ts_dict,
+                                                  self.section3_dict)
+
+        self.ms.write_mef_ts_segment_data(channels[0], 0,
+                                          self.pwd_1, self.pwd_2,
+                                          self.samps_per_mef_block,
+                                          matrix[:, 1])
+        self.ms.write_mef_ts_segment_data(channels[1], 0,
+                                          self.pwd_1, self.pwd_2,
+                                          self.samps_per_mef_block,
+                                          float_data, scale=4.0)
+
+        ms = MefSession(self.mef_session_path, self.pwd_2)
+        read_data = ms.read_ts_channels_sample(channels, [None, None])
+        self.assertTrue(np.array_equal(-self.raw_data, read_data[0]))
+        self.assertTrue(np.array_equal(self.raw_data, read_data[1]))
+        ms.close()
+
+    def test_compression_report(self):
+
+        channels = ['ts_report_lossless', 'ts_report_lossy']
+        for channel in channels:
+            self.ms.write_mef_ts_segment_metadata(channel, 0,
+                                                  self.pwd_1, self.pwd_2,
+                                                  self.start_time,
+                                                  self.end_time,
+                                                  self.section2_ts_dict,
+                                                  self.section3_dict)
+
+        report = self.ms.write_mef_ts_segment_data(channels[0], 0,
+                                                   self.pwd_1, self.pwd_2,
+                                                   self.samps_per_mef_block,
+                                                   self.raw_data)
+        n_blocks = int(np.ceil(len(self.raw_data)
+                               / self.samps_per_mef_block))
+        tdat_path = (self.mef_session_path + channels[0]
+                     + '.timd/' + channels[0] + '-000000.segd/'
+                     + channels[0] + '-000000.tdat')
+        data_bytes = os.path.getsize(tdat_path) - 1024
+        self.assertAlmostEqual(data_bytes / len(self.raw_data),
+                               report['bytes_per_sample'])
+        self.assertEqual(n_blocks, len(report['block_compression_ratios']))
+        self.assertNotIn('block_mean_residual_ratios', report)
+
+        lossy_params = {'mode': 'mean_residual_ratio',
+                        'goal_mean_residual_ratio': 0.2,
+                        'goal_tolerance': 0.02}
+        report = self.ms.write_mef_ts_segment_data(channels[1], 0,
+                                                   self.pwd_1, self.pwd_2,
+                                                   self.samps_per_mef_block,
+                                                   self.raw_data,
+                                                   lossy_params=lossy_params)
+        self.assertEqual(n_blocks,
+                         len(report['block_mean_residual_ratios']))
+
+    def test_adaptive_block_sizing(self):
+
+        channel = 'ts_adaptive_blocks'
+        self.ms.write_mef_ts_segment_metadata(channel, 0,
+                                              self.pwd_1, self.pwd_2,
+                                              self.start_time,
+                                              self.end_time,
+                                              self.section2_ts_dict,
+                                              self.section3_dict)
+        # quiet first half, noisy second half
+        data = self.raw_data.copy()
+        data[:len(data) // 2] //= 100
+        data[len(data) // 2:] *= 100
+
+        report = self.ms.write_mef_ts_segment_data(channel, 0,
+                                                   self.pwd_1, self.pwd_2,
+                                                   self.samps_per_mef_block,
+                                                   data,
+                                                   target_block_bytes=2000)
+
+        ms = MefSession(self.mef_session_path, self.pwd_2)
+        toc = ms.get_channel_toc(channel)
+        seg_md = ms.session_md['time_series_channels'][channel]['segments']
+        tmd2 = list(seg_md.values())[0]['section_2']
+        self.assertEqual(toc[1].max(), tmd2['maximum_block_samples'][0])
+        self.assertTrue(toc[1].max() <= self.samps_per_mef_block)
+        self.assertEqual(len(report['block_compression_ratios']),
+                         toc.shape[1])
+        self.assertEqual(1, toc[0].sum())
+        read_data = ms.read_ts_channels_sample(channel, [None, None])
+        self.assertTrue(np.array_equal(data, read_data))
+        ms.close()
+
+    def test_create_slice_session(self):
+
+        # slice edges fall inside blocks, the blocks in between are copied
+        slice_start = self.start_time + int(1.2345e6)
+        slice_stop = self.start_time + int(7.89e6)
+        data = self.ms.read_ts_channels_uutc(self.ts_channel,
+                                             [slice_start, slice_stop])
+
+        with tempfile.TemporaryDirectory(suffix='.mefd') as slice_path:
+            self.ms.create_slice_session(slice_path,
+                                         [slice_start, slice_stop],
+                                         self.pwd_1, self.pwd_2)
+
+            ms = MefSession(slice_path, self.pwd_2)
+            slice_data = ms.read_ts_channels_uutc(self.ts_channel,
+                                                  [slice_start, slice_stop])
+            ms.close()
+
+        self.assertTrue(np.array_equal(data, slice_data))
+
+    def test_create_slice_session_block_times(self):
+
+        # the session has a non-zero recording time offset, the copied
+        # blocks have to keep their times and follow the decoded edge
+        self.assertNotEqual(self.rec_offset, 0)
+        slice_start = self.start_time + int(1.2345e6)
+        slice_stop = self.start_time + int(7.89e6)
+        toc = self.ms.get_channel_toc(self.ts_channel)
+
+        with tempfile.TemporaryDirectory(suffix='.mefd') as slice_path:
+            self.ms.create_slice_session(slice_path,
+                                         [slice_start, slice_stop],
+                                         self.pwd_1, self.pwd_2)
+
+            ms = MefSession(slice_path, self.pwd_2)
+            slice_toc = ms.get_channel_toc(self.ts_channel)
+            ms.close()
+
+        block_times = slice_toc[3]
+        self.assertGreaterEqual(block_times[0], slice_start)
+        self.assertLess(block_times[-1], slice_stop)
+        self.assertTrue(np.all(np.diff(block_times) > 0))
+        self.assertTrue(np.all(np.isin(block_times[1:-1], toc[3])))
+
+    def test_create_slice_session_parallel(self):
+
+        slice_start = self.start_time + int(2e6)
+        slice_stop = self.start_time + int(4.5e6)
+        channels = list(self.ms.session_md['time_series_channels'].keys())
+        reports = []
+
+        with tempfile.TemporaryDirectory(suffix='.mefd') as slice_path:
+            self.ms.create_slice_session(slice_path,
+                                         [slice_start, slice_stop],
+                                         self.pwd_1, self.pwd_2,
+                                         process_n=4,
+                                         progress=lambda *x: reports.append(x))
+
+            ms = MefSession(slice_path, self.pwd_2)
+            for channel in ms.session_md['time_series_channels']:
+                data = self.ms.read_ts_channels_uutc(channel,
+                                                     [slice_start, slice_stop])
+                slice_data = ms.read_ts_channels_uutc(channel,
+                                                      [slice_start, slice_stop])
+                self.assertTrue(np.array_equal(data, slice_data,
+                                               equal_nan=True))
+            ms.close()
+
+        self.assertEqual(sorted(channels), sorted(x[0] for x in reports))
+        self.assertEqual(list(range(1, len(channels) + 1)),
+                         [x[1] for x in reports])
+
+    def test_channel_toc(self):
+
+        # channel TOC is the concatenation of the segment TOCs
+        channel_md = self.ms.session_md['time_series_channels'][self.ts_channel]
+        segs = sorted(channel_md['segments'].keys())
+        seg_toc = np.concatenate([channel_md['segments'][x]['TOC']
+                                  for x in segs], axis=1)
+        toc = self.ms.get_channel_toc(self.ts_channel)
+        self.assertTrue(np.array_equal(seg_toc, toc))
+
+        ranges = self.ms.get_channel_toc(self.ts_channel, ranges_only=True)
+        self.assertEqual(toc[0].sum(), ranges.shape[1])
+        self.assertEqual(toc[1].sum(), ranges[2].sum())
+        self.assertTrue(np.array_equal(toc[3][toc[0] == 1], ranges[0]))
+
+    def test_channel_toc_contiguous_segments(self):
+
+        # a segment that continues the previous one does not start a range
+        channel = 'ts_two_segments'
+        section_2 = self.section2_ts_dict.copy()
+        section_2['start_sample'] = len(self.raw_data)
+        with tempfile.TemporaryDirectory() as temp_path:
+            ms = MefSession(temp_path + '/segments.mefd', self.pwd_1,
+                            new_session=True)
+            ms.write_mef_ts_segment_metadata(channel, 0,
+                                             self.pwd_1, self.pwd_2,
+                                             self.start_time, self.end_time,
+                                             self.section2_ts_dict,
+                                             self.section3_dict)
+            ms.write_mef_ts_segment_data(channel, 0,
+                                         self.pwd_1, self.pwd_2,
+                                         self.samps_per_mef_block,
+                                         self.raw_data)
+            ms.write_mef_ts_segment_metadata(channel, 1,
+                                             self.pwd_1, self.pwd_2,
+                                             self.end_time,
+                                             2 * self.end_time
+                                             - self.start_time,
+                                             section_2,
+                                             self.section3_dict)
+            ms.write_mef_ts_segment_data(channel, 1,
+                                         self.pwd_1, self.pwd_2,
+                                         self.samps_per_mef_block,
+                                         self.raw_data)
+
+            ms = MefSession(temp_path + '/segments.mefd', self.pwd_2)
+            toc = ms.get_channel_toc(channel)
+            ranges = ms.get_channel_toc(channel, ranges_only=True)
+            seg_toc = ms.session_md['time_series_channels'][channel][
+                'segments'][channel + '-000001']['TOC']
+            ms.close()
+
+            cache_path = temp_path + '/cache'
+            MefSession(temp_path + '/segments.mefd', self.pwd_2,
+                       cache=cache_path).close()
+            ms = MefSession(temp_path + '/segments.mefd', self.pwd_2,
+                            cache=cache_path)
+            cached_ranges = ms.get_channel_toc(channel, ranges_only=True)
+            ms.close()
+
+        # the TOC keeps the flag on the first block of every segment
+        self.assertEqual(2, toc[0].sum())
+        self.assertEqual(1, seg_toc[0][0])
+        self.assertEqual([[self.start_time], [2 * self.end_time
+                                              - self.start_time],
+                          [2 * len(self.raw_data)]], ranges.tolist())
+        self.assertEqual(ranges.tolist(), cached_ranges.tolist())
+
+    def test_lazy_session(self):
+
+        ms = MefSession(self.mef_session_path, self.pwd_2, lazy=True)
+        ts_channels = ms.session_md['time_series_channels']
+        self.assertIn(self.ts_channel, ts_channels)
+        self.assertFalse(ts_channels.is_loaded(self.ts_channel))
+
+        data = ms.read_ts_channels_sample(self.ts_channel, [None, None])
+        self.assertTrue(ts_channels.is_loaded(self.ts_channel))
+        self.assertEqual(np.sum(self.raw_data_all), np.sum(data))
+
+        # session level metadata are read with the whole session
+        self.assertEqual(
+            self.ms.session_md['session_specific_metadata']['earliest_start_time'][0],
+            ms.session_md['session_specific_metadata']['earliest_start_time'][0])
+        ms.close()
+
+    def test_session_metadata_threads(self):
+
+        ms = MefSession(self.mef_session_path, self.pwd_2, process_n=4)
+        ts_channels = ms.session_md['time_series_channels']
+        self.assertEqual(sorted(self.ms.session_md['time_series_channels']),
+                         sorted(ts_channels))
+        self.assertTrue(np.array_equal(
+            self.ms.get_channel_toc(self.ts_channel),
+            ms.get_channel_toc(self.ts_channel)))
+        ms.close()
+
+    def test_metadata_cache(self):
+
+        with tempfile.TemporaryDirectory() as cache_path:
+            ms = MefSession(self.mef_session_path, self.pwd_2,
+                            cache=cache_path)
+            self.assertTrue(os.path.exists(os.path.join(cache_path,
+                                                        'manifest.json')))
+            toc = ms.get_channel_toc(self.ts_channel)
+            info = ms.read_ts_channel_basic_info()
+            ms.close()
+
+            # reopened from the cache, the channels are read on demand
+            ms = MefSession(self.mef_session_path, self.pwd_2,
+                            cache=cache_path)
+            self.assertTrue(ms.lazy)
+            ts_channels = ms.session_md['time_series_channels']
+            self.assertTrue(np.array_equal(
+                toc, ms.get_channel_toc(self.ts_channel)))
+            cached_info = ms.read_ts_channel_basic_info()
+            self.assertFalse(ts_channels.is_loaded(self.ts_channel))
+            self.assertEqual([x['nsamp'] for x in info],
+                             [x['nsamp'] for x in cached_info])
+            self.assertEqual([x['start_time'] for x in info],
+                             [x['start_time'] for x in cached_info])
+            ms.close()
+
+            # no protected subject metadata in the cache
+            self.assertFalse(os.path.exists(os.path.join(cache_path,
+                                                         'section_3.npy')))
+
+            # a level 1 password does not get the level 2 cache
+            ms = MefSession(self.mef_session_path, self.pwd_1,
+                            cache=cache_path)
+            self.assertFalse(ms.lazy)
+            ms.close()
+
+    def test_record_table(self):
+
+        read_records = self.ms.read_records('ts_channel', 0)
+        record_table = self.ms.read_record_table('ts_channel', 0)
+
+        self.assertEqual(len(read_records),
+                         sum(len(x['records']) for x in record_table.values()))
+
+        for rec_type, table in record_table.items():
+            type_records = [x for x in read_records if x['type'] == rec_type]
+            records = table['records']
+            self.assertEqual(len(type_records), len(records))
+            self.assertTrue(np.all(records['type_string'] == rec_type.encode()))
+            for i, read_record in enumerate(type_records):
+                self.assertEqual(read_record['time'], records['time'][i])
+                body = records['body'][i]
+                if 'text' in table:
+                    text = table['text'][body['text_offset']:]
+                    text = text[:body['text_length']].tobytes().decode()
+                    self.assertEqual(read_record['text'], text)
+                if rec_type == 'Seiz':
+                    first = body['channel_offset']
+                    channels = table['channels'][
+                        first:first+body['number_of_channels']]
+                    self.assertEqual([x['name'] for x in
+                                      read_record['channels']],
+                                     [x.decode() for x in channels['name']])
+                    self.assertEqual(read_record['annotation'],
+                                     body['annotation'].decode())
+                if rec_type == 'Curs':
+                    self.assertEqual(read_record['id_number'],
+                                     body['id_number'])
+
+        # session level records
+        record_table = self.ms.read_record_table()
+        self.assertEqual(len(self.ms.read_records()),
+                         sum(len(x['records']) for x in record_table.values()))
+
+        with self.assertRaises(ValueError):
+            self.ms.read_record_table('ts_channel', 100)
+
     def test_append_nonexistent_segment(self):
         error_text = "Data file '"+self.ms.path+"ts_channel.timd/ts_channel-000005.segd/ts_channel-000005.tdat' does not exist!"
 
@@ -875,6 +1570,27 @@ class TestStringMethods(unittest.TestCase):
         result = pymef3_file.check_mef_password(ts_metadata_file, self.pwd_2)
         self.assertEqual(2, result)
 
+    def test_session_passwords(self):
+        mef_files = []
+        for path, subdirs, files in os.walk(self.mef_session_path):
+            mef_files += [os.path.join(path, x) for x in files
+                          if x.rsplit('.', 1)[-1] in ('tmet', 'tidx', 'tdat')]
+
+        for n_threads in (0, 4):
+            result = pymef3_file.check_mef_passwords(mef_files, self.pwd_2,
+                                                     n_threads=n_threads)
+            self.assertEqual(2, result)
+            result = pymef3_file.check_mef_passwords(mef_files, 'bu',
+                                                     n_threads=n_threads)
+            self.assertEqual(-1, result)
+
+        # the check folded into the metadata read
+        with self.assertRaises(RuntimeError):
+            pymef3_file.read_mef_session_metadata(self.mef_session_path,
+                                                  'bu', check_password=True)
+        with self.assertRaises(RuntimeError):
+            MefSession(self.mef_session_path, 'bu')
+
 
 if __name__ == '__main__':
     unittest.main()